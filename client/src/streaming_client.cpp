@@ -3,8 +3,13 @@
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <iomanip>
 #include <cstring>
+#include <memory>
+#include <mutex>
 #include <fstream>
 #include <cstdlib>  // for getenv
 
@@ -51,6 +56,8 @@ public:
         bool decode_frames = true;
         bool display_stats = true;
         HardwareDecodeMode hw_decode = HardwareDecodeMode::AUTO;
+        size_t ring_size = 4;      // Encoded frames queued for the decode thread
+        bool drop_frames = true;   // Render the newest frame only; false renders every frame (QA)
     };
     
     StreamingClient() 
@@ -58,7 +65,16 @@ public:
         , connected_(false)
         , decoder_context_(nullptr)
         , av_frame_(nullptr)
-        , av_packet_(nullptr) {
+        , av_packet_(nullptr)
+        , pending_frame_(nullptr)
+        , display_frame_(nullptr)
+        , download_frame_(nullptr)
+        , has_pending_frame_(false)
+        , hw_pix_fmt_(AV_PIX_FMT_NONE)
+        , packet_pool_(nullptr)
+        , packet_pool_buffer_size_(0)
+        , rx_begin_(0)
+        , rx_end_(0) {
         
         // Initialize stats
         stats_.frames_received = 0;
@@ -69,12 +85,16 @@ public:
         stats_.hw_decode_frames = 0;
         stats_.sw_decode_frames = 0;
         stats_.hw_decode_active = false;
+        stats_.frames_rendered = 0;
+        stats_.frames_dropped = 0;
         stats_start_time_ = std::chrono::steady_clock::now();
     }
     
     ~StreamingClient() {
+        stop();
         disconnect();
         cleanup_decoder();
+        av_buffer_pool_uninit(&packet_pool_);
     }
     
     bool connect_to_server(const Config& config) {
@@ -104,6 +124,14 @@ public:
         server_addr.sin_family = AF_INET;
         server_addr.sin_port = htons(config.server_port);
         
+        // A deep kernel buffer rides out decode hiccups without stalling
+        // the server; set before connect so the window scales to it
+        int receive_buffer_size = 4 * 1024 * 1024;
+        if (setsockopt(socket_fd_, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&receive_buffer_size),
+                       sizeof(receive_buffer_size)) < 0) {
+            BLUSTREAM_LOG_WARN("Could not set socket receive buffer size");
+        }
+        
         if (inet_pton(AF_INET, config.server_ip.c_str(), &server_addr.sin_addr) <= 0) {
             BLUSTREAM_LOG_ERROR("Invalid server IP address");
             close(socket_fd_);
@@ -130,8 +158,11 @@ public:
         
         // Receive initial configuration
         BLUSTREAM_LOG_INFO("Waiting for config header from server...");
+        rx_buffer_.resize(READAHEAD_SIZE);
+        rx_begin_ = 0;
+        rx_end_ = 0;
         common::MessageHeader header;
-        ssize_t bytes_received = recv(socket_fd_, &header, sizeof(header), MSG_WAITALL);
+        ssize_t bytes_received = receive_exact(&header, sizeof(header));
         if (bytes_received != sizeof(header)) {
             BLUSTREAM_LOG_ERROR("Failed to receive config header. Got " + std::to_string(bytes_received) + " bytes, expected " + std::to_string(sizeof(header)));
             if (bytes_received > 0) {
@@ -157,7 +188,7 @@ public:
         }
         
         common::StreamConfig stream_config;
-        if (recv(socket_fd_, &stream_config, sizeof(stream_config), MSG_WAITALL) != sizeof(stream_config)) {
+        if (receive_exact(&stream_config, sizeof(stream_config)) != sizeof(stream_config)) {
             BLUSTREAM_LOG_ERROR("Failed to receive stream config");
             disconnect();
             return false;
@@ -172,9 +203,13 @@ public:
         
         stream_config_ = stream_config;
         
-        // Initialize H.264 parameter sets (SPS + PPS from server)
-        // These are extracted from the I-frame and needed for all subsequent frames
-        initialize_parameter_sets();
+        // Parameter sets arrive in-band with the first keyframe, which the
+        // server sends straight after the config
+        sps_pps_headers_.clear();
+        connect_time_ = std::chrono::steady_clock::now();
+        first_frame_logged_ = false;
+        report_ = ReportState();
+        report_.interval_start = connect_time_;
         
         // Initialize decoder if requested
         if (config.decode_frames) {
@@ -195,6 +230,8 @@ public:
         
         BLUSTREAM_LOG_INFO("Starting to receive frames...");
         
+        ring_ = std::make_unique<PacketRing>(std::max<size_t>(2, config_.ring_size));
+        decode_thread_ = std::thread(&StreamingClient::decode_loop, this);
         receive_thread_ = std::thread(&StreamingClient::receive_loop, this);
         
         // Start stats display thread if requested
@@ -210,6 +247,11 @@ public:
             receive_thread_.join();
         }
         
+        // The receive loop closes the ring on exit, which ends decoding
+        if (decode_thread_.joinable()) {
+            decode_thread_.join();
+        }
+        
         if (stats_thread_.joinable()) {
             stats_thread_.join();
         }
@@ -230,6 +272,104 @@ public:
     }
     
 private:
+    // Encoded frames between the receive and decode threads. Small, so a
+    // slow decode costs a few frames of latency at most: a keyframe makes
+    // everything queued before it stale, and a full ring is emptied and
+    // decoding resumes at the next keyframe.
+    class PacketRing {
+    public:
+        explicit PacketRing(size_t capacity) : head_(0), count_(0), closed_(false), discontinuity_(false) {
+            for (size_t i = 0; i < capacity; i++) {
+                slots_.push_back(av_packet_alloc());
+            }
+        }
+        
+        ~PacketRing() {
+            for (AVPacket*& slot : slots_) {
+                av_packet_free(&slot);
+            }
+        }
+        
+        // Takes over packet's reference; returns how many queued frames were
+        // discarded. keep_all waits for room instead of discarding.
+        size_t push(AVPacket* packet, bool keep_all) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (keep_all) {
+                not_full_.wait(lock, [this]() { return count_ < slots_.size() || closed_; });
+            }
+            if (closed_) {
+                av_packet_unref(packet);
+                return 0;
+            }
+            
+            size_t discarded = 0;
+            if (!keep_all && count_ > 0 && (packet->flags & AV_PKT_FLAG_KEY)) {
+                discarded = discard_front(count_);
+            } else if (count_ == slots_.size()) {
+                // Later frames reference the queued ones, so all of them go
+                discarded = discard_front(count_);
+                discontinuity_ = true;
+            }
+            
+            av_packet_move_ref(at(count_), packet);
+            count_++;
+            not_empty_.notify_one();
+            return discarded;
+        }
+        
+        // Waits for the oldest frame; false once closed and drained.
+        // discontinuity reports frames discarded since the last pop.
+        bool pop(AVPacket* packet, bool& discontinuity) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this]() { return count_ > 0 || closed_; });
+            if (count_ == 0) {
+                return false;
+            }
+            av_packet_move_ref(packet, at(0));
+            head_ = (head_ + 1) % slots_.size();
+            count_--;
+            discontinuity = discontinuity_;
+            discontinuity_ = false;
+            not_full_.notify_one();
+            return true;
+        }
+        
+        void close() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            not_empty_.notify_all();
+            not_full_.notify_all();
+        }
+        
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return count_;
+        }
+        
+    private:
+        AVPacket* at(size_t index) const { return slots_[(head_ + index) % slots_.size()]; }
+        
+        size_t discard_front(size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                av_packet_unref(at(0));
+                head_ = (head_ + 1) % slots_.size();
+                count_--;
+            }
+            return n;
+        }
+        
+        std::vector<AVPacket*> slots_;
+        size_t head_;
+        size_t count_;
+        bool closed_;
+        bool discontinuity_;
+        mutable std::mutex mutex_;
+        std::condition_variable not_empty_;
+        std::condition_variable not_full_;
+    };
+    
+    static constexpr size_t READAHEAD_SIZE = 256 * 1024;
+    
     Config config_;
     common::StreamConfig stream_config_;
     int socket_fd_;
@@ -237,32 +377,113 @@ private:
     
     // Threads
     std::thread receive_thread_;
+    std::thread decode_thread_;
     std::thread stats_thread_;
+    std::unique_ptr<PacketRing> ring_;
     
     // Decoder
     AVCodecContext* decoder_context_;
     AVFrame* av_frame_;
     AVPacket* av_packet_;
     
+    // Decode thread only. The pending frame is the newest decoded picture,
+    // the display frame the one last presented; download_frame_ holds a
+    // hardware frame copied to memory for debug dumps.
+    AVFrame* pending_frame_;
+    AVFrame* display_frame_;
+    AVFrame* download_frame_;
+    bool has_pending_frame_;
+    bool awaiting_keyframe_ = false;
+    std::atomic<bool> keyframe_wanted_{false};  // Set by the decode thread, sent with the next receiver report
+    AVPixelFormat hw_pix_fmt_;  // Surface format of the hardware device, NONE for software
+    
+    // Receive thread only: pooled packet payloads and socket readahead
+    AVBufferPool* packet_pool_;
+    size_t packet_pool_buffer_size_;
+    std::vector<uint8_t> rx_buffer_;
+    size_t rx_begin_;
+    size_t rx_end_;
+    
     // H.264 parameter sets for decoding
     std::vector<uint8_t> sps_pps_headers_;
     
-    void initialize_parameter_sets() {
-        // SPS (Sequence Parameter Set) + PPS (Picture Parameter Set) 
-        // Extracted from the I-frame for Phase 4 server
-        const uint8_t sps_pps[] = {
-            // SPS NAL unit (28 bytes)
-            0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x28,
-            0xac, 0xb6, 0x03, 0xc0, 0x11, 0x3f, 0x2c, 0x20,
-            0x00, 0x00, 0x03, 0x00, 0x20, 0x00, 0x00, 0x07,
-            0x91, 0xe3, 0x06, 0x5c,
-            // PPS NAL unit (12 bytes)  
-            0x00, 0x00, 0x00, 0x01, 0x68, 0xea, 0xcc, 0xb2,
-            0x2c, 0x00, 0x00, 0x01
-        };
-        
-        sps_pps_headers_.assign(sps_pps, sps_pps + sizeof(sps_pps));
-        BLUSTREAM_LOG_INFO("✓ H.264 parameter sets initialized (" + std::to_string(sps_pps_headers_.size()) + " bytes)");
+    std::chrono::steady_clock::time_point connect_time_;
+    bool first_frame_logged_ = false;
+    
+    // Receiver report bookkeeping; receive thread only
+    struct ReportState {
+        bool have_frame = false;
+        uint32_t last_sequence = 0;
+        uint32_t last_timestamp = 0;  // Server clock, echoed back for RTT
+        std::chrono::steady_clock::time_point last_frame_time;
+        std::chrono::steady_clock::time_point interval_start;
+        uint32_t frames_received = 0;
+        uint32_t frames_lost = 0;
+        uint32_t bytes_received = 0;
+    } report_;
+    
+    // True if the first slice is an IDR; the scan stops at the first slice
+    static bool starts_with_keyframe(const uint8_t* data, size_t size) {
+        for (size_t i = 0; i + 3 < size; i++) {
+            if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+                const int type = data[i + 3] & 0x1f;
+                if (type >= 1 && type <= 5) {
+                    return type == 5;
+                }
+                i += 2;
+            }
+        }
+        return false;
+    }
+    
+    static int nal_type_at(const uint8_t* data, size_t size, size_t offset) {
+        return offset < size ? (data[offset] & 0x1f) : -1;
+    }
+    
+    // Calls fn(nal_start, nal_payload_offset) for every Annex B NAL unit
+    template <typename Fn>
+    static void for_each_nal(const uint8_t* data, size_t size, Fn fn) {
+        size_t i = 0;
+        while (i + 3 <= size) {
+            if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+                size_t start = (i > 0 && data[i - 1] == 0) ? i - 1 : i;
+                fn(start, i + 3);
+                i += 3;
+            } else {
+                i++;
+            }
+        }
+    }
+    
+    // Remembers the SPS/PPS a keyframe carries; returns true if the frame
+    // has its own parameter sets and false if it needs the cached ones
+    bool update_parameter_sets(const uint8_t* data, size_t size, bool& is_idr) {
+        std::vector<size_t> starts;
+        std::vector<int> types;
+        for_each_nal(data, size, [&](size_t start, size_t payload) {
+            starts.push_back(start);
+            types.push_back(nal_type_at(data, size, payload));
+        });
+        
+        is_idr = false;
+        std::vector<uint8_t> parameter_sets;
+        for (size_t n = 0; n < starts.size(); n++) {
+            size_t end = n + 1 < starts.size() ? starts[n + 1] : size;
+            if (types[n] == 7 || types[n] == 8) {
+                parameter_sets.insert(parameter_sets.end(), data + starts[n], data + end);
+            } else if (types[n] == 5) {
+                is_idr = true;
+            }
+        }
+        
+        if (parameter_sets.empty()) {
+            return false;
+        }
+        if (parameter_sets != sps_pps_headers_) {
+            sps_pps_headers_ = std::move(parameter_sets);
+            BLUSTREAM_LOG_INFO("✓ H.264 parameter sets received (" + std::to_string(sps_pps_headers_.size()) + " bytes)");
+        }
+        return true;
     }
     
     // Statistics
@@ -275,9 +496,39 @@ private:
         std::atomic<size_t> hw_decode_frames;  // Frames decoded using hardware
         std::atomic<size_t> sw_decode_frames;  // Frames decoded using software
         std::atomic<bool> hw_decode_active;    // Whether HW decode is currently active
+        std::atomic<size_t> frames_rendered;   // Frames handed to the display
+        std::atomic<size_t> frames_dropped;    // Stale frames skipped, encoded or decoded
     } stats_;
     std::chrono::steady_clock::time_point stats_start_time_;
     
+    static AVPixelFormat find_hw_pixel_format(const AVCodec* codec, AVHWDeviceType device_type) {
+        if (device_type == AV_HWDEVICE_TYPE_NONE) {
+            return AV_PIX_FMT_NONE;
+        }
+        for (int i = 0;; i++) {
+            const AVCodecHWConfig* hw_config = avcodec_get_hw_config(codec, i);
+            if (!hw_config) {
+                return AV_PIX_FMT_NONE;
+            }
+            if ((hw_config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX) &&
+                hw_config->device_type == device_type) {
+                return hw_config->pix_fmt;
+            }
+        }
+    }
+    
+    // Device surfaces whenever the stream fits the hardware, software otherwise
+    static AVPixelFormat select_pixel_format(AVCodecContext* context, const AVPixelFormat* formats) {
+        const auto* client = static_cast<const StreamingClient*>(context->opaque);
+        for (const AVPixelFormat* format = formats; *format != AV_PIX_FMT_NONE; format++) {
+            if (*format == client->hw_pix_fmt_) {
+                return *format;
+            }
+        }
+        BLUSTREAM_LOG_WARN("[decode] Hardware cannot decode this stream, using software");
+        return avcodec_default_get_format(context, formats);
+    }
+    
     bool initialize_decoder() {
         // avcodec_register_all(); // Deprecated in newer FFmpeg versions
         
@@ -324,42 +575,57 @@ private:
             }
         }
         
-        // 3. Hardware acceleration based on platform and effective config
+        // 3. Hardware acceleration based on platform and effective config.
+        // The decoder runs on a device context and get_format picks the
+        // device's surface format, so decoded frames stay in GPU memory.
+        hw_pix_fmt_ = AV_PIX_FMT_NONE;
         if (effective_hw_mode != HardwareDecodeMode::OFF) {
             hw_attempted = true;
+            AVHWDeviceType device_type = AV_HWDEVICE_TYPE_NONE;
+            const char* device = nullptr;
             
 #ifdef __APPLE__
             // macOS: Try VideoToolbox
-            av_dict_set(&opts, "hwaccel", "videotoolbox", 0);
-            av_dict_set(&opts, "hwaccel_output_format", "videotoolbox_vld", 0);
+            device_type = AV_HWDEVICE_TYPE_VIDEOTOOLBOX;
             BLUSTREAM_LOG_INFO("[decode] Attempting hardware acceleration: VideoToolbox");
 #elif defined(_WIN32)
             // Windows: Try D3D11VA
-            av_dict_set(&opts, "hwaccel", "d3d11va", 0);
-            av_dict_set(&opts, "hwaccel_output_format", "d3d11", 0);
+            device_type = AV_HWDEVICE_TYPE_D3D11VA;
             BLUSTREAM_LOG_INFO("[decode] Attempting hardware acceleration: D3D11VA");
 #elif defined(__linux__)
-            // Linux: Enhanced VAAPI setup with device context
-            const char* vaapi_device = getenv("VAAPI_DEVICE");
-            if (!vaapi_device) {
-                vaapi_device = "/dev/dri/renderD128";
+            // Linux: VAAPI on the configured render node
+            device_type = AV_HWDEVICE_TYPE_VAAPI;
+            device = getenv("VAAPI_DEVICE");
+            if (!device) {
+                device = "/dev/dri/renderD128";
             }
+            BLUSTREAM_LOG_INFO("[decode] Attempting hardware acceleration: VAAPI");
+#endif
             
-            int vaapi_ret = av_hwdevice_ctx_create(&hw_device_ctx, AV_HWDEVICE_TYPE_VAAPI, 
-                                                   vaapi_device, nullptr, 0);
-            if (vaapi_ret >= 0) {
-                decoder_context_->hw_device_ctx = av_buffer_ref(hw_device_ctx);
-                av_dict_set(&opts, "hwaccel", "vaapi", 0);
-                av_dict_set(&opts, "hwaccel_output_format", "vaapi", 0);
-                BLUSTREAM_LOG_INFO("[decode] VAAPI device context created: " + std::string(vaapi_device));
+            const AVPixelFormat hw_format = find_hw_pixel_format(codec, device_type);
+            if (hw_format == AV_PIX_FMT_NONE) {
+                BLUSTREAM_LOG_WARN("[decode] H.264 decoder has no hardware support on this platform");
+            } else if (av_hwdevice_ctx_create(&hw_device_ctx, device_type, device, nullptr, 0) < 0) {
+                BLUSTREAM_LOG_WARN("[decode] Failed to create hardware device context" +
+                                  (device ? ": " + std::string(device) : std::string()));
             } else {
-                BLUSTREAM_LOG_WARN("[decode] Failed to create VAAPI device context: " + std::string(vaapi_device));
-                // Fallback to basic VAAPI without device context
-                av_dict_set(&opts, "hwaccel", "vaapi", 0);
-                av_dict_set(&opts, "hwaccel_output_format", "vaapi", 0);
+                hw_pix_fmt_ = hw_format;
+                decoder_context_->hw_device_ctx = av_buffer_ref(hw_device_ctx);
+                decoder_context_->opaque = this;
+                decoder_context_->get_format = &StreamingClient::select_pixel_format;
+                // Pending and displayed frames hold surfaces on top of the decoder's own
+                decoder_context_->extra_hw_frames = 2;
+                BLUSTREAM_LOG_INFO("[decode] Hardware device context created" +
+                                  (device ? ": " + std::string(device) : std::string()));
+            }
+            
+            if (hw_pix_fmt_ == AV_PIX_FMT_NONE && effective_hw_mode == HardwareDecodeMode::FORCE) {
+                BLUSTREAM_LOG_ERROR("[decode] Hardware decode forced but failed to initialize");
+                av_dict_free(&opts);
+                av_buffer_unref(&hw_device_ctx);
+                avcodec_free_context(&decoder_context_);
+                return false;
             }
-            BLUSTREAM_LOG_INFO("[decode] Attempting hardware acceleration: VAAPI");
-#endif
         } else {
             BLUSTREAM_LOG_INFO("[decode] Hardware acceleration disabled by config");
         }
@@ -367,7 +633,7 @@ private:
         // Try to open decoder with hardware acceleration
         int ret = avcodec_open2(decoder_context_, codec, &opts);
         
-        if (ret < 0 && hw_attempted && effective_hw_mode == HardwareDecodeMode::AUTO) {
+        if (ret < 0 && hw_pix_fmt_ != AV_PIX_FMT_NONE && effective_hw_mode == HardwareDecodeMode::AUTO) {
             // Hardware failed, try software fallback
             BLUSTREAM_LOG_WARN("[decode] Hardware acceleration failed, falling back to software");
             
@@ -386,9 +652,10 @@ private:
             av_dict_set(&opts, "thread_type", "frame", 0);
             
             ret = avcodec_open2(decoder_context_, codec, &opts);
+            hw_pix_fmt_ = AV_PIX_FMT_NONE;
             hw_success = false;
         } else if (ret >= 0 && hw_attempted) {
-            hw_success = true;
+            hw_success = hw_pix_fmt_ != AV_PIX_FMT_NONE;
         }
         
         av_dict_free(&opts);
@@ -399,6 +666,7 @@ private:
             } else {
                 BLUSTREAM_LOG_ERROR("[decode] Failed to open decoder (both HW and SW failed)");
             }
+            av_buffer_unref(&hw_device_ctx);
             avcodec_free_context(&decoder_context_);
             decoder_context_ = nullptr;
             return false;
@@ -425,9 +693,13 @@ private:
         }
         BLUSTREAM_LOG_INFO("[decode] Threading: " + std::to_string(thread_count) + " threads");
         
-        // Allocate frame
+        // Allocate frames
         av_frame_ = av_frame_alloc();
-        if (!av_frame_) {
+        pending_frame_ = av_frame_alloc();
+        display_frame_ = av_frame_alloc();
+        download_frame_ = av_frame_alloc();
+        has_pending_frame_ = false;
+        if (!av_frame_ || !pending_frame_ || !display_frame_ || !download_frame_) {
             BLUSTREAM_LOG_ERROR("Failed to allocate frame");
             cleanup_decoder();
             return false;
@@ -444,7 +716,7 @@ private:
         // Set initial hardware decode state based on success
         stats_.hw_decode_active = hw_success;
         
-        // Cleanup VAAPI device context if we created one
+        // The decoder holds its own reference to the device context
         if (hw_device_ctx) {
             av_buffer_unref(&hw_device_ctx);
         }
@@ -465,13 +737,91 @@ private:
             av_frame_free(&av_frame_);
         }
         
+        av_frame_free(&pending_frame_);
+        av_frame_free(&display_frame_);
+        av_frame_free(&download_frame_);
+        has_pending_frame_ = false;
+        
         if (decoder_context_) {
             avcodec_free_context(&decoder_context_);
         }
     }
     
+    // Reads exactly size bytes like recv(MSG_WAITALL), through the readahead
+    // buffer so one recv() usually brings in a header and the frame behind
+    // it. Remainders too large to buffer go straight to dst.
+    ssize_t receive_exact(void* dst, size_t size) {
+        uint8_t* out = static_cast<uint8_t*>(dst);
+        size_t copied = std::min(size, rx_end_ - rx_begin_);
+        std::memcpy(out, rx_buffer_.data() + rx_begin_, copied);
+        rx_begin_ += copied;
+        
+        while (copied < size) {
+            const size_t remaining = size - copied;
+            ssize_t bytes;
+            if (remaining >= rx_buffer_.size() / 2) {
+                bytes = recv(socket_fd_, reinterpret_cast<char*>(out + copied), remaining, MSG_WAITALL);
+                if (bytes > 0) {
+                    copied += bytes;
+                    continue;
+                }
+            } else {
+                rx_begin_ = 0;
+                rx_end_ = 0;
+                bytes = recv(socket_fd_, reinterpret_cast<char*>(rx_buffer_.data()), rx_buffer_.size(), 0);
+                if (bytes > 0) {
+                    rx_end_ = bytes;
+                    rx_begin_ = std::min(remaining, rx_end_);
+                    std::memcpy(out + copied, rx_buffer_.data(), rx_begin_);
+                    copied += rx_begin_;
+                    continue;
+                }
+            }
+            return copied > 0 ? static_cast<ssize_t>(copied) : bytes;
+        }
+        return static_cast<ssize_t>(copied);
+    }
+    
+    // Payloads land in pooled, padded buffers that the decoder references
+    // instead of copying; a frame larger than the pool's buffers regrows it
+    bool receive_packet(AVPacket* packet, size_t size) {
+        const size_t padded_size = size + AV_INPUT_BUFFER_PADDING_SIZE;
+        if (!packet_pool_ || padded_size > packet_pool_buffer_size_) {
+            // Buffers still in flight keep the old pool alive until released
+            av_buffer_pool_uninit(&packet_pool_);
+            packet_pool_buffer_size_ = std::max<size_t>(1024 * 1024, padded_size + padded_size / 2);
+            packet_pool_ = av_buffer_pool_init(packet_pool_buffer_size_, nullptr);
+            if (!packet_pool_) {
+                BLUSTREAM_LOG_ERROR("Failed to allocate packet pool");
+                return false;
+            }
+        }
+        
+        packet->buf = av_buffer_pool_get(packet_pool_);
+        if (!packet->buf) {
+            return false;
+        }
+        packet->data = packet->buf->data;
+        packet->size = static_cast<int>(size);
+        std::memset(packet->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+        
+        if (receive_exact(packet->data, size) != static_cast<ssize_t>(size)) {
+            av_packet_unref(packet);
+            return false;
+        }
+        if (starts_with_keyframe(packet->data, size)) {
+            packet->flags |= AV_PKT_FLAG_KEY;
+        }
+        return true;
+    }
+    
     void receive_loop() {
-        std::vector<uint8_t> buffer(1024 * 1024);  // 1MB buffer
+        AVPacket* packet = av_packet_alloc();
+        if (!packet) {
+            BLUSTREAM_LOG_ERROR("Failed to allocate packet");
+            ring_->close();
+            return;
+        }
         
         BLUSTREAM_LOG_INFO("Receive loop starting, connected=" + std::to_string(connected_.load()));
         
@@ -479,7 +829,7 @@ private:
             BLUSTREAM_LOG_INFO("Waiting for next message header...");
             // Receive message header with timeout
             common::MessageHeader header;
-            int bytes = recv(socket_fd_, &header, sizeof(header), MSG_WAITALL);
+            ssize_t bytes = receive_exact(&header, sizeof(header));
             
             if (bytes != sizeof(header)) {
                 if (connected_) {
@@ -507,28 +857,135 @@ private:
             
             BLUSTREAM_LOG_INFO("Received frame header: size=" + std::to_string(header.payload_size));
             
-            // Receive frame data
-            if (header.payload_size > buffer.size()) {
-                buffer.resize(header.payload_size);
+            // An empty packet would put the decoder into drain mode
+            if (header.payload_size == 0) {
+                continue;
             }
             
-            bytes = recv(socket_fd_, buffer.data(), header.payload_size, MSG_WAITALL);
-            if (static_cast<uint32_t>(bytes) != header.payload_size) {
+            // Receive frame data
+            if (!receive_packet(packet, header.payload_size)) {
                 BLUSTREAM_LOG_ERROR("Failed to receive frame data");
                 break;
             }
             
             stats_.frames_received++;
             stats_.bytes_received += header.payload_size;
+            note_frame_received(header);
             
-            // Process frame
-            process_frame(buffer.data(), header.payload_size);
+            // Hand off to the decode thread
+            stats_.frames_dropped += ring_->push(packet, !config_.drop_frames);
+            send_receiver_report_if_due();
         }
         
+        ring_->close();
+        av_packet_free(&packet);
         BLUSTREAM_LOG_INFO("Receive loop ended, connected=" + std::to_string(connected_.load()));
     }
     
-    void process_frame(const uint8_t* data, size_t size) {
+    void decode_loop() {
+        AVPacket* packet = av_packet_alloc();
+        if (!packet) {
+            BLUSTREAM_LOG_ERROR("Failed to allocate packet");
+            return;
+        }
+        
+        bool discontinuity = false;
+        while (ring_->pop(packet, discontinuity)) {
+            // Frames after a discarded one can't be decoded until the next keyframe
+            if (discontinuity && !awaiting_keyframe_) {
+                awaiting_keyframe_ = true;
+                keyframe_wanted_ = true;
+                BLUSTREAM_LOG_WARN("Decode fell behind, requesting a keyframe");
+            }
+            if (awaiting_keyframe_) {
+                if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+                    stats_.frames_dropped++;
+                    av_packet_unref(packet);
+                    continue;
+                }
+                awaiting_keyframe_ = false;
+            }
+            
+            process_frame(packet);
+            av_packet_unref(packet);
+            
+            // With more frames queued the picture would be stale on arrival
+            if (has_pending_frame_ && ring_->size() == 0) {
+                present_frame();
+            }
+        }
+        
+        av_packet_free(&packet);
+    }
+    
+    void note_frame_received(const common::MessageHeader& header) {
+        // Sequence gaps are frames that never arrived, whether the network
+        // or the server's send queue lost them
+        if (report_.have_frame) {
+            const uint32_t gap = header.sequence - report_.last_sequence;
+            if (gap > 1 && gap < 0x80000000u) {
+                report_.frames_lost += gap - 1;
+            }
+        }
+        report_.have_frame = true;
+        report_.last_sequence = header.sequence;
+        report_.last_timestamp = header.timestamp;
+        report_.last_frame_time = std::chrono::steady_clock::now();
+        report_.frames_received++;
+        report_.bytes_received += sizeof(header) + header.payload_size;
+    }
+    
+    // Twice a second the server gets loss, throughput and an RTT sample
+    // for its bitrate controller. A keyframe request goes out at once: with
+    // intra refresh the server sends no periodic IDR to resume from.
+    void send_receiver_report_if_due() {
+        auto now = std::chrono::steady_clock::now();
+        auto interval_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - report_.interval_start).count();
+        if (!report_.have_frame || (interval_ms < 500 && !keyframe_wanted_)) {
+            return;
+        }
+        
+        common::ReceiverReport report;
+        report.last_sequence = report_.last_sequence;
+        report.echo_timestamp = report_.last_timestamp;
+        report.hold_ms = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - report_.last_frame_time).count());
+        report.interval_ms = static_cast<uint32_t>(interval_ms);
+        report.frames_received = report_.frames_received;
+        report.frames_lost = report_.frames_lost;
+        report.bytes_received = report_.bytes_received;
+        report.decode_queue = static_cast<uint32_t>(ring_->size());
+        report.keyframe_request = keyframe_wanted_.exchange(false) ? 1 : 0;
+        
+        common::MessageHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic = 0x42535452;
+        header.version = 1;
+        header.type = static_cast<uint32_t>(common::MessageType::METRICS_UPDATE);
+        header.payload_size = sizeof(report);
+        
+        uint8_t message[sizeof(header) + sizeof(report)];
+        std::memcpy(message, &header, sizeof(header));
+        std::memcpy(message + sizeof(header), &report, sizeof(report));
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+#endif
+        if (send(socket_fd_, reinterpret_cast<const char*>(message), sizeof(message), flags) != sizeof(message)) {
+            BLUSTREAM_LOG_WARN("Failed to send receiver report");
+        }
+        
+        report_.interval_start = now;
+        report_.frames_received = 0;
+        report_.frames_lost = 0;
+        report_.bytes_received = 0;
+    }
+    
+    void process_frame(AVPacket* packet) {
+        const uint8_t* data = packet->data;
+        const size_t size = packet->size;
+        
         // Save raw H.264 if requested AND debug I/O is enabled
         if (config_.save_frames) {
             if (BLUSTREAM_DEBUG_IO_ENABLED()) {
@@ -547,17 +1004,32 @@ private:
         if (decoder_context_ && av_packet_ && av_frame_) {
             auto decode_start = std::chrono::steady_clock::now();
             
-            // Create frame data with SPS/PPS prepended for proper decoding
-            std::vector<uint8_t> frame_with_headers;
-            frame_with_headers.reserve(sps_pps_headers_.size() + size);
-            frame_with_headers.insert(frame_with_headers.end(), sps_pps_headers_.begin(), sps_pps_headers_.end());
-            frame_with_headers.insert(frame_with_headers.end(), data, data + size);
+            // Keyframes normally bring their own SPS/PPS; an IDR without
+            // them gets the last ones seen, and nothing decodes before the
+            // first set arrives
+            bool is_idr = false;
+            bool has_parameter_sets = update_parameter_sets(data, size, is_idr);
+            if (!has_parameter_sets && sps_pps_headers_.empty()) {
+                stats_.decode_errors++;
+                return;
+            }
             
-            av_packet_->data = frame_with_headers.data();
-            av_packet_->size = frame_with_headers.size();
+            // Only an IDR missing its parameter sets is copied; the decoder
+            // references pooled packets as they are
+            AVPacket* input = packet;
+            std::vector<uint8_t> frame_with_headers;
+            if (!has_parameter_sets && is_idr) {
+                frame_with_headers.reserve(sps_pps_headers_.size() + size + AV_INPUT_BUFFER_PADDING_SIZE);
+                frame_with_headers.insert(frame_with_headers.end(), sps_pps_headers_.begin(), sps_pps_headers_.end());
+                frame_with_headers.insert(frame_with_headers.end(), data, data + size);
+                av_packet_->size = frame_with_headers.size();
+                frame_with_headers.resize(frame_with_headers.size() + AV_INPUT_BUFFER_PADDING_SIZE, 0);
+                av_packet_->data = frame_with_headers.data();
+                input = av_packet_;
+            }
             
             // Send packet to decoder
-            if (avcodec_send_packet(decoder_context_, av_packet_) < 0) {
+            if (avcodec_send_packet(decoder_context_, input) < 0) {
                 stats_.decode_errors++;
                 return;
             }
@@ -566,15 +1038,32 @@ private:
             while (avcodec_receive_frame(decoder_context_, av_frame_) == 0) {
                 stats_.frames_decoded++;
                 
+                if (!first_frame_logged_) {
+                    first_frame_logged_ = true;
+                    auto first_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - connect_time_).count();
+                    BLUSTREAM_LOG_INFO("✓ First frame decoded " + std::to_string(first_ms) + " ms after connect");
+                }
+                
                 // Track hardware vs software decode statistics
-                if (stats_.hw_decode_active) {
+                const bool hw_frame = hw_pix_fmt_ != AV_PIX_FMT_NONE && av_frame_->format == hw_pix_fmt_;
+                stats_.hw_decode_active = hw_frame;
+                if (hw_frame) {
                     stats_.hw_decode_frames++;
                 } else {
                     stats_.sw_decode_frames++;
                 }
                 
-                // Process decoded frame (convert to RGB, display, etc.)
-                process_decoded_frame(av_frame_);
+                // A picture still waiting for display is stale now
+                if (has_pending_frame_) {
+                    av_frame_unref(pending_frame_);
+                    stats_.frames_dropped++;
+                }
+                av_frame_move_ref(pending_frame_, av_frame_);
+                has_pending_frame_ = true;
+                if (!config_.drop_frames) {
+                    present_frame();
+                }
             }
             
             auto decode_end = std::chrono::steady_clock::now();
@@ -586,6 +1075,19 @@ private:
         }
     }
     
+    // Hands the pending picture to the display. A hardware frame stays the
+    // decoder's GPU surface (VAAPI surface, CVPixelBuffer or D3D11 texture),
+    // which the renderer binds as a texture; nothing here converts or
+    // copies pixels.
+    void present_frame() {
+        av_frame_unref(display_frame_);
+        av_frame_move_ref(display_frame_, pending_frame_);
+        has_pending_frame_ = false;
+        stats_.frames_rendered++;
+        
+        process_decoded_frame(display_frame_);
+    }
+    
     void process_decoded_frame(AVFrame* frame) {
         // Save decoded frame as PPM if requested AND debug I/O is enabled
         if (config_.save_frames) {
@@ -593,17 +1095,35 @@ private:
                 BLUSTREAM_DEBUG_IO_PERMIT();
                 static int decoded_frame_num = 0;
                 
+                // Only debug dumps bring hardware frames back to memory
+                if (frame->format == hw_pix_fmt_) {
+                    av_frame_unref(download_frame_);
+                    if (av_hwframe_transfer_data(download_frame_, frame, 0) < 0) {
+                        BLUSTREAM_LOG_WARN("Failed to download hardware frame");
+                        return;
+                    }
+                    frame = download_frame_;
+                }
+                const bool interleaved_chroma = frame->format == AV_PIX_FMT_NV12;
+                
                 // Convert YUV to RGB
                 std::vector<uint8_t> rgb_data(frame->width * frame->height * 3);
                 
                 for (int y = 0; y < frame->height; y++) {
                     for (int x = 0; x < frame->width; x++) {
                         int y_idx = y * frame->linesize[0] + x;
-                        int uv_idx = (y / 2) * frame->linesize[1] + (x / 2);
                         
                         uint8_t Y = frame->data[0][y_idx];
-                        uint8_t U = frame->data[1][uv_idx];
-                        uint8_t V = frame->data[2][uv_idx];
+                        uint8_t U, V;
+                        if (interleaved_chroma) {
+                            int uv_idx = (y / 2) * frame->linesize[1] + (x / 2) * 2;
+                            U = frame->data[1][uv_idx];
+                            V = frame->data[1][uv_idx + 1];
+                        } else {
+                            int uv_idx = (y / 2) * frame->linesize[1] + (x / 2);
+                            U = frame->data[1][uv_idx];
+                            V = frame->data[2][uv_idx];
+                        }
                         
                         // YUV to RGB conversion
                         int C = Y - 16;
@@ -657,6 +1177,8 @@ private:
                          << " | Decoded: " << stats_.frames_decoded << " (" << decode_mode << ")"
                          << " | Decode: " << stats_.avg_decode_time_ms << " ms"
                          << " | HW/SW: " << stats_.hw_decode_frames << "/" << stats_.sw_decode_frames
+                         << " | Rendered: " << stats_.frames_rendered
+                         << " | Dropped: " << stats_.frames_dropped
                          << " | Errors: " << stats_.decode_errors
                          << "    " << std::flush;
             }
@@ -701,6 +1223,10 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Invalid hw-decode mode: " << mode << ". Use auto|off|force\n";
                 return 1;
             }
+        } else if (arg == "--ring-size" && i + 1 < argc) {
+            config.ring_size = static_cast<size_t>(std::max(2, std::atoi(argv[++i])));
+        } else if (arg == "--no-frame-drop") {
+            config.drop_frames = false;
         } else if (arg == "--help") {
             std::cout << "Usage: " << argv[0] << " [options]\n"
                      << "Options:\n"
@@ -714,6 +1240,8 @@ int main(int argc, char* argv[]) {
                      << "                    auto: attempt HW, fallback to SW if unsupported\n"
                      << "                    off: always use software decode\n"
                      << "                    force: fail if HW decode init fails\n"
+                     << "  --ring-size N     Encoded frames queued for decode (default: 4)\n"
+                     << "  --no-frame-drop   Decode and render every frame (QA)\n"
                      << "  --help            Show this help message\n";
             return 0;
         }
@@ -3,6 +3,12 @@
 #include <string>
 #include <memory>
 #include <sstream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
 
 namespace blustream {
 namespace common {
@@ -16,6 +22,20 @@ enum class LogLevel {
     FATAL = 5
 };
 
+// Levels below this are compiled out of the BLUSTREAM_LOG_* macros, message
+// construction included. Release builds keep INFO and up.
+#ifndef BLUSTREAM_MIN_LOG_LEVEL
+#ifdef BLUSTREAM_RELEASE_BUILD
+#define BLUSTREAM_MIN_LOG_LEVEL 2
+#else
+#define BLUSTREAM_MIN_LOG_LEVEL 0
+#endif
+#endif
+
+constexpr LogLevel COMPILED_LOG_LEVEL = static_cast<LogLevel>(BLUSTREAM_MIN_LOG_LEVEL);
+
+bool parse_log_level(const std::string& name, LogLevel& level);
+
 class Logger {
 public:
     virtual ~Logger() = default;
@@ -47,17 +67,162 @@ private:
     std::string format_message(LogLevel level, const std::string& message);
 };
 
+/**
+ * @brief Logger that hands lines to a writer thread through a lock-free ring
+ *
+ * log() stamps the time, copies the message into a preallocated slot and
+ * returns; formatting and the console writes happen on the writer thread,
+ * which flushes once per batch instead of once per line. Producers claim
+ * slots with a CAS, so any number of threads can log without a lock. When
+ * the ring is full the message is dropped and counted rather than making
+ * a pipeline thread wait, and the writer reports the count. Messages
+ * longer than a slot are truncated. ERROR and above wake the writer at
+ * once; FATAL also waits until it has been written.
+ */
+class AsyncLogger : public Logger {
+public:
+    explicit AsyncLogger(LogLevel level = LogLevel::INFO, size_t capacity = 4096);
+    ~AsyncLogger() override;
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    void log(LogLevel level, const std::string& message) override;
+    void set_level(LogLevel level) override { level_.store(level, std::memory_order_relaxed); }
+    LogLevel get_level() const override { return level_.load(std::memory_order_relaxed); }
+
+    // Blocks until everything logged before the call has been written
+    void flush();
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t MAX_MESSAGE = 496;
+
+    struct Slot {
+        std::atomic<uint64_t> sequence;  // Ready to read when one past its position
+        LogLevel level;
+        std::chrono::system_clock::time_point time;
+        uint16_t length;
+        char text[MAX_MESSAGE];
+    };
+
+    void writer_loop();
+    void wake_writer();
+
+    std::atomic<LogLevel> level_;
+    const size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<uint64_t> enqueue_pos_;
+    alignas(64) uint64_t dequeue_pos_;  // Writer thread only
+    std::atomic<uint64_t> written_pos_;
+    std::atomic<uint64_t> dropped_;
+
+    std::atomic<bool> running_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable written_cv_;
+    std::thread writer_;
+};
+
+/**
+ * @brief Lets one message through per interval from a single call site
+ *
+ * Counts what it holds back, so the next message that goes out can say
+ * how many were suppressed. Lock-free; used by BLUSTREAM_LOG_EVERY_MS.
+ */
+class LogRateLimiter {
+public:
+    explicit LogRateLimiter(int64_t interval_ms)
+        : interval_ns_(interval_ms * 1000000)
+        , next_ns_(0)
+        , suppressed_(0) {
+    }
+
+    bool allow(uint64_t& suppressed) {
+        const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t next = next_ns_.load(std::memory_order_relaxed);
+        if (now < next || !next_ns_.compare_exchange_strong(next, now + interval_ns_, std::memory_order_relaxed)) {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    const int64_t interval_ns_;
+    std::atomic<int64_t> next_ns_;
+    std::atomic<uint64_t> suppressed_;
+};
+
+inline std::string with_suppressed_count(std::string message, uint64_t suppressed) {
+    if (suppressed > 0) {
+        message += " (" + std::to_string(suppressed) + " similar suppressed)";
+    }
+    return message;
+}
+
 // Global logger instance
 Logger& get_logger();
 void set_logger(std::unique_ptr<Logger> logger);
 
-// Convenience macros for logging
-#define BLUSTREAM_LOG_TRACE(msg) ::blustream::common::get_logger().trace(msg)
-#define BLUSTREAM_LOG_DEBUG(msg) ::blustream::common::get_logger().debug(msg)
-#define BLUSTREAM_LOG_INFO(msg) ::blustream::common::get_logger().info(msg)
-#define BLUSTREAM_LOG_WARN(msg) ::blustream::common::get_logger().warn(msg)
-#define BLUSTREAM_LOG_ERROR(msg) ::blustream::common::get_logger().error(msg)
-#define BLUSTREAM_LOG_FATAL(msg) ::blustream::common::get_logger().fatal(msg)
+// True when a message at this level would be written
+inline bool log_enabled(LogLevel level) {
+    return level >= COMPILED_LOG_LEVEL && level >= get_logger().get_level();
+}
+
+// Convenience macros for logging. The message expression is only evaluated
+// when the level is enabled, and levels below COMPILED_LOG_LEVEL compile to
+// nothing. level is the bare enumerator: BLUSTREAM_LOG_ENABLED(DEBUG).
+#define BLUSTREAM_LOG_ENABLED(level) \
+    (::blustream::common::LogLevel::level >= ::blustream::common::COMPILED_LOG_LEVEL && \
+     ::blustream::common::log_enabled(::blustream::common::LogLevel::level))
+
+#define BLUSTREAM_LOG_AT(level, msg) \
+    do { \
+        if constexpr (::blustream::common::LogLevel::level >= ::blustream::common::COMPILED_LOG_LEVEL) { \
+            if (::blustream::common::log_enabled(::blustream::common::LogLevel::level)) { \
+                ::blustream::common::get_logger().log(::blustream::common::LogLevel::level, msg); \
+            } \
+        } \
+    } while (0)
+
+#define BLUSTREAM_LOG_TRACE(msg) BLUSTREAM_LOG_AT(TRACE, msg)
+#define BLUSTREAM_LOG_DEBUG(msg) BLUSTREAM_LOG_AT(DEBUG, msg)
+#define BLUSTREAM_LOG_INFO(msg) BLUSTREAM_LOG_AT(INFO, msg)
+#define BLUSTREAM_LOG_WARN(msg) BLUSTREAM_LOG_AT(WARN, msg)
+#define BLUSTREAM_LOG_ERROR(msg) BLUSTREAM_LOG_AT(ERROR, msg)
+#define BLUSTREAM_LOG_FATAL(msg) BLUSTREAM_LOG_AT(FATAL, msg)
+
+// At most one message per interval from this call site; the next one that
+// goes out carries the number suppressed in between
+#define BLUSTREAM_LOG_EVERY_MS(level, interval_ms, msg) \
+    do { \
+        if constexpr (::blustream::common::LogLevel::level >= ::blustream::common::COMPILED_LOG_LEVEL) { \
+            static ::blustream::common::LogRateLimiter blustream_log_limiter(interval_ms); \
+            uint64_t blustream_log_suppressed = 0; \
+            if (::blustream::common::log_enabled(::blustream::common::LogLevel::level) && \
+                blustream_log_limiter.allow(blustream_log_suppressed)) { \
+                ::blustream::common::get_logger().log(::blustream::common::LogLevel::level, \
+                    ::blustream::common::with_suppressed_count(msg, blustream_log_suppressed)); \
+            } \
+        } \
+    } while (0)
+
+// Only the first n messages from this call site
+#define BLUSTREAM_LOG_FIRST_N(level, n, msg) \
+    do { \
+        if constexpr (::blustream::common::LogLevel::level >= ::blustream::common::COMPILED_LOG_LEVEL) { \
+            static std::atomic<int> blustream_log_count(0); \
+            if (::blustream::common::log_enabled(::blustream::common::LogLevel::level) && \
+                blustream_log_count.load(std::memory_order_relaxed) < (n) && \
+                blustream_log_count.fetch_add(1, std::memory_order_relaxed) < (n)) { \
+                ::blustream::common::get_logger().log(::blustream::common::LogLevel::level, msg); \
+            } \
+        } \
+    } while (0)
 
 // Stream-style logging
 class LogStream {
@@ -97,6 +97,20 @@ struct StreamConfig {
     uint32_t bitrate_kbps;
 };
 
+// Receiver report a client sends as METRICS_UPDATE, about twice a second.
+// RTT on the server is its clock now, minus echo_timestamp, minus hold_ms.
+struct ReceiverReport {
+    uint32_t last_sequence;    // Sequence of the newest frame received
+    uint32_t echo_timestamp;   // That frame's header timestamp (server clock, ms)
+    uint32_t hold_ms;          // Time from receiving that frame to sending this report
+    uint32_t interval_ms;      // Time covered by the counts below
+    uint32_t frames_received;
+    uint32_t frames_lost;      // Sequence gaps, including frames the server skipped
+    uint32_t bytes_received;
+    uint32_t decode_queue;     // Frames received but not yet decoded
+    uint32_t keyframe_request; // Nonzero: the decoder dropped frames and waits for an IDR
+};
+
 struct Message {
     MessageType type;
     SessionId session_id;
@@ -1,6 +1,9 @@
 #include "blustream/common/logger.h"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 #include <memory>
@@ -10,6 +13,56 @@ namespace common {
 
 namespace {
     std::unique_ptr<Logger> g_logger;
+
+    std::string format_line(LogLevel level, std::chrono::system_clock::time_point now, const std::string& message) {
+        auto time_t = std::chrono::system_clock::to_time_t(now);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now.time_since_epoch()) % 1000;
+
+        std::ostringstream oss;
+        oss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
+        oss << '.' << std::setfill('0') << std::setw(3) << ms.count();
+
+        const char* level_str = "";
+        switch (level) {
+            case LogLevel::TRACE: level_str = "TRACE"; break;
+            case LogLevel::DEBUG: level_str = "DEBUG"; break;
+            case LogLevel::INFO:  level_str = "INFO "; break;
+            case LogLevel::WARN:  level_str = "WARN "; break;
+            case LogLevel::ERROR: level_str = "ERROR"; break;
+            case LogLevel::FATAL: level_str = "FATAL"; break;
+        }
+
+        oss << " [" << level_str << "] " << message;
+        return oss.str();
+    }
+
+    size_t round_up_pow2(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+bool parse_log_level(const std::string& name, LogLevel& level) {
+    if (name == "trace") {
+        level = LogLevel::TRACE;
+    } else if (name == "debug") {
+        level = LogLevel::DEBUG;
+    } else if (name == "info") {
+        level = LogLevel::INFO;
+    } else if (name == "warn") {
+        level = LogLevel::WARN;
+    } else if (name == "error") {
+        level = LogLevel::ERROR;
+    } else if (name == "fatal") {
+        level = LogLevel::FATAL;
+    } else {
+        return false;
+    }
+    return true;
 }
 
 // ConsoleLogger implementation
@@ -30,27 +83,136 @@ void ConsoleLogger::log(LogLevel level, const std::string& message) {
 }
 
 std::string ConsoleLogger::format_message(LogLevel level, const std::string& message) {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::ostringstream oss;
-    oss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    oss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    
-    const char* level_str = "";
-    switch (level) {
-        case LogLevel::TRACE: level_str = "TRACE"; break;
-        case LogLevel::DEBUG: level_str = "DEBUG"; break;
-        case LogLevel::INFO:  level_str = "INFO "; break;
-        case LogLevel::WARN:  level_str = "WARN "; break;
-        case LogLevel::ERROR: level_str = "ERROR"; break;
-        case LogLevel::FATAL: level_str = "FATAL"; break;
+    return format_line(level, std::chrono::system_clock::now(), message);
+}
+
+// AsyncLogger implementation
+AsyncLogger::AsyncLogger(LogLevel level, size_t capacity)
+    : level_(level)
+    , mask_(round_up_pow2(capacity > 1 ? capacity : 2) - 1)
+    , slots_(new Slot[mask_ + 1])
+    , enqueue_pos_(0)
+    , dequeue_pos_(0)
+    , written_pos_(0)
+    , dropped_(0)
+    , running_(true) {
+    for (size_t i = 0; i <= mask_; i++) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    writer_ = std::thread(&AsyncLogger::writer_loop, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    running_ = false;
+    wake_writer();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+void AsyncLogger::log(LogLevel level, const std::string& message) {
+    if (level < get_level()) {
+        return;
+    }
+
+    // Bounded MPMC ring (Vyukov): a slot is free for position pos when its
+    // sequence equals pos, and readable once the producer sets it to pos + 1
+    uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (;;) {
+        slot = &slots_[pos & mask_];
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full: the writer is a whole ring behind
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->time = std::chrono::system_clock::now();
+    slot->length = static_cast<uint16_t>(std::min(message.size(), MAX_MESSAGE));
+    std::memcpy(slot->text, message.data(), slot->length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    if (level >= LogLevel::ERROR) {
+        wake_writer();
+    }
+    if (level == LogLevel::FATAL) {
+        flush();
+    }
+}
+
+void AsyncLogger::flush() {
+    const uint64_t target = enqueue_pos_.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    wake_cv_.notify_one();
+    written_cv_.wait_for(lock, std::chrono::seconds(1), [&] {
+        return written_pos_.load(std::memory_order_acquire) >= target;
+    });
+}
+
+void AsyncLogger::wake_writer() {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_cv_.notify_one();
+}
+
+void AsyncLogger::writer_loop() {
+    std::string out;
+    std::string err;
+    uint64_t reported_dropped = 0;
+
+    for (;;) {
+        // Take everything published so far, in order
+        bool stopping = !running_.load();
+        for (;;) {
+            Slot& slot = slots_[dequeue_pos_ & mask_];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+                break;
+            }
+            std::string line = format_line(slot.level, slot.time, std::string(slot.text, slot.length));
+            line += '\n';
+            (slot.level >= LogLevel::ERROR ? err : out) += line;
+            slot.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+            dequeue_pos_++;
+        }
+
+        const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped) {
+            out += format_line(LogLevel::WARN, std::chrono::system_clock::now(),
+                               std::to_string(dropped - reported_dropped) + " log messages dropped, queue full") + "\n";
+            reported_dropped = dropped;
+        }
+
+        // One write and flush per batch, not per line
+        if (!out.empty()) {
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            std::fflush(stdout);
+            out.clear();
+        }
+        if (!err.empty()) {
+            std::fwrite(err.data(), 1, err.size(), stderr);
+            std::fflush(stderr);
+            err.clear();
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        written_pos_.store(dequeue_pos_, std::memory_order_release);
+        written_cv_.notify_all();
+        if (stopping) {
+            break;
+        }
+
+        // Routine lines wait for the next tick; urgent ones notify
+        wake_cv_.wait_for(lock, std::chrono::milliseconds(20));
     }
-    
-    oss << " [" << level_str << "] " << message;
-    return oss.str();
 }
 
 // Global logger functions
@@ -66,4 +228,4 @@ void set_logger(std::unique_ptr<Logger> logger) {
 }
 
 }  // namespace common
-}  // namespace blustream
\ No newline at end of file
+}  // namespace blustream
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "blustream/common/types.h"
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief Per-client send-rate estimate from receiver reports
+ *
+ * Delay-based AIMD in the spirit of GCC. Queuing delay is the report's
+ * RTT over the minimum RTT of the last ten seconds. Each report is judged:
+ * - Overuse (a growing queue past half the latency budget, more than 10%
+ *   loss, or a server-side backlog past the whole budget): the estimate
+ *   drops to 85% of what actually got through.
+ * - Clear path (low delay and loss): it grows about 8% per report,
+ *   never past 1.5x the measured throughput, so an app-limited stream
+ *   can't run the estimate away.
+ * - Anything else: hold.
+ * Increases also wait a second after each decrease. Thread-safe: reports
+ * arrive on the client's reader thread, the controller polls from the
+ * fanout thread.
+ */
+class BandwidthEstimator {
+public:
+    struct Config {
+        int min_kbps = 500;
+        int max_kbps = 10000;
+        int start_kbps = 5000;
+        int target_latency_ms = 150;
+    };
+
+    enum class Usage { UNDERUSE, NORMAL, OVERUSE };
+
+    explicit BandwidthEstimator(const Config& config);
+
+    // rtt_ms as measured for the report; server_lag_ms is the age of the
+    // oldest packet still queued for this client
+    void on_report(const common::ReceiverReport& report, uint32_t rtt_ms, uint32_t server_lag_ms);
+
+    bool has_estimate() const;
+    int estimate_kbps() const;
+    uint32_t rtt_ms() const;         // Smoothed
+    uint32_t min_rtt_ms() const;
+    float loss_fraction() const;     // From the last report
+    float throughput_kbps() const;   // From the last report
+    Usage last_usage() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Config config_;
+    mutable std::mutex mutex_;
+
+    bool has_estimate_;
+    double estimate_kbps_;
+    double srtt_ms_;
+    float loss_;
+    float throughput_kbps_;
+    Usage usage_;
+    Clock::time_point last_decrease_;
+
+    // (time, rtt) for the windowed minimum
+    std::deque<std::pair<Clock::time_point, uint32_t>> rtt_window_;
+    uint32_t min_rtt_ms_;
+    uint32_t last_rtt_ms_;
+};
+
+} // namespace server
+} // namespace blustream
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace blustream {
+namespace server {
+
+// Native storage type of volume samples; quantized formats carry a
+// scale/offset alongside (value = offset + scale * code)
+enum class SampleFormat : uint8_t {
+    U8 = 0,
+    U16 = 1,
+    F32 = 2
+};
+
+inline size_t sample_format_size(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::U8:  return 1;
+        case SampleFormat::U16: return 2;
+        case SampleFormat::F32:
+        default:                return 4;
+    }
+}
+
+/**
+ * @brief LRU page cache of fixed-size volume bricks
+ *
+ * The volume is tiled into cubic bricks (64³ by default). Bricks are fetched
+ * lazily through a loader callback on first touch and evicted in
+ * least-recently-used order once the resident size exceeds the byte budget.
+ * Readers hold a shared_ptr, so eviction never invalidates a brick in use.
+ * With Config::mapped the loader points each brick at memory it owns (a
+ * mapped brick file) instead of filling samples; only heap copies such as
+ * the crossline layout then count against the budget.
+ */
+class BrickCache {
+public:
+    struct Config {
+        int brick_size = 64;                          // Edge length in samples
+        size_t budget_bytes = 2048ull * 1024 * 1024;  // Resident byte budget
+        bool crossline_layout = false;                // Also keep an x-slowest copy per brick
+        SampleFormat format = SampleFormat::F32;      // Native sample type stored per brick
+        bool mapped = false;                          // Loader points bricks at memory it owns
+    };
+
+    struct Brick {
+        int origin[3];                   // First sample covered (x, y, z)
+        int size[3];                     // Extent in samples (edge bricks are smaller)
+        SampleFormat format;
+        std::vector<uint8_t> samples;    // Native samples, x-fastest, then y, then z
+        std::vector<uint8_t> crossline;  // Optional [x][z][y] copy: constant-x rows are contiguous
+
+        // Mapped bricks leave samples empty and read from memory they don't
+        // own, such as a brick file, which mapping keeps alive
+        const uint8_t* mapped = nullptr;
+        std::shared_ptr<const void> mapping;
+
+        size_t sample_count() const { return static_cast<size_t>(size[0]) * size[1] * size[2]; }
+        size_t sample_bytes() const { return sample_count() * sample_format_size(format); }
+        size_t byte_size() const { return samples.size() + crossline.size(); }  // Heap bytes only
+
+        template <typename T> T* samples_as() { return reinterpret_cast<T*>(samples.data()); }
+        template <typename T> const T* samples_as() const {
+            return reinterpret_cast<const T*>(mapped ? mapped : samples.data());
+        }
+        template <typename T> const T* crossline_as() const { return reinterpret_cast<const T*>(crossline.data()); }
+    };
+    using BrickPtr = std::shared_ptr<const Brick>;
+
+    // Fills brick.samples (already sized for brick.format) for the region
+    // described by brick.origin/size
+    using Loader = std::function<bool(Brick& brick)>;
+
+    struct Stats {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+        size_t load_failures;
+        size_t resident_bricks;
+        size_t resident_bytes;
+    };
+
+    BrickCache();
+    ~BrickCache();
+
+    // (Re)configure for a volume; drops all resident bricks
+    void configure(const Config& config, int width, int height, int depth, Loader loader);
+    void clear();
+
+    // Change the byte budget in place, evicting down to it if it shrank
+    void set_budget(size_t budget_bytes);
+
+    // Get a brick by brick coordinates, loading it on a miss (nullptr on failure).
+    // was_resident reports whether the brick was served without a load.
+    BrickPtr get(int bx, int by, int bz, bool* was_resident = nullptr);
+
+    // Check residency without loading or touching LRU order
+    bool is_resident(int bx, int by, int bz) const;
+
+    // Brick grid
+    int brick_size() const { return config_.brick_size; }
+    int bricks_x() const { return bricks_[0]; }
+    int bricks_y() const { return bricks_[1]; }
+    int bricks_z() const { return bricks_[2]; }
+
+    Stats get_stats() const;
+
+private:
+    using Key = uint64_t;
+
+    struct Entry {
+        BrickPtr brick;
+        std::list<Key>::iterator lru_pos;
+    };
+
+    static Key make_key(int bx, int by, int bz) {
+        return (static_cast<uint64_t>(bz) << 42) | (static_cast<uint64_t>(by) << 21) | static_cast<uint64_t>(bx);
+    }
+
+    void evict_to_budget();  // Requires mutex_ held
+    static void build_crossline_layout(Brick& brick);
+
+    Config config_;
+    int dims_[3];
+    int bricks_[3];
+    Loader loader_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable load_cv_;
+    std::unordered_map<Key, Entry> entries_;
+    std::unordered_set<Key> in_flight_;
+    std::list<Key> lru_;  // Front = most recently used
+    size_t resident_bytes_;
+
+    Stats stats_;
+};
+
+} // namespace server
+} // namespace blustream
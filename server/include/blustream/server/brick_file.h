@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "blustream/server/brick_cache.h"
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief Read-only mapping of a BluStream brick file
+ *
+ * A brick file holds a volume already tiled into bricks in its resident
+ * sample format. It is written once from any brick source, then mapped so
+ * a restart costs one header check. Bricks are returned as pointers into
+ * the mapping, and every server process on the node shares the same page
+ * cache pages.
+ *
+ * Layout, little-endian: a Header, the Entry index in x-fastest brick
+ * order, then each brick's samples in the BrickCache::Brick layout,
+ * starting on an ALIGNMENT boundary.
+ */
+class BrickFile {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t ALIGNMENT = 4096;
+
+    struct Header {
+        char magic[8];          // "BLSBRICK"
+        uint32_t version;
+        uint32_t format;        // SampleFormat
+        int32_t width;
+        int32_t height;
+        int32_t depth;
+        int32_t brick_size;
+        float scale;            // value = offset + scale * stored sample
+        float offset;
+        float min_value;
+        float max_value;
+        uint64_t brick_count;
+        uint64_t source_size;   // Size and mtime of the file the bricks came from, 0 if none
+        int64_t source_mtime;
+    };
+
+    struct Entry {
+        uint64_t offset;
+        uint64_t bytes;
+    };
+
+    // Both are read straight out of the mapping
+    static_assert(sizeof(Header) == 72 && std::is_trivially_copyable<Header>::value, "Header is on-disk layout");
+    static_assert(sizeof(Entry) == 16 && std::is_trivially_copyable<Entry>::value, "Entry is on-disk layout");
+
+    ~BrickFile();
+
+    BrickFile(const BrickFile&) = delete;
+    BrickFile& operator=(const BrickFile&) = delete;
+
+    // Maps and validates a brick file; null on any mismatch or I/O error
+    static std::shared_ptr<BrickFile> open(const std::string& path);
+
+    // Writes every brick of the described volume, filled by load exactly as
+    // BrickCache would fill it. The file appears under path only once it is
+    // complete. keep_running, when given, is polled between bricks and
+    // clearing it abandons the write.
+    static bool write(const std::string& path, const Header& header, const BrickCache::Loader& load,
+                      const std::atomic<bool>* keep_running = nullptr);
+
+    // Size and mtime of a file, for Header::source_size/source_mtime
+    static bool stat_source(const std::string& path, uint64_t& size, int64_t& mtime);
+
+    static Header make_header(SampleFormat format, int width, int height, int depth, int brick_size);
+
+    const Header& header() const { return header_; }
+    SampleFormat format() const { return static_cast<SampleFormat>(header_.format); }
+
+    // Samples of one brick inside the mapping; null if out of range. Also
+    // starts readahead on the brick's pages.
+    const uint8_t* brick_data(int bx, int by, int bz, size_t* bytes = nullptr) const;
+
+private:
+    BrickFile();
+
+    static void brick_grid(const Header& header, int grid[3]);
+
+    Header header_;
+    int grid_[3];
+    const Entry* index_;
+    const uint8_t* base_;
+    size_t mapped_bytes_;
+};
+
+} // namespace server
+} // namespace blustream
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "blustream/server/bandwidth_estimator.h"
+#include "blustream/server/frame_pipeline.h"
+#include "blustream/server/packet_pool.h"
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief Outgoing side of a single client connection
+ *
+ * Holds references to the shared packets queued for this client; nothing
+ * is copied per client. A ClientIOPool thread writes the queue out to the
+ * non-blocking socket with gathered header + payload writes.
+ *
+ * The queue is bounded. When a lagging client fills it, unsent
+ * non-reference frames go first; if that is not enough, every unsent
+ * frame is dropped and the client skips ahead to the next keyframe, asking
+ * the server for one. A slow client stays close to live and costs at most
+ * max_queued packets of memory. Control messages are never dropped.
+ *
+ * A new connection starts out waiting for a keyframe too: frames queued
+ * before the first keyframe are skipped (and not counted as drops), so
+ * the first picture the client gets is one it can decode.
+ *
+ * Receiver reports from the client feed a BandwidthEstimator, together
+ * with this queue's own lag.
+ */
+class ClientConnection {
+public:
+    enum class FlushResult {
+        DRAINED,  // Queue empty
+        BLOCKED,  // Socket buffer full, wait for writability
+        FAILED    // Peer gone
+    };
+
+    struct Stats {
+        size_t queued_packets;
+        size_t queued_bytes;
+        size_t peak_queued_packets;
+        uint64_t frames_sent;
+        uint64_t frames_dropped;
+        uint64_t keyframe_resyncs;  // Times the client had to skip ahead to a keyframe
+        uint32_t lag_ms;            // Age of the oldest queued packet
+        int32_t join_to_keyframe_ms;  // Connect to first keyframe queued; -1 while waiting
+        uint32_t rtt_ms;            // Smoothed, from receiver reports
+        int estimated_kbps;         // 0 until the client reports
+        float loss;
+    };
+
+    ClientConnection(int socket_fd, const std::string& address, size_t max_queued = 8,
+                     const BandwidthEstimator::Config& rate_config = BandwidthEstimator::Config());
+    ~ClientConnection();
+
+    ClientConnection(const ClientConnection&) = delete;
+    ClientConnection& operator=(const ClientConnection&) = delete;
+
+    // Queues a packet for the I/O thread, dropping frames when the queue is
+    // full; false once disconnected
+    bool send_frame(const SharedPacket& packet);
+
+    // True once each time the client starts waiting for a keyframe
+    bool take_keyframe_request() { return keyframe_requested_.exchange(false); }
+
+    // Control reader thread; the report's timestamps are on the server clock
+    void on_receiver_report(const common::ReceiverReport& report);
+    const BandwidthEstimator& bandwidth() const { return bandwidth_; }
+
+    // Shuts the socket down; the descriptor is closed on destruction
+    void disconnect();
+    bool is_connected() const { return connected_; }
+
+    std::string get_info() const;
+    Stats get_stats() const;
+    size_t get_bytes_sent() const { return bytes_sent_; }
+    int get_socket() const { return socket_fd_; }
+
+    // I/O thread only: write as much of the queue as the socket takes;
+    // send_latency gets seal-to-last-byte time for every frame completed
+    FlushResult flush(LatencyHistogram* send_latency = nullptr);
+    bool has_pending() const;
+
+private:
+    int socket_fd_;
+    std::string address_;
+    std::atomic<bool> connected_;
+    std::atomic<size_t> bytes_sent_;
+    std::atomic<bool> keyframe_requested_;
+    BandwidthEstimator bandwidth_;
+
+    // Producers push and may drop unsent entries; only the I/O thread pops,
+    // and the first in_flight_ entries stay put while its write is running
+    mutable std::mutex queue_mutex_;
+    std::deque<SharedPacket> send_queue_;
+    size_t send_offset_;  // Bytes of the front packet already written
+    size_t in_flight_;
+    size_t max_queued_;
+    bool awaiting_keyframe_;
+    bool started_;  // First keyframe queued
+    std::chrono::steady_clock::time_point connected_at_;
+    int32_t join_to_keyframe_ms_;
+
+    size_t peak_queued_;
+    uint64_t frames_sent_;
+    uint64_t frames_dropped_;
+    uint64_t keyframe_resyncs_;
+
+    // Drops unsent frames matching the filter; returns how many went
+    template <typename Filter>
+    size_t drop_unsent(Filter filter);
+};
+
+/**
+ * @brief Small epoll thread pool that services every client socket
+ *
+ * Each client is pinned to one worker. notify_pending() wakes the workers
+ * through an eventfd after packets are queued; a worker writes until the
+ * socket would block, then waits for EPOLLOUT on that socket alone. Thread
+ * count stays fixed however many clients connect.
+ */
+class ClientIOPool {
+public:
+    explicit ClientIOPool(size_t num_threads = 2, LatencyHistogram* send_latency = nullptr);
+    ~ClientIOPool();
+
+    ClientIOPool(const ClientIOPool&) = delete;
+    ClientIOPool& operator=(const ClientIOPool&) = delete;
+
+    bool start();
+    void stop();
+
+    bool add_client(const std::shared_ptr<ClientConnection>& client);
+
+    // Call after queueing packets on any number of clients
+    void notify_pending();
+
+    size_t thread_count() const { return workers_.size(); }
+
+private:
+    struct Entry {
+        std::shared_ptr<ClientConnection> client;
+        bool waiting_writable = false;
+    };
+
+    struct Worker {
+        int epoll_fd = -1;
+        int event_fd = -1;
+        std::thread thread;
+
+        std::mutex incoming_mutex;
+        std::vector<std::shared_ptr<ClientConnection>> incoming;
+
+        std::unordered_map<int, Entry> clients;  // Worker thread only
+    };
+
+    void worker_loop(Worker& worker);
+    void flush_entry(Worker& worker, Entry& entry);
+    void remove_entry(Worker& worker, int fd);
+
+    size_t num_threads_;
+    LatencyHistogram* send_latency_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_worker_;
+    std::atomic<bool> running_;
+};
+
+} // namespace server
+} // namespace blustream
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "blustream/server/brick_cache.h"
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief Precomputed transfer-function tables for slice colour mapping
+ *
+ * The transfer curve is evaluated once per table entry when the value range
+ * or map changes; mapping a slice is then a table lookup per sample. U8
+ * samples index a 256-entry table directly, U16 samples use their top 12
+ * bits and F32 samples are quantized into a 4096-entry table over the range.
+ * Lookups use AVX2 gathers or NEON table shuffles when the CPU has them.
+ * Matching BT.601 limited-range luma/chroma tables let a slice be written
+ * straight into I420 planes without an RGB intermediate.
+ * A built ColorMap is immutable, so one instance can be shared by threads.
+ */
+class ColorMap {
+public:
+    enum class Type {
+        SEISMIC_GRAY,    // Smoothed gamma grayscale over [min, max]
+        GRAY,            // Linear grayscale over [min, max]
+        RED_WHITE_BLUE   // Diverging, symmetric around zero amplitude
+    };
+
+    struct Params {
+        Type type = Type::SEISMIC_GRAY;
+        float min_value = 0.0f;
+        float max_value = 1.0f;
+
+        // Sample encoding the code tables are built for (value = offset + scale * code)
+        float scale = 1.0f;
+        float offset = 0.0f;
+    };
+
+    static constexpr size_t U8_ENTRIES = 256;
+    static constexpr size_t WIDE_ENTRIES = 4096;
+
+    ColorMap();
+
+    void build(const Params& params);
+    const Params& get_params() const { return params_; }
+    bool is_grayscale() const { return params_.type != Type::RED_WHITE_BLUE; }
+
+    // Map count samples of the given format to packed RGB24
+    void map(SampleFormat format, const void* samples, size_t count, uint8_t* rgb) const;
+
+    // Map count samples to BT.601 limited-range Y, or to packed U | V << 8
+    void map_luma(SampleFormat format, const void* samples, size_t count, uint8_t* luma) const;
+    void map_chroma(SampleFormat format, const void* samples, size_t count, uint16_t* chroma) const;
+
+    // RGB table for a format and where a texture-sampled value lands in it:
+    // entry = sample * index_scale + index_offset, with integer formats
+    // normalized to [0, 1] and F32 samples taken as-is
+    const uint32_t* get_rgb_table(SampleFormat format, size_t& entries,
+                                  float& index_scale, float& index_offset) const;
+
+    // Colour of a single amplitude (slow path, bypasses the tables)
+    void color_of(float value, uint8_t& r, uint8_t& g, uint8_t& b) const;
+
+    // BT.601 limited-range conversion used for every YUV table entry
+    static uint8_t rgb_to_luma(uint8_t r, uint8_t g, uint8_t b);
+    static uint16_t rgb_to_chroma(uint8_t r, uint8_t g, uint8_t b);  // U | V << 8
+
+    static bool parse_type(const std::string& name, Type& type);
+    static std::string type_to_string(Type type);
+
+    // Which lookup kernel map() uses on this CPU
+    static std::string get_kernel_name();
+
+private:
+    Params params_;
+
+    // Range each table spans; symmetric maps centre it on zero
+    float range_lo_;
+    float range_hi_;
+    float f32_index_scale_;  // (WIDE_ENTRIES - 1) / (range_hi_ - range_lo_)
+
+    // Packed 0x00BBGGRR entries for gather kernels
+    uint32_t lut_u8_[U8_ENTRIES];
+    uint32_t lut_u16_[WIDE_ENTRIES];
+    uint32_t lut_f32_[WIDE_ENTRIES];
+
+    // Planar copies of the U8 table for byte-shuffle kernels
+    uint8_t lut_u8_r_[U8_ENTRIES];
+    uint8_t lut_u8_g_[U8_ENTRIES];
+    uint8_t lut_u8_b_[U8_ENTRIES];
+
+    // The same entries converted to YUV; chroma is packed U | V << 8
+    uint8_t luma_u8_[U8_ENTRIES];
+    uint8_t luma_u16_[WIDE_ENTRIES];
+    uint8_t luma_f32_[WIDE_ENTRIES];
+    uint16_t chroma_u8_[U8_ENTRIES];
+    uint16_t chroma_u16_[WIDE_ENTRIES];
+    uint16_t chroma_f32_[WIDE_ENTRIES];
+
+    template <typename Entry>
+    void lookup(SampleFormat format, const void* samples, size_t count,
+                const Entry* table_u8, const Entry* table_u16, const Entry* table_f32, Entry* out) const;
+};
+
+} // namespace server
+} // namespace blustream
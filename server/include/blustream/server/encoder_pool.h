@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blustream/server/hardware_encoder.h"
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief Encoders for many concurrent streams, scheduled over a few threads
+ *
+ * Every stream leases its own HardwareEncoder, sized and keyed for that
+ * stream, since an H.264 encoder carries GOP state and one resolution.
+ * GPU leases are capped at max_gpu_encoders (NVENC limits concurrent
+ * sessions per board); beyond that streams get software x264 encoders up
+ * to max_cpu_encoders, and acquire() fails once both are used up.
+ *
+ * submit() hands a lease its newest frame. A frame that is still waiting
+ * when the next one arrives is replaced and counted as dropped, so a
+ * stream that can't keep up stays live. Ready leases are queued on one
+ * worker's deque; idle workers steal from the back of the others, so
+ * expensive CPU encodes and cheap GPU encodes even out across threads. A
+ * lease is only ever on one deque and encoded by one worker at a time,
+ * which keeps each stream's frames in order.
+ */
+class EncoderPool {
+public:
+    struct Config {
+        HardwareEncoder::Type gpu_encoder_type = HardwareEncoder::Type::AUTO_DETECT;
+        size_t max_gpu_encoders = 3;  // Consumer NVENC session limit
+        size_t max_cpu_encoders = 4;
+        size_t num_workers = 0;       // 0 = one per hardware thread, at most 8
+    };
+
+    // Called on a worker thread with the encoded frame, which lives in the
+    // lease's reused output buffer and is only valid during the call
+    using FrameCallback = std::function<void(const std::vector<uint8_t>& encoded, bool keyframe)>;
+
+    class Lease {
+    public:
+        bool is_hardware() const { return hardware_; }
+        const std::string& encoder_name() const { return name_; }
+        void request_keyframe() { encoder_->request_keyframe(); }
+        void set_bitrate(int kbps) { encoder_->set_bitrate(kbps); }  // Applied before the next frame
+
+        struct Stats {
+            uint64_t frames_encoded;
+            uint64_t frames_dropped;  // Replaced before a worker got to them
+            float avg_encode_time_ms;
+        };
+        Stats get_stats() const;
+
+    private:
+        friend class EncoderPool;
+
+        std::unique_ptr<HardwareEncoder> encoder_;
+        FrameCallback on_frame_;
+        bool hardware_ = false;
+        std::string name_;
+        size_t home_worker_ = 0;
+
+        mutable std::mutex mutex_;
+        std::vector<uint8_t> pending_;  // Newest submitted RGB frame
+        std::vector<uint8_t> working_;  // Frame being encoded; swapped with pending_
+        std::vector<uint8_t> encoded_;  // Worker output, handed to on_frame_
+        bool has_pending_ = false;
+        bool queued_ = false;     // On a worker deque or being encoded
+        bool released_ = false;
+        bool encoding_ = false;
+        std::condition_variable idle_cv_;
+
+        uint64_t frames_encoded_ = 0;
+        uint64_t frames_dropped_ = 0;
+        float avg_encode_time_ms_ = 0.0f;
+    };
+
+    struct Stats {
+        size_t gpu_encoders;
+        size_t cpu_encoders;
+        size_t workers;
+        uint64_t frames_encoded;
+        uint64_t frames_dropped;
+        uint64_t steals;
+    };
+
+    EncoderPool();
+    explicit EncoderPool(const Config& config);
+    ~EncoderPool();
+
+    EncoderPool(const EncoderPool&) = delete;
+    EncoderPool& operator=(const EncoderPool&) = delete;
+
+    bool start();
+    void stop();
+
+    // GPU first, then CPU; null when the pool is full or the encoder fails.
+    // encoder_type in the config is chosen by the pool.
+    std::shared_ptr<Lease> acquire(const HardwareEncoder::Config& encoder_config, FrameCallback on_frame);
+
+    // Waits for an in-progress encode, then frees the encoder slot
+    void release(const std::shared_ptr<Lease>& lease);
+
+    // Queues a copy of the frame for encoding into the lease's own buffer
+    // (no allocation once it has grown); false once released
+    bool submit(const std::shared_ptr<Lease>& lease, const uint8_t* rgb_data, size_t size);
+
+    Stats get_stats() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<Lease>> ready;
+        std::thread thread;
+    };
+
+    void worker_loop(size_t index);
+    bool take_work(size_t index, std::shared_ptr<Lease>& lease);
+    bool encode(Lease& lease);  // True if another frame is waiting
+    void schedule(const std::shared_ptr<Lease>& lease);
+
+    Config config_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_;
+
+    // Workers sleep here when every deque is empty. Also guards workers_
+    // against stop() for submitters.
+    mutable std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    size_t ready_count_;  // Leases on any deque; guarded by wake_mutex_
+
+    mutable std::mutex leases_mutex_;
+    size_t gpu_leases_;
+    size_t cpu_leases_;
+    size_t next_home_;
+
+    std::atomic<uint64_t> frames_encoded_;
+    std::atomic<uint64_t> frames_dropped_;
+    std::atomic<uint64_t> steals_;
+};
+
+} // namespace server
+} // namespace blustream
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief Bounded lock-free single-producer/single-consumer ring
+ *
+ * Hands small trivially copyable items (frame pointers) from one pipeline
+ * stage to the next. When the ring is full the producer can evict the
+ * oldest item instead of blocking, so a slow stage sees the freshest work.
+ * Both sides advance the head with a CAS for that; everything else is
+ * plain acquire/release. pop_wait() parks the consumer on a condition
+ * variable that producers only touch while someone is waiting.
+ */
+template <typename T>
+class SPSCRing {
+    static_assert(std::is_trivially_copyable<T>::value, "SPSCRing items must be trivially copyable");
+
+public:
+    explicit SPSCRing(size_t capacity)
+        : capacity_(capacity > 0 ? capacity : 1)
+        , slots_(new std::atomic<T>[capacity_])
+        , head_(0)
+        , tail_(0)
+        , waiting_(false) {
+    }
+
+    SPSCRing(const SPSCRing&) = delete;
+    SPSCRing& operator=(const SPSCRing&) = delete;
+
+    size_t capacity() const { return capacity_; }
+
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    // Producer only; false when the ring is full
+    bool try_push(T item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= capacity_) {
+            return false;
+        }
+        publish(tail, item);
+        return true;
+    }
+
+    // Producer only; makes room by taking out the oldest item when full.
+    // Returns true and sets evicted when an item had to go.
+    bool push_evicting(T item, T& evicted) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        bool evicted_any = false;
+
+        while (tail - head >= capacity_) {
+            T oldest = slots_[head % capacity_].load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                evicted = oldest;
+                evicted_any = true;
+                break;
+            }
+            // Lost to the consumer (or spurious); head is reloaded, re-check for room
+        }
+
+        publish(tail, item);
+        return evicted_any;
+    }
+
+    // Consumer only
+    bool try_pop(T& item) {
+        size_t head = head_.load(std::memory_order_acquire);
+        while (head != tail_.load(std::memory_order_acquire)) {
+            T value = slots_[head % capacity_].load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                item = value;
+                return true;
+            }
+            // The producer evicted this item; try the next one
+        }
+        return false;
+    }
+
+    // Consumer only; waits up to timeout for an item
+    bool pop_wait(T& item, std::chrono::milliseconds timeout) {
+        if (try_pop(item)) {
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(wait_mutex_);
+        waiting_.store(true);
+        bool popped = wait_cv_.wait_for(lock, timeout, [&] { return try_pop(item); });
+        waiting_.store(false);
+        return popped;
+    }
+
+    // Wakes a waiting consumer without pushing, e.g. on shutdown
+    void notify() {
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        wait_cv_.notify_all();
+    }
+
+private:
+    void publish(size_t tail, T item) {
+        slots_[tail % capacity_].store(item, std::memory_order_relaxed);
+        tail_.store(tail + 1, std::memory_order_seq_cst);
+        if (waiting_.load()) {
+            notify();
+        }
+    }
+
+    const size_t capacity_;
+    std::unique_ptr<std::atomic<T>[]> slots_;
+    std::atomic<size_t> head_;  // Next item to pop; consumer, or producer when evicting
+    std::atomic<size_t> tail_;  // Next slot to fill; producer only
+
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
+    std::atomic<bool> waiting_;
+};
+
+/**
+ * @brief Lock-free latency histogram with quarter-octave buckets
+ *
+ * Records microsecond durations into log-spaced buckets (four per power of
+ * two, so percentiles are within about 12%), cheap enough to call from
+ * every pipeline stage for every frame. Counts accumulate since the last
+ * reset().
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 128;
+
+    LatencyHistogram();
+
+    void record(std::chrono::steady_clock::duration elapsed);
+    void record_us(uint64_t microseconds);
+    void reset();
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t total_us() const { return total_us_.load(std::memory_order_relaxed); }
+    float mean_ms() const;
+    float max_ms() const { return static_cast<float>(max_us_.load(std::memory_order_relaxed)) / 1000.0f; }
+
+    // Upper edge of the bucket holding the p-th percentile (p in [0, 1])
+    float percentile_ms(double p) const;
+
+    // "p50 1.2ms p99 3.4ms max 5.6ms"
+    std::string summary() const;
+
+private:
+    static size_t bucket_of(uint64_t microseconds);
+    static uint64_t bucket_upper_us(size_t bucket);
+
+    std::atomic<uint64_t> buckets_[BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> total_us_;
+    std::atomic<uint64_t> max_us_;
+};
+
+/**
+ * @brief Skips ticks whose picture would repeat the last one
+ *
+ * A view is everything that decides the pixels: slice axis and index,
+ * colour map and output size. After a change a few more frames still go
+ * out (settle_frames), so the encoder can refine the still picture and a
+ * one-frame-late GPU readback catches up. After that, ticks are skipped
+ * and clients keep showing the last frame. A tick renders again when:
+ * - the view changes;
+ * - a client is waiting for a keyframe (a new viewer or a resync);
+ * - refresh_interval has passed, which re-sends a keyframe.
+ * Single-threaded: one render loop owns each gate.
+ */
+class StillFrameGate {
+public:
+    struct View {
+        int axis = -1;
+        int index = -1;
+        int lod = 0;                     // Level of detail; refining a still view renders it again
+        const void* colormap = nullptr;  // Identity of the colour map in use
+        int width = 0;
+        int height = 0;
+
+        bool operator==(const View& other) const;
+        bool operator!=(const View& other) const { return !(*this == other); }
+    };
+
+    enum class Decision {
+        RENDER,   // Something changed, or still settling
+        REFRESH,  // Unchanged, but due for a refresh keyframe
+        SKIP      // Unchanged; leave the last frame on screen
+    };
+
+    explicit StillFrameGate(int settle_frames = 8,
+                            std::chrono::steady_clock::duration refresh_interval = std::chrono::seconds(5));
+
+    Decision update(const View& view, bool keyframe_pending,
+                    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // The next update() renders whatever it is given
+    void invalidate() { valid_ = false; }
+
+    uint64_t skipped() const { return skipped_; }
+
+private:
+    int settle_frames_;
+    std::chrono::steady_clock::duration refresh_interval_;
+
+    bool valid_;
+    View view_;
+    int frames_since_change_;
+    std::chrono::steady_clock::time_point last_sent_;
+    uint64_t skipped_;
+};
+
+} // namespace server
+} // namespace blustream
@@ -4,6 +4,9 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <atomic>
+
+#include "blustream/server/yuv_converter.h"
 
 // Forward declarations for FFmpeg
 struct AVCodecContext;
@@ -56,7 +59,13 @@ public:
         // Hardware-specific settings
         bool use_zero_copy = true;     // OpenGL → GPU encoder direct
         bool enable_b_frames = false;  // Disable for lower latency
-        int async_depth = 4;           // Encoder pipeline depth
+        int async_depth = 4;           // Encoder pipeline depth when low_latency is off
+        
+        // Latency tuning
+        bool low_latency = true;       // zerolatency/ull tuning, no lookahead, one frame in flight
+        int slices_per_frame = 0;      // >1 splits each picture into independently decodable slices
+        bool intra_refresh = false;    // Rolling intra refresh over keyframe_interval frames, no periodic IDR
+        std::string profile;           // H.264 profile ("baseline", "main", "high"), empty = encoder default
         
         // Rate control
         enum RateControl {
@@ -66,6 +75,11 @@ public:
         } rate_control = VBR;
         
         int crf_quality = 23;  // For CQP mode (18-28 range)
+        int target_latency_ms = 150;  // Sizes the VBV buffer, so a frame burst drains within it
+        
+        // RGB input conversion for encode_frame()
+        YUVConverter::Backend yuv_backend = YUVConverter::Backend::NATIVE;
+        size_t yuv_threads = 1;  // Native backend threads (0 = auto); one encoder per session, so inline by default
     };
     
     HardwareEncoder();
@@ -76,12 +90,47 @@ public:
     void shutdown();
     bool is_initialized() const { return initialized_; }
     
-    // Encoding operations
-    std::vector<uint8_t> encode_frame(const std::vector<uint8_t>& rgb_data);
-    std::vector<uint8_t> encode_frame_yuv(const uint8_t* y_data, const uint8_t* u_data, const uint8_t* v_data);
+    // Encoding operations. Each replaces the contents of `encoded` with the
+    // next access unit and returns false if there is none yet; the caller
+    // keeps the buffer, so its capacity carries over and steady-state
+    // encoding doesn't allocate. A pipelined encoder (async NVENC/QSV,
+    // lookahead) can release several packets for one frame, so drain
+    // receive_packet() after every call. rgb_data is width * height packed
+    // RGB24 samples.
+    bool encode_frame(const uint8_t* rgb_data, size_t size, std::vector<uint8_t>& encoded);
+    
+    // Next packet the encoder has ready, in decode order; false when it
+    // needs more input
+    bool receive_packet(std::vector<uint8_t>& encoded);
+    
+    // End of stream: the encoder gives up the frames it still holds, first
+    // one in `encoded`, the rest through receive_packet(). It takes no more
+    // input until initialize() is called again.
+    bool flush(std::vector<uint8_t>& encoded);
+    
+    // Fill-in-place path: write the YUV420P planes of get_input_frame(), then
+    // call encode_input_frame(). Returns null if the frame can't be written.
+    AVFrame* get_input_frame();
+    bool encode_input_frame(std::vector<uint8_t>& encoded);
+    
+    // Encode an RGBA8 GL texture of the configured size whose row 0 is the top
+    // of the frame. The calling thread must have the texture's context current.
+    // With zero-copy active NVENC reads it through CUDA-GL interop; otherwise
+    // it is read back and converted on the CPU.
+    bool encode_from_texture(unsigned int gl_texture_id, std::vector<uint8_t>& encoded);
     
-    // Zero-copy OpenGL integration (future enhancement)
-    std::vector<uint8_t> encode_from_texture(unsigned int gl_texture_id);
+    // True when NVENC takes GPU textures directly; CPU input frames are then unavailable
+    bool is_zero_copy_active() const { return zero_copy_active_; }
+    
+    // Make the next encoded frame an IDR (thread-safe)
+    void request_keyframe() { keyframe_requested_ = true; }
+    
+    // Retarget rate control from the next frame on (thread-safe). libx264
+    // and NVENC reconfigure in place, without an IDR.
+    void set_bitrate(int kbps) { requested_bitrate_kbps_ = kbps; }
+    
+    // Whether the last packet returned was a keyframe
+    bool last_frame_was_keyframe() const { return last_frame_keyframe_; }
     
     // Encoder information
     Type get_active_encoder_type() const { return active_encoder_type_; }
@@ -100,6 +149,14 @@ public:
     };
     Stats get_stats() const;
     
+    // Simulcast ladder for one rendered picture: the top layer is config
+    // itself, each further layer about 2/3 the height of the one above
+    // (1080p -> 720p -> 360p style) with bitrate scaled by pixel count.
+    // Stops at max_layers, or before a layer would drop below min_height
+    // or min_bitrate_kbps.
+    static std::vector<Config> make_simulcast_ladder(const Config& config, size_t max_layers,
+                                                     int min_bitrate_kbps, int min_height = 180);
+    
     // Static utility functions
     static std::vector<Type> get_available_encoders();
     static std::string encoder_type_to_string(Type type);
@@ -123,28 +180,45 @@ private:
     
     // Frame conversion
     std::unique_ptr<AVFrame, void(*)(AVFrame*)> hw_frame_;
-    std::vector<uint8_t> yuv_buffer_;  // For RGB→YUV conversion
+    
+    // Zero-copy texture input (CUDA-GL interop builds only)
+    bool zero_copy_active_;
+    void* gl_interop_resource_;         // CUgraphicsResource of the registered texture
+    unsigned int gl_interop_texture_;   // Texture the resource was registered for
+    std::vector<uint8_t> texture_readback_;  // RGB24 staging when interop is unavailable
+    YUVConverter yuv_converter_;  // For RGB→YUV conversion
+    
+    std::atomic<bool> keyframe_requested_;
+    std::atomic<int> requested_bitrate_kbps_;  // 0 = no change pending
+    bool last_frame_keyframe_;
+    int64_t next_pts_;
     
     // Performance tracking
     mutable std::mutex stats_mutex_;
     Stats stats_;
     std::chrono::steady_clock::time_point encode_start_time_;
     std::chrono::steady_clock::time_point stats_start_time_;
-    std::vector<float> encode_times_;  // Rolling window for averages
+    uint64_t stats_timed_frames_;
     
     // Initialization helpers
+    void configure_common(AVCodecContext* ctx);
+    void configure_vbv(AVCodecContext* ctx);
     bool initialize_nvenc_encoder();
     bool initialize_quicksync_encoder();
     bool initialize_software_encoder();
+    bool initialize_cuda_frames(AVCodecContext* ctx);
+    void release_cuda_frames();
     
     // Hardware detection
     Type detect_best_encoder();
     bool test_encoder_availability(Type type);
     
     // Frame processing
-    bool convert_rgb_to_yuv420(const std::vector<uint8_t>& rgb_data, AVFrame* frame);
+    bool convert_rgb_to_yuv420(const uint8_t* rgb_data, size_t size, AVFrame* frame);
     bool upload_frame_to_hardware(AVFrame* sw_frame, AVFrame* hw_frame);
-    std::vector<uint8_t> extract_encoded_data(AVPacket* packet);
+    bool copy_texture_to_hardware(unsigned int gl_texture_id, AVFrame* hw_frame);
+    bool encode_avframe(AVFrame* frame, std::vector<uint8_t>& encoded);
+    void apply_bitrate(int kbps);
     
     // Utility
     void update_performance_stats(float encode_time_ms);
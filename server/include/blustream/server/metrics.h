@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blustream/server/frame_pipeline.h"
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief Monotonic event counter sharded across cache lines
+ *
+ * Each thread adds to its own shard with a relaxed atomic, so pipeline
+ * stages counting the same event never contend; value() sums the shards.
+ */
+class Counter {
+public:
+    void add(uint64_t n = 1);
+    uint64_t value() const;
+
+private:
+    static constexpr size_t SHARDS = 16;
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    Shard shards_[SHARDS];
+};
+
+/**
+ * @brief Named counters, gauges and latency histograms for export
+ *
+ * Registration takes a lock and is meant for start-up; it hands back a
+ * reference that stays valid for the registry's lifetime, and the hot path
+ * only touches that object's atomics. prometheus_text() renders the text
+ * exposition format: histograms go out as summaries, in seconds, with
+ * p50/p99/p999 quantiles. A label such as stage="encode" lets several
+ * series share one metric name.
+ */
+class MetricsRegistry {
+public:
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    LatencyHistogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    // read() runs on the exporting thread and must be thread-safe
+    void gauge(const std::string& name, const std::string& help, std::function<double()> read,
+               const std::string& labels = "");
+
+    std::string prometheus_text() const;
+
+private:
+    enum class Kind { COUNTER, GAUGE, SUMMARY };
+    struct Series {
+        Kind kind;
+        std::string name;
+        std::string help;
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<LatencyHistogram> histogram;
+        std::function<double()> gauge;
+    };
+
+    Series& add_series(Kind kind, const std::string& name, const std::string& help, const std::string& labels);
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Series>> series_;
+};
+
+/**
+ * @brief Fixed-size ring of timed spans for Chrome's trace viewer
+ *
+ * record() costs one relaxed load while tracing is off. When it's on,
+ * each span claims a slot with a fetch_add and the oldest spans are
+ * overwritten. chrome_trace_json() produces a file for chrome://tracing
+ * or Perfetto. Span names must be string literals. A dump taken while
+ * threads are still recording can show a span that was overwritten
+ * halfway.
+ */
+class TraceRecorder {
+public:
+    explicit TraceRecorder(size_t capacity = 65536);
+
+    void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void record(const char* name, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end);
+
+    std::string chrome_trace_json() const;
+    bool write_chrome_trace(const std::string& path) const;
+
+private:
+    struct Event {
+        std::atomic<const char*> name{nullptr};  // Null while being written
+        std::atomic<uint32_t> thread{0};
+        std::atomic<int64_t> start_us{0};
+        std::atomic<int64_t> duration_us{0};
+    };
+
+    std::atomic<bool> enabled_;
+    const size_t capacity_;
+    std::unique_ptr<Event[]> events_;
+    std::atomic<uint64_t> next_;
+    const std::chrono::steady_clock::time_point epoch_;
+};
+
+/**
+ * @brief Minimal HTTP endpoint for scraping metrics
+ *
+ * One thread answers GET /metrics with the registry's Prometheus text and,
+ * if a recorder is given, GET /trace with its Chrome trace. Requests are
+ * served one at a time and each connection is closed after its response,
+ * which is all a scraper needs. Linux only, like the client I/O pool.
+ */
+class MetricsServer {
+public:
+    explicit MetricsServer(const MetricsRegistry& registry, const TraceRecorder* trace = nullptr);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    bool start(int port);
+    void stop();
+
+private:
+    void serve_loop();
+    void handle_connection(int fd);
+
+    const MetricsRegistry& registry_;
+    const TraceRecorder* trace_;
+    int listen_fd_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
+
+} // namespace server
+} // namespace blustream
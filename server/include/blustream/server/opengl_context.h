@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -18,6 +20,8 @@
 #include <windows.h>
 #endif
 
+#include "blustream/server/vds_manager.h"
+
 namespace blustream {
 namespace server {
 
@@ -111,10 +115,123 @@ public:
      */
     std::string get_gl_renderer() const;
 
+    /**
+     * @brief Create or resize the offscreen frame render target
+     * 
+     * An RGBA8 texture attached to a framebuffer object. Encoders that can
+     * read GPU memory take frames from this texture without a CPU readback.
+     * Requires OpenGL 3.0 framebuffer objects; the context must be current.
+     * 
+     * @param width Target width in pixels
+     * @param height Target height in pixels
+     * @return true if the target is complete
+     */
+    bool create_render_target(int width, int height);
+
+    /**
+     * @brief Release the render target and its staging texture
+     */
+    void destroy_render_target();
+
+    /**
+     * @brief Upload a packed RGB image and scale it into the render target
+     * 
+     * Only the source image crosses the bus; scaling runs on the GPU. Row 0
+     * of the target texture is the top of the image, the layout video
+     * encoders expect.
+     * 
+     * @param rgb Packed RGB24 pixels, rows top to bottom
+     * @param width Image width in pixels
+     * @param height Image height in pixels
+     * @param linear_filter Bilinear instead of nearest-neighbour scaling
+     * @return true if the image was drawn
+     */
+    bool draw_rgb_image(const uint8_t* rgb, int width, int height, bool linear_filter);
+
+    /**
+     * @brief Compile the shader program draw_slice() renders with
+     * 
+     * Needs OpenGL 3.3 (GLSL 330); the context must be current.
+     * 
+     * @return true if the program linked
+     */
+    bool create_slice_renderer();
+
+    /**
+     * @brief Upload a native slice and colour map it into the render target
+     * 
+     * The slice goes up once in its own sample type (R8, R16 or R32F) with
+     * the colormap's RGB table beside it. The fragment shader samples the
+     * amplitudes with bilinear filtering and looks each result up in the
+     * table, so interpolation happens before classification. Row 0 of the
+     * target is slice row 0, as with draw_rgb_image().
+     * 
+     * @param slice Slice in the volume's sample format
+     * @param colormap Transfer function for the slice's value range
+     * @return true if the slice was drawn
+     */
+    bool draw_slice(const VDSManager::SliceBuffer& slice, const ColorMap& colormap);
+
+    /**
+     * @brief Read the render target back through double-buffered PBOs
+     * 
+     * Each call queues an asynchronous readback of the current frame and
+     * hands the previous one to consume as packed RGB24, rows top to bottom,
+     * so the transfer overlaps a frame of work at the cost of one frame of
+     * latency.
+     * 
+     * @param consume Called with the pixels and their row stride in bytes
+     * @return true if a frame was handed over (false on the first call)
+     */
+    bool read_render_target(const std::function<void(const uint8_t* rgb, int stride)>& consume);
+
+    /**
+     * @brief Check if the slice shader program is ready
+     */
+    bool has_slice_renderer() const { return slice_program_ != 0; }
+
+    /**
+     * @brief Check if a complete render target exists
+     */
+    bool has_render_target() const { return render_framebuffer_ != 0; }
+
+    GLuint get_render_texture() const { return render_texture_; }
+    GLuint get_render_framebuffer() const { return render_framebuffer_; }
+    int get_render_width() const { return render_width_; }
+    int get_render_height() const { return render_height_; }
+
 private:
     ContextConfig config_;
     bool context_valid_ = false;
 
+    // Frame render target plus the staging texture images are uploaded into
+    GLuint render_texture_ = 0;
+    GLuint render_framebuffer_ = 0;
+    int render_width_ = 0;
+    int render_height_ = 0;
+    GLuint staging_texture_ = 0;
+    GLuint staging_framebuffer_ = 0;
+    int staging_width_ = 0;
+    int staging_height_ = 0;
+
+    // Slice shader plus the textures it samples
+    GLuint slice_program_ = 0;
+    GLuint slice_vertex_array_ = 0;
+    GLuint slice_texture_ = 0;
+    GLuint table_texture_ = 0;
+    int slice_texture_width_ = 0;
+    int slice_texture_height_ = 0;
+    SampleFormat slice_texture_format_ = SampleFormat::U8;
+    GLint uniform_index_scale_ = -1;
+    GLint uniform_index_offset_ = -1;
+    GLint uniform_entries_ = -1;
+
+    // Readback buffers, alternating each frame
+    GLuint readback_buffers_[2] = {0, 0};
+    size_t readback_size_ = 0;
+    int readback_index_ = 0;
+    bool readback_pending_ = false;
+
 #ifdef __linux__
     Display* display_ = nullptr;
     GLXContext glx_context_ = nullptr;
@@ -141,6 +258,22 @@ private:
      * @return true if initialization successful
      */
     bool initialize_gl();
+
+    /**
+     * @brief Resolve the post-1.1 entry points the render target needs
+     * 
+     * @return true if framebuffer objects are available
+     */
+    bool load_gl_functions();
+
+    /**
+     * @brief Resolve the shader, vertex array and buffer entry points
+     * 
+     * @return true if the slice renderer and PBO readback are available
+     */
+    bool load_shader_functions();
+
+    void destroy_slice_renderer();
 };
 
 }  // namespace server
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "blustream/common/types.h"
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief One wire message shared by every client it goes to
+ *
+ * The header and payload are written once by the producer and then only
+ * read; each client holds a reference until its socket has taken the last
+ * byte.
+ */
+struct WirePacket {
+    common::MessageHeader header;
+    std::vector<uint8_t> payload;
+    bool keyframe = false;
+    bool droppable = false;  // No later frame references this one
+    std::chrono::steady_clock::time_point sealed_at;  // For send latency; header.timestamp is in ms
+
+    // Fills in the header for the current payload
+    void seal(common::MessageType type, uint32_t sequence = 0);
+
+    size_t wire_size() const { return sizeof(header) + payload.size(); }
+};
+
+using SharedPacket = std::shared_ptr<const WirePacket>;
+
+// True when an Annex B access unit carries slices but none of them is
+// used for reference (nal_ref_idc == 0), so skipping it breaks nothing
+bool h264_is_non_reference(const uint8_t* data, size_t size);
+
+/**
+ * @brief Recycles WirePacket buffers across frames
+ *
+ * acquire() hands out a packet whose payload keeps the capacity it grew to
+ * last time; when the last reference goes the packet returns to the pool
+ * instead of being freed. Returned packets outlive the pool safely.
+ * Thread-safe.
+ */
+class PacketPool {
+public:
+    explicit PacketPool(size_t max_cached = 64);
+
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    std::shared_ptr<WirePacket> acquire();
+
+    // Fills the free list up to count packets (at most max_cached) whose
+    // payloads already hold payload_bytes, so the first frames don't grow them
+    void reserve(size_t count, size_t payload_bytes);
+
+    size_t cached() const;
+
+private:
+    struct State {
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<WirePacket>> free;
+        size_t max_cached;
+    };
+    std::shared_ptr<State> state_;
+};
+
+} // namespace server
+} // namespace blustream
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "blustream/server/brick_cache.h"
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief Streaming amplitude histogram fed one brick at a time
+ *
+ * Bins span a fixed value range, normally the volume's sample encoding
+ * range; samples outside it land in the edge bins. Each brick is binned
+ * into a local histogram and merged with one atomic add per bin, so the
+ * threads loading bricks can all feed it at once. Exact min/max are tracked
+ * alongside, and percentiles can be read at any time from whatever has
+ * arrived so far, with no full-volume pass.
+ */
+class SampleHistogram {
+public:
+    static constexpr size_t BINS = 1024;
+
+    SampleHistogram();
+
+    // Empty the histogram and span [lo, hi]; not safe against concurrent add()
+    void reset(float lo, float hi);
+
+    // Bin every sample of a brick, decoded as offset + scale * stored sample
+    void add(const BrickCache::Brick& brick, float scale, float offset);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    bool observed_range(float& min_value, float& max_value) const;
+
+    // Values at two percentiles (0-100), interpolated within a bin and kept
+    // inside the observed range; false until a sample has arrived
+    bool percentile_range(float low_percentile, float high_percentile, float& low, float& high) const;
+
+private:
+    using LocalBins = std::array<uint32_t, BINS>;
+
+    template <typename T>
+    void accumulate(const T* samples, size_t count, float scale, float offset, LocalBins& bins,
+                    float& min_value, float& max_value) const;
+    float percentile(float percentile, uint64_t total) const;
+
+    float lo_;
+    float hi_;
+    float bin_scale_;  // BINS / (hi_ - lo_)
+    std::array<std::atomic<uint64_t>, BINS> bins_;
+    std::atomic<uint64_t> count_;
+    std::atomic<float> min_;
+    std::atomic<float> max_;
+};
+
+} // namespace server
+} // namespace blustream
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "blustream/server/colormap.h"
+#include "blustream/server/vds_manager.h"
+#include "blustream/server/yuv_converter.h"
+
+namespace blustream {
+namespace server {
+
+class ThreadPool;
+
+/**
+ * @brief Fused scale + colour map + YUV stage from native slices to I420
+ *
+ * Each output row is filled from the nearest source row: the source row is
+ * mapped through the colormap's luma table once, then expanded along the
+ * precomputed column map, and output rows that repeat a source row are
+ * copied from the row above. Grayscale maps write constant chroma; colour
+ * maps average the 2x2 block behind each chroma sample. Row pairs are split
+ * over the thread pool when one is given. Not thread-safe; use one
+ * compositor per render thread.
+ */
+class SliceCompositor {
+public:
+    explicit SliceCompositor(ThreadPool* pool = nullptr);
+
+    void set_thread_pool(ThreadPool* pool) { pool_ = pool; }
+
+    bool compose(const VDSManager::SliceBuffer& slice, const ColorMap& colormap, const YUV420Planes& out);
+
+    // Animated RGB gradient shown while no volume is loaded
+    static void compose_test_pattern(int frame_index, const YUV420Planes& out);
+
+    // Flat black, for frames whose slice could not be extracted
+    static void clear(const YUV420Planes& out);
+
+private:
+    ThreadPool* pool_;
+
+    // Nearest source column/row for every output column/row, rebuilt on resize
+    int map_slice_width_;
+    int map_slice_height_;
+    int map_out_width_;
+    int map_out_height_;
+    std::vector<int> src_cols_;
+    std::vector<int> src_rows_;
+
+    void update_maps(int slice_width, int slice_height, int out_width, int out_height);
+    void compose_rows(const VDSManager::SliceBuffer& slice, const ColorMap& colormap,
+                      const YUV420Planes& out, int pair_begin, int pair_end) const;
+};
+
+} // namespace server
+} // namespace blustream
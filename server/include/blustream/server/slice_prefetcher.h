@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace blustream {
+namespace server {
+
+class VDSManager;
+
+/**
+ * @brief Background warmer for the VDS brick cache
+ *
+ * The render thread reports the slice it is about to draw together with the
+ * current slice velocity (slices per frame, signed). A worker thread then
+ * predicts where the cursor will be over the next few frames and pulls the
+ * bricks backing those slices into the cache, so the render thread only ever
+ * copies resident data. A new report supersedes any prediction in progress.
+ */
+class SlicePrefetcher {
+public:
+    struct Config {
+        int lookahead_frames = 8;  // How far ahead of the cursor to warm
+        bool wrap = true;          // Animation loops back to the first slice
+    };
+
+    struct Stats {
+        size_t predictions;        // Cursor updates acted on
+        size_t slices_warmed;      // Predicted slices that needed loading
+        size_t slices_resident;    // Predicted slices already in cache
+        size_t bricks_loaded;
+    };
+
+    explicit SlicePrefetcher(const VDSManager& vds_manager);
+    ~SlicePrefetcher();
+
+    bool start(const Config& config);
+    void stop();
+    bool is_running() const { return running_; }
+
+    // Report the slice being rendered and the level of detail it is drawn
+    // at; velocity 0 warms both neighbours
+    void update(int axis, int index, float velocity, int lod = 0);
+
+    Stats get_stats() const;
+
+private:
+    const VDSManager& vds_manager_;
+    Config config_;
+
+    std::atomic<bool> running_;
+    std::thread worker_thread_;
+
+    // Latest cursor; generation_ bumps on every update so stale work is abandoned
+    std::mutex cursor_mutex_;
+    std::condition_variable cursor_cv_;
+    int cursor_axis_;
+    int cursor_index_;
+    float cursor_velocity_;
+    int cursor_lod_;
+    std::atomic<uint64_t> generation_;
+
+    std::atomic<size_t> predictions_;
+    std::atomic<size_t> slices_warmed_;
+    std::atomic<size_t> slices_resident_;
+    std::atomic<size_t> bricks_loaded_;
+
+    void worker_loop();
+    bool predict(int axis, int index, float velocity, int step, int& predicted) const;
+    void warm(int axis, int index, int lod);
+};
+
+} // namespace server
+} // namespace blustream
@@ -11,6 +11,12 @@
 #include "blustream/common/types.h"
 #include "blustream/server/opengl_context.h"
 #include "blustream/server/vds_manager.h"
+#include "blustream/server/slice_prefetcher.h"
+#include "blustream/server/slice_compositor.h"
+#include "blustream/server/frame_pipeline.h"
+#include "blustream/server/metrics.h"
+#include "blustream/server/packet_pool.h"
+#include "blustream/server/client_io.h"
 #include "blustream/server/network_server.h"
 
 // Forward declarations
@@ -24,15 +30,18 @@ namespace server {
 // Forward declarations
 class VDSRenderer;
 class VideoEncoder;
-class ClientConnection;
 
 /**
  * @brief Streaming server that renders VDS data and streams to clients
  * 
- * Pipeline:
- * 1. Render VDS slice using OpenGL
- * 2. Encode frame using x264/FFmpeg
- * 3. Stream encoded frames to connected clients
+ * Pipeline, one thread per stage joined by bounded SPSC rings:
+ * 1. Render: pick the slice and extract it (or draw it with OpenGL)
+ * 2. Convert: scale, colour map and write the encoder's I420 planes
+ * 3. Encode: x264/FFmpeg
+ * 4. Fanout: stream encoded frames to connected clients
+ *
+ * A stage that falls behind loses its stalest queued frame rather than
+ * stalling the stages before it.
  */
 class StreamingServer {
 public:
@@ -40,17 +49,31 @@ public:
         // Network
         int port = 8080;
         int max_clients = 10;
+        int io_threads = 2;            // epoll threads writing to client sockets
+        int client_queue_packets = 8;  // Per-client send queue; a full queue drops to the next keyframe
         
         // Rendering
         int render_width = 1920;
         int render_height = 1080;
         float target_fps = 30.0f;
+        bool gpu_render = false;       // Scale + colour map slices in a fragment shader, PBO readback
+        int pipeline_depth = 2;        // Frames queued between stages before the stalest is dropped
+        bool skip_still_frames = true; // Stop rendering and encoding while the slice doesn't change
+        int still_refresh_ms = 5000;   // Keyframe refresh while skipping
         
         // Encoding
         std::string encoder = "x264";  // "x264", "ffmpeg", "nvenc"
         int bitrate_kbps = 5000;
         std::string preset = "fast";   // ultrafast, fast, medium, slow
-        int keyframe_interval = 60;    // GOP size
+        int keyframe_interval = 60;    // GOP size, or the intra refresh period
+        int slices_per_frame = 0;      // >1 codes each picture as that many slices, on parallel threads
+        bool intra_refresh = false;    // Rolling intra refresh instead of an IDR every keyframe_interval
+        
+        // Rate control: client receiver reports steer the encoder bitrate
+        bool adaptive_bitrate = true;
+        int min_bitrate_kbps = 500;
+        int max_bitrate_kbps = 0;      // 0 = bitrate_kbps
+        int target_latency_ms = 150;   // Queuing delay budget; also sizes the VBV buffer
         
         // VDS
         std::string vds_path;
@@ -59,10 +82,25 @@ public:
         float animation_duration = 30.0f;      // Duration to traverse all slices (seconds)
         int initial_slice_axis = 2;            // 0=X, 1=Y, 2=Z (deprecated, use slice_orientation)
         int initial_slice_index = 32;
+        int vds_brick_size = 64;               // Brick edge length for the VDS page cache
+        size_t vds_cache_budget_mb = 2048;     // Resident brick budget
+        bool vds_crossline_layout = false;     // Transposed bricks for fast YZ (crossline) slices
+        std::string vds_sample_format = "u8";  // Resident sample type: "u8", "u16", "f32"
+        std::string vds_brick_file;            // Native brick file: mapped if current, else written once
+        int vds_lod_levels = 3;                // Downsampled levels for overview and fast scrubbing, 0 = off
+        std::string colormap = "seismic";      // "seismic", "gray", "red-white-blue"
+        float clip_low_percentile = 1.0f;      // Colour map range, from the streaming amplitude histogram
+        float clip_high_percentile = 99.0f;
+        bool enable_prefetch = true;           // Warm upcoming slices on a background thread
+        int prefetch_lookahead_frames = 8;     // How many frames ahead to predict
+        
+        // Observability
+        int metrics_port = 0;                  // HTTP /metrics (Prometheus) and /trace; 0 = off
+        std::string trace_path;                // Record stage spans; Chrome trace written here on stop
     };
     
     StreamingServer();
-    ~StreamingServer();
+    virtual ~StreamingServer();
     
     // Server lifecycle
     bool initialize(const Config& config);
@@ -73,7 +111,8 @@ public:
     // VDS management
     bool load_vds(const std::string& path);
     void set_slice_params(int axis, int index);
-    void navigate_slice(int delta);  // Move slice forward/backward
+    void navigate_slice(int delta, bool wrap = false);  // Move slice forward/backward
+    void handle_slice_control(const common::SliceControlMessage& control);
     
     // Client management
     size_t get_client_count() const;
@@ -87,12 +126,37 @@ public:
         size_t frames_rendered;
         size_t frames_encoded;
         size_t frames_dropped;
+        size_t frames_unchanged;  // Ticks skipped because the picture would repeat
         size_t bytes_sent;
         float bitrate_mbps;
+        
+        // Rate control
+        int target_bitrate_kbps;
+        uint32_t network_rtt_ms;  // Slowest reporting client, smoothed
+        float stream_fps;         // target_fps, halved while held at the bitrate floor
+        
+        // Slice cache (a hit means the whole slice was already resident)
+        size_t slice_cache_hits;
+        size_t slice_cache_misses;
+        size_t slices_prefetched;
+        size_t bricks_prefetched;
+        
+        // Pipeline stage latency; end_to_end runs from render start to fanout
+        struct StageLatency {
+            float p50_ms;
+            float p99_ms;
+        };
+        StageLatency slice_fetch_latency;
+        StageLatency render_latency;
+        StageLatency convert_latency;
+        StageLatency encode_latency;
+        StageLatency fanout_latency;
+        StageLatency send_latency;  // Seal to last byte written, across clients
+        StageLatency end_to_end_latency;
     };
     Stats get_stats() const;
     
-private:
+protected:
     // Configuration
     Config config_;
     
@@ -105,22 +169,106 @@ private:
     
     // VDS Manager
     std::unique_ptr<VDSManager> vds_manager_;
+    std::unique_ptr<SlicePrefetcher> prefetcher_;
+    std::thread brick_file_thread_;        // Writes vds_brick_file behind a freshly loaded VDS
+    std::atomic<bool> brick_file_running_;
+    void stop_brick_file_writer();
     
+    // Single-frame render into an encoder frame, for loops outside the pipeline
+    bool render_current_slice(AVFrame* frame);  // Composes straight into the frame's I420 planes
+    void select_current_slice(int& axis, int& index);  // Advances the cursor and feeds the prefetcher
+    int current_lod_;                      // Level of detail picked with the cursor, render thread only
+    VDSManager::SliceBuffer slice_buffer_;  // Render-thread scratch, reused across frames
+    SliceCompositor compositor_;
+    bool render_slice_on_gpu(AVFrame* frame);  // Shader path; frames arrive one behind the cursor
+    YUVConverter readback_converter_;  // RGB readback to I420 for the GPU path
     
-    // Render loop
+    // Frame pipeline: a fixed pool of frames travels render -> convert -> encode
+    // and back to render; encoded packets travel encode -> fanout and back
+    struct PipelineFrame {
+        enum class Source { TEST_PATTERN, SLICE, RGB, NONE };
+        Source source = Source::NONE;
+        VDSManager::SliceBuffer slice;   // Source::SLICE
+        std::vector<uint8_t> rgb;        // Source::RGB, packed rows of rgb_stride bytes
+        int rgb_stride = 0;
+        int test_pattern_index = 0;
+        std::unique_ptr<AVFrame, void(*)(AVFrame*)> yuv{nullptr, nullptr};
+        std::chrono::steady_clock::time_point render_start;
+        std::chrono::steady_clock::time_point queued_at;  // Pushed onto the current ring
+    };
+    struct EncodedPacket {
+        std::shared_ptr<WirePacket> wire;  // From packet_pool_, shared by every client once broadcast
+        std::chrono::steady_clock::time_point render_start;
+        std::chrono::steady_clock::time_point queued_at;
+    };
+    
+    bool create_pipeline();
+    void destroy_pipeline();
     void render_loop();
-    void encode_and_send_frame(const std::vector<uint8_t>& rgb_data);
+    void convert_loop();
+    void encode_loop();
+    void fanout_loop();
+    PipelineFrame* acquire_free_frame();  // Render thread only
+    bool render_pipeline_frame(PipelineFrame& frame, int axis, int index);
+    bool should_render_view(int axis, int index);  // Render thread: false while nothing on screen would change
+    bool convert_pipeline_frame(PipelineFrame& frame);
+    void encode_pipeline_frame(PipelineFrame& frame);
+    virtual void request_keyframe() { force_keyframe_ = true; }  // Next encoded frame is an IDR
+    void update_rate_control();                 // Fanout thread: fold client estimates into the target
+    void apply_encoder_bitrate(int kbps);       // Encode thread
+    
+    StillFrameGate still_gate_;                          // Render thread only
+    std::shared_ptr<const ColorMap> gated_colormap_;     // Pinned so its address can't be reused
+    std::chrono::steady_clock::time_point pts_epoch_;    // Encode thread only
+    int64_t last_pts_;
+    
+    std::vector<std::unique_ptr<PipelineFrame>> pipeline_frames_;
+    std::vector<PipelineFrame*> free_frames_;  // Render thread only
+    std::unique_ptr<SPSCRing<PipelineFrame*>> rendered_frames_;   // render -> convert
+    std::unique_ptr<SPSCRing<PipelineFrame*>> converted_frames_;  // convert -> encode
+    std::unique_ptr<SPSCRing<PipelineFrame*>> dropped_frames_;    // convert -> render, evicted before encode
+    std::unique_ptr<SPSCRing<PipelineFrame*>> encoded_frames_;    // encode -> render, done with
+    std::vector<std::unique_ptr<EncodedPacket>> pipeline_packets_;
+    std::vector<EncodedPacket*> free_packets_;  // Encode thread only
+    std::unique_ptr<SPSCRing<EncodedPacket*>> outgoing_packets_;  // encode -> fanout
+    std::unique_ptr<SPSCRing<EncodedPacket*>> sent_packets_;      // fanout -> encode
+    std::atomic<bool> force_keyframe_;
+    std::atomic<float> last_encode_ms_;
+    std::atomic<int> target_bitrate_kbps_;   // Set by the fanout thread, applied by the encoder
+    int applied_bitrate_kbps_;               // Encode thread only
+    std::atomic<int> frame_rate_divisor_;    // 1, or 2 to render every other tick
+    uint32_t render_tick_;                   // Render thread only
+    std::chrono::steady_clock::time_point last_rate_update_;  // Fanout thread only
+    
+    std::thread convert_thread_;
+    std::thread encode_thread_;
+    std::thread fanout_thread_;
     
     // Client management
     void accept_clients_loop();
-    void handle_client(int client_fd);
-    void broadcast_frame(const std::vector<uint8_t>& encoded_data, bool is_keyframe);
+    void handle_client(std::shared_ptr<ClientConnection> client);  // Reads control messages and receiver reports
+    void broadcast_frame(const SharedPacket& packet);  // Queues one shared packet on every client
+    void broadcast_frame(std::shared_ptr<WirePacket> packet, bool is_keyframe);  // Seals a pooled packet holding one encoded frame
+    void join_client(const std::shared_ptr<ClientConnection>& client);  // Starts a new viewer at a keyframe
+    void reap_client_readers();  // Requires clients_mutex_ held
+    std::unique_ptr<ClientIOPool> client_io_;
+    PacketPool packet_pool_;
+    std::atomic<uint32_t> packet_sequence_;
+    std::vector<uint8_t> parameter_sets_;  // Annex B SPS/PPS from the encoder, carried by every keyframe
+    SharedPacket latest_keyframe_;         // Guarded by clients_mutex_
+    bool keyframe_is_latest_;              // No frame broadcast since latest_keyframe_
     
     // Thread management
     std::atomic<bool> running_;
     std::thread render_thread_;
     std::thread accept_thread_;
     std::vector<std::shared_ptr<ClientConnection>> clients_;
+    // Control-message readers; finished ones are reaped on each accept, the rest joined on stop
+    struct ClientReader {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;  // Set by the reader as it exits
+    };
+    std::vector<ClientReader> client_readers_;
     mutable std::mutex clients_mutex_;
     
     // Frame timing
@@ -128,19 +276,39 @@ private:
     std::chrono::microseconds frame_duration_;
     std::chrono::steady_clock::time_point animation_start_time_;  // For time-based slice animation
     
-    // Statistics
+    // Statistics. Per-frame counts and stage latencies live in metrics_ and
+    // are updated without locks; stats_mutex_ only guards the rate-control
+    // fields of stats_, written a few times a second.
+    MetricsRegistry metrics_;
+    TraceRecorder trace_;
+    std::unique_ptr<MetricsServer> metrics_server_;
+    Counter& frames_rendered_;
+    Counter& frames_encoded_;
+    Counter& frames_dropped_;
+    Counter& frames_unchanged_;
+    Counter& bytes_sent_;
+    LatencyHistogram& slice_fetch_latency_;
+    LatencyHistogram& render_latency_;
+    LatencyHistogram& convert_queue_latency_;  // Waiting in rendered_frames_
+    LatencyHistogram& convert_latency_;        // Scale + colour map + YUV, one fused pass
+    LatencyHistogram& encode_queue_latency_;   // Waiting in converted_frames_
+    LatencyHistogram& encode_latency_;
+    LatencyHistogram& fanout_queue_latency_;   // Waiting in outgoing_packets_
+    LatencyHistogram& fanout_latency_;
+    LatencyHistogram& send_latency_;           // Seal to last byte on a client socket
+    LatencyHistogram& end_to_end_latency_;
+    std::atomic<float> last_render_ms_;
     mutable std::mutex stats_mutex_;
     Stats stats_;
     std::chrono::steady_clock::time_point stats_start_time_;
     
-    // Frame buffering
-    std::queue<std::vector<uint8_t>> frame_queue_;
-    std::mutex frame_queue_mutex_;
-    std::condition_variable frame_queue_cv_;
-    
     // Slice navigation
     std::atomic<int> current_slice_axis_;
     std::atomic<int> current_slice_index_;
+    std::atomic<bool> animation_enabled_;   // Cleared by manual navigation, set by SET_PLAYBACK
+    std::atomic<bool> animation_synced_;    // False until animation time matches the current slice
+    std::atomic<int> last_navigation_delta_;
+    std::atomic<int64_t> last_navigation_ms_;
     int vds_dimensions_[3];  // width, height, depth
     
     // Encoder helpers
@@ -149,39 +317,8 @@ private:
     std::vector<uint8_t> encode_frame(const std::vector<uint8_t>& rgb_data);
     
     // Utility
-    void update_stats(float render_ms, float encode_ms, size_t bytes_sent);
-    std::vector<uint8_t> convert_rgb_to_yuv420(const std::vector<uint8_t>& rgb_data);
-};
-
-/**
- * @brief Manages a single client connection
- */
-class ClientConnection {
-public:
-    ClientConnection(int socket_fd, const std::string& address);
-    ~ClientConnection();
-    
-    bool send_frame(const std::vector<uint8_t>& data);
-    void disconnect();
-    bool is_connected() const { return connected_; }
-    
-    std::string get_info() const;
-    size_t get_bytes_sent() const { return bytes_sent_; }
-    
-private:
-    int socket_fd_;
-    std::string address_;
-    std::atomic<bool> connected_;
-    std::atomic<size_t> bytes_sent_;
-    std::mutex send_mutex_;
-    
-    // Send queue for async sending
-    std::queue<std::vector<uint8_t>> send_queue_;
-    std::mutex queue_mutex_;
-    std::condition_variable queue_cv_;
-    std::thread send_thread_;
-    
-    void send_loop();
+    void update_stats(float render_ms, float encode_ms);  // Once per rendered frame, lock-free
+    void register_gauges();
 };
 
 } // namespace server
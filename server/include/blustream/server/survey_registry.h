@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blustream/server/colormap.h"
+#include "blustream/server/vds_manager.h"
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief Reference-counted set of surveys served by one process
+ *
+ * Surveys are registered by ID and opened on first acquire. Every session
+ * on a survey shares the same VDSManager, and through it one brick cache;
+ * slice reads are const, so sessions never change each other's view. The
+ * last release closes the survey.
+ *
+ * One brick budget is split evenly across the open surveys and rebalanced
+ * as they open and close. With a brick file directory set, each survey is
+ * served from <dir>/<id>.blsb, written in the background the first time it
+ * is opened from VDS, so other server processes map the same pages.
+ */
+class SurveyRegistry {
+public:
+    struct Config {
+        VDSManager::CacheConfig cache;  // budget_mb is replaced by the survey's share
+        size_t budget_mb = 4096;        // Shared by all open surveys
+        size_t min_survey_budget_mb = 64;
+        std::string brick_file_dir;     // Empty = no brick files
+        ColorMap::Type colormap = ColorMap::Type::SEISMIC_GRAY;
+        float clip_low_percentile = 1.0f;
+        float clip_high_percentile = 99.0f;
+    };
+
+    explicit SurveyRegistry(const Config& config);
+    ~SurveyRegistry();
+
+    SurveyRegistry(const SurveyRegistry&) = delete;
+    SurveyRegistry& operator=(const SurveyRegistry&) = delete;
+
+    // Register a survey; re-adding an ID points it at a new path for its next open
+    bool add_survey(const std::string& id, const std::string& path);
+    bool has_survey(const std::string& id) const;
+    std::vector<std::string> survey_ids() const;
+
+    // Open survey, loading it if no one holds it yet; null if unknown or
+    // it fails to load. Concurrent first acquires load it once.
+    std::shared_ptr<const VDSManager> acquire(const std::string& id);
+
+    size_t open_count() const;
+
+private:
+    // Outlives the registry for as long as any survey handle does
+    struct OpenSet {
+        std::mutex mutex;
+        std::vector<VDSManager*> surveys;
+        size_t budget_mb = 0;
+        size_t min_budget_mb = 0;
+
+        size_t share_mb() const;  // Requires mutex held
+        void rebalance();         // Requires mutex held
+    };
+
+    struct Entry {
+        std::string path;                // Guarded by the registry mutex
+        std::weak_ptr<const VDSManager> survey;
+        std::mutex open_mutex;           // Serialises loading this survey
+        std::thread brick_file_writer;   // Holds the survey open until written
+    };
+
+    std::unique_ptr<VDSManager> open_survey(const std::string& id, const std::string& path, size_t budget_mb,
+                                            bool& from_brick_file) const;
+    std::string brick_file_path(const std::string& id) const;
+
+    Config config_;
+    std::shared_ptr<OpenSet> open_;
+    std::map<std::string, std::unique_ptr<Entry>> entries_;  // Never erased
+    mutable std::mutex mutex_;
+    std::atomic<bool> running_;
+};
+
+} // namespace server
+} // namespace blustream
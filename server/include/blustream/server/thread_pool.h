@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief Fixed-size worker pool for data-parallel loops
+ *
+ * parallel_for() splits [0, count) into chunks that the workers and the
+ * calling thread pull from a shared counter, and returns once every chunk
+ * has run. One loop runs at a time; calls from other threads queue behind
+ * it. Not reentrant: the loop body must not call parallel_for() itself.
+ */
+class ThreadPool {
+public:
+    // 0 threads = one per hardware thread, less the caller
+    explicit ThreadPool(size_t num_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Workers plus the calling thread
+    size_t concurrency() const { return workers_.size() + 1; }
+
+    // Calls fn(begin, end) for consecutive ranges of at least min_chunk items
+    void parallel_for(size_t count, const std::function<void(size_t, size_t)>& fn, size_t min_chunk = 1);
+
+private:
+    void worker_loop();
+    void run_chunks();
+
+    std::vector<std::thread> workers_;
+
+    std::mutex call_mutex_;  // Serializes parallel_for callers
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    bool stopping_;
+    uint64_t generation_;
+    size_t active_workers_;
+
+    // Current loop; written under mutex_ before generation_ is bumped
+    const std::function<void(size_t, size_t)>* job_;
+    size_t job_count_;
+    size_t job_chunk_;
+    size_t job_chunks_;
+    std::atomic<size_t> next_chunk_;
+    std::atomic<size_t> completed_chunks_;
+};
+
+} // namespace server
+} // namespace blustream
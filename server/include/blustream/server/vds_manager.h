@@ -4,6 +4,12 @@
 #include <vector>
 #include <memory>
 #include <cstdint>
+#include <atomic>
+#include <mutex>
+
+#include "blustream/server/brick_cache.h"
+#include "blustream/server/colormap.h"
+#include "blustream/server/sample_histogram.h"
 
 // Forward declarations to avoid including heavy HueSpace headers
 namespace Hue {
@@ -16,15 +22,45 @@ namespace ProxyLib {
 namespace blustream {
 namespace server {
 
+class ThreadPool;
+class BrickFile;
+
 class VDSManager {
 public:
     struct VDSData {
         int width;
         int height; 
         int depth;
-        std::vector<float> data;
         float min_value;
         float max_value;
+        
+        // Native sample encoding: value = offset + scale * stored sample
+        SampleFormat format;
+        float scale;
+        float offset;
+    };
+    
+    // Brick page cache settings; apply before loading a volume
+    struct CacheConfig {
+        int brick_size = 64;           // Brick edge length in samples
+        size_t budget_mb = 2048;       // Resident brick budget
+        bool crossline_layout = false; // Keep a transposed copy for fast YZ slices (2x memory per brick)
+        size_t extract_threads = 0;    // Slice extraction workers (0 = auto)
+        SampleFormat sample_format = SampleFormat::U8;  // Resident sample type
+        int lod_levels = 3;            // Downsampled levels beside full res (2x, 4x, 8x); 0 = off
+    };
+    
+    // A slice in the volume's native sample type
+    struct SliceBuffer {
+        SampleFormat format = SampleFormat::F32;
+        float scale = 1.0f;
+        float offset = 0.0f;
+        int width = 0;                // Samples per row
+        int height = 0;               // Rows
+        std::vector<uint8_t> data;    // Row-major native samples
+        
+        size_t sample_count() const { return static_cast<size_t>(width) * height; }
+        template <typename T> const T* samples_as() const { return reinterpret_cast<const T*>(data.data()); }
     };
 
     VDSManager();
@@ -32,19 +68,80 @@ public:
 
     // Initialize HueSpace context
     bool initialize();
+    // Frees the brick caches, LOD pyramid and brick file; join every
+    // thread reading slices or bricks first
     void shutdown();
+    
+    void set_cache_config(const CacheConfig& config) { cache_config_ = config; }
+    const CacheConfig& get_cache_config() const { return cache_config_; }
+    
+    // Resize the brick budget of a loaded volume; safe alongside slice reads
+    void set_cache_budget(size_t budget_mb);
+    BrickCache::Stats get_cache_stats() const { return brick_cache_.get_stats(); }
+    
+    // Extraction workers, shared with per-frame stages on the render thread
+    ThreadPool* get_worker_pool() const { return extract_pool_.get(); }
+    
+    // Slice-level cache accounting: a hit means every brick was already resident
+    size_t get_slice_hits() const { return slice_hits_; }
+    size_t get_slice_misses() const { return slice_misses_; }
 
     // VDS operations
     bool load_from_file(const std::string& file_path);
     bool create_noise_volume(int width, int height, int depth, float noise_scale = 1.0f);
     
-    // Get slice data for rendering
-    std::vector<float> get_slice_data(int axis, int index) const;
-    std::vector<uint8_t> get_slice_rgb(int axis, int index) const;
+    // Native brick file: written once from the loaded volume, then mapped in
+    // place of it. A file recorded against a different source_path size or
+    // mtime, or another sample format, is refused.
+    bool write_brick_file(const std::string& path, const std::atomic<bool>* keep_running = nullptr) const;
+    bool load_brick_file(const std::string& path, const std::string& source_path = "");
+    
+    // Slice extraction into caller-owned memory; out must hold
+    // get_slice_sample_count(axis) samples
+    size_t get_slice_sample_count(int axis, int lod = 0) const;
+    bool get_slice_data(int axis, int index, float* out) const;
+    void slice_to_rgb(const float* data, size_t count, uint8_t* rgb) const;
+    
+    // Native-format extraction; buffers keep their capacity across calls.
+    // index is always a full-resolution index, whatever the lod.
+    bool get_slice(int axis, int index, SliceBuffer& slice, int lod = 0) const;
+    bool get_slice_rgb(int axis, int index, SliceBuffer& slice, std::vector<uint8_t>& rgb, int lod = 0) const;
+    void slice_to_rgb(const SliceBuffer& slice, uint8_t* rgb) const;
+    
+    // Level of detail: level l halves every axis l times. Coarse bricks are
+    // box filtered from the next finer level the first time they are touched.
+    int get_lod_levels() const { return static_cast<int>(lod_caches_.size()); }
+    int get_lod_axis_length(int axis, int lod) const;
+    
+    // Coarsest level whose slice still covers the output size, coarser again
+    // while the cursor moves velocity slices per frame; 0 once it stops
+    int select_lod(int axis, int output_width, int output_height, float velocity) const;
+    
+    static bool parse_sample_format(const std::string& name, SampleFormat& format);
+    
+    // Colour mapping; tables are rebuilt only when the map or value range changes
+    void set_colormap(ColorMap::Type type);
+    std::shared_ptr<const ColorMap> get_colormap() const;
+    
+    // The colour map spans these amplitude percentiles of the bricks loaded
+    // so far, so a few spikes don't flatten the contrast (0 and 100 = the
+    // observed extremes). It starts on the encoding range and follows the
+    // histogram as bricks arrive.
+    void set_clip_percentiles(float low, float high);
+    void get_display_range(float& low, float& high) const;
     
     // Animated slice extraction with time-based positioning
-    std::vector<float> get_animated_slice_data(const std::string& orientation, float time, float duration) const;
-    std::vector<uint8_t> get_animated_slice_rgb(const std::string& orientation, float time, float duration) const;
+    bool get_animated_slice(const std::string& orientation, float time, float duration, SliceBuffer& slice) const;
+    
+    // Slice index the animation is showing at the given time
+    int get_animated_slice_index(const std::string& orientation, float time, float duration, int& axis) const;
+    int get_animated_slice_index(int axis, float time, float duration) const;
+    static int orientation_to_axis(const std::string& orientation);
+    int get_axis_length(int axis) const;
+    
+    // Prefetch support: warm the bricks backing a slice without copying it out
+    bool is_slice_resident(int axis, int index, int lod = 0) const;
+    size_t prefetch_slice(int axis, int index, int lod = 0) const;  // Returns bricks loaded
     
     // Get slice dimensions for given orientation
     void get_slice_dimensions(const std::string& orientation, int& width, int& height) const;
@@ -63,14 +160,57 @@ private:
     // HueSpace objects (using void* to avoid header dependencies)
     void* proxy_interface_;  // Actually Hue::ProxyLib::IProxyInterface*
     void* current_vds_;      // Actually Hue::ProxyLib::VDS*
+    const void* vds_layout_; // Actually const Hue::HueSpaceLib::VolumeDataLayout*
     
-    // Cached VDS data for efficient slice extraction
+    // Survey metadata; sample data lives in the brick cache
     VDSData vds_data_;
+    float noise_scale_;
+    std::string source_path_;
+    
+    // Fills a brick from the current source, kept so it can also feed a brick file
+    BrickCache::Loader source_loader_;
+    std::shared_ptr<BrickFile> brick_file_;
+    
+    // Bricks are fetched on first touch, so the cache mutates under const reads
+    CacheConfig cache_config_;
+    mutable BrickCache brick_cache_;
+    std::vector<std::unique_ptr<BrickCache>> lod_caches_;  // Level l at [l - 1]
+    mutable std::atomic<size_t> slice_hits_;
+    mutable std::atomic<size_t> slice_misses_;
+    std::unique_ptr<ThreadPool> extract_pool_;
+    
+    ColorMap::Type colormap_type_;
+    std::shared_ptr<const ColorMap> colormap_;
+    mutable std::mutex colormap_mutex_;
+    
+    // Amplitude statistics of full-resolution bricks, each counted on first load
+    SampleHistogram histogram_;
+    std::unique_ptr<std::atomic<bool>[]> brick_counted_;
+    size_t brick_count_;
+    std::atomic<uint64_t> histogram_checked_;  // Samples binned at the last display range check
+    float clip_low_;
+    float clip_high_;
+    float display_min_;  // Guarded by colormap_mutex_
+    float display_max_;
     
     // Helper methods
     bool extract_vds_data();
-    std::vector<uint8_t> float_to_rgb(const std::vector<float>& data) const;
-    float normalize_value(float value) const;
+    void configure_brick_cache(BrickCache::Loader loader, const BrickFile* file = nullptr);
+    bool load_vds_brick(BrickCache::Brick& brick) const;
+    bool generate_noise_brick(BrickCache::Brick& brick) const;
+    BrickCache& lod_cache(int lod) const;
+    bool load_lod_brick(int lod, BrickCache::Brick& brick) const;
+    template <typename T>
+    bool downsample_brick(int lod, BrickCache::Brick& brick) const;
+    bool get_slice_brick_range(int lod, int axis, int index, int& layer, int& count_a, int& count_b) const;
+    template <typename T, typename Out, typename Convert>
+    bool extract_plane(int lod, int axis, int index, Out* out, Convert convert) const;
+    void set_sample_encoding(SampleFormat format, float min_value, float max_value);
+    void map_to_rgb(SampleFormat format, const void* samples, size_t count, uint8_t* rgb) const;
+    void rebuild_colormap();
+    void reset_display_range();
+    void record_brick(const BrickCache::Brick& brick);
+    void update_display_range();
     
     // Noise generation
     float generate_noise_value(int x, int y, int z, float scale) const;
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Only the WebRTC server sources include this; it needs libwebrtc headers
+#include "api/video/encoded_image.h"
+#include "api/video/video_frame.h"
+#include "api/video/video_frame_buffer.h"
+#include "api/video_codecs/sdp_video_format.h"
+#include "api/video_codecs/video_encoder.h"
+#include "api/video_codecs/video_encoder_factory.h"
+#include "media/base/adapted_video_track_source.h"
+
+namespace blustream {
+namespace server {
+
+/**
+ * @brief Receiver feedback for one session's pre-encoded stream
+ *
+ * Written by WebRTC's encoder queues, one per peer connection, and polled
+ * by the view render thread, so neither side waits on the other. The
+ * session's bitrate is the slowest of its peer connections' estimates.
+ */
+class EncodedStreamFeedback {
+public:
+    EncodedStreamFeedback() : keyframe_requested_(false), target_kbps_(0) {}
+
+    // PLI / FIR from a receiver
+    void request_keyframe() { keyframe_requested_ = true; }
+
+    // Bandwidth estimate (REMB or transport-cc) of one peer connection; 0 drops it
+    void set_target_bitrate(const void* encoder, int kbps);
+
+    bool take_keyframe_request() { return keyframe_requested_.exchange(false); }
+    int target_bitrate_kbps() const { return target_kbps_; }  // 0 until estimated
+
+private:
+    std::atomic<bool> keyframe_requested_;
+    std::atomic<int> target_kbps_;
+    std::mutex mutex_;
+    std::map<const void*, int> targets_;
+};
+
+/**
+ * @brief One H.264 access unit carried through WebRTC's raw-frame pipeline
+ *
+ * A native buffer, so libwebrtc never converts or scales it; only the
+ * passthrough encoder looks inside. The bytes are shared by every peer
+ * connection the frame goes to.
+ */
+class EncodedFrameBuffer : public webrtc::VideoFrameBuffer {
+public:
+    EncodedFrameBuffer(rtc::scoped_refptr<webrtc::EncodedImageBuffer> data, bool keyframe, int width, int height,
+                       std::shared_ptr<EncodedStreamFeedback> feedback);
+
+    Type type() const override { return Type::kNative; }
+    int width() const override { return width_; }
+    int height() const override { return height_; }
+    rtc::scoped_refptr<webrtc::I420BufferInterface> ToI420() override { return nullptr; }
+
+    const rtc::scoped_refptr<webrtc::EncodedImageBuffer>& data() const { return data_; }
+    bool keyframe() const { return keyframe_; }
+    const std::shared_ptr<EncodedStreamFeedback>& feedback() const { return feedback_; }
+
+private:
+    rtc::scoped_refptr<webrtc::EncodedImageBuffer> data_;
+    bool keyframe_;
+    int width_;
+    int height_;
+    std::shared_ptr<EncodedStreamFeedback> feedback_;
+};
+
+/**
+ * @brief Video track source fed with EncodedFrameBuffer frames
+ */
+class EncodedVideoSource : public rtc::AdaptedVideoTrackSource {
+public:
+    // Copies the access unit once; it is only valid during the call
+    void push_frame(const uint8_t* data, size_t size, bool keyframe, int width, int height,
+                    const std::shared_ptr<EncodedStreamFeedback>& feedback);
+
+    bool is_screencast() const override { return false; }
+    absl::optional<bool> needs_denoising() const override { return false; }
+    SourceState state() const override { return kLive; }
+    bool remote() const override { return false; }
+};
+
+/**
+ * @brief VideoEncoder that hands EncodedFrameBuffer contents straight to RTP
+ *
+ * Keyframe requests and rate updates from the send stream go to the
+ * frame's EncodedStreamFeedback instead of an encoder of its own.
+ */
+class PassthroughVideoEncoder : public webrtc::VideoEncoder {
+public:
+    PassthroughVideoEncoder();
+    ~PassthroughVideoEncoder() override;
+
+    int32_t InitEncode(const webrtc::VideoCodec* codec_settings, const Settings& settings) override;
+    int32_t RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback* callback) override;
+    int32_t Release() override;
+    int32_t Encode(const webrtc::VideoFrame& frame, const std::vector<webrtc::VideoFrameType>* frame_types) override;
+    void SetRates(const RateControlParameters& parameters) override;
+    EncoderInfo GetEncoderInfo() const override;
+
+private:
+    void bind(const std::shared_ptr<EncodedStreamFeedback>& feedback);
+
+    webrtc::EncodedImageCallback* callback_;
+    std::shared_ptr<EncodedStreamFeedback> feedback_;
+    int target_kbps_;  // Last SetRates(), replayed once a frame names the feedback target
+};
+
+/**
+ * @brief Encoder factory offering H.264 (packetization-mode 1) passthrough only
+ */
+class PassthroughEncoderFactory : public webrtc::VideoEncoderFactory {
+public:
+    std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override;
+    std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(const webrtc::SdpVideoFormat& format) override;
+};
+
+} // namespace server
+} // namespace blustream
@@ -6,12 +6,17 @@
 #include <vector>
 #include <mutex>
 #include <unordered_map>
+#include <map>
 #include <string>
 #include <functional>
 #include <queue>
 
 #include "blustream/common/types.h"
+#include "blustream/server/encoder_pool.h"
+#include "blustream/server/frame_pipeline.h"
 #include "blustream/server/hardware_encoder.h"
+#include "blustream/server/survey_registry.h"
+#include "blustream/server/vds_manager.h"
 
 // Forward declarations for libwebrtc
 namespace webrtc {
@@ -34,9 +39,10 @@ namespace blustream {
 namespace server {
 
 // Forward declarations
-class VDSManager;
 class WebRTCSession;
 class WebRTCSignalingServer;
+class EncodedStreamFeedback;
+class EncodedVideoSource;
 
 /**
  * @brief WebRTC-based streaming server for Phase 5
@@ -48,6 +54,7 @@ class WebRTCSignalingServer;
  * - Real-time WebRTC streaming (<150ms latency)
  * - Hardware encoding integration (NVENC/QuickSync)
  * - Interactive VDS navigation controls
+ * - Many surveys per process, each shared by every session viewing it
  * - Multi-client session management
  * - Adaptive quality based on network conditions
  */
@@ -72,15 +79,24 @@ public:
         // Hardware encoding
         HardwareEncoder::Type encoder_type = HardwareEncoder::Type::AUTO_DETECT;
         HardwareEncoder::Quality encoder_quality = HardwareEncoder::Quality::FAST;
+        size_t max_gpu_encoders = 3;   // Concurrent NVENC sessions the board allows
+        size_t max_cpu_encoders = 4;   // x264 sessions once the GPU is full
+        size_t encoder_threads = 0;    // Encoder pool workers (0 = auto)
         
         // VDS
         std::string vds_path;
+        std::string default_survey = "default";  // Sessions that name no survey get this one
+        size_t vds_cache_budget_mb = 4096;       // Brick budget shared by all open surveys
+        std::string brick_file_dir;              // Per-survey brick files, shared across processes
         std::string default_orientation = "XZ";
         bool enable_animation = true;
         float animation_duration = 30.0f;
+        bool skip_still_frames = true; // Paused and fixed-slice views stop encoding until they change
+        int still_refresh_ms = 5000;   // Keyframe refresh while skipping
         
-        // Quality adaptation
+        // Quality adaptation: a simulcast ladder per view, each session on the layer that fits it
         bool enable_adaptive_quality = true;
+        size_t simulcast_layers = 3;   // Top layer plus downscaled ones (1080p/720p/360p)
         int min_bitrate_kbps = 1000;
         int max_bitrate_kbps = 15000;
         int target_latency_ms = 150;
@@ -98,6 +114,7 @@ public:
         std::string quality = "auto";
         
         // VDS configuration
+        std::string survey_id;   // Empty = the default survey
         std::string orientation = "XZ";
         bool animate = true;
         float animation_speed = 1.0f;
@@ -119,7 +136,8 @@ public:
             PAUSE_RESUME,
             RESTART_ANIMATION,
             QUALITY_LEVEL,
-            FRAME_RATE
+            FRAME_RATE,
+            SELECT_SURVEY
         };
         
         Type type;
@@ -136,8 +154,10 @@ public:
     void stop();
     bool is_running() const { return running_; }
     
-    // VDS management
+    // Survey management; load_vds() registers the default survey and keeps it open
     bool load_vds(const std::string& path);
+    bool add_survey(const std::string& id, const std::string& path);
+    std::vector<std::string> get_survey_ids() const;
     
     // Session management
     std::string create_session(const SessionConfig& session_config = {});
@@ -163,8 +183,14 @@ public:
         float avg_encoding_time_ms;
         float avg_frame_rate;
         size_t frames_encoded;
+        size_t frames_dropped;       // Rendered frames replaced before encoding
+        size_t gpu_encoders;
+        size_t cpu_encoders;
         size_t bytes_sent;
         float avg_latency_ms;
+        size_t active_views;         // Distinct render+encode streams behind the sessions
+        size_t frames_unchanged;     // View ticks skipped because the picture would repeat
+        size_t open_surveys;
         std::unordered_map<std::string, float> session_stats;
     };
     Stats get_stats() const;
@@ -182,21 +208,83 @@ private:
     // WebRTC factory and components
     std::shared_ptr<webrtc::PeerConnectionFactoryInterface> peer_connection_factory_;
     
-    // VDS Manager
-    std::unique_ptr<VDSManager> vds_manager_;
-    
-    // Session management
-    std::unordered_map<std::string, std::unique_ptr<WebRTCSession>> sessions_;
+    // Surveys, opened while a view shows them
+    std::unique_ptr<SurveyRegistry> surveys_;
+    std::shared_ptr<const VDSManager> default_survey_;  // Pinned by load_vds()
+    
+    // Session management. Writers hold sessions_mutex_ and republish the
+    // snapshot after every change; signaling and statistics read the
+    // snapshot without locking, so they never wait on a view starting or
+    // stopping. A session stays alive while any snapshot still lists it.
+    using SessionMap = std::unordered_map<std::string, std::shared_ptr<WebRTCSession>>;
+    struct SessionSnapshot {
+        SessionMap sessions;
+        std::unordered_map<std::string, std::shared_ptr<EncoderPool::Lease>> session_encoders;  // Full-size layer of each session's view
+        std::vector<std::shared_ptr<EncoderPool::Lease>> encoders;  // Every layer of every view
+        size_t views = 0;
+    };
+    SessionMap sessions_;                               // Guarded by sessions_mutex_
+    std::shared_ptr<const SessionSnapshot> snapshot_;   // std::atomic_load / atomic_store only
     mutable std::mutex sessions_mutex_;
     
-    // Hardware encoder
-    std::unique_ptr<HardwareEncoder> hardware_encoder_;
-    std::mutex encoder_mutex_;
+    // One encoder per session, leased from a shared pool
+    std::unique_ptr<EncoderPool> encoder_pool_;
+    
+    // Everything that decides the pixels and the bitstream a session gets.
+    // Sessions with equal keys share one render + encode.
+    struct ViewKey {
+        std::string survey;
+        int axis = 0;
+        int slice = 0;                  // -1 while animating
+        float animation_speed = 0.0f;   // Animation fields are 0 for a fixed slice
+        float animation_duration = 0.0f;
+        int width = 0;
+        int height = 0;
+        int fps = 0;
+        int bitrate_kbps = 0;           // Snapped to a tier, see make_view_key()
+        
+        bool operator<(const ViewKey& other) const;
+        std::string to_string() const;
+    };
     
-    // Rendering loop
+    // One render thread per distinct view, feeding one pooled encoder per
+    // simulcast layer. Each session receives one layer and only changes
+    // layer at a keyframe of the new one.
+    struct ViewLayer {
+        HardwareEncoder::Config encoder_config;
+        std::shared_ptr<EncoderPool::Lease> encoder;
+        std::vector<uint8_t> rgb;  // Render thread only
+        int bitrate_kbps = 0;      // Applied rate; below encoder_config's only on the bottom layer
+    };
+    struct Subscriber {
+        static constexpr size_t NO_LAYER = static_cast<size_t>(-1);
+        WebRTCSession* session;
+        size_t layer;          // Layer being delivered; NO_LAYER until the first keyframe
+        size_t target_layer;   // Switched to at that layer's next keyframe
+        bool auto_quality;     // Follows the receiver's bandwidth estimate
+        int bitrate_kbps;      // Session's own ceiling
+        int estimate_kbps;     // Last estimate acted on, 0 = none
+    };
+    struct ViewStream {
+        ViewKey key;
+        SessionConfig config;  // Render settings of the first subscriber, same key as all the others
+        std::vector<ViewLayer> layers;  // Fixed once the view starts; layer 0 is full size
+        std::shared_ptr<const VDSManager> survey;        // Held open while the view runs
+        std::thread render_thread;
+        std::atomic<bool> running{false};
+        StillFrameGate still_gate;                        // Render thread only
+        std::shared_ptr<const ColorMap> gated_colormap;   // Pinned so its address can't be reused
+        
+        std::mutex subscribers_mutex;
+        std::vector<Subscriber> subscribers;
+    };
+    std::map<ViewKey, std::unique_ptr<ViewStream>> views_;      // Guarded by sessions_mutex_
+    std::unordered_map<std::string, ViewKey> session_views_;    // Guarded by sessions_mutex_
+    
+    // Housekeeping loop
     std::atomic<bool> running_;
-    std::thread render_thread_;
-    std::chrono::steady_clock::time_point animation_start_time_;
+    std::thread maintenance_thread_;
+    std::atomic<int64_t> animation_start_us_;  // steady_clock, shared by all session threads
     
     // Statistics
     mutable std::mutex stats_mutex_;
@@ -205,15 +293,50 @@ private:
     
     // Initialization helpers
     bool initialize_webrtc();
-    bool initialize_hardware_encoder();
+    bool initialize_encoder_pool();
     void cleanup();
     
     // Rendering pipeline
-    void render_loop();
-    void render_session(WebRTCSession* session);
-    std::vector<uint8_t> render_vds_frame(const SessionConfig& config, float animation_time);
+    void maintenance_loop();
+    ViewKey make_view_key(const SessionConfig& config) const;
+    
+    // Views are built and stopped with sessions_mutex_ released; under it
+    // sessions only move between views. Views a session leaves empty are
+    // handed back in retired for stop_views() once the lock is dropped.
+    bool attach_view(const std::string& session_id);  // Call without sessions_mutex_; false if no view can start
+    
+    // Call with sessions_mutex_ held. subscribe_session() joins key's view
+    // or adopts prepared as it; false if neither exists.
+    bool subscribe_session(const std::string& session_id, WebRTCSession* session, const ViewKey& key,
+                           std::unique_ptr<ViewStream>& prepared);
+    void unsubscribe_session(const std::string& session_id, std::vector<std::unique_ptr<ViewStream>>& retired);
+    // After a config change; false if the session left its view and needs attach_view()
+    bool update_session_view(const std::string& session_id, WebRTCSession* session,
+                             std::vector<std::unique_ptr<ViewStream>>& retired);
+    
+    // Call without sessions_mutex_
+    std::unique_ptr<ViewStream> build_view(const ViewKey& key, const SessionConfig& config);
+    void stop_view(ViewStream& view);
+    void stop_views(std::vector<std::unique_ptr<ViewStream>>& views);
+    size_t select_layer(const ViewStream& view, const SessionConfig& config) const;
+    static size_t layer_for_bitrate(const ViewStream& view, int bitrate_kbps);
+    void set_subscriber_layer(ViewStream& view, WebRTCSession* session, const SessionConfig& config);
+    void apply_receiver_feedback(ViewStream& view, bool& keyframe_pending);  // Requires subscribers_mutex held
+    void deliver_layer_frame(ViewStream& view, size_t layer, const std::vector<uint8_t>& encoded_frame, bool keyframe);
+    
+    void view_render_loop(ViewStream* view);
+    void render_view(ViewStream* view, VDSManager::SliceBuffer& slice, std::vector<uint8_t>& slice_rgb);
+    bool select_view_slice(const VDSManager& survey, const SessionConfig& config, float animation_time,
+                           int& axis, int& index) const;
+    static void scale_rgb(const std::vector<uint8_t>& src, int src_width, int src_height,
+                          int width, int height, std::vector<uint8_t>& dst);
     
     // Session helpers
+    std::shared_ptr<const SessionSnapshot> load_snapshot() const;
+    std::shared_ptr<WebRTCSession> find_session(const std::string& session_id) const;
+    void publish_snapshot();  // Call with sessions_mutex_ held
+    bool erase_session(const std::string& session_id,
+                       std::vector<std::unique_ptr<ViewStream>>& retired);  // Call with sessions_mutex_ held
     std::string generate_session_id();
     void cleanup_inactive_sessions();
     
@@ -248,9 +371,14 @@ public:
     void add_ice_candidate(const std::string& client_id, const std::string& candidate, 
                           const std::string& sdp_mid, int sdp_mline_index);
     
-    // Frame streaming
-    void send_frame(const std::vector<uint8_t>& encoded_frame);
-    void send_frame_to_client(const std::string& client_id, const std::vector<uint8_t>& encoded_frame);
+    // Frame streaming: H.264 access units go straight to RTP packetization
+    void send_frame(const std::vector<uint8_t>& encoded_frame, bool keyframe, int width, int height);
+    void send_frame_to_client(const std::string& client_id, const std::vector<uint8_t>& encoded_frame,
+                              bool keyframe, int width, int height);
+    
+    // Receiver feedback, polled by the view render thread
+    bool take_keyframe_request();    // PLI / FIR since the last call
+    int get_bitrate_estimate() const;  // Slowest client's estimate in kbps, 0 until known
     
     // Configuration
     void update_config(const WebRTCServer::SessionConfig& new_config);
@@ -281,7 +409,8 @@ private:
     // WebRTC components
     std::shared_ptr<webrtc::PeerConnectionFactoryInterface> factory_;
     std::unordered_map<std::string, std::shared_ptr<webrtc::PeerConnectionInterface>> peer_connections_;
-    std::shared_ptr<webrtc::VideoTrackSourceInterface> video_source_;
+    std::shared_ptr<EncodedVideoSource> video_source_;
+    std::shared_ptr<EncodedStreamFeedback> feedback_;
     std::shared_ptr<webrtc::VideoTrackInterface> video_track_;
     std::shared_ptr<webrtc::MediaStreamInterface> media_stream_;
     
@@ -297,7 +426,6 @@ private:
     class SessionPeerConnectionObserver;
     class SessionCreateSDPObserver;
     class SessionSetSDPObserver;
-    class CustomVideoSource;
     
     // Internal helpers
     bool create_media_stream();
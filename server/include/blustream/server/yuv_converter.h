@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct SwsContext;
+
+namespace blustream {
+namespace server {
+
+class ThreadPool;
+
+// Writable I420 destination, typically the planes of an encoder's AVFrame
+struct YUV420Planes {
+    uint8_t* y = nullptr;
+    uint8_t* u = nullptr;
+    uint8_t* v = nullptr;
+    int y_stride = 0;
+    int u_stride = 0;
+    int v_stride = 0;
+    int width = 0;
+    int height = 0;
+};
+
+/**
+ * @brief Packed RGB24 to I420 conversion shared by the encoders
+ *
+ * BT.601 limited range with the integer coefficients used everywhere in the
+ * server. Each chroma sample is converted from the average of the 2x2 RGB
+ * block it covers. The native backend handles one row pair per step with
+ * AVX2/SSE4.1 or NEON kernels, optionally splitting row bands over a
+ * thread pool started on the first conversion; the swscale backend hands
+ * the frame to a cached SwsContext instead. Not thread-safe; use one
+ * converter per encoder.
+ */
+class YUVConverter {
+public:
+    enum class Backend {
+        NATIVE,   // SIMD kernels, row bands on the converter's thread pool
+        SWSCALE   // FFmpeg sws_scale with a cached context
+    };
+
+    struct Config {
+        Backend backend = Backend::NATIVE;
+        size_t threads = 1;  // Native backend threads including the caller (0 = auto, 1 = inline)
+    };
+
+    YUVConverter();
+    ~YUVConverter();
+
+    YUVConverter(const YUVConverter&) = delete;
+    YUVConverter& operator=(const YUVConverter&) = delete;
+
+    void configure(const Config& config);
+    const Config& get_config() const { return config_; }
+
+    // rgb holds height rows of width packed RGB pixels, rgb_stride bytes apart
+    bool convert(const uint8_t* rgb, int rgb_stride, const YUV420Planes& out);
+
+    // BT.601 limited range for a single pixel
+    static uint8_t luma(uint8_t r, uint8_t g, uint8_t b) {
+        return static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+    static uint8_t chroma_u(uint8_t r, uint8_t g, uint8_t b) {
+        return static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    }
+    static uint8_t chroma_v(uint8_t r, uint8_t g, uint8_t b) {
+        return static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+
+    static bool parse_backend(const std::string& name, Backend& backend);
+    static std::string backend_to_string(Backend backend);
+
+    // Which row kernel the native backend uses on this CPU
+    static std::string get_kernel_name();
+
+private:
+    Config config_;
+    std::unique_ptr<ThreadPool> pool_;
+
+    SwsContext* sws_context_;
+    int sws_width_;
+    int sws_height_;
+
+    bool convert_native(const uint8_t* rgb, int rgb_stride, const YUV420Planes& out);
+    bool convert_swscale(const uint8_t* rgb, int rgb_stride, const YUV420Planes& out);
+};
+
+} // namespace server
+} // namespace blustream
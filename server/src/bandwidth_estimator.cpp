@@ -0,0 +1,121 @@
+#include "blustream/server/bandwidth_estimator.h"
+
+#include <algorithm>
+
+namespace blustream {
+namespace server {
+
+namespace {
+constexpr auto MIN_RTT_WINDOW = std::chrono::seconds(10);
+constexpr auto HOLD_AFTER_DECREASE = std::chrono::seconds(1);
+constexpr float OVERUSE_LOSS = 0.10f;
+constexpr float CLEAR_LOSS = 0.02f;
+}
+
+BandwidthEstimator::BandwidthEstimator(const Config& config)
+    : config_(config)
+    , has_estimate_(false)
+    , estimate_kbps_(config.start_kbps)
+    , srtt_ms_(0.0)
+    , loss_(0.0f)
+    , throughput_kbps_(0.0f)
+    , usage_(Usage::NORMAL)
+    , min_rtt_ms_(0)
+    , last_rtt_ms_(0) {
+}
+
+void BandwidthEstimator::on_report(const common::ReceiverReport& report, uint32_t rtt_ms, uint32_t server_lag_ms) {
+    const auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    srtt_ms_ = has_estimate_ ? srtt_ms_ * 0.875 + rtt_ms * 0.125 : rtt_ms;
+
+    // Windowed minimum; keeps the baseline current if the route changes
+    while (!rtt_window_.empty() && rtt_window_.back().second >= rtt_ms) {
+        rtt_window_.pop_back();
+    }
+    rtt_window_.emplace_back(now, rtt_ms);
+    while (now - rtt_window_.front().first > MIN_RTT_WINDOW) {
+        rtt_window_.pop_front();
+    }
+    min_rtt_ms_ = rtt_window_.front().second;
+
+    const uint32_t expected = report.frames_received + report.frames_lost;
+    loss_ = expected ? static_cast<float>(report.frames_lost) / expected : 0.0f;
+    if (report.interval_ms > 0) {
+        throughput_kbps_ = static_cast<float>(report.bytes_received) * 8.0f / report.interval_ms;
+    }
+
+    // Judged on this sample rather than the smoothed RTT, which trails a
+    // draining queue for seconds. A queue that is already shrinking after
+    // a decrease doesn't count as overuse again.
+    const double queue_delay_ms = static_cast<double>(rtt_ms) - min_rtt_ms_;
+    const bool queue_growing = !has_estimate_ || rtt_ms >= last_rtt_ms_;
+    const double budget_ms = config_.target_latency_ms;
+    last_rtt_ms_ = rtt_ms;
+
+    if (loss_ > OVERUSE_LOSS || (queue_delay_ms > budget_ms / 2 && queue_growing) ||
+        server_lag_ms > budget_ms) {
+        usage_ = Usage::OVERUSE;
+        // Back off from what is actually getting through, not from the
+        // old target, or a deep queue takes many steps to drain
+        double base = estimate_kbps_;
+        if (throughput_kbps_ > 0.0f) {
+            base = std::min(base, static_cast<double>(throughput_kbps_));
+        }
+        estimate_kbps_ = base * 0.85;
+        last_decrease_ = now;
+    } else if (loss_ < CLEAR_LOSS && queue_delay_ms < budget_ms / 4) {
+        usage_ = Usage::UNDERUSE;
+        if (now - last_decrease_ > HOLD_AFTER_DECREASE) {
+            double next = estimate_kbps_ + std::max(estimate_kbps_ * 0.08, 50.0);
+            if (throughput_kbps_ > 0.0f) {
+                next = std::min(next, std::max(estimate_kbps_, throughput_kbps_ * 1.5));
+            }
+            estimate_kbps_ = next;
+        }
+    } else {
+        usage_ = Usage::NORMAL;
+    }
+
+    estimate_kbps_ = std::max<double>(config_.min_kbps, std::min<double>(config_.max_kbps, estimate_kbps_));
+    has_estimate_ = true;
+}
+
+bool BandwidthEstimator::has_estimate() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return has_estimate_;
+}
+
+int BandwidthEstimator::estimate_kbps() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(estimate_kbps_);
+}
+
+uint32_t BandwidthEstimator::rtt_ms() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<uint32_t>(srtt_ms_);
+}
+
+uint32_t BandwidthEstimator::min_rtt_ms() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return min_rtt_ms_;
+}
+
+float BandwidthEstimator::loss_fraction() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return loss_;
+}
+
+float BandwidthEstimator::throughput_kbps() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return throughput_kbps_;
+}
+
+BandwidthEstimator::Usage BandwidthEstimator::last_usage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return usage_;
+}
+
+} // namespace server
+} // namespace blustream
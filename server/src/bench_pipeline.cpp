@@ -0,0 +1,600 @@
+/**
+ * @brief Benchmark suite for the VDS -> colour map -> YUV -> encode path
+ *
+ * Runs every stage on a synthetic noise volume, so the numbers depend only
+ * on the machine and the build: slice extraction on each axis, colour
+ * mapping, both YUV converter backends, encode_frame() for every encoder
+ * this FFmpeg can open, and an end-to-end headless run per resolution.
+ * Results go to stdout (or --output) as one JSON document for comparing
+ * builds and GPU SKUs; progress goes to stderr.
+ */
+
+#include "blustream/server/vds_manager.h"
+#include "blustream/server/slice_compositor.h"
+#include "blustream/server/yuv_converter.h"
+#include "blustream/server/hardware_encoder.h"
+#include "blustream/server/frame_pipeline.h"
+#include "blustream/server/thread_pool.h"
+#include "blustream/common/logger.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace blustream::server;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct BenchConfig {
+    int volume_width = 256;
+    int volume_height = 256;
+    int volume_depth = 256;
+    std::string sample_format = "u8";
+    std::vector<std::pair<int, int>> resolutions = {{1920, 1080}, {3840, 2160}};
+    int iterations = 200;   // Timed iterations per microbenchmark
+    int warmup = 10;        // Untimed iterations first
+    int e2e_frames = 300;
+    std::string encoder = "auto";  // End-to-end encoder
+    int bitrate_kbps = 8000;
+    bool skip_encoders = false;
+    std::string output_path;
+};
+
+std::string json_number(double value) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.4f", value);
+    return buf;
+}
+
+std::string json_string(const std::string& value) {
+    return "\"" + value + "\"";
+}
+
+// Latency distribution of one stage
+std::string stage_json(const LatencyHistogram& histogram) {
+    return "{\"count\":" + std::to_string(histogram.count()) +
+           ",\"mean_ms\":" + json_number(histogram.mean_ms()) +
+           ",\"p50_ms\":" + json_number(histogram.percentile_ms(0.50)) +
+           ",\"p90_ms\":" + json_number(histogram.percentile_ms(0.90)) +
+           ",\"p99_ms\":" + json_number(histogram.percentile_ms(0.99)) +
+           ",\"max_ms\":" + json_number(histogram.max_ms()) + "}";
+}
+
+std::string resolution_string(int width, int height) {
+    return std::to_string(width) + "x" + std::to_string(height);
+}
+
+bool parse_dimensions(const std::string& text, std::vector<int>& dims) {
+    dims.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find('x', start);
+        std::string part = text.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        int value = std::atoi(part.c_str());
+        if (value <= 0) {
+            return false;
+        }
+        dims.push_back(value);
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+bool parse_resolutions(const std::string& text, std::vector<std::pair<int, int>>& resolutions) {
+    resolutions.clear();
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find(',', start);
+        std::vector<int> dims;
+        if (!parse_dimensions(text.substr(start, end == std::string::npos ? std::string::npos : end - start), dims) ||
+            dims.size() != 2 || dims[0] % 2 != 0 || dims[1] % 2 != 0) {
+            return false;
+        }
+        resolutions.emplace_back(dims[0], dims[1]);
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return !resolutions.empty();
+}
+
+bool parse_encoder_type(const std::string& name, HardwareEncoder::Type& type) {
+    if (name == "auto") type = HardwareEncoder::Type::AUTO_DETECT;
+    else if (name == "nvenc" || name == "nvenc_h264") type = HardwareEncoder::Type::NVENC_H264;
+    else if (name == "nvenc_hevc") type = HardwareEncoder::Type::NVENC_HEVC;
+    else if (name == "qsv" || name == "quicksync") type = HardwareEncoder::Type::QUICKSYNC_H264;
+    else if (name == "x264" || name == "software") type = HardwareEncoder::Type::SOFTWARE_X264;
+    else return false;
+    return true;
+}
+
+// Gradients plus a fine XOR texture, so encoders have real detail to code
+std::vector<uint8_t> make_rgb_frame(int width, int height) {
+    std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* pixel = &rgb[(static_cast<size_t>(y) * width + x) * 3];
+            pixel[0] = static_cast<uint8_t>((x * 255) / width);
+            pixel[1] = static_cast<uint8_t>((y * 255) / height);
+            pixel[2] = static_cast<uint8_t>(((x ^ y) & 0xff));
+        }
+    }
+    return rgb;
+}
+
+// Owns the planes of one I420 frame
+struct YUVFrame {
+    std::vector<uint8_t> y, u, v;
+    YUV420Planes planes;
+
+    YUVFrame(int width, int height)
+        : y(static_cast<size_t>(width) * height)
+        , u(static_cast<size_t>(width / 2) * (height / 2))
+        , v(u.size()) {
+        planes.y = y.data();
+        planes.u = u.data();
+        planes.v = v.data();
+        planes.y_stride = width;
+        planes.u_stride = width / 2;
+        planes.v_stride = width / 2;
+        planes.width = width;
+        planes.height = height;
+    }
+};
+
+YUV420Planes frame_planes(AVFrame* frame) {
+    YUV420Planes planes;
+    planes.y = frame->data[0];
+    planes.u = frame->data[1];
+    planes.v = frame->data[2];
+    planes.y_stride = frame->linesize[0];
+    planes.u_stride = frame->linesize[1];
+    planes.v_stride = frame->linesize[2];
+    planes.width = frame->width;
+    planes.height = frame->height;
+    return planes;
+}
+
+// Runs body(i) warmup + iterations times, timing the last iterations
+template <typename Body>
+void time_iterations(int warmup, int iterations, LatencyHistogram& histogram, Body body) {
+    for (int i = 0; i < warmup; i++) {
+        body(i);
+    }
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        body(warmup + i);
+        histogram.record(Clock::now() - start);
+    }
+}
+
+// Mega-samples per second at the histogram's mean
+double throughput_msps(const LatencyHistogram& histogram, size_t samples) {
+    float mean_ms = histogram.mean_ms();
+    return mean_ms > 0.0f ? static_cast<double>(samples) / (mean_ms * 1000.0) : 0.0;
+}
+
+class JsonList {
+public:
+    void add(const std::string& object) {
+        items_ += (items_.empty() ? "" : ",\n    ") + object;
+    }
+    std::string str() const { return "[\n    " + items_ + "\n  ]"; }
+
+private:
+    std::string items_;
+};
+
+void bench_slice_extraction(const BenchConfig& config, VDSManager& vds, JsonList& results) {
+    static const char* axis_names[] = {"inline", "crossline", "timeslice"};
+
+    for (int axis = 0; axis < 3; axis++) {
+        std::cerr << "slice extraction: " << axis_names[axis] << "\n";
+        const int length = vds.get_axis_length(axis);
+
+        // Warm every brick behind this axis so the numbers are steady state
+        for (int index = 0; index < length; index++) {
+            vds.prefetch_slice(axis, index);
+        }
+
+        std::vector<float> samples(vds.get_slice_sample_count(axis));
+        LatencyHistogram float_latency;
+        time_iterations(config.warmup, config.iterations, float_latency, [&](int i) {
+            vds.get_slice_data(axis, i % length, samples.data());
+        });
+
+        VDSManager::SliceBuffer slice;
+        LatencyHistogram native_latency;
+        time_iterations(config.warmup, config.iterations, native_latency, [&](int i) {
+            vds.get_slice(axis, i % length, slice);
+        });
+
+        results.add("{\"name\":\"get_slice_data\",\"axis\":" + json_string(axis_names[axis]) +
+                    ",\"samples\":" + std::to_string(samples.size()) +
+                    ",\"msamples_per_s\":" + json_number(throughput_msps(float_latency, samples.size())) +
+                    ",\"latency\":" + stage_json(float_latency) + "}");
+        results.add("{\"name\":\"get_slice\",\"axis\":" + json_string(axis_names[axis]) +
+                    ",\"format\":" + json_string(config.sample_format) +
+                    ",\"samples\":" + std::to_string(slice.sample_count()) +
+                    ",\"msamples_per_s\":" + json_number(throughput_msps(native_latency, slice.sample_count())) +
+                    ",\"latency\":" + stage_json(native_latency) + "}");
+    }
+}
+
+void bench_colormap(const BenchConfig& config, VDSManager& vds, JsonList& results) {
+    std::cerr << "colour mapping\n";
+
+    // The timeslice is the largest plane of a cube and the usual view
+    const int axis = 2;
+    std::vector<float> samples(vds.get_slice_sample_count(axis));
+    vds.get_slice_data(axis, vds.get_axis_length(axis) / 2, samples.data());
+    VDSManager::SliceBuffer slice;
+    vds.get_slice(axis, vds.get_axis_length(axis) / 2, slice);
+    std::vector<uint8_t> rgb(samples.size() * 3);
+
+    LatencyHistogram float_latency;
+    time_iterations(config.warmup, config.iterations, float_latency, [&](int) {
+        vds.slice_to_rgb(samples.data(), samples.size(), rgb.data());
+    });
+
+    LatencyHistogram native_latency;
+    time_iterations(config.warmup, config.iterations, native_latency, [&](int) {
+        vds.slice_to_rgb(slice, rgb.data());
+    });
+
+    results.add("{\"name\":\"slice_to_rgb\",\"input\":\"f32\",\"samples\":" + std::to_string(samples.size()) +
+                ",\"msamples_per_s\":" + json_number(throughput_msps(float_latency, samples.size())) +
+                ",\"latency\":" + stage_json(float_latency) + "}");
+    results.add("{\"name\":\"slice_to_rgb\",\"input\":" + json_string(config.sample_format) +
+                ",\"samples\":" + std::to_string(slice.sample_count()) +
+                ",\"msamples_per_s\":" + json_number(throughput_msps(native_latency, slice.sample_count())) +
+                ",\"latency\":" + stage_json(native_latency) + "}");
+}
+
+void bench_yuv(const BenchConfig& config, JsonList& results) {
+    const YUVConverter::Backend backends[] = {YUVConverter::Backend::NATIVE, YUVConverter::Backend::SWSCALE};
+
+    for (const auto& resolution : config.resolutions) {
+        const int width = resolution.first;
+        const int height = resolution.second;
+        std::vector<uint8_t> rgb = make_rgb_frame(width, height);
+        YUVFrame yuv(width, height);
+
+        for (YUVConverter::Backend backend : backends) {
+            const std::string name = YUVConverter::backend_to_string(backend);
+            std::cerr << "yuv " << name << ": " << resolution_string(width, height) << "\n";
+
+            YUVConverter converter;
+            YUVConverter::Config converter_config;
+            converter_config.backend = backend;
+            converter_config.threads = 0;
+            converter.configure(converter_config);
+
+            LatencyHistogram latency;
+            bool ok = true;
+            time_iterations(config.warmup, config.iterations, latency, [&](int) {
+                ok = converter.convert(rgb.data(), width * 3, yuv.planes) && ok;
+            });
+
+            results.add("{\"name\":\"convert_rgb_to_yuv420\",\"backend\":" + json_string(name) +
+                        ",\"kernel\":" + json_string(backend == YUVConverter::Backend::NATIVE
+                                                     ? YUVConverter::get_kernel_name() : "sws_scale") +
+                        ",\"resolution\":" + json_string(resolution_string(width, height)) +
+                        ",\"ok\":" + (ok ? "true" : "false") +
+                        ",\"mpixels_per_s\":" +
+                        json_number(throughput_msps(latency, static_cast<size_t>(width) * height)) +
+                        ",\"latency\":" + stage_json(latency) + "}");
+        }
+    }
+}
+
+bool open_encoder(HardwareEncoder& encoder, HardwareEncoder::Type type, int width, int height,
+                  const BenchConfig& config) {
+    HardwareEncoder::Config encoder_config;
+    encoder_config.encoder_type = type;
+    encoder_config.width = width;
+    encoder_config.height = height;
+    encoder_config.bitrate_kbps = config.bitrate_kbps;
+    encoder_config.max_bitrate_kbps = config.bitrate_kbps * 3 / 2;
+    encoder_config.use_zero_copy = false;  // CPU input frames for every stage here
+    if (!encoder.initialize(encoder_config)) {
+        return false;
+    }
+    // initialize() falls back to x264; that is not the encoder asked for
+    return type == HardwareEncoder::Type::AUTO_DETECT || encoder.get_active_encoder_type() == type;
+}
+
+void bench_encoders(const BenchConfig& config, JsonList& results) {
+    for (HardwareEncoder::Type type : HardwareEncoder::get_available_encoders()) {
+        const std::string type_name = HardwareEncoder::encoder_type_to_string(type);
+
+        for (const auto& resolution : config.resolutions) {
+            const int width = resolution.first;
+            const int height = resolution.second;
+            std::cerr << "encode " << type_name << ": " << resolution_string(width, height) << "\n";
+
+            HardwareEncoder encoder;
+            if (!open_encoder(encoder, type, width, height, config)) {
+                results.add("{\"name\":\"encode_frame\",\"encoder\":" + json_string(type_name) +
+                            ",\"resolution\":" + json_string(resolution_string(width, height)) +
+                            ",\"available\":false}");
+                continue;
+            }
+
+            // Two frames alternating, so the encoder can't coast on a static picture
+            std::vector<uint8_t> frames[2] = {make_rgb_frame(width, height), make_rgb_frame(width, height)};
+            for (size_t i = 0; i < frames[1].size(); i += 3) {
+                frames[1][i] = static_cast<uint8_t>(255 - frames[1][i]);
+            }
+
+            // B-frames are off, so the n-th packet out is the n-th frame in,
+            // however late a pipelined encoder releases it
+            std::vector<uint8_t> encoded;
+            uint64_t bytes = 0;
+            int packets = 0;
+            int packets_out = 0;
+            auto count_packets = [&](bool produced) {
+                while (produced) {
+                    if (packets_out++ >= config.warmup) {
+                        bytes += encoded.size();
+                        packets++;
+                    }
+                    produced = encoder.receive_packet(encoded);
+                }
+            };
+            LatencyHistogram latency;
+            time_iterations(config.warmup, config.iterations, latency, [&](int i) {
+                const std::vector<uint8_t>& rgb = frames[i % 2];
+                count_packets(encoder.encode_frame(rgb.data(), rgb.size(), encoded));
+            });
+            count_packets(encoder.flush(encoded));
+
+            const double seconds = static_cast<double>(packets) / 30.0;
+            results.add("{\"name\":\"encode_frame\",\"encoder\":" + json_string(encoder.get_encoder_name()) +
+                        ",\"type\":" + json_string(type_name) +
+                        ",\"resolution\":" + json_string(resolution_string(width, height)) +
+                        ",\"available\":true,\"packets\":" + std::to_string(packets) +
+                        ",\"kbps_at_30fps\":" + json_number(seconds > 0 ? bytes * 8 / 1000.0 / seconds : 0.0) +
+                        ",\"latency\":" + stage_json(latency) + "}");
+            encoder.shutdown();
+        }
+    }
+}
+
+// The server's CPU render path on one thread: extract the native slice,
+// scale + colour map + convert straight into the encoder's input frame,
+// encode and drain. The server overlaps these stages across threads, so
+// its frame rate tops out nearer 1 / slowest stage than this 1 / sum.
+void bench_end_to_end(const BenchConfig& config, VDSManager& vds, JsonList& results) {
+    HardwareEncoder::Type type = HardwareEncoder::Type::AUTO_DETECT;
+    parse_encoder_type(config.encoder, type);
+
+    auto colormap = vds.get_colormap();
+    SliceCompositor compositor(vds.get_worker_pool());
+
+    for (const auto& resolution : config.resolutions) {
+        const int width = resolution.first;
+        const int height = resolution.second;
+        std::cerr << "end to end: " << resolution_string(width, height) << "\n";
+
+        HardwareEncoder encoder;
+        if (!colormap || !open_encoder(encoder, type, width, height, config)) {
+            results.add("{\"resolution\":" + json_string(resolution_string(width, height)) + ",\"available\":false}");
+            continue;
+        }
+
+        // Sweep the inline axis the way the server animates through a survey
+        const int axis = 0;
+        const int length = vds.get_axis_length(axis);
+        VDSManager::SliceBuffer slice;
+        std::vector<uint8_t> encoded;
+        LatencyHistogram fetch_latency;
+        LatencyHistogram compose_latency;
+        LatencyHistogram encode_latency;
+        LatencyHistogram frame_latency;
+        uint64_t bytes = 0;
+        int failures = 0;
+
+        Clock::time_point run_start;
+        for (int i = 0; i < config.warmup + config.e2e_frames; i++) {
+            if (i == config.warmup) {
+                run_start = Clock::now();
+            }
+            const bool timed = i >= config.warmup;
+
+            auto frame_start = Clock::now();
+            bool ok = vds.get_slice(axis, i % length, slice);
+            auto fetch_end = Clock::now();
+
+            AVFrame* input = encoder.get_input_frame();
+            ok = ok && input && compositor.compose(slice, *colormap, frame_planes(input));
+            auto compose_end = Clock::now();
+
+            bool produced = ok && encoder.encode_input_frame(encoded);
+            while (produced) {
+                bytes += timed ? encoded.size() : 0;
+                produced = encoder.receive_packet(encoded);
+            }
+            auto frame_end = Clock::now();
+
+            if (timed) {
+                failures += ok ? 0 : 1;
+                fetch_latency.record(fetch_end - frame_start);
+                compose_latency.record(compose_end - fetch_end);
+                encode_latency.record(frame_end - compose_end);
+                frame_latency.record(frame_end - frame_start);
+            }
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - run_start).count();
+        const double fps = seconds > 0 ? config.e2e_frames / seconds : 0.0;
+
+        results.add("{\"resolution\":" + json_string(resolution_string(width, height)) +
+                    ",\"available\":true,\"encoder\":" + json_string(encoder.get_encoder_name()) +
+                    ",\"frames\":" + std::to_string(config.e2e_frames) +
+                    ",\"failures\":" + std::to_string(failures) +
+                    ",\"fps\":" + json_number(fps) +
+                    ",\"kbps\":" + json_number(seconds > 0 ? bytes * 8 / 1000.0 / seconds : 0.0) +
+                    ",\"stages\":{\"slice_fetch\":" + stage_json(fetch_latency) +
+                    ",\"compose\":" + stage_json(compose_latency) +
+                    ",\"encode\":" + stage_json(encode_latency) +
+                    ",\"frame\":" + stage_json(frame_latency) + "}}");
+        encoder.shutdown();
+    }
+}
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --volume WxHxD        Synthetic volume size (default 256x256x256)\n"
+              << "  --format FMT          Resident sample format: u8, u16, f32 (default u8)\n"
+              << "  --resolutions LIST    Output sizes, e.g. 1920x1080,3840x2160 (default)\n"
+              << "  --iterations N        Timed iterations per microbenchmark (default 200)\n"
+              << "  --warmup N            Untimed iterations before each run (default 10)\n"
+              << "  --frames N            End-to-end frames per resolution (default 300)\n"
+              << "  --encoder TYPE        End-to-end encoder: auto, nvenc, nvenc_hevc, qsv, x264\n"
+              << "  --bitrate KBPS        Encoder bitrate (default 8000)\n"
+              << "  --skip-encoders       Leave out the per-encoder microbenchmarks\n"
+              << "  --output FILE         Write the JSON report to FILE instead of stdout\n";
+}
+
+bool parse_args(int argc, char* argv[], BenchConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--volume" && has_value) {
+            std::vector<int> dims;
+            if (!parse_dimensions(argv[++i], dims) || dims.size() != 3) {
+                std::cerr << "Invalid volume size: " << argv[i] << "\n";
+                return false;
+            }
+            config.volume_width = dims[0];
+            config.volume_height = dims[1];
+            config.volume_depth = dims[2];
+        } else if (arg == "--format" && has_value) {
+            config.sample_format = argv[++i];
+        } else if (arg == "--resolutions" && has_value) {
+            if (!parse_resolutions(argv[++i], config.resolutions)) {
+                std::cerr << "Invalid resolution list (even WxH, comma separated): " << argv[i] << "\n";
+                return false;
+            }
+        } else if (arg == "--iterations" && has_value) {
+            config.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && has_value) {
+            config.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--frames" && has_value) {
+            config.e2e_frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--encoder" && has_value) {
+            HardwareEncoder::Type type;
+            config.encoder = argv[++i];
+            if (!parse_encoder_type(config.encoder, type)) {
+                std::cerr << "Unknown encoder: " << config.encoder << "\n";
+                return false;
+            }
+        } else if (arg == "--bitrate" && has_value) {
+            config.bitrate_kbps = std::max(100, std::atoi(argv[++i]));
+        } else if (arg == "--skip-encoders") {
+            config.skip_encoders = true;
+        } else if (arg == "--output" && has_value) {
+            config.output_path = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    if (!parse_args(argc, argv, config)) {
+        return 1;
+    }
+
+    // Keep stdout for the report
+    blustream::common::set_logger(
+        std::make_unique<blustream::common::ConsoleLogger>(blustream::common::LogLevel::WARN));
+
+    VDSManager vds;
+    VDSManager::CacheConfig cache_config;
+    if (!VDSManager::parse_sample_format(config.sample_format, cache_config.sample_format)) {
+        std::cerr << "Unknown sample format: " << config.sample_format << "\n";
+        return 1;
+    }
+    vds.set_cache_config(cache_config);
+    vds.set_colormap(ColorMap::Type::SEISMIC_GRAY);
+
+    std::cerr << "Generating " << config.volume_width << "x" << config.volume_height << "x"
+              << config.volume_depth << " noise volume\n";
+    if (!vds.create_noise_volume(config.volume_width, config.volume_height, config.volume_depth, 0.05f)) {
+        std::cerr << "Failed to create the noise volume\n";
+        return 1;
+    }
+
+    JsonList micro;
+    bench_slice_extraction(config, vds, micro);
+    bench_colormap(config, vds, micro);
+    bench_yuv(config, micro);
+    if (!config.skip_encoders) {
+        bench_encoders(config, micro);
+    }
+
+    JsonList end_to_end;
+    bench_end_to_end(config, vds, end_to_end);
+
+    std::string encoders;
+    for (HardwareEncoder::Type type : HardwareEncoder::get_available_encoders()) {
+        encoders += (encoders.empty() ? "" : ",") + json_string(HardwareEncoder::encoder_type_to_string(type));
+    }
+
+    const BrickCache::Stats cache = vds.get_cache_stats();
+    std::string report = "{\n  \"system\":{\"hardware_threads\":" +
+                         std::to_string(std::thread::hardware_concurrency()) +
+                         ",\"yuv_kernel\":" + json_string(YUVConverter::get_kernel_name()) +
+                         ",\"colormap_kernel\":" + json_string(ColorMap::get_kernel_name()) +
+                         ",\"encoders\":[" + encoders + "]},\n" +
+                         "  \"config\":{\"volume\":" + json_string(std::to_string(config.volume_width) + "x" +
+                                                                    std::to_string(config.volume_height) + "x" +
+                                                                    std::to_string(config.volume_depth)) +
+                         ",\"format\":" + json_string(config.sample_format) +
+                         ",\"iterations\":" + std::to_string(config.iterations) +
+                         ",\"warmup\":" + std::to_string(config.warmup) +
+                         ",\"frames\":" + std::to_string(config.e2e_frames) +
+                         ",\"bitrate_kbps\":" + std::to_string(config.bitrate_kbps) + "},\n" +
+                         "  \"brick_cache\":{\"hits\":" + std::to_string(cache.hits) +
+                         ",\"misses\":" + std::to_string(cache.misses) + "},\n" +
+                         "  \"microbenchmarks\":" + micro.str() + ",\n" +
+                         "  \"end_to_end\":" + end_to_end.str() + "\n}\n";
+
+    if (config.output_path.empty()) {
+        std::cout << report;
+        return 0;
+    }
+
+    std::ofstream file(config.output_path, std::ios::trunc);
+    file << report;
+    if (!file) {
+        std::cerr << "Failed to write " << config.output_path << "\n";
+        return 1;
+    }
+    std::cerr << "Wrote " << config.output_path << "\n";
+    return 0;
+}
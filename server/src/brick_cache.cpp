@@ -0,0 +1,200 @@
+#include "blustream/server/brick_cache.h"
+#include "blustream/common/logger.h"
+
+#include <algorithm>
+
+namespace blustream {
+namespace server {
+
+BrickCache::BrickCache()
+    : dims_{0, 0, 0}
+    , bricks_{0, 0, 0}
+    , resident_bytes_(0) {
+    stats_ = {};
+}
+
+BrickCache::~BrickCache() {
+    clear();
+}
+
+void BrickCache::configure(const Config& config, int width, int height, int depth, Loader loader) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Let any loads for the previous volume land before swapping the loader
+    load_cv_.wait(lock, [this] { return in_flight_.empty(); });
+
+    config_ = config;
+    config_.brick_size = std::max(1, config_.brick_size);
+
+    dims_[0] = width;
+    dims_[1] = height;
+    dims_[2] = depth;
+    for (int i = 0; i < 3; i++) {
+        bricks_[i] = (dims_[i] + config_.brick_size - 1) / config_.brick_size;
+    }
+
+    loader_ = std::move(loader);
+    entries_.clear();
+    lru_.clear();
+    resident_bytes_ = 0;
+    stats_ = {};
+
+    BLUSTREAM_LOG_INFO("Brick cache configured: " + std::to_string(bricks_[0]) + "x" +
+                      std::to_string(bricks_[1]) + "x" + std::to_string(bricks_[2]) +
+                      " bricks of " + std::to_string(config_.brick_size) + "^3, budget " +
+                      std::to_string(config_.budget_bytes / (1024 * 1024)) + " MB");
+}
+
+void BrickCache::clear() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    load_cv_.wait(lock, [this] { return in_flight_.empty(); });
+
+    entries_.clear();
+    lru_.clear();
+    resident_bytes_ = 0;
+}
+
+BrickCache::BrickPtr BrickCache::get(int bx, int by, int bz, bool* was_resident) {
+    if (bx < 0 || by < 0 || bz < 0 || bx >= bricks_[0] || by >= bricks_[1] || bz >= bricks_[2]) {
+        return nullptr;
+    }
+
+    const Key key = make_key(bx, by, bz);
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Another thread may already be fetching this brick; wait for it instead of
+    // issuing a duplicate request to the backing store
+    load_cv_.wait(lock, [this, key] { return in_flight_.count(key) == 0; });
+
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+        stats_.hits++;
+        if (was_resident) *was_resident = true;
+        return it->second.brick;
+    }
+
+    if (was_resident) *was_resident = false;
+
+    stats_.misses++;
+    in_flight_.insert(key);
+    Loader loader = loader_;
+    lock.unlock();
+
+    // Load outside the lock so hits on other bricks are never blocked by I/O
+    auto brick = std::make_shared<Brick>();
+    brick->origin[0] = bx * config_.brick_size;
+    brick->origin[1] = by * config_.brick_size;
+    brick->origin[2] = bz * config_.brick_size;
+    for (int i = 0; i < 3; i++) {
+        brick->size[i] = std::min(config_.brick_size, dims_[i] - brick->origin[i]);
+    }
+    brick->format = config_.format;
+    if (!config_.mapped) {
+        brick->samples.resize(brick->sample_bytes());
+    }
+
+    bool loaded = loader && loader(*brick);
+    if (loaded && config_.crossline_layout) {
+        build_crossline_layout(*brick);
+    }
+
+    lock.lock();
+    in_flight_.erase(key);
+
+    if (!loaded) {
+        stats_.load_failures++;
+        lock.unlock();
+        load_cv_.notify_all();
+        BLUSTREAM_LOG_ERROR("Failed to load brick " + std::to_string(bx) + "," +
+                           std::to_string(by) + "," + std::to_string(bz));
+        return nullptr;
+    }
+
+    lru_.push_front(key);
+    entries_[key] = Entry{brick, lru_.begin()};
+    resident_bytes_ += brick->byte_size();
+    evict_to_budget();
+
+    lock.unlock();
+    load_cv_.notify_all();
+    return brick;
+}
+
+bool BrickCache::is_resident(int bx, int by, int bz) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.count(make_key(bx, by, bz)) != 0;
+}
+
+void BrickCache::set_budget(size_t budget_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_.budget_bytes = budget_bytes;
+    evict_to_budget();
+}
+
+void BrickCache::evict_to_budget() {
+    // Always keep the most recent brick, even if it alone exceeds the budget
+    while (resident_bytes_ > config_.budget_bytes && lru_.size() > 1) {
+        Key victim = lru_.back();
+        lru_.pop_back();
+
+        auto it = entries_.find(victim);
+        if (it != entries_.end()) {
+            resident_bytes_ -= it->second.brick->byte_size();
+            entries_.erase(it);
+        }
+        stats_.evictions++;
+    }
+}
+
+// Transpose x-fastest samples into [x][z][y] in square tiles so both the
+// reads and the writes stay within a handful of cache lines per tile
+template <typename T>
+static void transpose_crossline(const T* src_samples, T* dst, int sx, int sy, int sz) {
+    const int tile = 16;
+    for (int z = 0; z < sz; z++) {
+        for (int y0 = 0; y0 < sy; y0 += tile) {
+            const int y1 = std::min(y0 + tile, sy);
+            for (int x0 = 0; x0 < sx; x0 += tile) {
+                const int x1 = std::min(x0 + tile, sx);
+                for (int y = y0; y < y1; y++) {
+                    const T* src = src_samples + (static_cast<size_t>(z) * sy + y) * sx;
+                    for (int x = x0; x < x1; x++) {
+                        dst[(static_cast<size_t>(x) * sz + z) * sy + y] = src[x];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void BrickCache::build_crossline_layout(Brick& brick) {
+    const int sx = brick.size[0];
+    const int sy = brick.size[1];
+    const int sz = brick.size[2];
+    const Brick& source = brick;  // Reads mapped samples too
+    brick.crossline.resize(brick.sample_bytes());
+
+    switch (brick.format) {
+        case SampleFormat::U8:
+            transpose_crossline(source.samples_as<uint8_t>(), reinterpret_cast<uint8_t*>(brick.crossline.data()), sx, sy, sz);
+            break;
+        case SampleFormat::U16:
+            transpose_crossline(source.samples_as<uint16_t>(), reinterpret_cast<uint16_t*>(brick.crossline.data()), sx, sy, sz);
+            break;
+        case SampleFormat::F32:
+            transpose_crossline(source.samples_as<float>(), reinterpret_cast<float*>(brick.crossline.data()), sx, sy, sz);
+            break;
+    }
+}
+
+BrickCache::Stats BrickCache::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.resident_bricks = entries_.size();
+    stats.resident_bytes = resident_bytes_;
+    return stats;
+}
+
+} // namespace server
+} // namespace blustream
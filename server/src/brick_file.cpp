@@ -0,0 +1,243 @@
+#include "blustream/server/brick_file.h"
+#include "blustream/common/logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace blustream {
+namespace server {
+
+namespace {
+
+const char BRICK_FILE_MAGIC[8] = {'B', 'L', 'S', 'B', 'R', 'I', 'C', 'K'};
+
+uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool write_all(int fd, const void* data, size_t size, uint64_t offset) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t n = pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+BrickFile::BrickFile()
+    : header_{}
+    , grid_{0, 0, 0}
+    , index_(nullptr)
+    , base_(nullptr)
+    , mapped_bytes_(0) {
+}
+
+BrickFile::~BrickFile() {
+    if (base_) {
+        munmap(const_cast<uint8_t*>(base_), mapped_bytes_);
+    }
+}
+
+BrickFile::Header BrickFile::make_header(SampleFormat format, int width, int height, int depth, int brick_size) {
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BRICK_FILE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.format = static_cast<uint32_t>(format);
+    header.width = width;
+    header.height = height;
+    header.depth = depth;
+    header.brick_size = std::max(1, brick_size);
+    header.scale = 1.0f;
+
+    int grid[3];
+    brick_grid(header, grid);
+    header.brick_count = static_cast<uint64_t>(grid[0]) * grid[1] * grid[2];
+    return header;
+}
+
+void BrickFile::brick_grid(const Header& header, int grid[3]) {
+    const int dims[3] = {header.width, header.height, header.depth};
+    for (int i = 0; i < 3; i++) {
+        grid[i] = (dims[i] + header.brick_size - 1) / header.brick_size;
+    }
+}
+
+bool BrickFile::stat_source(const std::string& path, uint64_t& size, int64_t& mtime) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    mtime = static_cast<int64_t>(st.st_mtime);
+    return true;
+}
+
+std::shared_ptr<BrickFile> BrickFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        close(fd);
+        BLUSTREAM_LOG_WARN("Brick file too small: " + path);
+        return nullptr;
+    }
+
+    const size_t file_bytes = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, file_bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // The mapping keeps the file referenced
+    if (mapping == MAP_FAILED) {
+        BLUSTREAM_LOG_ERROR("Failed to map brick file " + path + ": " + std::string(strerror(errno)));
+        return nullptr;
+    }
+
+    std::shared_ptr<BrickFile> file(new BrickFile());
+    file->base_ = static_cast<const uint8_t*>(mapping);
+    file->mapped_bytes_ = file_bytes;
+    std::memcpy(&file->header_, file->base_, sizeof(Header));
+
+    const Header& header = file->header_;
+    if (std::memcmp(header.magic, BRICK_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != VERSION ||
+        header.format > static_cast<uint32_t>(SampleFormat::F32) || header.brick_size <= 0 ||
+        header.width <= 0 || header.height <= 0 || header.depth <= 0) {
+        BLUSTREAM_LOG_WARN("Not a usable brick file: " + path);
+        return nullptr;
+    }
+
+    brick_grid(header, file->grid_);
+    const uint64_t expected_count = static_cast<uint64_t>(file->grid_[0]) * file->grid_[1] * file->grid_[2];
+    const uint64_t index_end = sizeof(Header) + expected_count * sizeof(Entry);
+    if (header.brick_count != expected_count || index_end > file_bytes) {
+        BLUSTREAM_LOG_WARN("Brick file index is inconsistent: " + path);
+        return nullptr;
+    }
+    file->index_ = reinterpret_cast<const Entry*>(file->base_ + sizeof(Header));
+
+    // Check every entry once so brick_data() can trust the index
+    for (uint64_t i = 0; i < expected_count; i++) {
+        const Entry& entry = file->index_[i];
+        if (entry.offset % ALIGNMENT != 0 || entry.offset < index_end || entry.offset + entry.bytes > file_bytes) {
+            BLUSTREAM_LOG_WARN("Brick file entry " + std::to_string(i) + " is out of bounds: " + path);
+            return nullptr;
+        }
+    }
+
+    // Slices touch bricks all over the file; readahead is requested per brick instead
+    madvise(mapping, file_bytes, MADV_RANDOM);
+
+    BLUSTREAM_LOG_INFO("Mapped brick file " + path + ": " + std::to_string(header.width) + "x" +
+                      std::to_string(header.height) + "x" + std::to_string(header.depth) + ", " +
+                      std::to_string(expected_count) + " bricks, " +
+                      std::to_string(file_bytes / (1024 * 1024)) + " MB");
+    return file;
+}
+
+const uint8_t* BrickFile::brick_data(int bx, int by, int bz, size_t* bytes) const {
+    if (bx < 0 || by < 0 || bz < 0 || bx >= grid_[0] || by >= grid_[1] || bz >= grid_[2]) {
+        return nullptr;
+    }
+
+    const Entry& entry = index_[(static_cast<size_t>(bz) * grid_[1] + by) * grid_[0] + bx];
+    const uint8_t* data = base_ + entry.offset;
+
+    // Entries are page aligned, so this only ever rounds for pages larger than ALIGNMENT
+    static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t start = reinterpret_cast<uintptr_t>(data) / page * page;
+    madvise(reinterpret_cast<void*>(start), reinterpret_cast<uintptr_t>(data) + entry.bytes - start, MADV_WILLNEED);
+
+    if (bytes) {
+        *bytes = entry.bytes;
+    }
+    return data;
+}
+
+bool BrickFile::write(const std::string& path, const Header& header, const BrickCache::Loader& load,
+                      const std::atomic<bool>* keep_running) {
+    int grid[3];
+    brick_grid(header, grid);
+    const SampleFormat format = static_cast<SampleFormat>(header.format);
+    const size_t count = static_cast<size_t>(grid[0]) * grid[1] * grid[2];
+    const int dims[3] = {header.width, header.height, header.depth};
+
+    // Offsets follow from the grid alone, so the index goes out first
+    std::vector<Entry> index(count);
+    uint64_t offset = align_up(sizeof(Header) + count * sizeof(Entry), ALIGNMENT);
+    for (size_t i = 0; i < count; i++) {
+        const int b[3] = {static_cast<int>(i % grid[0]), static_cast<int>((i / grid[0]) % grid[1]),
+                          static_cast<int>(i / (static_cast<size_t>(grid[0]) * grid[1]))};
+        uint64_t samples = 1;
+        for (int axis = 0; axis < 3; axis++) {
+            samples *= std::min(header.brick_size, dims[axis] - b[axis] * header.brick_size);
+        }
+        index[i].offset = offset;
+        index[i].bytes = samples * sample_format_size(format);
+        offset = align_up(offset + index[i].bytes, ALIGNMENT);
+    }
+
+    const std::string temp_path = path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        BLUSTREAM_LOG_ERROR("Failed to create brick file " + temp_path + ": " + std::string(strerror(errno)));
+        return false;
+    }
+
+    Header out = header;
+    out.brick_count = count;
+    bool ok = ftruncate(fd, static_cast<off_t>(offset)) == 0 &&
+              write_all(fd, &out, sizeof(out), 0) &&
+              write_all(fd, index.data(), index.size() * sizeof(Entry), sizeof(Header));
+
+    BrickCache::Brick brick;
+    brick.format = format;
+    for (size_t i = 0; ok && i < count; i++) {
+        if (keep_running && !keep_running->load()) {
+            ok = false;
+            break;
+        }
+        brick.origin[0] = static_cast<int>(i % grid[0]) * header.brick_size;
+        brick.origin[1] = static_cast<int>((i / grid[0]) % grid[1]) * header.brick_size;
+        brick.origin[2] = static_cast<int>(i / (static_cast<size_t>(grid[0]) * grid[1])) * header.brick_size;
+        for (int axis = 0; axis < 3; axis++) {
+            brick.size[axis] = std::min(header.brick_size, dims[axis] - brick.origin[axis]);
+        }
+        brick.samples.resize(index[i].bytes);
+        ok = load(brick) && write_all(fd, brick.samples.data(), brick.samples.size(), index[i].offset);
+    }
+
+    // Durable before it becomes visible, so a crash never leaves a torn file under path
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        if (!keep_running || keep_running->load()) {
+            BLUSTREAM_LOG_ERROR("Failed to write brick file " + path);
+        }
+        return false;
+    }
+
+    BLUSTREAM_LOG_INFO("Wrote brick file " + path + " (" + std::to_string(count) + " bricks, " +
+                      std::to_string(offset / (1024 * 1024)) + " MB)");
+    return true;
+}
+
+} // namespace server
+} // namespace blustream
@@ -0,0 +1,486 @@
+#include "blustream/server/client_io.h"
+#include "blustream/common/logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace blustream {
+namespace server {
+
+namespace {
+
+// Packets gathered into one sendmsg(); two iovecs each
+constexpr size_t MAX_BATCH_PACKETS = 32;
+
+bool is_frame(const WirePacket& packet) {
+    return packet.header.type == static_cast<uint32_t>(common::MessageType::FRAME);
+}
+
+uint32_t steady_ms() {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+ClientConnection::ClientConnection(int socket_fd, const std::string& address, size_t max_queued,
+                                   const BandwidthEstimator::Config& rate_config)
+    : socket_fd_(socket_fd)
+    , address_(address)
+    , connected_(true)
+    , bytes_sent_(0)
+    , keyframe_requested_(false)
+    , bandwidth_(rate_config)
+    , send_offset_(0)
+    , in_flight_(0)
+    , max_queued_(std::max<size_t>(2, max_queued))
+    , awaiting_keyframe_(true)
+    , started_(false)
+    , connected_at_(std::chrono::steady_clock::now())
+    , join_to_keyframe_ms_(-1)
+    , peak_queued_(0)
+    , frames_sent_(0)
+    , frames_dropped_(0)
+    , keyframe_resyncs_(0) {
+}
+
+ClientConnection::~ClientConnection() {
+    disconnect();
+    if (socket_fd_ >= 0) {
+        close(socket_fd_);
+        socket_fd_ = -1;
+    }
+}
+
+bool ClientConnection::send_frame(const SharedPacket& packet) {
+    if (!connected_ || !packet) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+
+    if (is_frame(*packet)) {
+        // Frames after a gap can't be decoded until the next keyframe
+        if (awaiting_keyframe_) {
+            if (!packet->keyframe) {
+                if (started_) {
+                    frames_dropped_++;
+                }
+                return true;
+            }
+            awaiting_keyframe_ = false;
+            
+            if (!started_) {
+                started_ = true;
+                join_to_keyframe_ms_ = static_cast<int32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - connected_at_).count());
+                BLUSTREAM_LOG_INFO("Client " + address_ + " starts at keyframe after " +
+                                  std::to_string(join_to_keyframe_ms_) + " ms");
+            }
+        }
+
+        if (send_queue_.size() >= max_queued_) {
+            frames_dropped_ += drop_unsent([](const WirePacket& queued) {
+                return is_frame(queued) && queued.droppable;
+            });
+        }
+
+        if (send_queue_.size() >= max_queued_ && packet->droppable) {
+            frames_dropped_++;
+            return true;
+        }
+
+        if (send_queue_.size() >= max_queued_) {
+            // Everything unsent leads up to frames the client won't get in
+            // time; a keyframe restarts decoding, anything else waits for one
+            frames_dropped_ += drop_unsent(is_frame);
+            if (!packet->keyframe) {
+                frames_dropped_++;
+                keyframe_resyncs_++;
+                awaiting_keyframe_ = true;
+                keyframe_requested_ = true;
+                return true;
+            }
+        }
+    }
+
+    send_queue_.push_back(packet);
+    peak_queued_ = std::max(peak_queued_, send_queue_.size());
+    return true;
+}
+
+void ClientConnection::on_receiver_report(const common::ReceiverReport& report) {
+    // Both ends of the round trip are on this clock; the client only
+    // subtracts how long it sat on the frame before reporting
+    const uint32_t elapsed = steady_ms() - report.echo_timestamp;
+    const uint32_t rtt = elapsed > report.hold_ms ? elapsed - report.hold_ms : 0;
+
+    uint32_t lag = 0;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (!send_queue_.empty()) {
+            lag = steady_ms() - send_queue_.front()->header.timestamp;
+        }
+    }
+    bandwidth_.on_report(report, rtt, lag);
+
+    // The next broadcast takes this like a send-queue resync
+    if (report.keyframe_request) {
+        keyframe_requested_ = true;
+    }
+}
+
+template <typename Filter>
+size_t ClientConnection::drop_unsent(Filter filter) {
+    // Called with queue_mutex_ held; entries the I/O thread is writing stay,
+    // as does a front packet that is partly on the wire
+    const size_t first = std::min(std::max<size_t>(in_flight_, send_offset_ > 0 ? 1 : 0), send_queue_.size());
+    auto begin = send_queue_.begin() + static_cast<std::ptrdiff_t>(first);
+    auto keep_end = std::stable_partition(begin, send_queue_.end(), [&](const SharedPacket& queued) {
+        return !filter(*queued);
+    });
+    const size_t dropped = static_cast<size_t>(send_queue_.end() - keep_end);
+    send_queue_.erase(keep_end, send_queue_.end());
+    return dropped;
+}
+
+void ClientConnection::disconnect() {
+    // Shut down rather than close, so the I/O pool and the control reader
+    // see the end of the stream before the descriptor can be reused
+    if (connected_.exchange(false) && socket_fd_ >= 0) {
+        shutdown(socket_fd_, SHUT_RDWR);
+    }
+}
+
+bool ClientConnection::has_pending() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return !send_queue_.empty();
+}
+
+ClientConnection::FlushResult ClientConnection::flush(LatencyHistogram* send_latency) {
+    if (!connected_) {
+        return FlushResult::FAILED;
+    }
+
+    while (true) {
+        // Raw pointers are safe: only this thread pops, and deque push_back
+        // leaves existing elements where they are
+        const WirePacket* batch[MAX_BATCH_PACKETS];
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            count = std::min(send_queue_.size(), MAX_BATCH_PACKETS);
+            for (size_t i = 0; i < count; i++) {
+                batch[i] = send_queue_[i].get();
+            }
+            in_flight_ = count;
+        }
+        if (count == 0) {
+            return FlushResult::DRAINED;
+        }
+
+        iovec iov[MAX_BATCH_PACKETS * 2];
+        size_t iov_count = 0;
+        for (size_t i = 0; i < count; i++) {
+            const WirePacket* packet = batch[i];
+            size_t skip = i == 0 ? send_offset_ : 0;
+
+            if (skip < sizeof(packet->header)) {
+                iov[iov_count].iov_base = const_cast<uint8_t*>(
+                    reinterpret_cast<const uint8_t*>(&packet->header)) + skip;
+                iov[iov_count].iov_len = sizeof(packet->header) - skip;
+                iov_count++;
+                skip = 0;
+            } else {
+                skip -= sizeof(packet->header);
+            }
+            if (packet->payload.size() > skip) {
+                iov[iov_count].iov_base = const_cast<uint8_t*>(packet->payload.data()) + skip;
+                iov[iov_count].iov_len = packet->payload.size() - skip;
+                iov_count++;
+            }
+        }
+
+        // sendmsg is writev with MSG_NOSIGNAL, so a dead peer can't raise SIGPIPE
+        msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov_count;
+        ssize_t written = sendmsg(socket_fd_, &msg, MSG_NOSIGNAL);
+        const int send_error = errno;
+
+        // Retire every packet the write completed
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        in_flight_ = 0;
+        if (written < 0) {
+            if (send_error == EINTR) continue;
+            if (send_error == EAGAIN || send_error == EWOULDBLOCK) return FlushResult::BLOCKED;
+            connected_ = false;
+            return FlushResult::FAILED;
+        }
+        bytes_sent_ += static_cast<size_t>(written);
+
+        size_t remaining = static_cast<size_t>(written);
+        while (!send_queue_.empty()) {
+            const size_t left = send_queue_.front()->wire_size() - send_offset_;
+            if (remaining < left) {
+                send_offset_ += remaining;
+                break;
+            }
+            remaining -= left;
+            send_offset_ = 0;
+            if (is_frame(*send_queue_.front())) {
+                frames_sent_++;
+                if (send_latency) {
+                    send_latency->record(std::chrono::steady_clock::now() - send_queue_.front()->sealed_at);
+                }
+            }
+            send_queue_.pop_front();
+        }
+    }
+}
+
+std::string ClientConnection::get_info() const {
+    Stats stats = get_stats();
+    return address_ + " (sent: " + std::to_string(bytes_sent_ / 1024) + " KB" +
+           ", queued: " + std::to_string(stats.queued_packets) +
+           ", lag: " + std::to_string(stats.lag_ms) + " ms" +
+           ", dropped: " + std::to_string(stats.frames_dropped) +
+           ", resyncs: " + std::to_string(stats.keyframe_resyncs) +
+           ", rtt: " + std::to_string(stats.rtt_ms) + " ms" +
+           ", estimate: " + std::to_string(stats.estimated_kbps) + " kbps)";
+}
+
+ClientConnection::Stats ClientConnection::get_stats() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+
+    Stats stats;
+    stats.queued_packets = send_queue_.size();
+    stats.queued_bytes = 0;
+    for (const auto& packet : send_queue_) {
+        stats.queued_bytes += packet->wire_size();
+    }
+    stats.queued_bytes -= std::min(stats.queued_bytes, send_offset_);
+    stats.peak_queued_packets = peak_queued_;
+    stats.frames_sent = frames_sent_;
+    stats.frames_dropped = frames_dropped_;
+    stats.keyframe_resyncs = keyframe_resyncs_;
+    stats.join_to_keyframe_ms = join_to_keyframe_ms_;
+    stats.lag_ms = send_queue_.empty() ? 0 : steady_ms() - send_queue_.front()->header.timestamp;
+    stats.rtt_ms = bandwidth_.rtt_ms();
+    stats.estimated_kbps = bandwidth_.has_estimate() ? bandwidth_.estimate_kbps() : 0;
+    stats.loss = bandwidth_.loss_fraction();
+    return stats;
+}
+
+ClientIOPool::ClientIOPool(size_t num_threads, LatencyHistogram* send_latency)
+    : num_threads_(std::max<size_t>(1, num_threads))
+    , send_latency_(send_latency)
+    , next_worker_(0)
+    , running_(false) {
+}
+
+ClientIOPool::~ClientIOPool() {
+    stop();
+}
+
+bool ClientIOPool::start() {
+    if (running_) {
+        return true;
+    }
+
+    for (size_t i = 0; i < num_threads_; i++) {
+        auto worker = std::make_unique<Worker>();
+        worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        worker->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (worker->epoll_fd < 0 || worker->event_fd < 0) {
+            BLUSTREAM_LOG_ERROR("Failed to create client I/O poller: " + std::string(strerror(errno)));
+            if (worker->epoll_fd >= 0) close(worker->epoll_fd);
+            if (worker->event_fd >= 0) close(worker->event_fd);
+            stop();
+            return false;
+        }
+
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = worker->event_fd;
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->event_fd, &event);
+        workers_.push_back(std::move(worker));
+    }
+
+    running_ = true;
+    for (auto& worker : workers_) {
+        Worker* w = worker.get();
+        w->thread = std::thread([this, w] { worker_loop(*w); });
+    }
+
+    BLUSTREAM_LOG_INFO("Client I/O pool started with " + std::to_string(workers_.size()) + " threads");
+    return true;
+}
+
+void ClientIOPool::stop() {
+    running_ = false;
+    notify_pending();
+
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+        worker->clients.clear();
+        worker->incoming.clear();
+        if (worker->epoll_fd >= 0) close(worker->epoll_fd);
+        if (worker->event_fd >= 0) close(worker->event_fd);
+    }
+    workers_.clear();
+}
+
+bool ClientIOPool::add_client(const std::shared_ptr<ClientConnection>& client) {
+    if (!running_ || workers_.empty() || !client) {
+        return false;
+    }
+
+    Worker& worker = *workers_[next_worker_++ % workers_.size()];
+    {
+        std::lock_guard<std::mutex> lock(worker.incoming_mutex);
+        worker.incoming.push_back(client);
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(worker.event_fd, &one, sizeof(one));
+    (void)ignored;
+    return true;
+}
+
+void ClientIOPool::notify_pending() {
+    uint64_t one = 1;
+    for (auto& worker : workers_) {
+        if (worker->event_fd >= 0) {
+            ssize_t ignored = write(worker->event_fd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+}
+
+void ClientIOPool::worker_loop(Worker& worker) {
+    epoll_event events[64];
+
+    while (running_) {
+        int ready = epoll_wait(worker.epoll_fd, events, 64, 100);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            BLUSTREAM_LOG_ERROR("Client I/O epoll_wait failed: " + std::string(strerror(errno)));
+            break;
+        }
+
+        bool woken = ready == 0;  // Sweep on timeout too, in case a wakeup was coalesced
+        for (int i = 0; i < ready; i++) {
+            const int fd = events[i].data.fd;
+            if (fd == worker.event_fd) {
+                uint64_t count;
+                ssize_t ignored = read(worker.event_fd, &count, sizeof(count));
+                (void)ignored;
+                woken = true;
+                continue;
+            }
+
+            auto it = worker.clients.find(fd);
+            if (it == worker.clients.end()) {
+                continue;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                it->second.client->disconnect();
+                remove_entry(worker, fd);
+            } else if (events[i].events & EPOLLOUT) {
+                flush_entry(worker, it->second);
+                if (!it->second.client->is_connected()) {
+                    remove_entry(worker, fd);
+                }
+            }
+        }
+
+        // Adopt new clients; only EPOLLERR/EPOLLHUP until a write blocks
+        std::vector<std::shared_ptr<ClientConnection>> incoming;
+        {
+            std::lock_guard<std::mutex> lock(worker.incoming_mutex);
+            incoming.swap(worker.incoming);
+        }
+        for (auto& client : incoming) {
+            const int fd = client->get_socket();
+            epoll_event event;
+            std::memset(&event, 0, sizeof(event));
+            event.data.fd = fd;
+            if (fd < 0 || epoll_ctl(worker.epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+                client->disconnect();
+                continue;
+            }
+            worker.clients[fd].client = client;
+            woken = true;
+        }
+
+        if (!woken) {
+            continue;
+        }
+
+        // Write to every client that has something queued and isn't blocked
+        std::vector<int> gone;
+        for (auto& item : worker.clients) {
+            Entry& entry = item.second;
+            if (!entry.client->is_connected()) {
+                gone.push_back(item.first);
+            } else if (!entry.waiting_writable && entry.client->has_pending()) {
+                flush_entry(worker, entry);
+                if (!entry.client->is_connected()) {
+                    gone.push_back(item.first);
+                }
+            }
+        }
+        for (int fd : gone) {
+            remove_entry(worker, fd);
+        }
+    }
+}
+
+void ClientIOPool::flush_entry(Worker& worker, Entry& entry) {
+    const int fd = entry.client->get_socket();
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.data.fd = fd;
+
+    switch (entry.client->flush(send_latency_)) {
+        case ClientConnection::FlushResult::DRAINED:
+            if (entry.waiting_writable) {
+                epoll_ctl(worker.epoll_fd, EPOLL_CTL_MOD, fd, &event);
+                entry.waiting_writable = false;
+            }
+            break;
+
+        case ClientConnection::FlushResult::BLOCKED:
+            if (!entry.waiting_writable) {
+                event.events = EPOLLOUT;
+                epoll_ctl(worker.epoll_fd, EPOLL_CTL_MOD, fd, &event);
+                entry.waiting_writable = true;
+            }
+            break;
+
+        case ClientConnection::FlushResult::FAILED:
+            entry.client->disconnect();  // Removed by the caller's sweep
+            break;
+    }
+}
+
+void ClientIOPool::remove_entry(Worker& worker, int fd) {
+    // Deregister before the entry goes, as dropping it may close the socket
+    epoll_ctl(worker.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    worker.clients.erase(fd);
+}
+
+} // namespace server
+} // namespace blustream
@@ -0,0 +1,415 @@
+#include "blustream/server/colormap.h"
+#include "blustream/server/yuv_converter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLUSTREAM_COLORMAP_AVX2 1
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define BLUSTREAM_COLORMAP_NEON 1
+#endif
+
+namespace blustream {
+namespace server {
+
+namespace {
+
+// Seismic grayscale transfer curve applied to a normalized amplitude
+uint8_t seismic_intensity(float normalized) {
+    // Enhanced seismic visualization with smoother rendering to reduce graininess
+    uint8_t intensity;
+
+    // Apply Gaussian-like smoothing curve to reduce graininess
+    float smooth_factor = 1.0f - std::exp(-normalized * 3.0f);
+    float smoothed = normalized * 0.7f + smooth_factor * 0.3f;
+
+    // Apply gentler gamma correction
+    float gamma_corrected = std::pow(smoothed, 0.6f);
+
+    // Create smooth seismic-style color mapping with reduced contrast jumps
+    if (normalized < 0.05f) {
+        // Very low amplitude - smooth dark
+        intensity = static_cast<uint8_t>(smoothed * 20.0f * 255.0f);
+    } else if (normalized > 0.95f) {
+        // Very high amplitude - smooth bright
+        intensity = static_cast<uint8_t>(255.0f * (0.8f + 0.2f * smoothed));
+    } else {
+        // Mid range - smooth gradient with enhanced contrast
+        intensity = static_cast<uint8_t>(gamma_corrected * 255.0f);
+    }
+    return intensity;
+}
+
+uint32_t pack_rgb(uint8_t r, uint8_t g, uint8_t b) {
+    return static_cast<uint32_t>(r) | (static_cast<uint32_t>(g) << 8) | (static_cast<uint32_t>(b) << 16);
+}
+
+void store_rgb(uint32_t packed, uint8_t* dst) {
+    dst[0] = static_cast<uint8_t>(packed);
+    dst[1] = static_cast<uint8_t>(packed >> 8);
+    dst[2] = static_cast<uint8_t>(packed >> 16);
+}
+
+// Scalar kernels; also finish the tails the SIMD kernels leave behind
+
+void map_u8_scalar(const uint8_t* src, size_t begin, size_t count, const uint32_t* lut, uint8_t* rgb) {
+    for (size_t i = begin; i < count; i++) {
+        store_rgb(lut[src[i]], rgb + i * 3);
+    }
+}
+
+void map_u16_scalar(const uint16_t* src, size_t begin, size_t count, const uint32_t* lut, uint8_t* rgb) {
+    for (size_t i = begin; i < count; i++) {
+        store_rgb(lut[src[i] >> 4], rgb + i * 3);
+    }
+}
+
+void map_f32_scalar(const float* src, size_t begin, size_t count, const uint32_t* lut,
+                    float lo, float index_scale, uint8_t* rgb) {
+    const float max_index = static_cast<float>(ColorMap::WIDE_ENTRIES - 1);
+    for (size_t i = begin; i < count; i++) {
+        float t = (src[i] - lo) * index_scale;
+        t = t >= 0.0f ? std::min(t, max_index) : 0.0f;  // NaN lands on entry 0
+        store_rgb(lut[static_cast<int>(t)], rgb + i * 3);
+    }
+}
+
+#if BLUSTREAM_COLORMAP_AVX2
+
+// Pack eight 0x00BBGGRR pixels into 24 RGB bytes. Writes 28 bytes, so callers
+// keep at least two pixels of slack after every block.
+__attribute__((target("avx2")))
+inline void store_rgb8_avx2(__m256i packed, uint8_t* dst) {
+    const __m256i compact = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                             0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m256i rgb = _mm256_shuffle_epi8(packed, compact);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(rgb));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 12), _mm256_extracti128_si256(rgb, 1));
+}
+
+__attribute__((target("avx2")))
+size_t map_u8_avx2(const uint8_t* src, size_t count, const uint32_t* lut, uint8_t* rgb) {
+    size_t i = 0;
+    for (; i + 10 <= count; i += 8) {
+        __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+        __m256i px = _mm256_i32gather_epi32(reinterpret_cast<const int*>(lut), idx, 4);
+        store_rgb8_avx2(px, rgb + i * 3);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t map_u16_avx2(const uint16_t* src, size_t count, const uint32_t* lut, uint8_t* rgb) {
+    size_t i = 0;
+    for (; i + 10 <= count; i += 8) {
+        __m256i codes = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        __m256i px = _mm256_i32gather_epi32(reinterpret_cast<const int*>(lut), _mm256_srli_epi32(codes, 4), 4);
+        store_rgb8_avx2(px, rgb + i * 3);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t map_f32_avx2(const float* src, size_t count, const uint32_t* lut, float lo, float index_scale, uint8_t* rgb) {
+    const __m256 lo_v = _mm256_set1_ps(lo);
+    const __m256 scale_v = _mm256_set1_ps(index_scale);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 max_index = _mm256_set1_ps(static_cast<float>(ColorMap::WIDE_ENTRIES - 1));
+
+    size_t i = 0;
+    for (; i + 10 <= count; i += 8) {
+        __m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(src + i), lo_v), scale_v);
+        t = _mm256_min_ps(_mm256_max_ps(t, zero), max_index);  // max_ps(NaN, 0) yields 0
+        __m256i px = _mm256_i32gather_epi32(reinterpret_cast<const int*>(lut), _mm256_cvttps_epi32(t), 4);
+        store_rgb8_avx2(px, rgb + i * 3);
+    }
+    return i;
+}
+
+bool cpu_has_avx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+#endif // BLUSTREAM_COLORMAP_AVX2
+
+#if BLUSTREAM_COLORMAP_NEON
+
+// 256-entry byte lookup as four 64-byte TBL/TBX steps; out-of-range indices
+// leave the previous result untouched, so the steps compose
+inline uint8x16_t lookup256_neon(const uint8x16x4_t table[4], uint8x16_t idx) {
+    uint8x16_t result = vqtbl4q_u8(table[0], idx);
+    result = vqtbx4q_u8(result, table[1], vsubq_u8(idx, vdupq_n_u8(64)));
+    result = vqtbx4q_u8(result, table[2], vsubq_u8(idx, vdupq_n_u8(128)));
+    result = vqtbx4q_u8(result, table[3], vsubq_u8(idx, vdupq_n_u8(192)));
+    return result;
+}
+
+inline void load_table_neon(const uint8_t* lut, uint8x16x4_t table[4]) {
+    for (int t = 0; t < 4; t++) {
+        for (int v = 0; v < 4; v++) {
+            table[t].val[v] = vld1q_u8(lut + t * 64 + v * 16);
+        }
+    }
+}
+
+size_t map_u8_neon(const uint8_t* src, size_t count, const uint8_t* lut_r, const uint8_t* lut_g,
+                   const uint8_t* lut_b, bool grayscale, uint8_t* rgb) {
+    uint8x16x4_t table_r[4], table_g[4], table_b[4];
+    load_table_neon(lut_r, table_r);
+    if (!grayscale) {
+        load_table_neon(lut_g, table_g);
+        load_table_neon(lut_b, table_b);
+    }
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t idx = vld1q_u8(src + i);
+        uint8x16x3_t out;
+        out.val[0] = lookup256_neon(table_r, idx);
+        if (grayscale) {
+            out.val[1] = out.val[0];
+            out.val[2] = out.val[0];
+        } else {
+            out.val[1] = lookup256_neon(table_g, idx);
+            out.val[2] = lookup256_neon(table_b, idx);
+        }
+        vst3q_u8(rgb + i * 3, out);
+    }
+    return i;
+}
+
+#endif // BLUSTREAM_COLORMAP_NEON
+
+} // namespace
+
+ColorMap::ColorMap()
+    : range_lo_(0.0f)
+    , range_hi_(1.0f)
+    , f32_index_scale_(static_cast<float>(WIDE_ENTRIES - 1)) {
+    build(Params());
+}
+
+void ColorMap::build(const Params& params) {
+    params_ = params;
+
+    range_lo_ = params_.min_value;
+    range_hi_ = params_.max_value;
+    if (params_.type == Type::RED_WHITE_BLUE) {
+        // Keep zero amplitude on white regardless of how lopsided the range is
+        float extent = std::max(std::fabs(range_lo_), std::fabs(range_hi_));
+        range_lo_ = -extent;
+        range_hi_ = extent;
+    }
+    if (!(range_hi_ > range_lo_)) {
+        range_hi_ = range_lo_ + 1.0f;
+    }
+    f32_index_scale_ = static_cast<float>(WIDE_ENTRIES - 1) / (range_hi_ - range_lo_);
+
+    uint8_t r, g, b;
+    for (size_t code = 0; code < U8_ENTRIES; code++) {
+        color_of(params_.offset + params_.scale * static_cast<float>(code), r, g, b);
+        lut_u8_[code] = pack_rgb(r, g, b);
+        lut_u8_r_[code] = r;
+        lut_u8_g_[code] = g;
+        lut_u8_b_[code] = b;
+        luma_u8_[code] = rgb_to_luma(r, g, b);
+        chroma_u8_[code] = rgb_to_chroma(r, g, b);
+    }
+
+    for (size_t entry = 0; entry < WIDE_ENTRIES; entry++) {
+        // U16 entries cover 16 codes each; sample the middle of the bucket
+        color_of(params_.offset + params_.scale * static_cast<float>(entry * 16 + 8), r, g, b);
+        lut_u16_[entry] = pack_rgb(r, g, b);
+        luma_u16_[entry] = rgb_to_luma(r, g, b);
+        chroma_u16_[entry] = rgb_to_chroma(r, g, b);
+
+        color_of(range_lo_ + static_cast<float>(entry) / f32_index_scale_, r, g, b);
+        lut_f32_[entry] = pack_rgb(r, g, b);
+        luma_f32_[entry] = rgb_to_luma(r, g, b);
+        chroma_f32_[entry] = rgb_to_chroma(r, g, b);
+    }
+}
+
+void ColorMap::color_of(float value, uint8_t& r, uint8_t& g, uint8_t& b) const {
+    float normalized = (value - range_lo_) / (range_hi_ - range_lo_);
+    normalized = normalized >= 0.0f ? std::min(normalized, 1.0f) : 0.0f;
+
+    switch (params_.type) {
+        case Type::SEISMIC_GRAY:
+            r = g = b = seismic_intensity(normalized);
+            break;
+
+        case Type::GRAY:
+            r = g = b = static_cast<uint8_t>(normalized * 255.0f + 0.5f);
+            break;
+
+        case Type::RED_WHITE_BLUE: {
+            // Negative amplitudes fade from blue to white, positive from white to red
+            float t = normalized * 2.0f - 1.0f;
+            uint8_t fade = static_cast<uint8_t>((1.0f - std::fabs(t)) * 255.0f + 0.5f);
+            if (t < 0.0f) {
+                r = fade;
+                g = fade;
+                b = 255;
+            } else {
+                r = 255;
+                g = fade;
+                b = fade;
+            }
+            break;
+        }
+    }
+}
+
+void ColorMap::map(SampleFormat format, const void* samples, size_t count, uint8_t* rgb) const {
+    size_t done = 0;
+
+    switch (format) {
+        case SampleFormat::U8: {
+            const auto* src = static_cast<const uint8_t*>(samples);
+#if BLUSTREAM_COLORMAP_AVX2
+            if (cpu_has_avx2()) done = map_u8_avx2(src, count, lut_u8_, rgb);
+#elif BLUSTREAM_COLORMAP_NEON
+            done = map_u8_neon(src, count, lut_u8_r_, lut_u8_g_, lut_u8_b_, is_grayscale(), rgb);
+#endif
+            map_u8_scalar(src, done, count, lut_u8_, rgb);
+            break;
+        }
+
+        case SampleFormat::U16: {
+            const auto* src = static_cast<const uint16_t*>(samples);
+#if BLUSTREAM_COLORMAP_AVX2
+            if (cpu_has_avx2()) done = map_u16_avx2(src, count, lut_u16_, rgb);
+#endif
+            map_u16_scalar(src, done, count, lut_u16_, rgb);
+            break;
+        }
+
+        case SampleFormat::F32: {
+            const auto* src = static_cast<const float*>(samples);
+#if BLUSTREAM_COLORMAP_AVX2
+            if (cpu_has_avx2()) done = map_f32_avx2(src, count, lut_f32_, range_lo_, f32_index_scale_, rgb);
+#endif
+            map_f32_scalar(src, done, count, lut_f32_, range_lo_, f32_index_scale_, rgb);
+            break;
+        }
+    }
+}
+
+const uint32_t* ColorMap::get_rgb_table(SampleFormat format, size_t& entries,
+                                        float& index_scale, float& index_offset) const {
+    switch (format) {
+        case SampleFormat::U8:
+            // Half a code of offset so normalization error can't floor a code into its neighbour
+            entries = U8_ENTRIES;
+            index_scale = 255.0f;
+            index_offset = 0.5f;
+            return lut_u8_;
+
+        case SampleFormat::U16:
+            // Each entry covers 16 codes
+            entries = WIDE_ENTRIES;
+            index_scale = 65535.0f / 16.0f;
+            index_offset = 0.5f / 16.0f;
+            return lut_u16_;
+
+        case SampleFormat::F32:
+        default:
+            entries = WIDE_ENTRIES;
+            index_scale = f32_index_scale_;
+            index_offset = -range_lo_ * f32_index_scale_;
+            return lut_f32_;
+    }
+}
+
+void ColorMap::map_luma(SampleFormat format, const void* samples, size_t count, uint8_t* luma) const {
+    lookup(format, samples, count, luma_u8_, luma_u16_, luma_f32_, luma);
+}
+
+void ColorMap::map_chroma(SampleFormat format, const void* samples, size_t count, uint16_t* chroma) const {
+    lookup(format, samples, count, chroma_u8_, chroma_u16_, chroma_f32_, chroma);
+}
+
+// Plain table walk; callers map one source row at a time, which is small
+// next to the scaled frame it feeds
+template <typename Entry>
+void ColorMap::lookup(SampleFormat format, const void* samples, size_t count,
+                      const Entry* table_u8, const Entry* table_u16, const Entry* table_f32, Entry* out) const {
+    switch (format) {
+        case SampleFormat::U8: {
+            const auto* src = static_cast<const uint8_t*>(samples);
+            for (size_t i = 0; i < count; i++) {
+                out[i] = table_u8[src[i]];
+            }
+            break;
+        }
+
+        case SampleFormat::U16: {
+            const auto* src = static_cast<const uint16_t*>(samples);
+            for (size_t i = 0; i < count; i++) {
+                out[i] = table_u16[src[i] >> 4];
+            }
+            break;
+        }
+
+        case SampleFormat::F32: {
+            const auto* src = static_cast<const float*>(samples);
+            const float max_index = static_cast<float>(WIDE_ENTRIES - 1);
+            for (size_t i = 0; i < count; i++) {
+                float t = (src[i] - range_lo_) * f32_index_scale_;
+                t = t >= 0.0f ? std::min(t, max_index) : 0.0f;  // NaN lands on entry 0
+                out[i] = table_f32[static_cast<int>(t)];
+            }
+            break;
+        }
+    }
+}
+
+uint8_t ColorMap::rgb_to_luma(uint8_t r, uint8_t g, uint8_t b) {
+    return YUVConverter::luma(r, g, b);
+}
+
+uint16_t ColorMap::rgb_to_chroma(uint8_t r, uint8_t g, uint8_t b) {
+    return static_cast<uint16_t>(YUVConverter::chroma_u(r, g, b) | (YUVConverter::chroma_v(r, g, b) << 8));
+}
+
+bool ColorMap::parse_type(const std::string& name, Type& type) {
+    if (name == "seismic") {
+        type = Type::SEISMIC_GRAY;
+    } else if (name == "gray" || name == "grey") {
+        type = Type::GRAY;
+    } else if (name == "rwb" || name == "red-white-blue") {
+        type = Type::RED_WHITE_BLUE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string ColorMap::type_to_string(Type type) {
+    switch (type) {
+        case Type::SEISMIC_GRAY:   return "seismic";
+        case Type::GRAY:           return "gray";
+        case Type::RED_WHITE_BLUE: return "red-white-blue";
+        default:                   return "unknown";
+    }
+}
+
+std::string ColorMap::get_kernel_name() {
+#if BLUSTREAM_COLORMAP_AVX2
+    return cpu_has_avx2() ? "avx2" : "scalar";
+#elif BLUSTREAM_COLORMAP_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace server
+} // namespace blustream
@@ -0,0 +1,340 @@
+#include "blustream/server/encoder_pool.h"
+#include "blustream/common/logger.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace blustream {
+namespace server {
+
+EncoderPool::Lease::Stats EncoderPool::Lease::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.frames_encoded = frames_encoded_;
+    stats.frames_dropped = frames_dropped_;
+    stats.avg_encode_time_ms = avg_encode_time_ms_;
+    return stats;
+}
+
+EncoderPool::EncoderPool()
+    : EncoderPool(Config()) {
+}
+
+EncoderPool::EncoderPool(const Config& config)
+    : config_(config)
+    , running_(false)
+    , ready_count_(0)
+    , gpu_leases_(0)
+    , cpu_leases_(0)
+    , next_home_(0)
+    , frames_encoded_(0)
+    , frames_dropped_(0)
+    , steals_(0) {
+}
+
+EncoderPool::~EncoderPool() {
+    stop();
+}
+
+bool EncoderPool::start() {
+    if (running_) {
+        return true;
+    }
+
+    size_t num_workers = config_.num_workers;
+    if (num_workers == 0) {
+        num_workers = std::min<size_t>(8, std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    {
+        // schedule() only reaches workers_ once running_ is set under this lock
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        for (size_t i = 0; i < num_workers; i++) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        running_ = true;
+    }
+    for (size_t i = 0; i < num_workers; i++) {
+        workers_[i]->thread = std::thread(&EncoderPool::worker_loop, this, i);
+    }
+
+    BLUSTREAM_LOG_INFO("Encoder pool started: " + std::to_string(num_workers) + " workers, up to " +
+                      std::to_string(config_.max_gpu_encoders) + " GPU + " +
+                      std::to_string(config_.max_cpu_encoders) + " CPU encoders");
+    return true;
+}
+
+void EncoderPool::stop() {
+    {
+        // Once running_ is clear under this lock, no submitter touches workers_
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        if (!running_.exchange(false)) {
+            return;
+        }
+        wake_cv_.notify_all();
+    }
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    // Leases still on a deque are not queued anymore; their next submit
+    // after start() schedules them again
+    for (auto& worker : workers_) {
+        for (auto& lease : worker->ready) {
+            std::lock_guard<std::mutex> lock(lease->mutex_);
+            lease->queued_ = false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    workers_.clear();
+    ready_count_ = 0;
+}
+
+std::shared_ptr<EncoderPool::Lease> EncoderPool::acquire(const HardwareEncoder::Config& encoder_config,
+                                                        FrameCallback on_frame) {
+    // Reserve the slot first; opening an encoder takes a while
+    bool want_gpu = false;
+    {
+        std::lock_guard<std::mutex> lock(leases_mutex_);
+        if (gpu_leases_ < config_.max_gpu_encoders) {
+            want_gpu = true;
+            gpu_leases_++;
+        } else if (cpu_leases_ < config_.max_cpu_encoders) {
+            cpu_leases_++;
+        } else {
+            BLUSTREAM_LOG_WARN("Encoder pool full (" + std::to_string(gpu_leases_) + " GPU, " +
+                              std::to_string(cpu_leases_) + " CPU)");
+            return nullptr;
+        }
+    }
+
+    HardwareEncoder::Config lease_config = encoder_config;
+    lease_config.encoder_type = want_gpu ? config_.gpu_encoder_type : HardwareEncoder::Type::SOFTWARE_X264;
+
+    auto lease = std::make_shared<Lease>();
+    lease->encoder_ = std::make_unique<HardwareEncoder>();
+    bool opened = lease->encoder_->initialize(lease_config);
+    lease->hardware_ = opened && lease->encoder_->supports_hardware_acceleration();
+
+    {
+        std::lock_guard<std::mutex> lock(leases_mutex_);
+
+        // No GPU encoder after all (none present, or the board is out of
+        // sessions): the encoder fell back to x264 and needs a CPU slot
+        if (want_gpu && !lease->hardware_) {
+            gpu_leases_--;
+            if (opened && cpu_leases_ < config_.max_cpu_encoders) {
+                cpu_leases_++;
+            } else {
+                opened = false;
+            }
+        } else if (!opened) {
+            cpu_leases_--;
+        }
+        lease->home_worker_ = next_home_++;
+    }
+
+    if (!opened) {
+        BLUSTREAM_LOG_ERROR("Failed to open a pooled encoder for " + std::to_string(lease_config.width) + "x" +
+                           std::to_string(lease_config.height));
+        return nullptr;
+    }
+
+    lease->name_ = lease->encoder_->get_encoder_name();
+    lease->on_frame_ = std::move(on_frame);
+    BLUSTREAM_LOG_INFO("Leased " + std::string(lease->hardware_ ? "GPU" : "CPU") + " encoder " + lease->name_ +
+                      " for " + std::to_string(lease_config.width) + "x" + std::to_string(lease_config.height));
+    return lease;
+}
+
+void EncoderPool::release(const std::shared_ptr<Lease>& lease) {
+    if (!lease) {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(lease->mutex_);
+        if (lease->released_) {
+            return;
+        }
+        lease->released_ = true;
+        lease->has_pending_ = false;
+        lease->idle_cv_.wait(lock, [&] { return !lease->encoding_; });
+    }
+
+    // A copy may still sit on a deque; the worker drops it. The encoder
+    // itself goes now so its slot is really free.
+    lease->encoder_->shutdown();
+
+    std::lock_guard<std::mutex> lock(leases_mutex_);
+    if (lease->hardware_) {
+        gpu_leases_--;
+    } else {
+        cpu_leases_--;
+    }
+}
+
+bool EncoderPool::submit(const std::shared_ptr<Lease>& lease, const uint8_t* rgb_data, size_t size) {
+    if (!lease) {
+        return false;
+    }
+
+    bool needs_schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(lease->mutex_);
+        if (lease->released_) {
+            return false;
+        }
+        if (lease->has_pending_) {
+            lease->frames_dropped_++;
+            frames_dropped_++;
+        }
+        lease->pending_.assign(rgb_data, rgb_data + size);
+        lease->has_pending_ = true;
+        if (!lease->queued_) {
+            lease->queued_ = true;
+            needs_schedule = true;
+        }
+    }
+
+    if (needs_schedule) {
+        schedule(lease);
+    }
+    return true;
+}
+
+void EncoderPool::schedule(const std::shared_ptr<Lease>& lease) {
+    {
+        // stop() clears running_ under this lock before it joins the
+        // workers and clears workers_
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        if (running_ && !workers_.empty()) {
+            Worker& worker = *workers_[lease->home_worker_ % workers_.size()];
+            {
+                std::lock_guard<std::mutex> worker_lock(worker.mutex);
+                worker.ready.push_back(lease);
+            }
+            ready_count_++;
+            wake_cv_.notify_one();
+            return;
+        }
+    }
+
+    // Stopped: nothing will encode it, so let the next submit schedule it again
+    std::lock_guard<std::mutex> lock(lease->mutex_);
+    lease->queued_ = false;
+}
+
+bool EncoderPool::take_work(size_t index, std::shared_ptr<Lease>& lease) {
+    // Own deque from the front, everyone else's from the back
+    bool stolen = false;
+    for (size_t n = 0; n < workers_.size() && !lease; n++) {
+        Worker& worker = *workers_[(index + n) % workers_.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.ready.empty()) {
+            continue;
+        }
+        if (n == 0) {
+            lease = std::move(worker.ready.front());
+            worker.ready.pop_front();
+        } else {
+            lease = std::move(worker.ready.back());
+            worker.ready.pop_back();
+            stolen = true;
+        }
+    }
+
+    if (!lease) {
+        return false;
+    }
+    if (stolen) {
+        steals_++;
+    }
+
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    ready_count_--;
+    return true;
+}
+
+void EncoderPool::worker_loop(size_t index) {
+    while (running_) {
+        std::shared_ptr<Lease> lease;
+        if (take_work(index, lease)) {
+            // A frame that arrived mid-encode found the lease still queued;
+            // put it back so that frame gets its turn
+            if (encode(*lease)) {
+                schedule(lease);
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cv_.wait_for(lock, std::chrono::milliseconds(100), [&] {
+            return ready_count_ > 0 || !running_;
+        });
+    }
+}
+
+bool EncoderPool::encode(Lease& lease) {
+    {
+        std::lock_guard<std::mutex> lock(lease.mutex_);
+        if (lease.released_ || !lease.has_pending_) {
+            lease.queued_ = false;
+            return false;
+        }
+        lease.working_.swap(lease.pending_);
+        lease.has_pending_ = false;
+        lease.encoding_ = true;
+    }
+
+    auto encode_start = std::chrono::steady_clock::now();
+    // encoded_ is only touched here, and one worker at a time holds a lease
+    bool produced = lease.encoder_->encode_frame(lease.working_.data(), lease.working_.size(), lease.encoded_);
+    float encode_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - encode_start).count();
+
+    // Still inside encoding_, so release() can't return while the callback
+    // runs. Everything the encoder has ready goes out now, in order.
+    while (produced) {
+        if (lease.on_frame_) {
+            lease.on_frame_(lease.encoded_, lease.encoder_->last_frame_was_keyframe());
+        }
+        produced = lease.encoder_->receive_packet(lease.encoded_);
+    }
+
+    bool again = false;
+    {
+        std::lock_guard<std::mutex> lock(lease.mutex_);
+        lease.encoding_ = false;
+        lease.frames_encoded_++;
+        lease.avg_encode_time_ms_ = lease.frames_encoded_ == 1 ? encode_ms
+                                  : lease.avg_encode_time_ms_ * 0.9f + encode_ms * 0.1f;
+        again = lease.has_pending_ && !lease.released_;
+        lease.queued_ = again;
+    }
+    lease.idle_cv_.notify_all();
+    frames_encoded_++;
+    return again;
+}
+
+EncoderPool::Stats EncoderPool::get_stats() const {
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(leases_mutex_);
+        stats.gpu_encoders = gpu_leases_;
+        stats.cpu_encoders = cpu_leases_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stats.workers = workers_.size();
+    }
+    stats.frames_encoded = frames_encoded_;
+    stats.frames_dropped = frames_dropped_;
+    stats.steals = steals_;
+    return stats;
+}
+
+} // namespace server
+} // namespace blustream
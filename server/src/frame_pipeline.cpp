@@ -0,0 +1,134 @@
+#include "blustream/server/frame_pipeline.h"
+
+#include <cstdio>
+
+namespace blustream {
+namespace server {
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration elapsed) {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    record_us(us > 0 ? static_cast<uint64_t>(us) : 0);
+}
+
+void LatencyHistogram::record_us(uint64_t microseconds) {
+    buckets_[bucket_of(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_us_.fetch_add(microseconds, std::memory_order_relaxed);
+
+    uint64_t max = max_us_.load(std::memory_order_relaxed);
+    while (microseconds > max &&
+           !max_us_.compare_exchange_weak(max, microseconds, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    total_us_.store(0, std::memory_order_relaxed);
+    max_us_.store(0, std::memory_order_relaxed);
+}
+
+float LatencyHistogram::mean_ms() const {
+    const uint64_t n = count();
+    return n ? static_cast<float>(total_us_.load(std::memory_order_relaxed)) / n / 1000.0f : 0.0f;
+}
+
+float LatencyHistogram::percentile_ms(double p) const {
+    const uint64_t n = count();
+    if (n == 0) {
+        return 0.0f;
+    }
+
+    const uint64_t rank = static_cast<uint64_t>(p * (n - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // The bucket edge can overshoot the largest sample actually seen
+            const uint64_t upper = bucket_upper_us(i);
+            const uint64_t max = max_us_.load(std::memory_order_relaxed);
+            return static_cast<float>(upper < max ? upper : max) / 1000.0f;
+        }
+    }
+    return static_cast<float>(max_us_.load(std::memory_order_relaxed)) / 1000.0f;
+}
+
+std::string LatencyHistogram::summary() const {
+    char buf[96];
+    snprintf(buf, sizeof(buf), "p50 %.1fms p99 %.1fms max %.1fms",
+             percentile_ms(0.50), percentile_ms(0.99),
+             static_cast<float>(max_us_.load(std::memory_order_relaxed)) / 1000.0f);
+    return buf;
+}
+
+// Values below 4us get a bucket each; above that, bucket 4 * (octave - 1) + sub
+// where sub is the two bits below the leading one
+size_t LatencyHistogram::bucket_of(uint64_t microseconds) {
+    if (microseconds < 4) {
+        return static_cast<size_t>(microseconds);
+    }
+
+    int octave = 63;
+    while (!(microseconds >> octave)) {
+        octave--;
+    }
+    const size_t sub = static_cast<size_t>((microseconds >> (octave - 2)) & 3);
+    const size_t bucket = 4 * static_cast<size_t>(octave - 1) + sub;
+    return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+uint64_t LatencyHistogram::bucket_upper_us(size_t bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    const int octave = static_cast<int>(bucket / 4) + 1;
+    const uint64_t sub = bucket % 4;
+    return ((4 + sub + 1) << (octave - 2)) - 1;
+}
+
+bool StillFrameGate::View::operator==(const View& other) const {
+    return axis == other.axis && index == other.index && lod == other.lod && colormap == other.colormap &&
+           width == other.width && height == other.height;
+}
+
+StillFrameGate::StillFrameGate(int settle_frames, std::chrono::steady_clock::duration refresh_interval)
+    : settle_frames_(settle_frames)
+    , refresh_interval_(refresh_interval)
+    , valid_(false)
+    , frames_since_change_(0)
+    , skipped_(0) {
+}
+
+StillFrameGate::Decision StillFrameGate::update(const View& view, bool keyframe_pending,
+                                                std::chrono::steady_clock::time_point now) {
+    if (!valid_ || view != view_) {
+        valid_ = true;
+        view_ = view;
+        frames_since_change_ = 0;
+        last_sent_ = now;
+        return Decision::RENDER;
+    }
+
+    if (keyframe_pending || frames_since_change_ < settle_frames_) {
+        frames_since_change_++;
+        last_sent_ = now;
+        return Decision::RENDER;
+    }
+
+    if (now - last_sent_ >= refresh_interval_) {
+        last_sent_ = now;
+        return Decision::REFRESH;
+    }
+
+    skipped_++;
+    return Decision::SKIP;
+}
+
+} // namespace server
+} // namespace blustream
@@ -5,7 +5,6 @@
 #include <chrono>
 #include <cstring>
 #include <sstream>
-#include <numeric>
 
 // FFmpeg includes
 extern "C" {
@@ -17,6 +16,22 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
+// GPU texture input
+#ifdef __linux__
+#include <GL/gl.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#include <GL/gl.h>
+#endif
+
+#ifdef BLUSTREAM_ENABLE_CUDA_INTEROP
+#include <cuda.h>
+#include <cudaGL.h>
+extern "C" {
+#include <libavutil/hwcontext_cuda.h>
+}
+#endif
+
 namespace blustream {
 namespace server {
 
@@ -39,6 +54,20 @@ static void free_packet(AVPacket* packet) {
     }
 }
 
+// Latency options come and go between FFmpeg releases; a missing one costs
+// latency, not correctness, so it's only worth a warning
+static void set_encoder_option(AVCodecContext* ctx, const char* name, int value) {
+    if (av_opt_set_int(ctx->priv_data, name, value, 0) < 0) {
+        BLUSTREAM_LOG_WARN(std::string("Encoder option not supported: ") + name);
+    }
+}
+
+static void set_encoder_option(AVCodecContext* ctx, const char* name, const char* value) {
+    if (av_opt_set(ctx->priv_data, name, value, 0) < 0) {
+        BLUSTREAM_LOG_WARN(std::string("Encoder option not supported: ") + name + "=" + value);
+    }
+}
+
 HardwareEncoder::HardwareEncoder()
     : active_encoder_type_(Type::SOFTWARE_X264)
     , initialized_(false)
@@ -47,7 +76,15 @@ HardwareEncoder::HardwareEncoder()
     , output_packet_(nullptr, free_packet)
     , hw_device_ctx_(nullptr)
     , hw_frames_ctx_(nullptr)
-    , hw_frame_(nullptr, free_frame) {
+    , hw_frame_(nullptr, free_frame)
+    , zero_copy_active_(false)
+    , gl_interop_resource_(nullptr)
+    , gl_interop_texture_(0)
+    , keyframe_requested_(false)
+    , requested_bitrate_kbps_(0)
+    , last_frame_keyframe_(false)
+    , next_pts_(0)
+    , stats_timed_frames_(0) {
     
     // Initialize stats
     stats_ = {};
@@ -102,6 +139,7 @@ bool HardwareEncoder::initialize(const Config& config) {
         BLUSTREAM_LOG_ERROR("Failed to initialize " + encoder_type_to_string(active_encoder_type_) + " encoder");
         
         // Fallback to software encoder
+        release_cuda_frames();
         if (active_encoder_type_ != Type::SOFTWARE_X264) {
             BLUSTREAM_LOG_INFO("Falling back to software x264 encoder...");
             active_encoder_type_ = Type::SOFTWARE_X264;
@@ -133,8 +171,11 @@ bool HardwareEncoder::initialize(const Config& config) {
         return false;
     }
     
-    // Allocate YUV conversion buffer
-    yuv_buffer_.resize(config_.width * config_.height * 3 / 2);  // YUV420 size
+    // RGB input goes straight into the frame planes
+    YUVConverter::Config converter_config;
+    converter_config.backend = config_.yuv_backend;
+    converter_config.threads = config_.yuv_threads;
+    yuv_converter_.configure(converter_config);
     
     initialized_ = true;
     stats_start_time_ = std::chrono::steady_clock::now();
@@ -152,68 +193,213 @@ void HardwareEncoder::shutdown() {
     
     BLUSTREAM_LOG_INFO("Shutting down hardware encoder...");
     
-    // Clean up hardware contexts
-    if (hw_frames_ctx_) {
-        av_buffer_unref(&hw_frames_ctx_);
-    }
-    
-    if (hw_device_ctx_) {
-        av_buffer_unref(&hw_device_ctx_);
-    }
-    
-    // Reset smart pointers (automatic cleanup)
+    // Reset smart pointers (automatic cleanup); the codec goes first so it
+    // drops its references to the hardware frames
     hw_frame_.reset();
     output_packet_.reset();
     input_frame_.reset();
     encoder_context_.reset();
     
+    // Clean up hardware contexts
+    release_cuda_frames();
+    
     initialized_ = false;
     BLUSTREAM_LOG_INFO("Hardware encoder shut down");
 }
 
-std::vector<uint8_t> HardwareEncoder::encode_frame(const std::vector<uint8_t>& rgb_data) {
+bool HardwareEncoder::encode_frame(const uint8_t* rgb_data, size_t size, std::vector<uint8_t>& encoded) {
+    encoded.clear();
     if (!initialized_) {
         BLUSTREAM_LOG_ERROR("Encoder not initialized");
-        return {};
+        return false;
     }
     
-    auto encode_start = std::chrono::steady_clock::now();
-    
     // Convert RGB to YUV420
-    if (!convert_rgb_to_yuv420(rgb_data, input_frame_.get())) {
+    AVFrame* frame = get_input_frame();
+    if (!frame || !convert_rgb_to_yuv420(rgb_data, size, frame)) {
         BLUSTREAM_LOG_ERROR("Failed to convert RGB to YUV420");
-        return {};
+        return false;
+    }
+    
+    return encode_input_frame(encoded);
+}
+
+AVFrame* HardwareEncoder::get_input_frame() {
+    if (!initialized_) {
+        return nullptr;
+    }
+    
+    if (zero_copy_active_) {
+        // The codec was opened for CUDA frames; system-memory planes can't be sent
+        return nullptr;
+    }
+    
+    // The encoder may still hold a reference to the previous frame's buffer
+    if (av_frame_make_writable(input_frame_.get()) < 0) {
+        BLUSTREAM_LOG_ERROR("Failed to make encoder input frame writable");
+        return nullptr;
+    }
+    return input_frame_.get();
+}
+
+bool HardwareEncoder::encode_input_frame(std::vector<uint8_t>& encoded) {
+    encoded.clear();
+    if (!initialized_) {
+        BLUSTREAM_LOG_ERROR("Encoder not initialized");
+        return false;
+    }
+    
+    if (zero_copy_active_) {
+        BLUSTREAM_LOG_ERROR("Encoder takes GPU textures only; use encode_from_texture()");
+        return false;
+    }
+    
+    return encode_avframe(input_frame_.get(), encoded);
+}
+
+bool HardwareEncoder::encode_from_texture(unsigned int gl_texture_id, std::vector<uint8_t>& encoded) {
+    encoded.clear();
+    if (!initialized_) {
+        BLUSTREAM_LOG_ERROR("Encoder not initialized");
+        return false;
+    }
+    
+    if (!zero_copy_active_) {
+        // No interop: read the texture back and take the CPU conversion path
+        texture_readback_.resize(static_cast<size_t>(config_.width) * config_.height * 3);
+        glBindTexture(GL_TEXTURE_2D, gl_texture_id);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, texture_readback_.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR) {
+            BLUSTREAM_LOG_ERROR("Failed to read back texture " + std::to_string(gl_texture_id) +
+                               ": GL error " + std::to_string(error));
+            return false;
+        }
+        return encode_frame(texture_readback_.data(), texture_readback_.size(), encoded);
     }
     
-    // Send frame to encoder
-    int ret = avcodec_send_frame(encoder_context_.get(), input_frame_.get());
+    if (!copy_texture_to_hardware(gl_texture_id, hw_frame_.get())) {
+        return false;
+    }
+    return encode_avframe(hw_frame_.get(), encoded);
+}
+
+bool HardwareEncoder::encode_avframe(AVFrame* frame, std::vector<uint8_t>& encoded) {
+    auto encode_start = std::chrono::steady_clock::now();
+    
+    frame->pict_type = keyframe_requested_.exchange(false) ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+    frame->pts = next_pts_++;
+    
+    const int bitrate_kbps = requested_bitrate_kbps_.exchange(0);
+    if (bitrate_kbps > 0 && bitrate_kbps != config_.bitrate_kbps) {
+        apply_bitrate(bitrate_kbps);
+    }
+    
+    // A full pipeline refuses input until a packet has been taken out
+    bool produced = false;
+    int ret = avcodec_send_frame(encoder_context_.get(), frame);
+    if (ret == AVERROR(EAGAIN)) {
+        produced = receive_packet(encoded);
+        ret = avcodec_send_frame(encoder_context_.get(), frame);
+    }
     if (ret < 0) {
-        BLUSTREAM_LOG_ERROR("Failed to send frame to encoder: " + std::to_string(ret));
-        return {};
+        BLUSTREAM_LOG_EVERY_MS(ERROR, 1000, "Failed to send frame to encoder: " + std::to_string(ret));
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.frames_dropped++;
+        return produced;
     }
     
-    // Receive encoded packet
-    ret = avcodec_receive_packet(encoder_context_.get(), output_packet_.get());
+    if (!produced) {
+        produced = receive_packet(encoded);
+    }
+    
+    // Time from input to first output; with a pipelined encoder that is
+    // the submit cost, not the encoder's latency
+    if (produced) {
+        auto encode_end = std::chrono::steady_clock::now();
+        update_performance_stats(std::chrono::duration<float, std::milli>(encode_end - encode_start).count());
+    }
+    return produced;
+}
+
+bool HardwareEncoder::receive_packet(std::vector<uint8_t>& encoded) {
+    encoded.clear();
+    last_frame_keyframe_ = false;
+    if (!initialized_) {
+        return false;
+    }
+    
+    int ret = avcodec_receive_packet(encoder_context_.get(), output_packet_.get());
     if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
         // Need more frames or end of stream
-        return {};
+        return false;
     } else if (ret < 0) {
-        BLUSTREAM_LOG_ERROR("Failed to receive packet from encoder: " + std::to_string(ret));
-        return {};
+        BLUSTREAM_LOG_EVERY_MS(ERROR, 1000, "Failed to receive packet from encoder: " + std::to_string(ret));
+        return false;
     }
     
-    // Extract encoded data
-    std::vector<uint8_t> encoded_data = extract_encoded_data(output_packet_.get());
+    // Copy out into the caller's buffer; the packet goes straight back to the codec
+    last_frame_keyframe_ = (output_packet_->flags & AV_PKT_FLAG_KEY) != 0;
+    encoded.assign(output_packet_->data, output_packet_->data + output_packet_->size);
     av_packet_unref(output_packet_.get());
     
-    // Update performance statistics
-    auto encode_end = std::chrono::steady_clock::now();
-    float encode_time_ms = std::chrono::duration<float, std::milli>(encode_end - encode_start).count();
-    update_performance_stats(encode_time_ms);
-    
+    std::lock_guard<std::mutex> lock(stats_mutex_);
     stats_.frames_encoded++;
+    return true;
+}
+
+bool HardwareEncoder::flush(std::vector<uint8_t>& encoded) {
+    encoded.clear();
+    if (!initialized_) {
+        return false;
+    }
     
-    return encoded_data;
+    int ret = avcodec_send_frame(encoder_context_.get(), nullptr);
+    if (ret < 0 && ret != AVERROR_EOF) {
+        BLUSTREAM_LOG_ERROR("Failed to flush encoder: " + std::to_string(ret));
+        return false;
+    }
+    return receive_packet(encoded);
+}
+
+void HardwareEncoder::configure_common(AVCodecContext* ctx) {
+    ctx->width = config_.width;
+    ctx->height = config_.height;
+    ctx->time_base = {1, config_.fps};
+    ctx->framerate = {config_.fps, 1};
+    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    ctx->bit_rate = config_.bitrate_kbps * 1000;
+    ctx->gop_size = config_.keyframe_interval;
+    ctx->max_b_frames = config_.enable_b_frames && !config_.low_latency ? 2 : 0;
+    
+    // Slices are coded in parallel and can be decoded before the whole
+    // picture has arrived; every encoder maps this to its own slice count
+    if (config_.slices_per_frame > 1) {
+        ctx->slices = config_.slices_per_frame;
+    }
+    
+    // NVENC, QuickSync and x264 share the common profile names; the level is
+    // left to the encoder, which derives it from size and frame rate
+    if (!config_.profile.empty() && av_opt_set(ctx->priv_data, "profile", config_.profile.c_str(), 0) < 0) {
+        BLUSTREAM_LOG_WARN("Encoder does not support H.264 profile " + config_.profile);
+    }
+    
+    configure_vbv(ctx);
+}
+
+void HardwareEncoder::configure_vbv(AVCodecContext* ctx) {
+    // x264 only takes a new bitrate at runtime if VBV was on when it opened,
+    // so every bitrate mode runs with it; CBR peaks at the target
+    if (config_.rate_control == Config::CQP) {
+        return;
+    }
+    const int max_kbps = config_.rate_control == Config::VBR
+                       ? std::max(config_.bitrate_kbps, config_.max_bitrate_kbps) : config_.bitrate_kbps;
+    ctx->rc_max_rate = static_cast<int64_t>(max_kbps) * 1000;
+    ctx->rc_buffer_size = config_.bitrate_kbps * config_.target_latency_ms;
 }
 
 bool HardwareEncoder::initialize_nvenc_encoder() {
@@ -236,20 +422,27 @@ bool HardwareEncoder::initialize_nvenc_encoder() {
     encoder_context_.reset(ctx);
     
     // Configure encoder
-    ctx->width = config_.width;
-    ctx->height = config_.height;
-    ctx->time_base = {1, config_.fps};
-    ctx->framerate = {config_.fps, 1};
-    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-    ctx->bit_rate = config_.bitrate_kbps * 1000;
-    ctx->gop_size = config_.keyframe_interval;
-    ctx->max_b_frames = config_.enable_b_frames ? 2 : 0;
+    configure_common(ctx);
     
     // NVENC-specific options
     av_opt_set(ctx->priv_data, "preset", "p4", 0);  // Fast preset for low latency
-    av_opt_set(ctx->priv_data, "tune", "ll", 0);    // Low latency tuning
-    av_opt_set_int(ctx->priv_data, "delay", 0, 0);  // Zero delay
-    av_opt_set_int(ctx->priv_data, "zerolatency", 1, 0);
+    if (config_.low_latency) {
+        // Each frame comes out of the encode call it went into
+        av_opt_set(ctx->priv_data, "tune", "ull", 0);  // Ultra-low latency tuning
+        av_opt_set_int(ctx->priv_data, "delay", 0, 0);
+        av_opt_set_int(ctx->priv_data, "zerolatency", 1, 0);
+        set_encoder_option(ctx, "rc-lookahead", 0);
+    } else {
+        av_opt_set(ctx->priv_data, "tune", "ll", 0);
+        av_opt_set_int(ctx->priv_data, "delay", config_.async_depth, 0);
+    }
+    
+    // Intra refresh sweeps an intra column across keyframe_interval frames
+    // and NVENC then stops inserting IDRs; requested keyframes stay IDRs
+    av_opt_set_int(ctx->priv_data, "forced-idr", 1, 0);
+    if (config_.intra_refresh) {
+        set_encoder_option(ctx, "intra-refresh", 1);
+    }
     
     // Rate control
     switch (config_.rate_control) {
@@ -258,7 +451,6 @@ bool HardwareEncoder::initialize_nvenc_encoder() {
             break;
         case Config::VBR:
             av_opt_set(ctx->priv_data, "rc", "vbr", 0);
-            ctx->rc_max_rate = config_.max_bitrate_kbps * 1000;
             break;
         case Config::CQP:
             av_opt_set(ctx->priv_data, "rc", "constqp", 0);
@@ -282,6 +474,11 @@ bool HardwareEncoder::initialize_nvenc_encoder() {
             break;
     }
     
+    // Zero-copy: take RGBA frames in GPU memory copied straight from GL textures
+    if (config_.use_zero_copy && !initialize_cuda_frames(ctx)) {
+        BLUSTREAM_LOG_INFO("NVENC zero-copy unavailable, using system-memory frames");
+    }
+    
     // Open codec
     int ret = avcodec_open2(ctx, codec, nullptr);
     if (ret < 0) {
@@ -289,10 +486,153 @@ bool HardwareEncoder::initialize_nvenc_encoder() {
         return false;
     }
     
-    BLUSTREAM_LOG_INFO("✓ NVENC encoder initialized successfully");
+    BLUSTREAM_LOG_INFO("✓ NVENC encoder initialized successfully" +
+                      std::string(zero_copy_active_ ? " (zero-copy GL textures)" : ""));
     return true;
 }
 
+bool HardwareEncoder::initialize_cuda_frames(AVCodecContext* ctx) {
+#ifdef BLUSTREAM_ENABLE_CUDA_INTEROP
+    int ret = av_hwdevice_ctx_create(&hw_device_ctx_, AV_HWDEVICE_TYPE_CUDA, nullptr, nullptr, 0);
+    if (ret < 0) {
+        BLUSTREAM_LOG_WARN("Failed to create CUDA device: " + std::to_string(ret));
+        return false;
+    }
+    
+    hw_frames_ctx_ = av_hwframe_ctx_alloc(hw_device_ctx_);
+    if (!hw_frames_ctx_) {
+        release_cuda_frames();
+        return false;
+    }
+    
+    // GL RGBA8 textures are R, G, B, A in memory; NVENC does the YUV conversion
+    auto* frames = reinterpret_cast<AVHWFramesContext*>(hw_frames_ctx_->data);
+    frames->format = AV_PIX_FMT_CUDA;
+    frames->sw_format = AV_PIX_FMT_RGBA;
+    frames->width = config_.width;
+    frames->height = config_.height;
+    frames->initial_pool_size = config_.async_depth + 2;
+    
+    ret = av_hwframe_ctx_init(hw_frames_ctx_);
+    if (ret < 0) {
+        BLUSTREAM_LOG_WARN("Failed to initialize CUDA frame pool: " + std::to_string(ret));
+        release_cuda_frames();
+        return false;
+    }
+    
+    hw_frame_.reset(av_frame_alloc());
+    if (!hw_frame_) {
+        release_cuda_frames();
+        return false;
+    }
+    
+    ctx->pix_fmt = AV_PIX_FMT_CUDA;
+    ctx->hw_frames_ctx = av_buffer_ref(hw_frames_ctx_);
+    zero_copy_active_ = true;
+    return true;
+#else
+    (void)ctx;
+    BLUSTREAM_LOG_INFO("Built without BLUSTREAM_ENABLE_CUDA_INTEROP");
+    return false;
+#endif
+}
+
+void HardwareEncoder::release_cuda_frames() {
+#ifdef BLUSTREAM_ENABLE_CUDA_INTEROP
+    if (gl_interop_resource_ && hw_device_ctx_) {
+        auto* device = reinterpret_cast<AVHWDeviceContext*>(hw_device_ctx_->data);
+        auto* cuda = static_cast<AVCUDADeviceContext*>(device->hwctx);
+        CUcontext previous;
+        cuCtxPushCurrent(cuda->cuda_ctx);
+        cuGraphicsUnregisterResource(static_cast<CUgraphicsResource>(gl_interop_resource_));
+        cuCtxPopCurrent(&previous);
+    }
+#endif
+    gl_interop_resource_ = nullptr;
+    gl_interop_texture_ = 0;
+    
+    hw_frame_.reset();
+    if (hw_frames_ctx_) {
+        av_buffer_unref(&hw_frames_ctx_);
+    }
+    if (hw_device_ctx_) {
+        av_buffer_unref(&hw_device_ctx_);
+    }
+    zero_copy_active_ = false;
+}
+
+bool HardwareEncoder::copy_texture_to_hardware(unsigned int gl_texture_id, AVFrame* hw_frame) {
+#ifdef BLUSTREAM_ENABLE_CUDA_INTEROP
+    // The previous frame may still be queued in NVENC; take a fresh pool surface
+    av_frame_unref(hw_frame);
+    int ret = av_hwframe_get_buffer(hw_frames_ctx_, hw_frame, 0);
+    if (ret < 0) {
+        BLUSTREAM_LOG_ERROR("Failed to get CUDA frame: " + std::to_string(ret));
+        return false;
+    }
+    
+    auto* device = reinterpret_cast<AVHWDeviceContext*>(hw_device_ctx_->data);
+    auto* cuda = static_cast<AVCUDADeviceContext*>(device->hwctx);
+    CUcontext previous;
+    if (cuCtxPushCurrent(cuda->cuda_ctx) != CUDA_SUCCESS) {
+        BLUSTREAM_LOG_ERROR("Failed to make CUDA context current");
+        return false;
+    }
+    
+    bool ok = true;
+    auto resource = static_cast<CUgraphicsResource>(gl_interop_resource_);
+    
+    // Registration is expensive, so keep it until the texture changes
+    if (gl_texture_id != gl_interop_texture_ || !resource) {
+        if (resource) {
+            cuGraphicsUnregisterResource(resource);
+            resource = nullptr;
+        }
+        if (cuGraphicsGLRegisterImage(&resource, gl_texture_id, GL_TEXTURE_2D,
+                                      CU_GRAPHICS_REGISTER_FLAGS_READ_ONLY) != CUDA_SUCCESS) {
+            BLUSTREAM_LOG_ERROR("Failed to register GL texture " + std::to_string(gl_texture_id) + " with CUDA");
+            resource = nullptr;
+            ok = false;
+        }
+        gl_interop_resource_ = resource;
+        gl_interop_texture_ = ok ? gl_texture_id : 0;
+    }
+    
+    if (ok && cuGraphicsMapResources(1, &resource, 0) == CUDA_SUCCESS) {
+        CUarray array;
+        if (cuGraphicsSubResourceGetMappedArray(&array, resource, 0, 0) == CUDA_SUCCESS) {
+            // Device-to-device copy; the frame never leaves the GPU
+            CUDA_MEMCPY2D copy;
+            std::memset(&copy, 0, sizeof(copy));
+            copy.srcMemoryType = CU_MEMORYTYPE_ARRAY;
+            copy.srcArray = array;
+            copy.dstMemoryType = CU_MEMORYTYPE_DEVICE;
+            copy.dstDevice = reinterpret_cast<CUdeviceptr>(hw_frame->data[0]);
+            copy.dstPitch = hw_frame->linesize[0];
+            copy.WidthInBytes = static_cast<size_t>(config_.width) * 4;
+            copy.Height = config_.height;
+            ok = cuMemcpy2D(&copy) == CUDA_SUCCESS;
+        } else {
+            ok = false;
+        }
+        cuGraphicsUnmapResources(1, &resource, 0);
+    } else {
+        ok = false;
+    }
+    
+    cuCtxPopCurrent(&previous);
+    
+    if (!ok) {
+        BLUSTREAM_LOG_ERROR("Failed to copy GL texture into CUDA frame");
+    }
+    return ok;
+#else
+    (void)gl_texture_id;
+    (void)hw_frame;
+    return false;
+#endif
+}
+
 bool HardwareEncoder::initialize_quicksync_encoder() {
     BLUSTREAM_LOG_INFO("Initializing Intel QuickSync encoder...");
     
@@ -313,16 +653,15 @@ bool HardwareEncoder::initialize_quicksync_encoder() {
     encoder_context_.reset(ctx);
     
     // Configure encoder (similar to NVENC)
-    ctx->width = config_.width;
-    ctx->height = config_.height;
-    ctx->time_base = {1, config_.fps};
-    ctx->framerate = {config_.fps, 1};
-    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-    ctx->bit_rate = config_.bitrate_kbps * 1000;
-    ctx->gop_size = config_.keyframe_interval;
+    configure_common(ctx);
     
     // QuickSync-specific options
     av_opt_set(ctx->priv_data, "preset", "fast", 0);
+    set_encoder_option(ctx, "async_depth", config_.low_latency ? 1 : config_.async_depth);
+    if (config_.intra_refresh) {
+        set_encoder_option(ctx, "int_ref_type", "vertical");
+        set_encoder_option(ctx, "int_ref_cycle_size", config_.keyframe_interval);
+    }
     
     int ret = avcodec_open2(ctx, codec, nullptr);
     if (ret < 0) {
@@ -352,17 +691,17 @@ bool HardwareEncoder::initialize_software_encoder() {
     encoder_context_.reset(ctx);
     
     // Configure encoder
-    ctx->width = config_.width;
-    ctx->height = config_.height;
-    ctx->time_base = {1, config_.fps};
-    ctx->framerate = {config_.fps, 1};
-    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-    ctx->bit_rate = config_.bitrate_kbps * 1000;
-    ctx->gop_size = config_.keyframe_interval;
+    configure_common(ctx);
     
-    // x264-specific options
+    // x264-specific options. zerolatency drops lookahead and frame threading
+    // (slices run on sliced threads instead), so each frame comes straight back
     av_opt_set(ctx->priv_data, "preset", "fast", 0);
-    av_opt_set(ctx->priv_data, "tune", "zerolatency", 0);
+    if (config_.low_latency) {
+        av_opt_set(ctx->priv_data, "tune", "zerolatency", 0);
+    }
+    if (config_.intra_refresh) {
+        set_encoder_option(ctx, "intra-refresh", 1);
+    }
     
     int ret = avcodec_open2(ctx, codec, nullptr);
     if (ret < 0) {
@@ -413,61 +752,34 @@ bool HardwareEncoder::test_encoder_availability(Type type) {
     return codec != nullptr;
 }
 
-bool HardwareEncoder::convert_rgb_to_yuv420(const std::vector<uint8_t>& rgb_data, AVFrame* frame) {
-    // Simple RGB to YUV420 conversion
-    // This is a basic implementation - could be optimized with SIMD or hardware
-    
-    if (rgb_data.size() != config_.width * config_.height * 3) {
+bool HardwareEncoder::convert_rgb_to_yuv420(const uint8_t* rgb_data, size_t size, AVFrame* frame) {
+    if (!rgb_data || size != static_cast<size_t>(config_.width) * config_.height * 3) {
         BLUSTREAM_LOG_ERROR("Invalid RGB data size");
         return false;
     }
     
-    const uint8_t* rgb = rgb_data.data();
-    uint8_t* y_plane = frame->data[0];
-    uint8_t* u_plane = frame->data[1];
-    uint8_t* v_plane = frame->data[2];
+    YUV420Planes planes;
+    planes.y = frame->data[0];
+    planes.u = frame->data[1];
+    planes.v = frame->data[2];
+    planes.y_stride = frame->linesize[0];
+    planes.u_stride = frame->linesize[1];
+    planes.v_stride = frame->linesize[2];
+    planes.width = config_.width;
+    planes.height = config_.height;
     
-    // Convert RGB to YUV using standard coefficients
-    for (int y = 0; y < config_.height; y++) {
-        for (int x = 0; x < config_.width; x++) {
-            int rgb_idx = (y * config_.width + x) * 3;
-            int y_idx = y * frame->linesize[0] + x;
-            
-            uint8_t r = rgb[rgb_idx + 0];
-            uint8_t g = rgb[rgb_idx + 1];
-            uint8_t b = rgb[rgb_idx + 2];
-            
-            // Y component
-            y_plane[y_idx] = (77 * r + 150 * g + 29 * b + 128) >> 8;
-            
-            // U and V components (subsampled)
-            if ((y % 2 == 0) && (x % 2 == 0)) {
-                int uv_idx = (y / 2) * frame->linesize[1] + (x / 2);
-                u_plane[uv_idx] = ((-43 * r - 84 * g + 127 * b + 128) >> 8) + 128;
-                v_plane[uv_idx] = ((127 * r - 106 * g - 21 * b + 128) >> 8) + 128;
-            }
-        }
-    }
-    
-    return true;
-}
-
-std::vector<uint8_t> HardwareEncoder::extract_encoded_data(AVPacket* packet) {
-    std::vector<uint8_t> data(packet->data, packet->data + packet->size);
-    return data;
+    return yuv_converter_.convert(rgb_data, config_.width * 3, planes);
 }
 
 void HardwareEncoder::update_performance_stats(float encode_time_ms) {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     
-    encode_times_.push_back(encode_time_ms);
-    if (encode_times_.size() > 60) {  // Keep last 60 samples (2 seconds at 30fps)
-        encode_times_.erase(encode_times_.begin());
-    }
-    
-    stats_.avg_encode_time_ms = std::accumulate(encode_times_.begin(), encode_times_.end(), 0.0f) / encode_times_.size();
-    stats_.min_encode_time_ms = *std::min_element(encode_times_.begin(), encode_times_.end());
-    stats_.max_encode_time_ms = *std::max_element(encode_times_.begin(), encode_times_.end());
+    // Constant work per frame: the average decays over roughly the last
+    // 20 frames, min and max cover the encoder's lifetime
+    const bool first = stats_timed_frames_++ == 0;
+    stats_.avg_encode_time_ms = first ? encode_time_ms : stats_.avg_encode_time_ms * 0.95f + encode_time_ms * 0.05f;
+    stats_.min_encode_time_ms = first ? encode_time_ms : std::min(stats_.min_encode_time_ms, encode_time_ms);
+    stats_.max_encode_time_ms = std::max(stats_.max_encode_time_ms, encode_time_ms);
 }
 
 const char* HardwareEncoder::get_nvenc_codec_name() {
@@ -513,6 +825,50 @@ std::string HardwareEncoder::encoder_type_to_string(Type type) {
     }
 }
 
+void HardwareEncoder::apply_bitrate(int kbps) {
+    // The encoder wrappers compare these fields on every send_frame and
+    // reconfigure rate control when they change. The VBR peak keeps its
+    // ratio to the target; the VBV buffer stays one latency budget.
+    AVCodecContext* ctx = encoder_context_.get();
+    const double scale = config_.bitrate_kbps > 0 ? static_cast<double>(kbps) / config_.bitrate_kbps : 1.0;
+    config_.max_bitrate_kbps = static_cast<int>(config_.max_bitrate_kbps * scale);
+    config_.bitrate_kbps = kbps;
+    ctx->bit_rate = static_cast<int64_t>(kbps) * 1000;
+    configure_vbv(ctx);
+    
+    BLUSTREAM_LOG_DEBUG("Encoder bitrate now " + std::to_string(kbps) + " kbps");
+}
+
+std::vector<HardwareEncoder::Config> HardwareEncoder::make_simulcast_ladder(const Config& config, size_t max_layers,
+                                                                          int min_bitrate_kbps, int min_height) {
+    std::vector<Config> ladder;
+    ladder.push_back(config);
+    
+    // 1080 -> 720 -> 360: two thirds, then half, so the common rungs land exactly
+    static const int steps[][2] = {{2, 3}, {1, 2}, {1, 2}};
+    int height = config.height;
+    for (size_t i = 0; ladder.size() < max_layers && i < sizeof(steps) / sizeof(steps[0]); i++) {
+        height = (height * steps[i][0] / steps[i][1]) & ~1;
+        if (height < min_height) {
+            break;
+        }
+        
+        Config layer = config;
+        layer.height = height;
+        layer.width = static_cast<int>(static_cast<int64_t>(config.width) * height / config.height) & ~1;
+        const double pixel_ratio = static_cast<double>(layer.width) * layer.height /
+                                   (static_cast<double>(config.width) * config.height);
+        layer.bitrate_kbps = static_cast<int>(config.bitrate_kbps * pixel_ratio);
+        layer.max_bitrate_kbps = static_cast<int>(config.max_bitrate_kbps * pixel_ratio);
+        if (layer.bitrate_kbps < min_bitrate_kbps) {
+            break;
+        }
+        ladder.push_back(layer);
+    }
+    
+    return ladder;
+}
+
 std::vector<HardwareEncoder::Type> HardwareEncoder::get_available_encoders() {
     std::vector<Type> available;
     
@@ -0,0 +1,314 @@
+#include "blustream/server/metrics.h"
+#include "blustream/common/logger.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace blustream {
+namespace server {
+
+namespace {
+
+std::atomic<uint32_t> next_thread_index(0);
+
+// Small stable number per thread, for counter shards and trace lanes
+uint32_t thread_index() {
+    static thread_local const uint32_t index = next_thread_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+std::string series_name(const std::string& name, const std::string& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) {
+        return name;
+    }
+    std::string joined = labels;
+    if (!joined.empty() && !extra.empty()) {
+        joined += ",";
+    }
+    return name + "{" + joined + extra + "}";
+}
+
+void append_sample(std::string& out, const std::string& series, double value) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), " %.6g\n", value);
+    out += series;
+    out += buf;
+}
+
+// Counts stay exact however large they get
+void append_sample(std::string& out, const std::string& series, uint64_t value) {
+    out += series + " " + std::to_string(value) + "\n";
+}
+
+} // namespace
+
+void Counter::add(uint64_t n) {
+    shards_[thread_index() % SHARDS].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+MetricsRegistry::Series& MetricsRegistry::add_series(Kind kind, const std::string& name, const std::string& help,
+                                                     const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto series = std::make_unique<Series>();
+    series->kind = kind;
+    series->name = name;
+    series->help = help;
+    series->labels = labels;
+    series_.push_back(std::move(series));
+    return *series_.back();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    Series& series = add_series(Kind::COUNTER, name, help, labels);
+    series.counter = std::make_unique<Counter>();
+    return *series.counter;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                             const std::string& labels) {
+    Series& series = add_series(Kind::SUMMARY, name, help, labels);
+    series.histogram = std::make_unique<LatencyHistogram>();
+    return *series.histogram;
+}
+
+void MetricsRegistry::gauge(const std::string& name, const std::string& help, std::function<double()> read,
+                            const std::string& labels) {
+    Series& series = add_series(Kind::GAUGE, name, help, labels);
+    series.gauge = std::move(read);
+}
+
+std::string MetricsRegistry::prometheus_text() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::string out;
+    std::set<std::string> described;
+    for (const auto& series : series_) {
+        // HELP and TYPE once per metric, however many labelled series it has
+        if (described.insert(series->name).second) {
+            const char* type = series->kind == Kind::COUNTER ? "counter"
+                             : series->kind == Kind::GAUGE ? "gauge" : "summary";
+            out += "# HELP " + series->name + " " + series->help + "\n";
+            out += "# TYPE " + series->name + " " + type + "\n";
+        }
+
+        switch (series->kind) {
+            case Kind::COUNTER:
+                append_sample(out, series_name(series->name, series->labels), series->counter->value());
+                break;
+            case Kind::GAUGE:
+                append_sample(out, series_name(series->name, series->labels), series->gauge());
+                break;
+            case Kind::SUMMARY: {
+                const LatencyHistogram& histogram = *series->histogram;
+                append_sample(out, series_name(series->name, series->labels, "quantile=\"0.5\""),
+                              histogram.percentile_ms(0.50) / 1000.0);
+                append_sample(out, series_name(series->name, series->labels, "quantile=\"0.99\""),
+                              histogram.percentile_ms(0.99) / 1000.0);
+                append_sample(out, series_name(series->name, series->labels, "quantile=\"0.999\""),
+                              histogram.percentile_ms(0.999) / 1000.0);
+                append_sample(out, series_name(series->name + "_sum", series->labels),
+                              static_cast<double>(histogram.total_us()) / 1e6);
+                append_sample(out, series_name(series->name + "_count", series->labels), histogram.count());
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+TraceRecorder::TraceRecorder(size_t capacity)
+    : enabled_(false)
+    , capacity_(capacity > 0 ? capacity : 1)
+    , events_(new Event[capacity_])
+    , next_(0)
+    , epoch_(std::chrono::steady_clock::now()) {
+}
+
+void TraceRecorder::record(const char* name, std::chrono::steady_clock::time_point start,
+                           std::chrono::steady_clock::time_point end) {
+    if (!enabled()) {
+        return;
+    }
+
+    Event& event = events_[next_.fetch_add(1, std::memory_order_relaxed) % capacity_];
+    event.name.store(nullptr, std::memory_order_relaxed);
+    event.thread.store(thread_index(), std::memory_order_relaxed);
+    event.start_us.store(std::chrono::duration_cast<std::chrono::microseconds>(start - epoch_).count(),
+                         std::memory_order_relaxed);
+    event.duration_us.store(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(),
+                            std::memory_order_relaxed);
+    event.name.store(name, std::memory_order_release);
+}
+
+std::string TraceRecorder::chrome_trace_json() const {
+    const uint64_t written = next_.load(std::memory_order_acquire);
+    const uint64_t first = written > capacity_ ? written - capacity_ : 0;
+
+    std::string out = "{\"traceEvents\":[";
+    bool any = false;
+    for (uint64_t i = first; i < written; i++) {
+        const Event& event = events_[i % capacity_];
+        const char* name = event.name.load(std::memory_order_acquire);
+        if (!name) {
+            continue;
+        }
+        char buf[192];
+        snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}",
+                 any ? "," : "", name, event.thread.load(std::memory_order_relaxed),
+                 static_cast<long long>(event.start_us.load(std::memory_order_relaxed)),
+                 static_cast<long long>(event.duration_us.load(std::memory_order_relaxed)));
+        out += buf;
+        any = true;
+    }
+    out += "],\"displayTimeUnit\":\"ms\"}\n";
+    return out;
+}
+
+bool TraceRecorder::write_chrome_trace(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        BLUSTREAM_LOG_ERROR("Failed to open trace file: " + path);
+        return false;
+    }
+    file << chrome_trace_json();
+    return static_cast<bool>(file);
+}
+
+MetricsServer::MetricsServer(const MetricsRegistry& registry, const TraceRecorder* trace)
+    : registry_(registry)
+    , trace_(trace)
+    , listen_fd_(-1)
+    , running_(false) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(int port) {
+    if (running_) {
+        return true;
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        BLUSTREAM_LOG_ERROR("Failed to create metrics socket: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(listen_fd_, 4) < 0) {
+        BLUSTREAM_LOG_ERROR("Failed to listen for metrics on port " + std::to_string(port) + ": " +
+                           std::string(strerror(errno)));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    running_ = true;
+    thread_ = std::thread(&MetricsServer::serve_loop, this);
+    BLUSTREAM_LOG_INFO("Metrics on http://0.0.0.0:" + std::to_string(port) + "/metrics");
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    close(listen_fd_);
+    listen_fd_ = -1;
+}
+
+void MetricsServer::serve_loop() {
+    while (running_) {
+        // Poll so stop() is noticed without closing the socket under accept()
+        pollfd pfd;
+        pfd.fd = listen_fd_;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        handle_connection(fd);
+        close(fd);
+    }
+}
+
+void MetricsServer::handle_connection(int fd) {
+    // A stalled scraper can hold the thread for a second at most
+    timeval timeout;
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Only the request line matters
+    char request[1024];
+    ssize_t received = recv(fd, request, sizeof(request) - 1, 0);
+    if (received <= 0) {
+        return;
+    }
+    request[received] = '\0';
+
+    std::string status = "200 OK";
+    std::string content_type = "text/plain; version=0.0.4";
+    std::string body;
+    if (std::strncmp(request, "GET /metrics", 12) == 0) {
+        body = registry_.prometheus_text();
+    } else if (trace_ && std::strncmp(request, "GET /trace", 10) == 0) {
+        content_type = "application/json";
+        body = trace_->chrome_trace_json();
+    } else {
+        status = "404 Not Found";
+        body = "not found\n";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + content_type +
+                           "\r\nContent-Length: " + std::to_string(body.size()) +
+                           "\r\nConnection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+} // namespace server
+} // namespace blustream
@@ -4,9 +4,146 @@
 #include <cstring>
 #include <vector>
 
+#include <GL/glext.h>
+
 namespace blustream {
 namespace server {
 
+namespace {
+
+// Framebuffer object entry points, resolved once a context exists
+PFNGLGENFRAMEBUFFERSPROC gl_gen_framebuffers = nullptr;
+PFNGLDELETEFRAMEBUFFERSPROC gl_delete_framebuffers = nullptr;
+PFNGLBINDFRAMEBUFFERPROC gl_bind_framebuffer = nullptr;
+PFNGLFRAMEBUFFERTEXTURE2DPROC gl_framebuffer_texture_2d = nullptr;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC gl_check_framebuffer_status = nullptr;
+PFNGLBLITFRAMEBUFFERPROC gl_blit_framebuffer = nullptr;
+
+// Shader, vertex array and buffer object entry points for the slice renderer
+PFNGLCREATESHADERPROC gl_create_shader = nullptr;
+PFNGLDELETESHADERPROC gl_delete_shader = nullptr;
+PFNGLSHADERSOURCEPROC gl_shader_source = nullptr;
+PFNGLCOMPILESHADERPROC gl_compile_shader = nullptr;
+PFNGLGETSHADERIVPROC gl_get_shaderiv = nullptr;
+PFNGLGETSHADERINFOLOGPROC gl_get_shader_info_log = nullptr;
+PFNGLCREATEPROGRAMPROC gl_create_program = nullptr;
+PFNGLDELETEPROGRAMPROC gl_delete_program = nullptr;
+PFNGLATTACHSHADERPROC gl_attach_shader = nullptr;
+PFNGLLINKPROGRAMPROC gl_link_program = nullptr;
+PFNGLGETPROGRAMIVPROC gl_get_programiv = nullptr;
+PFNGLGETPROGRAMINFOLOGPROC gl_get_program_info_log = nullptr;
+PFNGLUSEPROGRAMPROC gl_use_program = nullptr;
+PFNGLGETUNIFORMLOCATIONPROC gl_get_uniform_location = nullptr;
+PFNGLUNIFORM1IPROC gl_uniform_1i = nullptr;
+PFNGLUNIFORM1FPROC gl_uniform_1f = nullptr;
+PFNGLGENVERTEXARRAYSPROC gl_gen_vertex_arrays = nullptr;
+PFNGLDELETEVERTEXARRAYSPROC gl_delete_vertex_arrays = nullptr;
+PFNGLBINDVERTEXARRAYPROC gl_bind_vertex_array = nullptr;
+PFNGLACTIVETEXTUREPROC gl_active_texture = nullptr;
+PFNGLGENBUFFERSPROC gl_gen_buffers = nullptr;
+PFNGLDELETEBUFFERSPROC gl_delete_buffers = nullptr;
+PFNGLBINDBUFFERPROC gl_bind_buffer = nullptr;
+PFNGLBUFFERDATAPROC gl_buffer_data = nullptr;
+PFNGLMAPBUFFERRANGEPROC gl_map_buffer_range = nullptr;
+PFNGLUNMAPBUFFERPROC gl_unmap_buffer = nullptr;
+bool shader_functions_loaded = false;
+
+// Fullscreen triangle from gl_VertexID; uv (0, 0) is texture row 0
+const char* const SLICE_VERTEX_SHADER = R"(#version 330 core
+out vec2 uv;
+void main() {
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    uv = pos;
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// Bilinear amplitude, then the colormap entry it falls in
+const char* const SLICE_FRAGMENT_SHADER = R"(#version 330 core
+in vec2 uv;
+out vec4 color;
+uniform sampler2D slice_samples;
+uniform sampler2D color_table;
+uniform float index_scale;
+uniform float index_offset;
+uniform int entries;
+void main() {
+    float value = texture(slice_samples, uv).r;
+    int entry = clamp(int(floor(value * index_scale + index_offset)), 0, entries - 1);
+    color = texelFetch(color_table, ivec2(entry, 0), 0);
+}
+)";
+
+template <typename Fn>
+bool resolve_gl_function(Fn& fn, const char* name) {
+#ifdef __linux__
+    fn = reinterpret_cast<Fn>(glXGetProcAddressARB(reinterpret_cast<const GLubyte*>(name)));
+#elif defined(_WIN32)
+    fn = reinterpret_cast<Fn>(wglGetProcAddress(name));
+#else
+    fn = nullptr;
+#endif
+    return fn != nullptr;
+}
+
+// RGBA8 texture with a framebuffer object around it
+bool create_texture_target(int width, int height, GLuint& texture, GLuint& framebuffer) {
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    gl_gen_framebuffers(1, &framebuffer);
+    gl_bind_framebuffer(GL_FRAMEBUFFER, framebuffer);
+    gl_framebuffer_texture_2d(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    GLenum status = gl_check_framebuffer_status(GL_FRAMEBUFFER);
+    gl_bind_framebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        BLUSTREAM_LOG_ERROR("Framebuffer incomplete: status " + std::to_string(status));
+        gl_delete_framebuffers(1, &framebuffer);
+        glDeleteTextures(1, &texture);
+        framebuffer = 0;
+        texture = 0;
+        return false;
+    }
+    return true;
+}
+
+GLuint compile_shader(GLenum type, const char* source) {
+    GLuint shader = gl_create_shader(type);
+    gl_shader_source(shader, 1, &source, nullptr);
+    gl_compile_shader(shader);
+    
+    GLint compiled = GL_FALSE;
+    gl_get_shaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE) {
+        char log[1024] = {0};
+        gl_get_shader_info_log(shader, sizeof(log), nullptr, log);
+        BLUSTREAM_LOG_ERROR("Slice shader failed to compile: " + std::string(log));
+        gl_delete_shader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+void delete_texture_target(GLuint& texture, GLuint& framebuffer) {
+    if (framebuffer && gl_delete_framebuffers) {
+        gl_delete_framebuffers(1, &framebuffer);
+    }
+    if (texture) {
+        glDeleteTextures(1, &texture);
+    }
+    framebuffer = 0;
+    texture = 0;
+}
+
+} // namespace
+
 OpenGLContext::OpenGLContext() = default;
 
 OpenGLContext::~OpenGLContext() {
@@ -82,6 +219,8 @@ void OpenGLContext::destroy() {
     
     BLUSTREAM_LOG_INFO("🧹 Destroying OpenGL context...");
     
+    destroy_slice_renderer();
+    destroy_render_target();
     release_context();
     
 #ifdef __linux__
@@ -392,6 +531,13 @@ bool OpenGLContext::initialize_gl() {
         return false;
     }
     
+    if (!load_gl_functions()) {
+        BLUSTREAM_LOG_WARN("Framebuffer objects unavailable; GPU render targets disabled");
+    }
+    if (!load_shader_functions()) {
+        BLUSTREAM_LOG_WARN("Shader or buffer objects unavailable; GPU slice rendering disabled");
+    }
+    
     // Set up initial OpenGL state
     glViewport(0, 0, config_.width, config_.height);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -409,5 +555,331 @@ bool OpenGLContext::initialize_gl() {
     return true;
 }
 
+bool OpenGLContext::load_gl_functions() {
+    bool ok = true;
+    ok &= resolve_gl_function(gl_gen_framebuffers, "glGenFramebuffers");
+    ok &= resolve_gl_function(gl_delete_framebuffers, "glDeleteFramebuffers");
+    ok &= resolve_gl_function(gl_bind_framebuffer, "glBindFramebuffer");
+    ok &= resolve_gl_function(gl_framebuffer_texture_2d, "glFramebufferTexture2D");
+    ok &= resolve_gl_function(gl_check_framebuffer_status, "glCheckFramebufferStatus");
+    ok &= resolve_gl_function(gl_blit_framebuffer, "glBlitFramebuffer");
+    return ok;
+}
+
+bool OpenGLContext::load_shader_functions() {
+    bool ok = true;
+    ok &= resolve_gl_function(gl_create_shader, "glCreateShader");
+    ok &= resolve_gl_function(gl_delete_shader, "glDeleteShader");
+    ok &= resolve_gl_function(gl_shader_source, "glShaderSource");
+    ok &= resolve_gl_function(gl_compile_shader, "glCompileShader");
+    ok &= resolve_gl_function(gl_get_shaderiv, "glGetShaderiv");
+    ok &= resolve_gl_function(gl_get_shader_info_log, "glGetShaderInfoLog");
+    ok &= resolve_gl_function(gl_create_program, "glCreateProgram");
+    ok &= resolve_gl_function(gl_delete_program, "glDeleteProgram");
+    ok &= resolve_gl_function(gl_attach_shader, "glAttachShader");
+    ok &= resolve_gl_function(gl_link_program, "glLinkProgram");
+    ok &= resolve_gl_function(gl_get_programiv, "glGetProgramiv");
+    ok &= resolve_gl_function(gl_get_program_info_log, "glGetProgramInfoLog");
+    ok &= resolve_gl_function(gl_use_program, "glUseProgram");
+    ok &= resolve_gl_function(gl_get_uniform_location, "glGetUniformLocation");
+    ok &= resolve_gl_function(gl_uniform_1i, "glUniform1i");
+    ok &= resolve_gl_function(gl_uniform_1f, "glUniform1f");
+    ok &= resolve_gl_function(gl_gen_vertex_arrays, "glGenVertexArrays");
+    ok &= resolve_gl_function(gl_delete_vertex_arrays, "glDeleteVertexArrays");
+    ok &= resolve_gl_function(gl_bind_vertex_array, "glBindVertexArray");
+    ok &= resolve_gl_function(gl_active_texture, "glActiveTexture");
+    ok &= resolve_gl_function(gl_gen_buffers, "glGenBuffers");
+    ok &= resolve_gl_function(gl_delete_buffers, "glDeleteBuffers");
+    ok &= resolve_gl_function(gl_bind_buffer, "glBindBuffer");
+    ok &= resolve_gl_function(gl_buffer_data, "glBufferData");
+    ok &= resolve_gl_function(gl_map_buffer_range, "glMapBufferRange");
+    ok &= resolve_gl_function(gl_unmap_buffer, "glUnmapBuffer");
+    shader_functions_loaded = ok;
+    return ok;
+}
+
+bool OpenGLContext::create_render_target(int width, int height) {
+    if (!context_valid_ || !gl_gen_framebuffers || !gl_blit_framebuffer) {
+        BLUSTREAM_LOG_ERROR("Cannot create render target without framebuffer object support");
+        return false;
+    }
+    
+    if (render_framebuffer_ && width == render_width_ && height == render_height_) {
+        return true;
+    }
+    
+    delete_texture_target(render_texture_, render_framebuffer_);
+    if (!create_texture_target(width, height, render_texture_, render_framebuffer_)) {
+        render_width_ = 0;
+        render_height_ = 0;
+        return false;
+    }
+    
+    render_width_ = width;
+    render_height_ = height;
+    BLUSTREAM_LOG_INFO("Render target ready: " + std::to_string(width) + "x" + std::to_string(height) + " RGBA8");
+    return true;
+}
+
+void OpenGLContext::destroy_render_target() {
+    delete_texture_target(render_texture_, render_framebuffer_);
+    delete_texture_target(staging_texture_, staging_framebuffer_);
+    render_width_ = render_height_ = 0;
+    staging_width_ = staging_height_ = 0;
+}
+
+bool OpenGLContext::draw_rgb_image(const uint8_t* rgb, int width, int height, bool linear_filter) {
+    if (!has_render_target() || !rgb || width <= 0 || height <= 0) {
+        return false;
+    }
+    
+    // Staging texture follows the source size, which only changes with the slice axis
+    if (!staging_framebuffer_ || width != staging_width_ || height != staging_height_) {
+        delete_texture_target(staging_texture_, staging_framebuffer_);
+        if (!create_texture_target(width, height, staging_texture_, staging_framebuffer_)) {
+            staging_width_ = staging_height_ = 0;
+            return false;
+        }
+        staging_width_ = width;
+        staging_height_ = height;
+    }
+    
+    glBindTexture(GL_TEXTURE_2D, staging_texture_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    // Texture to texture, so row 0 stays the top row and no flip is needed
+    gl_bind_framebuffer(GL_READ_FRAMEBUFFER, staging_framebuffer_);
+    gl_bind_framebuffer(GL_DRAW_FRAMEBUFFER, render_framebuffer_);
+    gl_blit_framebuffer(0, 0, width, height, 0, 0, render_width_, render_height_,
+                        GL_COLOR_BUFFER_BIT, linear_filter ? GL_LINEAR : GL_NEAREST);
+    gl_bind_framebuffer(GL_FRAMEBUFFER, 0);
+    
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        BLUSTREAM_LOG_ERROR("OpenGL error drawing image into render target: " + std::to_string(error));
+        return false;
+    }
+    return true;
+}
+
+bool OpenGLContext::create_slice_renderer() {
+    if (slice_program_) {
+        return true;
+    }
+    if (!context_valid_ || !shader_functions_loaded) {
+        BLUSTREAM_LOG_ERROR("Cannot create slice renderer without shader support");
+        return false;
+    }
+    
+    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, SLICE_VERTEX_SHADER);
+    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, SLICE_FRAGMENT_SHADER);
+    if (!vertex_shader || !fragment_shader) {
+        if (vertex_shader) gl_delete_shader(vertex_shader);
+        if (fragment_shader) gl_delete_shader(fragment_shader);
+        return false;
+    }
+    
+    GLuint program = gl_create_program();
+    gl_attach_shader(program, vertex_shader);
+    gl_attach_shader(program, fragment_shader);
+    gl_link_program(program);
+    gl_delete_shader(vertex_shader);  // Freed with the program
+    gl_delete_shader(fragment_shader);
+    
+    GLint linked = GL_FALSE;
+    gl_get_programiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        char log[1024] = {0};
+        gl_get_program_info_log(program, sizeof(log), nullptr, log);
+        BLUSTREAM_LOG_ERROR("Slice shader failed to link: " + std::string(log));
+        gl_delete_program(program);
+        return false;
+    }
+    
+    gl_use_program(program);
+    gl_uniform_1i(gl_get_uniform_location(program, "slice_samples"), 0);
+    gl_uniform_1i(gl_get_uniform_location(program, "color_table"), 1);
+    gl_use_program(0);
+    uniform_index_scale_ = gl_get_uniform_location(program, "index_scale");
+    uniform_index_offset_ = gl_get_uniform_location(program, "index_offset");
+    uniform_entries_ = gl_get_uniform_location(program, "entries");
+    
+    // Core profiles draw nothing without a vertex array, even an empty one
+    gl_gen_vertex_arrays(1, &slice_vertex_array_);
+    
+    glGenTextures(1, &table_texture_);
+    glBindTexture(GL_TEXTURE_2D, table_texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    slice_program_ = program;
+    
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        BLUSTREAM_LOG_ERROR("OpenGL error creating slice renderer: " + std::to_string(error));
+        destroy_slice_renderer();
+        return false;
+    }
+    
+    BLUSTREAM_LOG_INFO("Slice renderer ready (bilinear sampling, colormap in fragment shader)");
+    return true;
+}
+
+void OpenGLContext::destroy_slice_renderer() {
+    if (slice_program_) {
+        gl_delete_program(slice_program_);
+    }
+    if (slice_vertex_array_) {
+        gl_delete_vertex_arrays(1, &slice_vertex_array_);
+    }
+    if (slice_texture_) {
+        glDeleteTextures(1, &slice_texture_);
+    }
+    if (table_texture_) {
+        glDeleteTextures(1, &table_texture_);
+    }
+    if (readback_buffers_[0]) {
+        gl_delete_buffers(2, readback_buffers_);
+    }
+    
+    slice_program_ = 0;
+    slice_vertex_array_ = 0;
+    slice_texture_ = 0;
+    table_texture_ = 0;
+    slice_texture_width_ = slice_texture_height_ = 0;
+    readback_buffers_[0] = readback_buffers_[1] = 0;
+    readback_size_ = 0;
+    readback_pending_ = false;
+}
+
+bool OpenGLContext::draw_slice(const VDSManager::SliceBuffer& slice, const ColorMap& colormap) {
+    if (!has_render_target() || !has_slice_renderer() || slice.width <= 0 || slice.height <= 0 ||
+        slice.data.size() < slice.sample_count() * sample_format_size(slice.format)) {
+        return false;
+    }
+    
+    GLint internal_format = GL_R8;
+    GLenum type = GL_UNSIGNED_BYTE;
+    switch (slice.format) {
+        case SampleFormat::U8:  internal_format = GL_R8;   type = GL_UNSIGNED_BYTE;  break;
+        case SampleFormat::U16: internal_format = GL_R16;  type = GL_UNSIGNED_SHORT; break;
+        case SampleFormat::F32: internal_format = GL_R32F; type = GL_FLOAT;          break;
+    }
+    
+    // Slice texture only changes shape with the slice axis or sample format
+    gl_active_texture(GL_TEXTURE0);
+    if (!slice_texture_) {
+        glGenTextures(1, &slice_texture_);
+    }
+    glBindTexture(GL_TEXTURE_2D, slice_texture_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (slice.width != slice_texture_width_ || slice.height != slice_texture_height_ ||
+        slice.format != slice_texture_format_) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, slice.width, slice.height, 0,
+                     GL_RED, type, slice.data.data());
+        slice_texture_width_ = slice.width;
+        slice_texture_height_ = slice.height;
+        slice_texture_format_ = slice.format;
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, slice.width, slice.height,
+                        GL_RED, type, slice.data.data());
+    }
+    
+    // The table is at most 16 KB, so it simply follows the colormap every frame
+    size_t entries = 0;
+    float index_scale = 0.0f;
+    float index_offset = 0.0f;
+    const uint32_t* table = colormap.get_rgb_table(slice.format, entries, index_scale, index_offset);
+    gl_active_texture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, table_texture_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, static_cast<GLsizei>(entries), 1, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, table);  // 0x00BBGGRR is R, G, B, 0 in memory
+    
+    gl_bind_framebuffer(GL_FRAMEBUFFER, render_framebuffer_);
+    glViewport(0, 0, render_width_, render_height_);
+    glDisable(GL_DEPTH_TEST);
+    gl_use_program(slice_program_);
+    gl_uniform_1f(uniform_index_scale_, index_scale);
+    gl_uniform_1f(uniform_index_offset_, index_offset);
+    gl_uniform_1i(uniform_entries_, static_cast<GLint>(entries));
+    gl_bind_vertex_array(slice_vertex_array_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    gl_bind_vertex_array(0);
+    gl_use_program(0);
+    gl_bind_framebuffer(GL_FRAMEBUFFER, 0);
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    gl_active_texture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        BLUSTREAM_LOG_ERROR("OpenGL error drawing slice: " + std::to_string(error));
+        return false;
+    }
+    return true;
+}
+
+bool OpenGLContext::read_render_target(const std::function<void(const uint8_t* rgb, int stride)>& consume) {
+    if (!has_render_target() || !shader_functions_loaded) {
+        return false;
+    }
+    
+    const int stride = render_width_ * 3;
+    const size_t size = static_cast<size_t>(stride) * render_height_;
+    if (!readback_buffers_[0] || size != readback_size_) {
+        if (readback_buffers_[0]) {
+            gl_delete_buffers(2, readback_buffers_);
+        }
+        gl_gen_buffers(2, readback_buffers_);
+        for (GLuint buffer : readback_buffers_) {
+            gl_bind_buffer(GL_PIXEL_PACK_BUFFER, buffer);
+            gl_buffer_data(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+        }
+        readback_size_ = size;
+        readback_index_ = 0;
+        readback_pending_ = false;
+    }
+    
+    // Queue this frame; glReadPixels into a bound pack buffer returns immediately
+    gl_bind_framebuffer(GL_READ_FRAMEBUFFER, render_framebuffer_);
+    gl_bind_buffer(GL_PIXEL_PACK_BUFFER, readback_buffers_[readback_index_]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, render_width_, render_height_, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    gl_bind_framebuffer(GL_READ_FRAMEBUFFER, 0);
+    
+    // Hand over last frame's, which has had a frame's worth of time to land
+    bool delivered = false;
+    if (readback_pending_) {
+        gl_bind_buffer(GL_PIXEL_PACK_BUFFER, readback_buffers_[readback_index_ ^ 1]);
+        const void* pixels = gl_map_buffer_range(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT);
+        if (pixels) {
+            consume(static_cast<const uint8_t*>(pixels), stride);
+            gl_unmap_buffer(GL_PIXEL_PACK_BUFFER);
+            delivered = true;
+        }
+    }
+    gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    readback_index_ ^= 1;
+    readback_pending_ = true;
+    
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        BLUSTREAM_LOG_ERROR("OpenGL error reading back render target: " + std::to_string(error));
+        return false;
+    }
+    return delivered;
+}
+
 }  // namespace server
-}  // namespace blustream
\ No newline at end of file
+}  // namespace blustream
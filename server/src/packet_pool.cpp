@@ -0,0 +1,91 @@
+#include "blustream/server/packet_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace blustream {
+namespace server {
+
+void WirePacket::seal(common::MessageType type, uint32_t sequence) {
+    std::memset(&header, 0, sizeof(header));
+    header.magic = 0x42535452;  // 'BSTR'
+    header.version = 1;
+    header.type = static_cast<uint32_t>(type);
+    header.payload_size = static_cast<uint32_t>(payload.size());
+    header.sequence = sequence;
+    sealed_at = std::chrono::steady_clock::now();
+    header.timestamp = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        sealed_at.time_since_epoch()).count());
+}
+
+bool h264_is_non_reference(const uint8_t* data, size_t size) {
+    // Walk the 00 00 01 start codes (a leading zero makes the 4-byte form)
+    // up to the first slice; every slice of a picture shares its nal_ref_idc
+    for (size_t i = 0; i + 3 < size; i++) {
+        if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) {
+            continue;
+        }
+        const uint8_t nal = data[i + 3];
+        const int nal_type = nal & 0x1F;
+        if (nal_type == 1 || nal_type == 5) {  // Coded slice, non-IDR / IDR
+            return (nal & 0x60) == 0;
+        }
+        i += 3;
+    }
+    return false;
+}
+
+PacketPool::PacketPool(size_t max_cached)
+    : state_(std::make_shared<State>()) {
+    state_->max_cached = max_cached;
+}
+
+std::shared_ptr<WirePacket> PacketPool::acquire() {
+    std::unique_ptr<WirePacket> packet;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (!state_->free.empty()) {
+            packet = std::move(state_->free.back());
+            state_->free.pop_back();
+        }
+    }
+    if (!packet) {
+        packet = std::make_unique<WirePacket>();
+    }
+    packet->payload.clear();
+    packet->keyframe = false;
+    packet->droppable = false;
+
+    // The deleter keeps the free list alive, not the pool object
+    std::shared_ptr<State> state = state_;
+    return std::shared_ptr<WirePacket>(packet.release(), [state](WirePacket* returned) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->free.size() < state->max_cached) {
+            state->free.emplace_back(returned);
+        } else {
+            delete returned;
+        }
+    });
+}
+
+void PacketPool::reserve(size_t count, size_t payload_bytes) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    for (auto& packet : state_->free) {
+        packet->payload.reserve(payload_bytes);
+    }
+    count = std::min(count, state_->max_cached);
+    while (state_->free.size() < count) {
+        auto packet = std::make_unique<WirePacket>();
+        packet->payload.reserve(payload_bytes);
+        state_->free.push_back(std::move(packet));
+    }
+}
+
+size_t PacketPool::cached() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->free.size();
+}
+
+} // namespace server
+} // namespace blustream
@@ -25,13 +25,36 @@ void print_usage(const char* program) {
               << "  --height HEIGHT      Render height (default: 1080)\n"
               << "  --fps FPS           Target FPS (default: 30)\n"
               << "  --bitrate KBPS      Bitrate in kbps (default: 5000)\n"
+              << "  --min-bitrate KBPS  Adaptive bitrate floor (default: 500)\n"
+              << "  --max-bitrate KBPS  Adaptive bitrate ceiling (default: --bitrate)\n"
+              << "  --target-latency MS Queuing delay the bitrate controller allows (default: 150)\n"
+              << "  --no-adaptive-bitrate  Keep the bitrate fixed whatever clients report\n"
               << "  --preset PRESET     x264 preset (ultrafast/fast/medium/slow, default: fast)\n"
+              << "  --slices N          Slices per frame, encoded in parallel (default: 1)\n"
+              << "  --intra-refresh     Rolling intra refresh instead of periodic keyframes\n"
               << "  --vds PATH          VDS file to load\n"
               << "  --slice-orientation ORIENT  Slice orientation: XY, XZ, YZ (default: XZ for vertical sections)\n"
               << "  --animate-slice     Enable slice position animation (default: enabled)\n"
               << "  --no-animate-slice  Disable slice position animation\n"
               << "  --animation-duration SEC    Duration to traverse all slices in seconds (default: 30)\n"
               << "  --max-clients N     Maximum clients (default: 10)\n"
+              << "  --cache-mb MB       VDS brick cache budget in MB (default: 2048)\n"
+              << "  --brick-size N      VDS brick edge length in samples (default: 64)\n"
+              << "  --crossline-layout  Keep transposed bricks for faster YZ slices (2x cache memory)\n"
+              << "  --sample-format FMT Resident VDS sample type: u8, u16, f32 (default: u8)\n"
+              << "  --brick-file PATH   Map VDS bricks from PATH, writing it first if missing or stale\n"
+              << "  --lod-levels N      Downsampled levels for overview and scrubbing (default: 3, 0 = off)\n"
+              << "  --colormap MAP      Slice colormap: seismic, gray, red-white-blue (default: seismic)\n"
+              << "  --clip-percentiles LO,HI  Colormap range as amplitude percentiles (default: 1,99)\n"
+              << "  --gpu-render        Scale and colour map slices in an OpenGL shader\n"
+              << "  --no-skip-still     Keep encoding every frame while the slice is still\n"
+              << "  --pipeline-depth N  Frames queued between pipeline stages (default: 2)\n"
+              << "  --io-threads N      Threads writing to client sockets (default: 2)\n"
+              << "  --client-queue N    Frames queued per client before it skips to a keyframe (default: 8)\n"
+              << "  --metrics-port N    Serve Prometheus /metrics and /trace on this port (default: off)\n"
+              << "  --trace FILE        Record pipeline spans and write a Chrome trace on exit\n"
+              << "  --log-level LEVEL   trace, debug, info, warn, error (default: info)\n"
+              << "  --sync-log          Write log lines on the logging thread instead of a background writer\n"
               << "  --help              Show this help message\n";
 }
 
@@ -42,6 +65,8 @@ int main(int argc, char* argv[]) {
     
     // Parse command line arguments
     blustream::server::StreamingServer::Config config;
+    blustream::common::LogLevel log_level = blustream::common::LogLevel::INFO;
+    bool sync_log = false;
     
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
@@ -56,8 +81,20 @@ int main(int argc, char* argv[]) {
             config.target_fps = std::atof(argv[++i]);
         } else if (arg == "--bitrate" && i + 1 < argc) {
             config.bitrate_kbps = std::atoi(argv[++i]);
+        } else if (arg == "--min-bitrate" && i + 1 < argc) {
+            config.min_bitrate_kbps = std::atoi(argv[++i]);
+        } else if (arg == "--max-bitrate" && i + 1 < argc) {
+            config.max_bitrate_kbps = std::atoi(argv[++i]);
+        } else if (arg == "--target-latency" && i + 1 < argc) {
+            config.target_latency_ms = std::atoi(argv[++i]);
+        } else if (arg == "--no-adaptive-bitrate") {
+            config.adaptive_bitrate = false;
         } else if (arg == "--preset" && i + 1 < argc) {
             config.preset = argv[++i];
+        } else if (arg == "--slices" && i + 1 < argc) {
+            config.slices_per_frame = std::atoi(argv[++i]);
+        } else if (arg == "--intra-refresh") {
+            config.intra_refresh = true;
         } else if (arg == "--vds" && i + 1 < argc) {
             config.vds_path = argv[++i];
         } else if (arg == "--slice-orientation" && i + 1 < argc) {
@@ -70,6 +107,47 @@ int main(int argc, char* argv[]) {
             config.animation_duration = std::atof(argv[++i]);
         } else if (arg == "--max-clients" && i + 1 < argc) {
             config.max_clients = std::atoi(argv[++i]);
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            config.vds_cache_budget_mb = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--brick-size" && i + 1 < argc) {
+            config.vds_brick_size = std::atoi(argv[++i]);
+        } else if (arg == "--crossline-layout") {
+            config.vds_crossline_layout = true;
+        } else if (arg == "--sample-format" && i + 1 < argc) {
+            config.vds_sample_format = argv[++i];
+        } else if (arg == "--brick-file" && i + 1 < argc) {
+            config.vds_brick_file = argv[++i];
+        } else if (arg == "--lod-levels" && i + 1 < argc) {
+            config.vds_lod_levels = std::atoi(argv[++i]);
+        } else if (arg == "--colormap" && i + 1 < argc) {
+            config.colormap = argv[++i];
+        } else if (arg == "--clip-percentiles" && i + 1 < argc) {
+            char* end = nullptr;
+            config.clip_low_percentile = std::strtof(argv[++i], &end);
+            if (*end == ',') {
+                config.clip_high_percentile = std::strtof(end + 1, nullptr);
+            }
+        } else if (arg == "--gpu-render") {
+            config.gpu_render = true;
+        } else if (arg == "--no-skip-still") {
+            config.skip_still_frames = false;
+        } else if (arg == "--pipeline-depth" && i + 1 < argc) {
+            config.pipeline_depth = std::atoi(argv[++i]);
+        } else if (arg == "--io-threads" && i + 1 < argc) {
+            config.io_threads = std::atoi(argv[++i]);
+        } else if (arg == "--client-queue" && i + 1 < argc) {
+            config.client_queue_packets = std::atoi(argv[++i]);
+        } else if (arg == "--metrics-port" && i + 1 < argc) {
+            config.metrics_port = std::atoi(argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            config.trace_path = argv[++i];
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            if (!blustream::common::parse_log_level(argv[++i], log_level)) {
+                std::cerr << "Unknown log level: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (arg == "--sync-log") {
+            sync_log = true;
         } else if (arg == "--help") {
             print_usage(argv[0]);
             return 0;
@@ -80,6 +158,13 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // Pipeline threads shouldn't wait on the console
+    if (sync_log) {
+        blustream::common::set_logger(std::make_unique<blustream::common::ConsoleLogger>(log_level));
+    } else {
+        blustream::common::set_logger(std::make_unique<blustream::common::AsyncLogger>(log_level));
+    }
+    
     std::cout << "\n====================================\n";
     std::cout << "BluStream Phase 4: Streaming Server\n";
     std::cout << "====================================\n\n";
@@ -132,7 +217,10 @@ int main(int argc, char* argv[]) {
                      << " | Render: " << std::setprecision(1) << stats.render_time_ms << "ms"
                      << " | Encode: " << stats.encoding_time_ms << "ms"
                      << " | Bitrate: " << stats.bitrate_mbps << " Mbps"
+                     << " (target " << stats.target_bitrate_kbps << " kbps, RTT " << stats.network_rtt_ms << "ms)"
                      << " | Frames: " << stats.frames_encoded
+                     << " | Dropped: " << stats.frames_dropped
+                     << " | E2E p99: " << stats.end_to_end_latency.p99_ms << "ms"
                      << "    " << std::flush;
             
             last_stats_time = now;
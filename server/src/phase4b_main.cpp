@@ -36,6 +36,20 @@ void print_usage(const char* program) {
               << "  --no-animate-slice  Disable slice position animation\n"
               << "  --animation-duration SEC    Duration to traverse all slices (default: 30)\n"
               << "  --max-clients N     Maximum clients (default: 5 for 4K)\n"
+              << "  --cache-mb MB       VDS brick cache budget in MB (default: 2048)\n"
+              << "  --brick-size N      VDS brick edge length in samples (default: 64)\n"
+              << "  --crossline-layout  Keep transposed bricks for faster YZ slices (2x cache memory)\n"
+              << "  --sample-format FMT Resident VDS sample type: u8, u16, f32 (default: u8)\n"
+              << "  --brick-file PATH   Map VDS bricks from PATH, writing it first if missing or stale\n"
+              << "  --lod-levels N      Downsampled levels for overview and scrubbing (default: 3, 0 = off)\n"
+              << "  --colormap MAP      Slice colormap: seismic, gray, red-white-blue (default: seismic)\n"
+              << "  --clip-percentiles LO,HI  Colormap range as amplitude percentiles (default: 1,99)\n"
+              << "  --gpu-render        Scale and colour map slices in an OpenGL shader\n"
+              << "  --pipeline-depth N  Frames queued between pipeline stages (default: 2)\n"
+              << "  --io-threads N      Threads writing to client sockets (default: 2)\n"
+              << "  --client-queue N    Frames queued per client before it skips to a keyframe (default: 8)\n"
+              << "  --log-level LEVEL   trace, debug, info, warn, error (default: info)\n"
+              << "  --sync-log          Write log lines on the logging thread instead of a background writer\n"
               << "  --test-encoding     Run encoding performance test\n"
               << "  --help              Show this help message\n\n"
               << "4K Streaming Presets:\n"
@@ -109,9 +123,10 @@ int run_encoding_test() {
             // Quick 10-frame test
             auto test_frame = std::vector<uint8_t>(width * height * 3, 128); // Gray frame
             
+            std::vector<uint8_t> encoded;
             auto start = std::chrono::steady_clock::now();
             for (int i = 0; i < 10; i++) {
-                encoder->encode_frame(test_frame);
+                encoder->encode_frame(test_frame.data(), test_frame.size(), encoded);
             }
             auto end = std::chrono::steady_clock::now();
             
@@ -158,6 +173,8 @@ int main(int argc, char* argv[]) {
     
     blustream::server::HardwareEncoder::Type encoder_type = blustream::server::HardwareEncoder::Type::AUTO_DETECT;
     blustream::server::HardwareEncoder::Quality quality_preset = blustream::server::HardwareEncoder::Quality::FAST;
+    blustream::common::LogLevel log_level = blustream::common::LogLevel::INFO;
+    bool sync_log = false;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -200,9 +217,51 @@ int main(int argc, char* argv[]) {
             config.animation_duration = std::atof(argv[++i]);
         } else if (arg == "--max-clients" && i + 1 < argc) {
             config.max_clients = std::atoi(argv[++i]);
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            config.vds_cache_budget_mb = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--brick-size" && i + 1 < argc) {
+            config.vds_brick_size = std::atoi(argv[++i]);
+        } else if (arg == "--crossline-layout") {
+            config.vds_crossline_layout = true;
+        } else if (arg == "--sample-format" && i + 1 < argc) {
+            config.vds_sample_format = argv[++i];
+        } else if (arg == "--brick-file" && i + 1 < argc) {
+            config.vds_brick_file = argv[++i];
+        } else if (arg == "--lod-levels" && i + 1 < argc) {
+            config.vds_lod_levels = std::atoi(argv[++i]);
+        } else if (arg == "--colormap" && i + 1 < argc) {
+            config.colormap = argv[++i];
+        } else if (arg == "--clip-percentiles" && i + 1 < argc) {
+            char* end = nullptr;
+            config.clip_low_percentile = std::strtof(argv[++i], &end);
+            if (*end == ',') {
+                config.clip_high_percentile = std::strtof(end + 1, nullptr);
+            }
+        } else if (arg == "--gpu-render") {
+            config.gpu_render = true;
+        } else if (arg == "--pipeline-depth" && i + 1 < argc) {
+            config.pipeline_depth = std::atoi(argv[++i]);
+        } else if (arg == "--io-threads" && i + 1 < argc) {
+            config.io_threads = std::atoi(argv[++i]);
+        } else if (arg == "--client-queue" && i + 1 < argc) {
+            config.client_queue_packets = std::atoi(argv[++i]);
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            if (!blustream::common::parse_log_level(argv[++i], log_level)) {
+                std::cerr << "Unknown log level: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (arg == "--sync-log") {
+            sync_log = true;
         }
     }
     
+    // Pipeline threads shouldn't wait on the console
+    if (sync_log) {
+        blustream::common::set_logger(std::make_unique<blustream::common::ConsoleLogger>(log_level));
+    } else {
+        blustream::common::set_logger(std::make_unique<blustream::common::AsyncLogger>(log_level));
+    }
+    
     // Display configuration
     std::cout << "📋 Phase 4B Server Configuration:\n";
     std::cout << "  Resolution: " << config.render_width << "x" << config.render_height << "\n";
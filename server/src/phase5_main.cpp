@@ -4,6 +4,7 @@
 #include <atomic>
 #include <thread>
 #include <iomanip>
+#include <algorithm>
 #include <memory>
 #include <chrono>
 
@@ -41,11 +42,18 @@ void print_usage(const char* program) {
               << "  --fps FPS           Default target FPS (default: 30)\n"
               << "  --encoder TYPE      Encoder type (nvenc/quicksync/software/auto, default: auto)\n"
               << "  --quality PRESET    Quality preset (ultrafast/fast/balanced/high, default: fast)\n"
-              << "  --vds PATH          VDS file to load\n"
+              << "  --vds PATH          VDS file to load as the default survey\n"
+              << "  --survey ID=PATH    Serve another survey, selected by sessions by ID (repeatable)\n"
+              << "  --cache-mb MB       Brick cache budget shared by all open surveys (default: 4096)\n"
+              << "  --brick-dir DIR     Keep per-survey brick files here, mapped by every server process\n"
               << "  --max-sessions N    Maximum concurrent sessions (default: 10)\n"
               << "  --min-bitrate KBPS  Minimum bitrate in kbps (default: 1000)\n"
               << "  --max-bitrate KBPS  Maximum bitrate in kbps (default: 15000)\n"
               << "  --target-latency MS Target latency in milliseconds (default: 150)\n"
+              << "  --gpu-encoders N    Concurrent NVENC sessions to use (default: 3)\n"
+              << "  --cpu-encoders N    Software encoders once the GPU is full (default: 4)\n"
+              << "  --encoder-threads N Encoder pool worker threads (default: auto)\n"
+              << "  --simulcast N       Simulcast layers per view, 1 disables (default: 3)\n"
               << "  --help              Show this help message\n\n"
               << "WebRTC Streaming Features:\n"
               << "  ✅ Ultra-low latency streaming (<150ms)\n"
@@ -82,6 +90,9 @@ public:
         if (query.find("orientation") != query.end()) {
             session_config.orientation = query["orientation"];
         }
+        if (query.find("survey") != query.end()) {
+            session_config.survey_id = query["survey"];
+        }
         
         // Create session
         auto session_id = g_webrtc_server->create_session(session_config);
@@ -95,6 +106,7 @@ public:
             response["config"]["fps"] = json::value::number(session_config.fps);
             response["config"]["quality"] = json::value::string(session_config.quality);
             response["config"]["orientation"] = json::value::string(session_config.orientation);
+            response["config"]["survey"] = json::value::string(session_config.survey_id);
             
             request.reply(status_codes::OK, response);
         } else {
@@ -214,6 +226,8 @@ public:
                     message.type = blustream::server::WebRTCServer::ControlMessage::RESTART_ANIMATION;
                 } else if (control_type == "quality-level") {
                     message.type = blustream::server::WebRTCServer::ControlMessage::QUALITY_LEVEL;
+                } else if (control_type == "select-survey") {
+                    message.type = blustream::server::WebRTCServer::ControlMessage::SELECT_SURVEY;
                 } else {
                     throw std::runtime_error("Unknown control type");
                 }
@@ -251,6 +265,9 @@ public:
         response["framesEncoded"] = json::value::number(stats.frames_encoded);
         response["bytesSent"] = json::value::number(stats.bytes_sent);
         response["avgLatencyMs"] = json::value::number(stats.avg_latency_ms);
+        response["activeViews"] = json::value::number(stats.active_views);
+        response["framesUnchanged"] = json::value::number(stats.frames_unchanged);
+        response["openSurveys"] = json::value::number(stats.open_surveys);
         
         request.reply(status_codes::OK, response);
     }
@@ -337,6 +354,7 @@ int main(int argc, char* argv[]) {
     config.min_bitrate_kbps = 1000;
     config.max_bitrate_kbps = 15000;
     config.target_latency_ms = 150;
+    std::vector<std::pair<std::string, std::string>> surveys;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -373,6 +391,18 @@ int main(int argc, char* argv[]) {
             }
         } else if (arg == "--vds" && i + 1 < argc) {
             config.vds_path = argv[++i];
+        } else if (arg == "--survey" && i + 1 < argc) {
+            std::string survey = argv[++i];
+            size_t separator = survey.find('=');
+            if (separator == std::string::npos || separator == 0) {
+                std::cerr << "❌ --survey expects ID=PATH, got: " << survey << "\n";
+                return -1;
+            }
+            surveys.emplace_back(survey.substr(0, separator), survey.substr(separator + 1));
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            config.vds_cache_budget_mb = static_cast<size_t>(std::max(64, std::atoi(argv[++i])));
+        } else if (arg == "--brick-dir" && i + 1 < argc) {
+            config.brick_file_dir = argv[++i];
         } else if (arg == "--max-sessions" && i + 1 < argc) {
             config.max_sessions = std::atoi(argv[++i]);
         } else if (arg == "--min-bitrate" && i + 1 < argc) {
@@ -381,6 +411,14 @@ int main(int argc, char* argv[]) {
             config.max_bitrate_kbps = std::atoi(argv[++i]);
         } else if (arg == "--target-latency" && i + 1 < argc) {
             config.target_latency_ms = std::atoi(argv[++i]);
+        } else if (arg == "--gpu-encoders" && i + 1 < argc) {
+            config.max_gpu_encoders = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--cpu-encoders" && i + 1 < argc) {
+            config.max_cpu_encoders = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--encoder-threads" && i + 1 < argc) {
+            config.encoder_threads = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--simulcast" && i + 1 < argc) {
+            config.simulcast_layers = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
         }
     }
     
@@ -393,6 +431,8 @@ int main(int argc, char* argv[]) {
     std::cout << "  Bitrate Range: " << config.min_bitrate_kbps << "-" << config.max_bitrate_kbps << " kbps\n";
     std::cout << "  Target Latency: " << config.target_latency_ms << "ms\n";
     std::cout << "  VDS File: " << config.vds_path << "\n";
+    std::cout << "  Extra Surveys: " << surveys.size() << "\n";
+    std::cout << "  Survey Cache: " << config.vds_cache_budget_mb << " MB shared\n";
     std::cout << "  Default Orientation: " << config.default_orientation << "\n";
     std::cout << "  Animation: " << (config.enable_animation ? "ENABLED" : "DISABLED") << "\n";
     std::cout << "  Adaptive Quality: " << (config.enable_adaptive_quality ? "ENABLED" : "DISABLED") << "\n";
@@ -412,6 +452,13 @@ int main(int argc, char* argv[]) {
         std::cerr << "⚠️  Server will continue without VDS data\n";
     }
     
+    // Further surveys open when a session first selects them
+    for (const auto& survey : surveys) {
+        if (!g_webrtc_server->add_survey(survey.first, survey.second)) {
+            std::cerr << "❌ Failed to register survey " << survey.first << "\n";
+        }
+    }
+    
     // Set up WebRTC server callbacks for signaling integration
     g_webrtc_server->on_offer_created = [](const std::string& session_id, const std::string& client_id, const std::string& sdp) {
         std::cout << "📤 Offer created for session " << session_id << ", client " << client_id << "\n";
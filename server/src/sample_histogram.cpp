@@ -0,0 +1,135 @@
+#include "blustream/server/sample_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace blustream {
+namespace server {
+
+namespace {
+
+void atomic_min(std::atomic<float>& target, float value) {
+    float current = target.load(std::memory_order_relaxed);
+    while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void atomic_max(std::atomic<float>& target, float value) {
+    float current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+SampleHistogram::SampleHistogram() {
+    reset(0.0f, 1.0f);
+}
+
+void SampleHistogram::reset(float lo, float hi) {
+    lo_ = lo;
+    hi_ = hi > lo ? hi : lo + 1.0f;
+    bin_scale_ = static_cast<float>(BINS) / (hi_ - lo_);
+    for (auto& bin : bins_) {
+        bin.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<float>::max(), std::memory_order_relaxed);
+    max_.store(std::numeric_limits<float>::lowest(), std::memory_order_relaxed);
+}
+
+template <typename T>
+void SampleHistogram::accumulate(const T* samples, size_t count, float scale, float offset, LocalBins& bins,
+                                 float& min_value, float& max_value) const {
+    const float max_bin = static_cast<float>(BINS - 1);
+    for (size_t i = 0; i < count; i++) {
+        const float value = offset + scale * static_cast<float>(samples[i]);
+        if (!std::isfinite(value)) {
+            continue;
+        }
+        min_value = std::min(min_value, value);
+        max_value = std::max(max_value, value);
+        bins[static_cast<size_t>(std::clamp((value - lo_) * bin_scale_, 0.0f, max_bin))]++;
+    }
+}
+
+void SampleHistogram::add(const BrickCache::Brick& brick, float scale, float offset) {
+    LocalBins bins{};
+    float min_value = std::numeric_limits<float>::max();
+    float max_value = std::numeric_limits<float>::lowest();
+    const size_t count = brick.sample_count();
+
+    switch (brick.format) {
+        case SampleFormat::U8:
+            accumulate(brick.samples_as<uint8_t>(), count, scale, offset, bins, min_value, max_value);
+            break;
+        case SampleFormat::U16:
+            accumulate(brick.samples_as<uint16_t>(), count, scale, offset, bins, min_value, max_value);
+            break;
+        case SampleFormat::F32:
+            accumulate(brick.samples_as<float>(), count, 1.0f, 0.0f, bins, min_value, max_value);
+            break;
+    }
+
+    // Merge with one atomic add per touched bin
+    uint64_t added = 0;
+    for (size_t i = 0; i < BINS; i++) {
+        if (bins[i]) {
+            bins_[i].fetch_add(bins[i], std::memory_order_relaxed);
+            added += bins[i];
+        }
+    }
+    if (added == 0) {
+        return;
+    }
+    atomic_min(min_, min_value);
+    atomic_max(max_, max_value);
+    count_.fetch_add(added, std::memory_order_release);
+}
+
+bool SampleHistogram::observed_range(float& min_value, float& max_value) const {
+    if (count_.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    min_value = min_.load(std::memory_order_relaxed);
+    max_value = max_.load(std::memory_order_relaxed);
+    return true;
+}
+
+float SampleHistogram::percentile(float percentile, uint64_t total) const {
+    const double target = std::clamp(percentile, 0.0f, 100.0f) / 100.0 * static_cast<double>(total);
+    double cumulative = 0.0;
+    for (size_t i = 0; i < BINS; i++) {
+        const double in_bin = static_cast<double>(bins_[i].load(std::memory_order_relaxed));
+        if (in_bin > 0.0 && cumulative + in_bin >= target) {
+            const double fraction = (target - cumulative) / in_bin;
+            return lo_ + static_cast<float>((static_cast<double>(i) + fraction) / bin_scale_);
+        }
+        cumulative += in_bin;
+    }
+    return hi_;
+}
+
+bool SampleHistogram::percentile_range(float low_percentile, float high_percentile, float& low, float& high) const {
+    float min_value, max_value;
+    const uint64_t total = count_.load(std::memory_order_acquire);
+    if (total == 0 || !observed_range(min_value, max_value)) {
+        return false;
+    }
+
+    // Bins are merged independently, so a concurrent add() can be half
+    // counted; that only nudges the estimate
+    low = std::clamp(percentile(low_percentile, total), min_value, max_value);
+    high = std::clamp(percentile(high_percentile, total), min_value, max_value);
+    if (low_percentile <= 0.0f) {
+        low = min_value;
+    }
+    if (high_percentile >= 100.0f) {
+        high = max_value;
+    }
+    return true;
+}
+
+} // namespace server
+} // namespace blustream
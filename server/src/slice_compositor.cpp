@@ -0,0 +1,168 @@
+#include "blustream/server/slice_compositor.h"
+#include "blustream/server/thread_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace blustream {
+namespace server {
+
+SliceCompositor::SliceCompositor(ThreadPool* pool)
+    : pool_(pool)
+    , map_slice_width_(0)
+    , map_slice_height_(0)
+    , map_out_width_(0)
+    , map_out_height_(0) {
+}
+
+bool SliceCompositor::compose(const VDSManager::SliceBuffer& slice, const ColorMap& colormap, const YUV420Planes& out) {
+    if (slice.width <= 0 || slice.height <= 0 || out.width <= 0 || out.height <= 0 ||
+        slice.data.size() < slice.sample_count() * sample_format_size(slice.format)) {
+        return false;
+    }
+
+    update_maps(slice.width, slice.height, out.width, out.height);
+
+    const int pairs = (out.height + 1) / 2;
+    if (pool_) {
+        pool_->parallel_for(static_cast<size_t>(pairs), [&](size_t begin, size_t end) {
+            compose_rows(slice, colormap, out, static_cast<int>(begin), static_cast<int>(end));
+        }, 8);
+    } else {
+        compose_rows(slice, colormap, out, 0, pairs);
+    }
+    return true;
+}
+
+void SliceCompositor::update_maps(int slice_width, int slice_height, int out_width, int out_height) {
+    if (slice_width == map_slice_width_ && slice_height == map_slice_height_ &&
+        out_width == map_out_width_ && out_height == map_out_height_) {
+        return;
+    }
+
+    src_cols_.resize(out_width);
+    for (int x = 0; x < out_width; x++) {
+        src_cols_[x] = static_cast<int>(static_cast<int64_t>(x) * slice_width / out_width);
+    }
+    src_rows_.resize(out_height);
+    for (int y = 0; y < out_height; y++) {
+        src_rows_[y] = static_cast<int>(static_cast<int64_t>(y) * slice_height / out_height);
+    }
+
+    map_slice_width_ = slice_width;
+    map_slice_height_ = slice_height;
+    map_out_width_ = out_width;
+    map_out_height_ = out_height;
+}
+
+void SliceCompositor::compose_rows(const VDSManager::SliceBuffer& slice, const ColorMap& colormap,
+                                   const YUV420Planes& out, int pair_begin, int pair_end) const {
+    // Per-thread source-row scratch; pool workers keep theirs across frames
+    thread_local std::vector<uint8_t> luma_row;
+    thread_local std::vector<uint16_t> chroma_rows;
+
+    const size_t row_bytes = static_cast<size_t>(slice.width) * sample_format_size(slice.format);
+    const uint8_t* samples = slice.data.data();
+    const bool grayscale = colormap.is_grayscale();
+    const int chroma_width = (out.width + 1) / 2;
+
+    luma_row.resize(slice.width);
+    if (!grayscale) {
+        chroma_rows.resize(static_cast<size_t>(slice.width) * 2);
+    }
+
+    int luma_src_row = -1;  // Source row currently held in luma_row
+
+    for (int pair = pair_begin; pair < pair_end; pair++) {
+        const int y0 = pair * 2;
+        const int y1 = std::min(y0 + 1, out.height - 1);
+
+        for (int y = y0; y <= y1; y++) {
+            uint8_t* dst = out.y + static_cast<size_t>(y) * out.y_stride;
+            const int src_row = src_rows_[y];
+
+            // Upscaling repeats source rows; reuse the row we just wrote
+            if (y > pair_begin * 2 && src_rows_[y - 1] == src_row) {
+                std::memcpy(dst, dst - out.y_stride, out.width);
+                continue;
+            }
+
+            if (src_row != luma_src_row) {
+                colormap.map_luma(slice.format, samples + src_row * row_bytes, slice.width, luma_row.data());
+                luma_src_row = src_row;
+            }
+            for (int x = 0; x < out.width; x++) {
+                dst[x] = luma_row[src_cols_[x]];
+            }
+        }
+
+        uint8_t* dst_u = out.u + static_cast<size_t>(pair) * out.u_stride;
+        uint8_t* dst_v = out.v + static_cast<size_t>(pair) * out.v_stride;
+
+        if (grayscale) {
+            // R == G == B, so U and V sit exactly on the neutral value
+            std::memset(dst_u, 128, chroma_width);
+            std::memset(dst_v, 128, chroma_width);
+            continue;
+        }
+
+        if (pair > pair_begin && src_rows_[y0] == src_rows_[y0 - 2] && src_rows_[y1] == src_rows_[y0 - 1]) {
+            std::memcpy(dst_u, dst_u - out.u_stride, chroma_width);
+            std::memcpy(dst_v, dst_v - out.v_stride, chroma_width);
+            continue;
+        }
+
+        uint16_t* top = chroma_rows.data();
+        uint16_t* bottom = top + slice.width;
+        colormap.map_chroma(slice.format, samples + src_rows_[y0] * row_bytes, slice.width, top);
+        if (src_rows_[y1] != src_rows_[y0]) {
+            colormap.map_chroma(slice.format, samples + src_rows_[y1] * row_bytes, slice.width, bottom);
+        } else {
+            bottom = top;
+        }
+
+        // Average the 2x2 block behind each chroma sample
+        for (int cx = 0; cx < chroma_width; cx++) {
+            const int c0 = src_cols_[cx * 2];
+            const int c1 = src_cols_[std::min(cx * 2 + 1, out.width - 1)];
+            const uint16_t a = top[c0], b = top[c1], c = bottom[c0], d = bottom[c1];
+            dst_u[cx] = static_cast<uint8_t>(((a & 0xFF) + (b & 0xFF) + (c & 0xFF) + (d & 0xFF) + 2) >> 2);
+            dst_v[cx] = static_cast<uint8_t>(((a >> 8) + (b >> 8) + (c >> 8) + (d >> 8) + 2) >> 2);
+        }
+    }
+}
+
+void SliceCompositor::compose_test_pattern(int frame_index, const YUV420Planes& out) {
+    for (int y = 0; y < out.height; y++) {
+        uint8_t* dst_y = out.y + static_cast<size_t>(y) * out.y_stride;
+        for (int x = 0; x < out.width; x++) {
+            // Animated gradient
+            const uint8_t r = static_cast<uint8_t>((x + frame_index) % 256);
+            const uint8_t g = static_cast<uint8_t>((y + frame_index / 2) % 256);
+            const uint8_t b = static_cast<uint8_t>(frame_index % 256);
+            dst_y[x] = ColorMap::rgb_to_luma(r, g, b);
+
+            if ((y & 1) == 0 && (x & 1) == 0) {
+                const uint16_t chroma = ColorMap::rgb_to_chroma(r, g, b);
+                out.u[static_cast<size_t>(y / 2) * out.u_stride + x / 2] = static_cast<uint8_t>(chroma);
+                out.v[static_cast<size_t>(y / 2) * out.v_stride + x / 2] = static_cast<uint8_t>(chroma >> 8);
+            }
+        }
+    }
+}
+
+void SliceCompositor::clear(const YUV420Planes& out) {
+    const int chroma_width = (out.width + 1) / 2;
+    const int chroma_height = (out.height + 1) / 2;
+
+    for (int y = 0; y < out.height; y++) {
+        std::memset(out.y + static_cast<size_t>(y) * out.y_stride, 16, out.width);
+    }
+    for (int y = 0; y < chroma_height; y++) {
+        std::memset(out.u + static_cast<size_t>(y) * out.u_stride, 128, chroma_width);
+        std::memset(out.v + static_cast<size_t>(y) * out.v_stride, 128, chroma_width);
+    }
+}
+
+} // namespace server
+} // namespace blustream
@@ -0,0 +1,166 @@
+#include "blustream/server/slice_prefetcher.h"
+#include "blustream/server/vds_manager.h"
+#include "blustream/common/logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace blustream {
+namespace server {
+
+SlicePrefetcher::SlicePrefetcher(const VDSManager& vds_manager)
+    : vds_manager_(vds_manager)
+    , running_(false)
+    , cursor_axis_(-1)
+    , cursor_index_(0)
+    , cursor_velocity_(0.0f)
+    , cursor_lod_(0)
+    , generation_(0)
+    , predictions_(0)
+    , slices_warmed_(0)
+    , slices_resident_(0)
+    , bricks_loaded_(0) {
+}
+
+SlicePrefetcher::~SlicePrefetcher() {
+    stop();
+}
+
+bool SlicePrefetcher::start(const Config& config) {
+    if (running_) {
+        return true;
+    }
+
+    config_ = config;
+    config_.lookahead_frames = std::max(1, config_.lookahead_frames);
+
+    running_ = true;
+    worker_thread_ = std::thread(&SlicePrefetcher::worker_loop, this);
+
+    BLUSTREAM_LOG_INFO("Slice prefetcher started (lookahead " +
+                      std::to_string(config_.lookahead_frames) + " frames)");
+    return true;
+}
+
+void SlicePrefetcher::stop() {
+    if (!running_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cursor_mutex_);
+        running_ = false;
+    }
+    cursor_cv_.notify_all();
+
+    if (worker_thread_.joinable()) {
+        worker_thread_.join();
+    }
+
+    BLUSTREAM_LOG_INFO("Slice prefetcher stopped");
+}
+
+void SlicePrefetcher::update(int axis, int index, float velocity, int lod) {
+    {
+        std::lock_guard<std::mutex> lock(cursor_mutex_);
+
+        // Nothing new to predict while the cursor sits still
+        if (axis == cursor_axis_ && index == cursor_index_ && velocity == cursor_velocity_ && lod == cursor_lod_) {
+            return;
+        }
+
+        cursor_axis_ = axis;
+        cursor_index_ = index;
+        cursor_velocity_ = velocity;
+        cursor_lod_ = lod;
+        generation_++;
+    }
+    cursor_cv_.notify_one();
+}
+
+SlicePrefetcher::Stats SlicePrefetcher::get_stats() const {
+    Stats stats;
+    stats.predictions = predictions_;
+    stats.slices_warmed = slices_warmed_;
+    stats.slices_resident = slices_resident_;
+    stats.bricks_loaded = bricks_loaded_;
+    return stats;
+}
+
+void SlicePrefetcher::worker_loop() {
+    uint64_t seen_generation = 0;
+
+    while (running_) {
+        int axis, index, lod;
+        float velocity;
+        {
+            std::unique_lock<std::mutex> lock(cursor_mutex_);
+            cursor_cv_.wait(lock, [this, seen_generation] {
+                return !running_ || generation_ != seen_generation;
+            });
+            if (!running_) {
+                break;
+            }
+
+            seen_generation = generation_;
+            axis = cursor_axis_;
+            index = cursor_index_;
+            velocity = cursor_velocity_;
+            lod = cursor_lod_;
+        }
+
+        predictions_++;
+
+        // Walk outward from the cursor, nearest frame first, and bail out as
+        // soon as a newer cursor arrives so we never warm a stale trajectory
+        const bool idle = std::fabs(velocity) < 1e-3f;
+        for (int step = 1; step <= config_.lookahead_frames && running_; step++) {
+            if (generation_ != seen_generation) {
+                break;
+            }
+
+            int predicted;
+            if (predict(axis, index, velocity, step, predicted)) {
+                warm(axis, predicted, lod);
+            }
+            // A stationary cursor may be nudged either way by NEXT/PREV_SLICE
+            if (idle && predict(axis, index, velocity, -step, predicted)) {
+                warm(axis, predicted, lod);
+            }
+        }
+    }
+}
+
+bool SlicePrefetcher::predict(int axis, int index, float velocity, int step, int& predicted) const {
+    const int length = vds_manager_.get_axis_length(axis);
+    if (length <= 0) {
+        return false;
+    }
+
+    const bool idle = std::fabs(velocity) < 1e-3f;
+    int target = idle ? index + step
+                      : index + static_cast<int>(std::lround(velocity * step));
+
+    if (target < 0 || target >= length) {
+        if (!config_.wrap || idle) {
+            return false;
+        }
+        target = ((target % length) + length) % length;
+    }
+
+    predicted = target;
+    return target != index;
+}
+
+void SlicePrefetcher::warm(int axis, int index, int lod) {
+    if (vds_manager_.is_slice_resident(axis, index, lod)) {
+        slices_resident_++;
+        return;
+    }
+
+    bricks_loaded_ += vds_manager_.prefetch_slice(axis, index, lod);
+    slices_warmed_++;
+}
+
+} // namespace server
+} // namespace blustream
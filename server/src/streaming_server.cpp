@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <cstring>
 #include <iomanip>
+#include <cmath>
 
 // System headers for sockets
 #ifdef _WIN32
@@ -14,9 +15,12 @@
 #pragma comment(lib, "ws2_32.lib")
 #else
 #include <sys/socket.h>
+#include <poll.h>
 #include <unistd.h>
 #endif
 
+#include <cerrno>
+
 // FFmpeg headers
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -53,26 +57,81 @@ static void cleanup_packet(AVPacket* pkt) {
     }
 }
 
+// "00 00 00 01 67 ..." for the first bytes of a bitstream, for debug logs
+static std::string hex_prefix(const uint8_t* data, size_t size, size_t max_bytes) {
+    std::string hex;
+    for (size_t i = 0; i < std::min(size, max_bytes); i++) {
+        char buf[4];
+        snprintf(buf, sizeof(buf), "%02x ", data[i]);
+        hex += buf;
+    }
+    return hex;
+}
+
+// Every stage histogram is one series of this metric, labelled by stage
+static const char* const STAGE_METRIC = "blustream_stage_seconds";
+static const char* const STAGE_HELP = "Time spent in each pipeline stage and queue";
+
 StreamingServer::StreamingServer()
     : encoder_context_(nullptr, cleanup_codec_context)
     , av_frame_(nullptr, cleanup_frame)
     , av_packet_(nullptr, cleanup_packet)
     
     , vds_manager_(std::make_unique<VDSManager>())
+    , brick_file_running_(false)
+    , current_lod_(0)
+    , last_pts_(-1)
+    , force_keyframe_(false)
+    , last_encode_ms_(0.0f)
+    , target_bitrate_kbps_(0)
+    , applied_bitrate_kbps_(0)
+    , frame_rate_divisor_(1)
+    , render_tick_(0)
+    , packet_sequence_(0)
+    , keyframe_is_latest_(false)
     , running_(false)
+    , frames_rendered_(metrics_.counter("blustream_frames_rendered_total", "Frames rendered"))
+    , frames_encoded_(metrics_.counter("blustream_frames_encoded_total", "Encoded frames broadcast to clients"))
+    , frames_dropped_(metrics_.counter("blustream_frames_dropped_total", "Frames dropped inside the pipeline"))
+    , frames_unchanged_(metrics_.counter("blustream_frames_unchanged_total", "Ticks skipped on a still view"))
+    , bytes_sent_(metrics_.counter("blustream_encoded_bytes_total", "Encoded bytes broadcast, counted once"))
+    , slice_fetch_latency_(metrics_.histogram(STAGE_METRIC, STAGE_HELP, "stage=\"slice_fetch\""))
+    , render_latency_(metrics_.histogram(STAGE_METRIC, STAGE_HELP, "stage=\"render\""))
+    , convert_queue_latency_(metrics_.histogram(STAGE_METRIC, STAGE_HELP, "stage=\"convert_queue\""))
+    , convert_latency_(metrics_.histogram(STAGE_METRIC, STAGE_HELP, "stage=\"convert\""))
+    , encode_queue_latency_(metrics_.histogram(STAGE_METRIC, STAGE_HELP, "stage=\"encode_queue\""))
+    , encode_latency_(metrics_.histogram(STAGE_METRIC, STAGE_HELP, "stage=\"encode\""))
+    , fanout_queue_latency_(metrics_.histogram(STAGE_METRIC, STAGE_HELP, "stage=\"fanout_queue\""))
+    , fanout_latency_(metrics_.histogram(STAGE_METRIC, STAGE_HELP, "stage=\"fanout\""))
+    , send_latency_(metrics_.histogram(STAGE_METRIC, STAGE_HELP, "stage=\"socket_send\""))
+    , end_to_end_latency_(metrics_.histogram("blustream_frame_latency_seconds", "Render start to fanout"))
+    , last_render_ms_(0.0f)
     , current_slice_axis_(2)
-    , current_slice_index_(32) {
+    , current_slice_index_(32)
+    , animation_enabled_(true)
+    , animation_synced_(false)
+    , last_navigation_delta_(0)
+    , last_navigation_ms_(0) {
     
     // Initialize stats
     memset(&stats_, 0, sizeof(stats_));
     stats_start_time_ = std::chrono::steady_clock::now();
+    register_gauges();
+    
+    // One convert stage per process, so it can have the cores
+    YUVConverter::Config converter_config;
+    converter_config.threads = 0;
+    readback_converter_.configure(converter_config);
 }
 
 StreamingServer::~StreamingServer() {
+    // Pipeline, prefetch and brick file threads read bricks and LOD levels
+    // until joined; only then can the caches and the mapped brick file go
+    stop();
+    stop_brick_file_writer();
     if (vds_manager_) {
         vds_manager_->shutdown();
     }
-    stop();
     cleanup_encoder();
 }
 
@@ -87,6 +146,20 @@ bool StreamingServer::initialize(const Config& config) {
     BLUSTREAM_LOG_INFO("  Encoder: " + config_.encoder);
     BLUSTREAM_LOG_INFO("  Bitrate: " + std::to_string(config_.bitrate_kbps) + " kbps");
     
+    if (config_.max_bitrate_kbps <= 0) {
+        config_.max_bitrate_kbps = config_.bitrate_kbps;
+    }
+    config_.min_bitrate_kbps = std::min(config_.min_bitrate_kbps, config_.max_bitrate_kbps);
+    target_bitrate_kbps_ = config_.bitrate_kbps;
+    applied_bitrate_kbps_ = config_.bitrate_kbps;
+    stats_.target_bitrate_kbps = config_.bitrate_kbps;
+    stats_.stream_fps = config_.target_fps;
+    if (config_.adaptive_bitrate) {
+        BLUSTREAM_LOG_INFO("  Adaptive bitrate: " + std::to_string(config_.min_bitrate_kbps) + "-" +
+                          std::to_string(config_.max_bitrate_kbps) + " kbps, " +
+                          std::to_string(config_.target_latency_ms) + " ms latency budget");
+    }
+    
     // Calculate frame duration
     frame_duration_ = std::chrono::microseconds(static_cast<int64_t>(1000000.0 / config_.target_fps));
     
@@ -103,6 +176,17 @@ bool StreamingServer::initialize(const Config& config) {
     
     BLUSTREAM_LOG_INFO("✓ OpenGL context created");
     
+    if (config_.gpu_render) {
+        if (gl_context_->create_render_target(config_.render_width, config_.render_height) &&
+            gl_context_->create_slice_renderer()) {
+            BLUSTREAM_LOG_INFO("✓ GPU slice rendering enabled");
+        } else {
+            BLUSTREAM_LOG_WARN("GPU slice rendering unavailable, compositing slices on the CPU");
+            config_.gpu_render = false;
+        }
+    }
+    gl_context_->release_context();  // The render thread makes it current itself
+    
     // Initialize network server
     network_server_ = std::make_unique<NetworkServer>();
     if (!network_server_->start(config_.port)) {
@@ -127,6 +211,26 @@ bool StreamingServer::initialize(const Config& config) {
         BLUSTREAM_LOG_ERROR("Failed to initialize VDS manager");
         return false;
     }
+    
+    VDSManager::CacheConfig cache_config;
+    cache_config.brick_size = config_.vds_brick_size;
+    cache_config.budget_mb = config_.vds_cache_budget_mb;
+    cache_config.crossline_layout = config_.vds_crossline_layout;
+    cache_config.lod_levels = config_.vds_lod_levels;
+    if (!VDSManager::parse_sample_format(config_.vds_sample_format, cache_config.sample_format)) {
+        BLUSTREAM_LOG_WARN("Unknown VDS sample format '" + config_.vds_sample_format + "', using u8");
+    }
+    vds_manager_->set_cache_config(cache_config);
+    
+    ColorMap::Type colormap_type = ColorMap::Type::SEISMIC_GRAY;
+    if (!ColorMap::parse_type(config_.colormap, colormap_type)) {
+        BLUSTREAM_LOG_WARN("Unknown colormap '" + config_.colormap + "', using seismic");
+    }
+    vds_manager_->set_colormap(colormap_type);
+    vds_manager_->set_clip_percentiles(config_.clip_low_percentile, config_.clip_high_percentile);
+    BLUSTREAM_LOG_INFO("  Colormap: " + ColorMap::type_to_string(colormap_type) +
+                      " (" + ColorMap::get_kernel_name() + " kernel)");
+    
     if (!config_.vds_path.empty()) {
         if (!load_vds(config_.vds_path)) {
             BLUSTREAM_LOG_WARN("Failed to load VDS: " + config_.vds_path);
@@ -169,8 +273,18 @@ bool StreamingServer::initialize_encoder() {
     ctx->framerate = AVRational{static_cast<int>(config_.target_fps), 1};
     ctx->gop_size = config_.keyframe_interval;
     ctx->max_b_frames = 0;  // No B-frames for low latency
+    if (config_.slices_per_frame > 1) {
+        ctx->slices = config_.slices_per_frame;  // zerolatency runs x264's threads per slice
+    }
     ctx->pix_fmt = AV_PIX_FMT_YUV420P;
     
+    // Runtime bitrate changes need VBV from the start; a buffer of one
+    // latency budget keeps a frame burst from outliving that budget
+    if (config_.adaptive_bitrate) {
+        ctx->rc_max_rate = ctx->bit_rate;
+        ctx->rc_buffer_size = config_.bitrate_kbps * config_.target_latency_ms;
+    }
+    
     // CRITICAL: Force Annex B format with parameter sets
     ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
     
@@ -179,6 +293,11 @@ bool StreamingServer::initialize_encoder() {
         av_opt_set(ctx->priv_data, "preset", config_.preset.c_str(), 0);
         av_opt_set(ctx->priv_data, "tune", "zerolatency", 0);
         av_opt_set(ctx->priv_data, "x264opts", "no-scenecut", 0);
+        // Keyframes are what a client resyncs on; with intra refresh they
+        // only come when one is requested, and the bitrate stays flat
+        if (config_.intra_refresh) {
+            av_opt_set_int(ctx->priv_data, "intra-refresh", 1, 0);
+        }
         // Force parameter sets in stream
         av_opt_set(ctx->priv_data, "annex_b", "1", 0);
         av_opt_set(ctx->priv_data, "repeat-headers", "1", 0);
@@ -215,6 +334,20 @@ bool StreamingServer::initialize_encoder() {
     }
     av_packet_.reset(pkt);
     
+    // Cache the parameter sets once; keyframes carry them so any keyframe
+    // is a valid starting point for a new viewer
+    parameter_sets_.clear();
+    if (ctx->extradata_size >= 4 &&
+        ctx->extradata[0] == 0x00 && ctx->extradata[1] == 0x00 &&
+        ctx->extradata[2] == 0x00 && ctx->extradata[3] == 0x01) {
+        parameter_sets_.assign(ctx->extradata, ctx->extradata + ctx->extradata_size);
+        
+        BLUSTREAM_LOG_INFO("✓ Encoder extradata available (" + std::to_string(parameter_sets_.size()) + " bytes)");
+        BLUSTREAM_LOG_DEBUG("  Extradata: " + hex_prefix(parameter_sets_.data(), parameter_sets_.size(), 32) + "...");
+    } else if (ctx->extradata_size > 0) {
+        BLUSTREAM_LOG_WARN("Encoder extradata is not Annex B, relying on in-band parameter sets");
+    }
+    
     BLUSTREAM_LOG_INFO("Encoder initialized: " + std::string(codec->name) + 
                       " @ " + std::to_string(config_.bitrate_kbps) + " kbps");
     
@@ -236,12 +369,50 @@ bool StreamingServer::start() {
     
     BLUSTREAM_LOG_INFO("Starting streaming server...");
     
+    // Slice cursor starts from the configured orientation
+    current_slice_axis_ = VDSManager::orientation_to_axis(config_.slice_orientation);
+    current_slice_index_ = config_.initial_slice_index;
+    animation_enabled_ = config_.animate_slice;
+    animation_synced_ = false;
+    
+    if (config_.enable_prefetch && vds_manager_ && vds_manager_->has_vds()) {
+        prefetcher_ = std::make_unique<SlicePrefetcher>(*vds_manager_);
+        SlicePrefetcher::Config prefetch_config;
+        prefetch_config.lookahead_frames = config_.prefetch_lookahead_frames;
+        prefetcher_->start(prefetch_config);
+    }
+    
+    if (!create_pipeline()) {
+        BLUSTREAM_LOG_ERROR("Failed to create frame pipeline");
+        destroy_pipeline();
+        return false;
+    }
+    
+    client_io_ = std::make_unique<ClientIOPool>(static_cast<size_t>(std::max(1, config_.io_threads)), &send_latency_);
+    if (!client_io_->start()) {
+        BLUSTREAM_LOG_ERROR("Failed to start client I/O pool");
+        destroy_pipeline();
+        return false;
+    }
+    
+    trace_.set_enabled(!config_.trace_path.empty());
+    if (config_.metrics_port > 0) {
+        metrics_server_ = std::make_unique<MetricsServer>(metrics_, &trace_);
+        if (!metrics_server_->start(config_.metrics_port)) {
+            BLUSTREAM_LOG_WARN("Continuing without the metrics endpoint");
+            metrics_server_.reset();
+        }
+    }
+    
     running_ = true;
     
     // Start accept thread
     accept_thread_ = std::thread(&StreamingServer::accept_clients_loop, this);
     
-    // Start render thread
+    // Start the pipeline from the far end so every stage has a consumer
+    fanout_thread_ = std::thread(&StreamingServer::fanout_loop, this);
+    encode_thread_ = std::thread(&StreamingServer::encode_loop, this);
+    convert_thread_ = std::thread(&StreamingServer::convert_loop, this);
     render_thread_ = std::thread(&StreamingServer::render_loop, this);
     
     BLUSTREAM_LOG_INFO("✓ Streaming server started");
@@ -262,46 +433,198 @@ void StreamingServer::stop() {
         network_server_->stop();
     }
     
-    // Wake up any waiting threads
-    frame_queue_cv_.notify_all();
-    
-    // Join threads
+    // Join threads; pipeline stages wake from their ring waits within 50 ms
     if (accept_thread_.joinable()) {
         accept_thread_.join();
     }
     
-    if (render_thread_.joinable()) {
-        render_thread_.join();
+    for (std::thread* stage : {&render_thread_, &convert_thread_, &encode_thread_, &fanout_thread_}) {
+        if (stage->joinable()) {
+            stage->join();
+        }
+    }
+    destroy_pipeline();
+    
+    if (prefetcher_) {
+        prefetcher_->stop();
+    }
+    stop_brick_file_writer();
+    
+    if (metrics_server_) {
+        metrics_server_->stop();
+        metrics_server_.reset();
+    }
+    if (trace_.enabled()) {
+        trace_.set_enabled(false);
+        if (trace_.write_chrome_trace(config_.trace_path)) {
+            BLUSTREAM_LOG_INFO("Chrome trace written to " + config_.trace_path);
+        }
     }
     
     // Disconnect all clients
+    std::vector<ClientReader> client_readers;
     {
         std::lock_guard<std::mutex> lock(clients_mutex_);
         for (auto& client : clients_) {
             client->disconnect();
         }
         clients_.clear();
+        client_readers.swap(client_readers_);
+    }
+    
+    // Control readers poll with a timeout and exit once running_ is cleared
+    for (auto& reader : client_readers) {
+        if (reader.thread.joinable()) {
+            reader.thread.join();
+        }
+    }
+    
+    if (client_io_) {
+        client_io_->stop();
+        client_io_.reset();
     }
     
     BLUSTREAM_LOG_INFO("✓ Streaming server stopped");
 }
 
+// I420 view of an AVFrame's planes, honouring the encoder's line padding
+static YUV420Planes frame_planes(AVFrame* frame) {
+    YUV420Planes planes;
+    planes.y = frame->data[0];
+    planes.u = frame->data[1];
+    planes.v = frame->data[2];
+    planes.y_stride = frame->linesize[0];
+    planes.u_stride = frame->linesize[1];
+    planes.v_stride = frame->linesize[2];
+    planes.width = frame->width;
+    planes.height = frame->height;
+    return planes;
+}
+
+bool StreamingServer::create_pipeline() {
+    const size_t depth = static_cast<size_t>(std::max(1, config_.pipeline_depth));
+    
+    still_gate_ = StillFrameGate(std::max(1, config_.pipeline_depth) * 4,
+                                 std::chrono::milliseconds(std::max(100, config_.still_refresh_ms)));
+    pts_epoch_ = std::chrono::steady_clock::now();
+    last_pts_ = -1;
+    
+    // Enough frames that every ring can be full with one more in each stage
+    const size_t frame_count = depth * 2 + 4;
+    pipeline_frames_.clear();
+    free_frames_.clear();
+    for (size_t i = 0; i < frame_count; i++) {
+        auto frame = std::make_unique<PipelineFrame>();
+        frame->yuv = std::unique_ptr<AVFrame, void(*)(AVFrame*)>(av_frame_alloc(), cleanup_frame);
+        if (!frame->yuv) {
+            BLUSTREAM_LOG_ERROR("Failed to allocate pipeline frame");
+            return false;
+        }
+        frame->yuv->format = encoder_context_->pix_fmt;
+        frame->yuv->width = encoder_context_->width;
+        frame->yuv->height = encoder_context_->height;
+        if (av_frame_get_buffer(frame->yuv.get(), 0) < 0) {
+            BLUSTREAM_LOG_ERROR("Failed to allocate pipeline frame buffer");
+            return false;
+        }
+        free_frames_.push_back(frame.get());
+        pipeline_frames_.push_back(std::move(frame));
+    }
+    
+    // Packets live from the encoder to the slowest client's queue. A quarter
+    // of the luma plane covers all but the largest keyframes.
+    packet_pool_.reserve(frame_count + static_cast<size_t>(std::max(1, config_.client_queue_packets)),
+                         static_cast<size_t>(encoder_context_->width) * encoder_context_->height / 4);
+    
+    rendered_frames_ = std::make_unique<SPSCRing<PipelineFrame*>>(depth);
+    converted_frames_ = std::make_unique<SPSCRing<PipelineFrame*>>(depth);
+    dropped_frames_ = std::make_unique<SPSCRing<PipelineFrame*>>(frame_count);
+    encoded_frames_ = std::make_unique<SPSCRing<PipelineFrame*>>(frame_count);
+    
+    // Packets are never dropped silently: running out forces a keyframe instead
+    const size_t packet_count = 16;
+    pipeline_packets_.clear();
+    free_packets_.clear();
+    for (size_t i = 0; i < packet_count; i++) {
+        pipeline_packets_.push_back(std::make_unique<EncodedPacket>());
+        free_packets_.push_back(pipeline_packets_.back().get());
+    }
+    outgoing_packets_ = std::make_unique<SPSCRing<EncodedPacket*>>(packet_count);
+    sent_packets_ = std::make_unique<SPSCRing<EncodedPacket*>>(packet_count);
+    
+    render_latency_.reset();
+    convert_latency_.reset();
+    encode_latency_.reset();
+    fanout_latency_.reset();
+    end_to_end_latency_.reset();
+    
+    BLUSTREAM_LOG_INFO("Frame pipeline: " + std::to_string(frame_count) + " frames, depth " +
+                      std::to_string(depth) + " per stage");
+    return true;
+}
+
+void StreamingServer::destroy_pipeline() {
+    rendered_frames_.reset();
+    converted_frames_.reset();
+    dropped_frames_.reset();
+    encoded_frames_.reset();
+    outgoing_packets_.reset();
+    sent_packets_.reset();
+    free_frames_.clear();
+    free_packets_.clear();
+    pipeline_frames_.clear();
+    pipeline_packets_.clear();
+}
+
+StreamingServer::PipelineFrame* StreamingServer::acquire_free_frame() {
+    PipelineFrame* frame = nullptr;
+    while (dropped_frames_->try_pop(frame)) {
+        free_frames_.push_back(frame);
+    }
+    while (encoded_frames_->try_pop(frame)) {
+        free_frames_.push_back(frame);
+    }
+    
+    if (free_frames_.empty()) {
+        return nullptr;
+    }
+    frame = free_frames_.back();
+    free_frames_.pop_back();
+    return frame;
+}
+
 void StreamingServer::render_loop() {
     BLUSTREAM_LOG_INFO("Render loop started");
     
     next_frame_time_ = std::chrono::steady_clock::now();
     animation_start_time_ = std::chrono::steady_clock::now();
     
-    // Create a test pattern if no VDS loaded
-    std::vector<uint8_t> test_pattern(config_.render_width * config_.render_height * 3);
-    
-    // Slice cycling for comprehensive capture
-    static int frame_count = 0;
-    static int slice_change_interval = 5; // Change slice every 5 frames
-    
     while (running_) {
+        // Held at the bitrate floor, the controller halves the frame rate
+        // so each frame keeps enough bits; animation is time based and
+        // keeps its pace
+        const int divisor = frame_rate_divisor_;
+        if (divisor > 1 && render_tick_++ % divisor != 0) {
+            next_frame_time_ += frame_duration_;
+            std::this_thread::sleep_until(next_frame_time_);
+            continue;
+        }
+        
         auto render_start = std::chrono::steady_clock::now();
         
+        // A still slice costs nothing to render, convert, encode or send
+        // until it changes or is due a refresh
+        int axis = 0, index = 0;
+        if (vds_manager_ && vds_manager_->has_vds()) {
+            select_current_slice(axis, index);
+            if (config_.skip_still_frames && !should_render_view(axis, index)) {
+                frames_unchanged_.add();
+                next_frame_time_ += frame_duration_;
+                std::this_thread::sleep_until(next_frame_time_);
+                continue;
+            }
+        }
+        
         // Make OpenGL context current
         if (!gl_context_->make_current()) {
             BLUSTREAM_LOG_ERROR("Failed to make OpenGL context current");
@@ -309,99 +632,30 @@ void StreamingServer::render_loop() {
             continue;
         }
         
-        // Render frame (either VDS or test pattern)
-        std::vector<uint8_t> rgb_frame;
-        
-        if (vds_manager_ && vds_manager_->has_vds()) {
-            std::vector<uint8_t> slice_rgb;
-            int slice_width, slice_height;
-            
-            if (config_.animate_slice) {
-                // Time-based animated slice rendering for seismic wiggles
-                auto current_time = std::chrono::steady_clock::now();
-                float elapsed_seconds = std::chrono::duration<float>(current_time - animation_start_time_).count();
-                
-                // Get animated slice data
-                slice_rgb = vds_manager_->get_animated_slice_rgb(config_.slice_orientation, elapsed_seconds, config_.animation_duration);
-                vds_manager_->get_slice_dimensions(config_.slice_orientation, slice_width, slice_height);
-                
-                // Log progress occasionally for vertical sections (XZ)
-                if (frame_count % 30 == 0 && config_.slice_orientation == "XZ") {
-                    float progress = fmod(elapsed_seconds, config_.animation_duration) / config_.animation_duration * 100.0f;
-                    BLUSTREAM_LOG_INFO("Vertical section animation: " + std::to_string(static_cast<int>(progress)) + "% through Y-axis");
-                }
-            } else {
-                // Legacy static slice rendering
-                slice_rgb = vds_manager_->get_slice_rgb(current_slice_axis_, current_slice_index_);
-                
-                // Get slice dimensions using legacy method
-                switch (current_slice_axis_) {
-                    case 0: // YZ plane
-                        slice_width = vds_manager_->get_height();
-                        slice_height = vds_manager_->get_depth();
-                        break;
-                    case 1: // XZ plane
-                        slice_width = vds_manager_->get_width();
-                        slice_height = vds_manager_->get_depth();
-                        break;
-                    case 2: // XY plane
-                    default:
-                        slice_width = vds_manager_->get_width();
-                        slice_height = vds_manager_->get_height();
-                        break;
-                }
-            }
-            frame_count++;
-            if (!slice_rgb.empty()) {
-                
-                // Scale to render size
-                rgb_frame.resize(config_.render_width * config_.render_height * 3);
-                
-                // Simple nearest neighbor scaling
-                for (int y = 0; y < config_.render_height; y++) {
-                    for (int x = 0; x < config_.render_width; x++) {
-                        int src_x = (x * slice_width) / config_.render_width;
-                        int src_y = (y * slice_height) / config_.render_height;
-                        int src_idx = (src_y * slice_width + src_x) * 3;
-                        int dst_idx = (y * config_.render_width + x) * 3;
-                        
-                        if (src_idx + 2 < slice_rgb.size()) {
-                            rgb_frame[dst_idx + 0] = slice_rgb[src_idx + 0];
-                            rgb_frame[dst_idx + 1] = slice_rgb[src_idx + 1];
-                            rgb_frame[dst_idx + 2] = slice_rgb[src_idx + 2];
-                        }
-                    }
-                }
-            } else {
-                rgb_frame = test_pattern;  // Fallback
-            }
+        PipelineFrame* frame = acquire_free_frame();
+        if (!frame) {
+            // Every frame is still queued downstream; skip this tick
+            frames_dropped_.add();
         } else {
-            // Generate test pattern
-            static int frame_counter = 0;
-            for (int y = 0; y < config_.render_height; y++) {
-                for (int x = 0; x < config_.render_width; x++) {
-                    int idx = (y * config_.render_width + x) * 3;
-                    // Animated gradient
-                    test_pattern[idx + 0] = (x + frame_counter) % 256;     // R
-                    test_pattern[idx + 1] = (y + frame_counter / 2) % 256; // G
-                    test_pattern[idx + 2] = (frame_counter) % 256;         // B
-                }
+            frame->render_start = render_start;
+            if (!render_pipeline_frame(*frame, axis, index)) {
+                frame->source = PipelineFrame::Source::NONE;  // Converted to black
+            }
+            frame->queued_at = std::chrono::steady_clock::now();
+            render_latency_.record(frame->queued_at - render_start);
+            trace_.record("render", render_start, frame->queued_at);
+            
+            // Never wait on the converter: if it is behind, its oldest frame goes
+            PipelineFrame* stale = nullptr;
+            if (rendered_frames_->push_evicting(frame, stale)) {
+                free_frames_.push_back(stale);
+                frames_dropped_.add();
             }
-            frame_counter++;
-            rgb_frame = test_pattern;
         }
         
         auto render_end = std::chrono::steady_clock::now();
         float render_ms = std::chrono::duration<float, std::milli>(render_end - render_start).count();
-        
-        // Encode and send frame
-        auto encode_start = std::chrono::steady_clock::now();
-        encode_and_send_frame(rgb_frame);
-        auto encode_end = std::chrono::steady_clock::now();
-        float encode_ms = std::chrono::duration<float, std::milli>(encode_end - encode_start).count();
-        
-        // Update statistics
-        update_stats(render_ms, encode_ms, 0);
+        update_stats(render_ms, last_encode_ms_);
         
         // Frame rate control
         next_frame_time_ += frame_duration_;
@@ -411,141 +665,332 @@ void StreamingServer::render_loop() {
     BLUSTREAM_LOG_INFO("Render loop stopped");
 }
 
-void StreamingServer::encode_and_send_frame(const std::vector<uint8_t>& rgb_data) {
-    // Convert RGB to YUV420
-    auto yuv_data = convert_rgb_to_yuv420(rgb_data);
+bool StreamingServer::should_render_view(int axis, int index) {
+    // Holding the previous colour map keeps a replacement from landing at
+    // the same address and passing for it
+    gated_colormap_ = vds_manager_->get_colormap();
+    
+    StillFrameGate::View view;
+    view.axis = axis;
+    view.index = index;
+    view.lod = current_lod_;
+    view.colormap = gated_colormap_.get();
+    view.width = config_.render_width;
+    view.height = config_.render_height;
+    
+    // A joining or resyncing client has asked for a keyframe; only a new
+    // frame can carry one
+    switch (still_gate_.update(view, force_keyframe_)) {
+        case StillFrameGate::Decision::RENDER:
+            return true;
+        case StillFrameGate::Decision::REFRESH:
+            request_keyframe();
+            return true;
+        case StillFrameGate::Decision::SKIP:
+        default:
+            return false;
+    }
+}
+
+bool StreamingServer::render_pipeline_frame(PipelineFrame& frame, int axis, int index) {
+    if (!vds_manager_ || !vds_manager_->has_vds()) {
+        // Generate test pattern
+        static int frame_counter = 0;
+        frame.source = PipelineFrame::Source::TEST_PATTERN;
+        frame.test_pattern_index = frame_counter++;
+        return true;
+    }
     
-    // Copy YUV data to frame
-    AVFrame* frame = av_frame_.get();
+    // Slice extraction is where brick cache misses show up
+    VDSManager::SliceBuffer& slice = config_.gpu_render ? slice_buffer_ : frame.slice;
+    auto fetch_start = std::chrono::steady_clock::now();
+    bool fetched = vds_manager_->get_slice(axis, index, slice, current_lod_);
+    auto fetch_end = std::chrono::steady_clock::now();
+    slice_fetch_latency_.record(fetch_end - fetch_start);
+    trace_.record("slice_fetch", fetch_start, fetch_end);
+    
+    if (!config_.gpu_render) {
+        // Extract in the native sample type; the convert stage maps and scales it
+        frame.source = PipelineFrame::Source::SLICE;
+        return fetched;
+    }
     
-    // Y plane
-    size_t y_size = config_.render_width * config_.render_height;
-    memcpy(frame->data[0], yuv_data.data(), y_size);
+    // The GL context lives on this thread, so the shader pass and readback happen here
+    auto colormap = vds_manager_->get_colormap();
+    if (!colormap || !fetched || !gl_context_->draw_slice(slice_buffer_, *colormap)) {
+        return false;
+    }
     
-    // U plane
-    size_t uv_size = y_size / 4;
-    memcpy(frame->data[1], yuv_data.data() + y_size, uv_size);
+    bool delivered = gl_context_->read_render_target([&](const uint8_t* rgb, int stride) {
+        frame.rgb.assign(rgb, rgb + static_cast<size_t>(stride) * gl_context_->get_render_height());
+        frame.rgb_stride = stride;
+    });
+    frame.source = PipelineFrame::Source::RGB;
+    return delivered;
+}
+
+void StreamingServer::convert_loop() {
+    BLUSTREAM_LOG_INFO("Convert loop started");
     
-    // V plane
-    memcpy(frame->data[2], yuv_data.data() + y_size + uv_size, uv_size);
+    while (running_) {
+        PipelineFrame* frame = nullptr;
+        if (!rendered_frames_->pop_wait(frame, std::chrono::milliseconds(50))) {
+            continue;
+        }
+        
+        auto convert_start = std::chrono::steady_clock::now();
+        convert_queue_latency_.record(convert_start - frame->queued_at);
+        if (!convert_pipeline_frame(*frame)) {
+            SliceCompositor::clear(frame_planes(frame->yuv.get()));  // Fallback
+        }
+        frame->queued_at = std::chrono::steady_clock::now();
+        convert_latency_.record(frame->queued_at - convert_start);
+        trace_.record("convert", convert_start, frame->queued_at);
+        
+        PipelineFrame* stale = nullptr;
+        if (converted_frames_->push_evicting(frame, stale)) {
+            dropped_frames_->try_push(stale);  // Sized for the whole pool, never full
+            frames_dropped_.add();
+        }
+    }
     
-    // Set frame PTS
-    static int64_t pts = 0;
-    frame->pts = pts++;
+    BLUSTREAM_LOG_INFO("Convert loop stopped");
+}
+
+bool StreamingServer::convert_pipeline_frame(PipelineFrame& frame) {
+    // The encoder may still reference this frame's buffers from its last trip
+    AVFrame* yuv = frame.yuv.get();
+    if (av_frame_make_writable(yuv) < 0) {
+        BLUSTREAM_LOG_ERROR("Failed to make encoder frame writable");
+        return false;
+    }
+    const YUV420Planes planes = frame_planes(yuv);
+    
+    switch (frame.source) {
+        case PipelineFrame::Source::TEST_PATTERN:
+            SliceCompositor::compose_test_pattern(frame.test_pattern_index, planes);
+            return true;
+            
+        case PipelineFrame::Source::SLICE: {
+            // Scale, colour map and convert in one pass
+            auto colormap = vds_manager_->get_colormap();
+            if (!colormap) {
+                return false;
+            }
+            compositor_.set_thread_pool(vds_manager_->get_worker_pool());
+            return compositor_.compose(frame.slice, *colormap, planes);
+        }
+            
+        case PipelineFrame::Source::RGB:
+            return readback_converter_.convert(frame.rgb.data(), frame.rgb_stride, planes);
+            
+        case PipelineFrame::Source::NONE:
+        default:
+            return false;
+    }
+}
+
+void StreamingServer::encode_loop() {
+    BLUSTREAM_LOG_INFO("Encode loop started");
+    
+    while (running_) {
+        PipelineFrame* frame = nullptr;
+        if (!converted_frames_->pop_wait(frame, std::chrono::milliseconds(50))) {
+            continue;
+        }
+        
+        auto encode_start = std::chrono::steady_clock::now();
+        encode_queue_latency_.record(encode_start - frame->queued_at);
+        encode_pipeline_frame(*frame);
+        auto encode_end = std::chrono::steady_clock::now();
+        encode_latency_.record(encode_end - encode_start);
+        trace_.record("encode", encode_start, encode_end);
+        last_encode_ms_ = std::chrono::duration<float, std::milli>(encode_end - encode_start).count();
+        
+        encoded_frames_->try_push(frame);  // Sized for the whole pool, never full
+    }
+    
+    BLUSTREAM_LOG_INFO("Encode loop stopped");
+}
+
+void StreamingServer::encode_pipeline_frame(PipelineFrame& frame) {
+    AVFrame* yuv = frame.yuv.get();
+    
+    // PTS follows the render clock: ticks skipped for a still slice or a
+    // halved frame rate leave gaps instead of speeding the stream up
+    const auto since_epoch = std::chrono::duration_cast<std::chrono::microseconds>(frame.render_start - pts_epoch_);
+    const int64_t pts = static_cast<int64_t>(since_epoch.count() * static_cast<double>(config_.target_fps) / 1000000.0 + 0.5);
+    last_pts_ = std::max(last_pts_ + 1, pts);
+    yuv->pts = last_pts_;
+    
+    // A dropped packet breaks the reference chain; restart it with an IDR
+    yuv->pict_type = force_keyframe_.exchange(false) ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+    
+    const int target_kbps = target_bitrate_kbps_;
+    if (target_kbps != applied_bitrate_kbps_) {
+        apply_encoder_bitrate(target_kbps);
+    }
     
     // Send frame to encoder
-    if (avcodec_send_frame(encoder_context_.get(), frame) < 0) {
-        BLUSTREAM_LOG_ERROR("Failed to send frame to encoder");
+    if (avcodec_send_frame(encoder_context_.get(), yuv) < 0) {
+        BLUSTREAM_LOG_EVERY_MS(ERROR, 1000, "Failed to send frame to encoder");
         return;
     }
     
     // Receive encoded packets
     AVPacket* pkt = av_packet_.get();
     while (avcodec_receive_packet(encoder_context_.get(), pkt) == 0) {
+        EncodedPacket* sent = nullptr;
+        while (sent_packets_->try_pop(sent)) {
+            free_packets_.push_back(sent);
+        }
+        if (free_packets_.empty()) {
+            BLUSTREAM_LOG_EVERY_MS(WARN, 1000, "Fanout behind, dropping packet and forcing a keyframe");
+            request_keyframe();
+            av_packet_unref(pkt);
+            frames_dropped_.add();
+            continue;
+        }
+        EncodedPacket* packet = free_packets_.back();
+        free_packets_.pop_back();
+        
         // Check if keyframe
         bool is_keyframe = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
         
-        // Create encoded frame data with proper H.264 headers
-        std::vector<uint8_t> encoded_data;
+        // Create encoded frame data with proper H.264 headers, straight into
+        // the buffer every client will share
+        packet->wire = packet_pool_.acquire();
+        std::vector<uint8_t>& encoded_data = packet->wire->payload;
         
-        // Prepend parameter sets to EVERY frame for maximum compatibility
-        // This ensures each frame can be decoded independently
-        {
-            static bool parameter_sets_logged = false;
-            
-            if (encoder_context_->extradata_size > 0) {
-                if (!parameter_sets_logged) {
-                    BLUSTREAM_LOG_INFO("✓ Encoder extradata available (" + std::to_string(encoder_context_->extradata_size) + " bytes)");
-                    parameter_sets_logged = true;
-                    
-                    // Log the extradata in hex for debugging
-                    std::string hex_data = "";
-                    for (int i = 0; i < std::min(32, encoder_context_->extradata_size); i++) {
-                        char buf[4];
-                        snprintf(buf, sizeof(buf), "%02x ", encoder_context_->extradata[i]);
-                        hex_data += buf;
-                    }
-                    BLUSTREAM_LOG_INFO("  Extradata: " + hex_data + "...");
-                }
-                
-                // Prepend extradata to ALL frames (keyframe and P-frames)
-                if (encoder_context_->extradata_size >= 4 && 
-                    encoder_context_->extradata[0] == 0x00 && 
-                    encoder_context_->extradata[1] == 0x00 && 
-                    encoder_context_->extradata[2] == 0x00 && 
-                    encoder_context_->extradata[3] == 0x01) {
-                    // Looks like Annex B format, prepend it to every frame
-                    encoded_data.insert(encoded_data.end(), 
-                                      encoder_context_->extradata, 
-                                      encoder_context_->extradata + encoder_context_->extradata_size);
-                    
-                    if (!parameter_sets_logged) {
-                        BLUSTREAM_LOG_INFO("  Will prepend Annex B extradata to ALL frames");
-                    }
-                }
-            }
+        // Keyframes lead with the cached SPS/PPS. Clients only ever start
+        // decoding at a keyframe (on join or after a resync), so P-frames
+        // don't need to repeat them
+        if (is_keyframe) {
+            encoded_data.insert(encoded_data.end(), parameter_sets_.begin(), parameter_sets_.end());
         }
         
         // Add the actual frame data
         encoded_data.insert(encoded_data.end(), pkt->data, pkt->data + pkt->size);
         
-        // Log packet details for debugging
-        static int packet_count = 0;
-        if (packet_count < 5) { // Only log first 5 packets
-            std::string packet_hex = "";
-            for (int i = 0; i < std::min(16, pkt->size); i++) {
-                char buf[4];
-                snprintf(buf, sizeof(buf), "%02x ", pkt->data[i]);
-                packet_hex += buf;
-            }
-            BLUSTREAM_LOG_INFO("Packet " + std::to_string(packet_count) + 
-                              " (keyframe=" + std::to_string(is_keyframe) + 
+        // Log the first few packets for debugging
+        BLUSTREAM_LOG_FIRST_N(DEBUG, 5, "Packet (keyframe=" + std::to_string(is_keyframe) + 
                               ", size=" + std::to_string(pkt->size) + 
-                              "): " + packet_hex + "...");
-            packet_count++;
-        }
+                              "): " + hex_prefix(pkt->data, static_cast<size_t>(pkt->size), 16) + "...");
         
-        // Broadcast to all clients
-        broadcast_frame(encoded_data, is_keyframe);
+        packet->wire->keyframe = is_keyframe;
+        packet->wire->droppable = h264_is_non_reference(pkt->data, static_cast<size_t>(pkt->size));
+        packet->wire->seal(common::MessageType::FRAME, packet_sequence_++);
+        packet->render_start = frame.render_start;
+        packet->queued_at = std::chrono::steady_clock::now();
         
-        // Update stats
-        stats_.frames_encoded++;
-        stats_.bytes_sent += pkt->size;
+        // Every free packet fits in the ring, so this only fails if the pool is misconfigured
+        if (!outgoing_packets_->try_push(packet)) {
+            packet->wire.reset();
+            free_packets_.push_back(packet);
+            request_keyframe();
+        }
         
         av_packet_unref(pkt);
     }
 }
 
-std::vector<uint8_t> StreamingServer::convert_rgb_to_yuv420(const std::vector<uint8_t>& rgb_data) {
-    int width = config_.render_width;
-    int height = config_.render_height;
-    size_t y_size = width * height;
-    size_t uv_size = y_size / 4;
+void StreamingServer::fanout_loop() {
+    BLUSTREAM_LOG_INFO("Fanout loop started");
+    
+    while (running_) {
+        EncodedPacket* packet = nullptr;
+        if (!outgoing_packets_->pop_wait(packet, std::chrono::milliseconds(50))) {
+            continue;
+        }
+        
+        // Broadcast to all clients
+        auto fanout_start = std::chrono::steady_clock::now();
+        fanout_queue_latency_.record(fanout_start - packet->queued_at);
+        const size_t payload_size = packet->wire->payload.size();
+        broadcast_frame(SharedPacket(std::move(packet->wire)));
+        auto fanout_end = std::chrono::steady_clock::now();
+        fanout_latency_.record(fanout_end - fanout_start);
+        end_to_end_latency_.record(fanout_end - packet->render_start);
+        trace_.record("fanout", fanout_start, fanout_end);
+        
+        frames_encoded_.add();
+        bytes_sent_.add(payload_size);
+        
+        sent_packets_->try_push(packet);  // Sized for the whole pool, never full
+        
+        if (config_.adaptive_bitrate) {
+            update_rate_control();
+        }
+    }
     
-    std::vector<uint8_t> yuv_data(y_size + uv_size * 2);
+    BLUSTREAM_LOG_INFO("Fanout loop stopped");
+}
+
+void StreamingServer::update_rate_control() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_rate_update_ < std::chrono::milliseconds(250)) {
+        return;
+    }
+    last_rate_update_ = now;
     
-    // Simple RGB to YUV420 conversion (not optimized)
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            int rgb_idx = (y * width + x) * 3;
-            uint8_t r = rgb_data[rgb_idx + 0];
-            uint8_t g = rgb_data[rgb_idx + 1];
-            uint8_t b = rgb_data[rgb_idx + 2];
-            
-            // Y component
-            int y_idx = y * width + x;
-            yuv_data[y_idx] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
-            
-            // U and V components (subsample 2x2)
-            if (x % 2 == 0 && y % 2 == 0) {
-                int uv_idx = (y / 2) * (width / 2) + (x / 2);
-                yuv_data[y_size + uv_idx] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
-                yuv_data[y_size + uv_size + uv_idx] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    // One encode feeds every client, so the slowest one sets the rate.
+    // Clients that never report (older builds) don't hold it back.
+    int estimate_kbps = 0;
+    bool congested = false;
+    uint32_t rtt_ms = 0;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        for (const auto& client : clients_) {
+            const BandwidthEstimator& bandwidth = client->bandwidth();
+            if (!client->is_connected() || !bandwidth.has_estimate()) {
+                continue;
             }
+            const int client_kbps = bandwidth.estimate_kbps();
+            if (estimate_kbps == 0 || client_kbps < estimate_kbps) {
+                estimate_kbps = client_kbps;
+                congested = bandwidth.last_usage() == BandwidthEstimator::Usage::OVERUSE;
+            }
+            rtt_ms = std::max(rtt_ms, bandwidth.rtt_ms());
         }
     }
+    if (estimate_kbps == 0) {
+        return;
+    }
+    
+    const int target_kbps = std::max(config_.min_bitrate_kbps, std::min(config_.max_bitrate_kbps, estimate_kbps));
+    target_bitrate_kbps_ = target_kbps;
+    
+    // Frame rate tier: at the floor and still congested, drop to half rate;
+    // come back once the estimate has clear headroom over the floor
+    int divisor = frame_rate_divisor_;
+    if (divisor == 1 && target_kbps <= config_.min_bitrate_kbps && congested) {
+        divisor = 2;
+    } else if (divisor > 1 && target_kbps >= config_.min_bitrate_kbps * 2) {
+        divisor = 1;
+    }
+    if (frame_rate_divisor_.exchange(divisor) != divisor) {
+        BLUSTREAM_LOG_INFO("Rate control: " + std::string(divisor > 1 ? "halving" : "restoring") +
+                          " frame rate at " + std::to_string(target_kbps) + " kbps (rtt " +
+                          std::to_string(rtt_ms) + " ms)");
+    }
     
-    return yuv_data;
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.target_bitrate_kbps = target_kbps;
+    stats_.network_rtt_ms = rtt_ms;
+    stats_.stream_fps = config_.target_fps / divisor;
+}
+
+void StreamingServer::apply_encoder_bitrate(int kbps) {
+    // libx264 and h264_nvenc compare these on every send_frame and
+    // reconfigure rate control in place; no IDR, no reopen
+    AVCodecContext* ctx = encoder_context_.get();
+    ctx->bit_rate = static_cast<int64_t>(kbps) * 1000;
+    ctx->rc_max_rate = ctx->bit_rate;
+    ctx->rc_buffer_size = kbps * config_.target_latency_ms;
+    
+    BLUSTREAM_LOG_DEBUG("Encoder bitrate " + std::to_string(applied_bitrate_kbps_) + " -> " +
+                       std::to_string(kbps) + " kbps");
+    applied_bitrate_kbps_ = kbps;
 }
 
 void StreamingServer::accept_clients_loop() {
@@ -566,80 +1011,270 @@ void StreamingServer::accept_clients_loop() {
         BLUSTREAM_LOG_INFO("New client connected from: " + client_addr);
         
         // Create client connection
-        auto client = std::make_shared<ClientConnection>(client_fd, client_addr);
+        BandwidthEstimator::Config rate_config;
+        rate_config.min_kbps = config_.min_bitrate_kbps;
+        rate_config.max_kbps = config_.max_bitrate_kbps;
+        rate_config.start_kbps = target_bitrate_kbps_;
+        rate_config.target_latency_ms = config_.target_latency_ms;
+        auto client = std::make_shared<ClientConnection>(client_fd, client_addr,
+                                                         static_cast<size_t>(config_.client_queue_packets),
+                                                         rate_config);
         
-        // Add to client list
-        {
-            std::lock_guard<std::mutex> lock(clients_mutex_);
-            clients_.push_back(client);
+        // Stream configuration goes first, queued ahead of any frame
+        common::StreamConfig stream_config;
+        stream_config.width = config_.render_width;
+        stream_config.height = config_.render_height;
+        stream_config.fps = config_.target_fps;
+        stream_config.codec = common::VideoCodec::H264;
+        stream_config.bitrate_kbps = config_.bitrate_kbps;
+        
+        auto config_packet = packet_pool_.acquire();
+        const auto* config_bytes = reinterpret_cast<const uint8_t*>(&stream_config);
+        config_packet->payload.assign(config_bytes, config_bytes + sizeof(stream_config));
+        config_packet->seal(common::MessageType::CONFIG);
+        client->send_frame(config_packet);
+        
+        if (!client_io_->add_client(client)) {
+            BLUSTREAM_LOG_ERROR("Failed to register client " + client_addr + " for I/O");
+            continue;
         }
         
-        // Start client thread
-        std::thread client_thread(&StreamingServer::handle_client, this, client_fd);
-        client_thread.detach();
+        join_client(client);
+        
+        // Start client thread; readers of clients that have left are joined first
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        reap_client_readers();
+        ClientReader reader;
+        reader.done = std::make_shared<std::atomic<bool>>(false);
+        reader.thread = std::thread([this, client, done = reader.done]() {
+            handle_client(client);
+            *done = true;
+        });
+        client_readers_.push_back(std::move(reader));
     }
     
     BLUSTREAM_LOG_INFO("Accept clients loop stopped");
 }
 
-void StreamingServer::handle_client(int client_fd) {
-    // Send initial configuration
-    common::MessageHeader header;
-    header.magic = 0x42535452;  // 'BSTR'
-    header.version = 1;
-    header.type = static_cast<uint32_t>(common::MessageType::CONFIG);
-    header.payload_size = sizeof(common::StreamConfig);
-    
-    common::StreamConfig stream_config;
-    stream_config.width = config_.render_width;
-    stream_config.height = config_.render_height;
-    stream_config.fps = config_.target_fps;
-    stream_config.codec = common::VideoCodec::H264;
-    stream_config.bitrate_kbps = config_.bitrate_kbps;
-    
-    send(client_fd, &header, sizeof(header), 0);
-    send(client_fd, &stream_config, sizeof(stream_config), 0);
+// Read exactly size bytes from a non-blocking client socket, giving up when
+// the peer goes away or the server stops
+static bool recv_exact(int socket_fd, void* buffer, size_t size, const std::atomic<bool>& running) {
+    auto* dst = static_cast<uint8_t*>(buffer);
+    size_t received = 0;
+    
+    while (received < size && running) {
+        pollfd pfd;
+        pfd.fd = socket_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        
+        int ready = poll(&pfd, 1, 100);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (ready == 0) {
+            continue;
+        }
+        if (!(pfd.revents & POLLIN)) {
+            return false;  // POLLERR / POLLHUP / POLLNVAL
+        }
+        
+        ssize_t n = recv(socket_fd, dst + received, size - received, 0);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
+            return false;
+        }
+        received += static_cast<size_t>(n);
+    }
     
-    // Client will be handled by broadcast_frame
+    return received == size;
 }
 
-void StreamingServer::broadcast_frame(const std::vector<uint8_t>& encoded_data, bool is_keyframe) {
-    std::lock_guard<std::mutex> lock(clients_mutex_);
+void StreamingServer::handle_client(std::shared_ptr<ClientConnection> client) {
+    // Configuration and frames go out through the client I/O pool; this
+    // thread only reads control messages and receiver reports. Holding the
+    // connection keeps the descriptor open until the reader is done.
+    const int client_fd = client->get_socket();
+    const uint32_t max_payload = 64 * 1024;
+    std::vector<uint8_t> payload;
     
-    // Remove disconnected clients
-    clients_.erase(
-        std::remove_if(clients_.begin(), clients_.end(),
-            [](const std::shared_ptr<ClientConnection>& client) {
-                return !client->is_connected();
-            }),
-        clients_.end()
-    );
+    while (running_) {
+        common::MessageHeader msg;
+        if (!recv_exact(client_fd, &msg, sizeof(msg), running_)) {
+            break;
+        }
+        
+        if (msg.magic != 0x42535452 || msg.payload_size > max_payload) {
+            BLUSTREAM_LOG_WARN("Invalid control message from client, closing reader");
+            break;
+        }
+        
+        payload.resize(msg.payload_size);
+        if (msg.payload_size > 0 && !recv_exact(client_fd, payload.data(), payload.size(), running_)) {
+            break;
+        }
+        
+        if (msg.type == static_cast<uint32_t>(common::MessageType::SLICE_CONTROL) &&
+            payload.size() == sizeof(common::SliceControlMessage)) {
+            common::SliceControlMessage control;
+            std::memcpy(&control, payload.data(), sizeof(control));
+            handle_slice_control(control);
+        } else if (msg.type == static_cast<uint32_t>(common::MessageType::METRICS_UPDATE) &&
+                   payload.size() == sizeof(common::ReceiverReport)) {
+            common::ReceiverReport report;
+            std::memcpy(&report, payload.data(), sizeof(report));
+            client->on_receiver_report(report);
+        }
+    }
+}
+
+void StreamingServer::reap_client_readers() {
+    // A finished reader has returned from handle_client(), so these joins don't wait
+    auto finished = std::partition(client_readers_.begin(), client_readers_.end(),
+                                   [](const ClientReader& reader) { return !*reader.done; });
+    for (auto it = finished; it != client_readers_.end(); ++it) {
+        it->thread.join();
+    }
+    client_readers_.erase(finished, client_readers_.end());
+}
+
+void StreamingServer::join_client(const std::shared_ptr<ClientConnection>& client) {
+    bool keyframe_needed = false;
+    {
+        // Under the same lock as broadcast, so no frame falls between the
+        // cached keyframe and the client's first live frame
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        if (keyframe_is_latest_ && latest_keyframe_) {
+            client->send_frame(latest_keyframe_);
+        } else {
+            keyframe_needed = true;
+        }
+        clients_.push_back(client);
+    }
     
-    // Send to all connected clients
-    for (auto& client : clients_) {
-        client->send_frame(encoded_data);
+    // Otherwise the client would sit out the rest of the GOP, up to
+    // keyframe_interval frames; one IDR serves everyone joining meanwhile
+    if (keyframe_needed) {
+        request_keyframe();
     }
+    client_io_->notify_pending();
 }
 
-void StreamingServer::update_stats(float render_ms, float encode_ms, size_t bytes_sent) {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
+void StreamingServer::broadcast_frame(const SharedPacket& packet) {
+    bool keyframe_needed = false;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        
+        if (packet->header.type == static_cast<uint32_t>(common::MessageType::FRAME)) {
+            if (packet->keyframe) {
+                latest_keyframe_ = packet;
+            }
+            keyframe_is_latest_ = packet->keyframe;
+        }
+        
+        // Remove disconnected clients
+        clients_.erase(
+            std::remove_if(clients_.begin(), clients_.end(),
+                [](const std::shared_ptr<ClientConnection>& client) {
+                    return !client->is_connected();
+                }),
+            clients_.end()
+        );
+        
+        // Every client queues a reference to the same buffer
+        for (auto& client : clients_) {
+            client->send_frame(packet);
+            if (client->take_keyframe_request()) {
+                BLUSTREAM_LOG_EVERY_MS(WARN, 1000, "Client " + client->get_info() + " fell behind, skipping to next keyframe");
+                keyframe_needed = true;
+            }
+        }
+    }
     
-    stats_.render_time_ms = render_ms;
-    stats_.encoding_time_ms = encode_ms;
-    stats_.frames_rendered++;
+    // Lagging clients resume at the next IDR, so don't make them wait a whole GOP
+    if (keyframe_needed) {
+        request_keyframe();
+    }
     
-    // Calculate FPS
-    auto now = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration<float>(now - stats_start_time_).count();
-    if (duration > 0) {
-        stats_.current_fps = stats_.frames_rendered / duration;
-        stats_.bitrate_mbps = (stats_.bytes_sent * 8.0f) / (duration * 1000000.0f);
+    if (client_io_) {
+        client_io_->notify_pending();
     }
 }
 
+void StreamingServer::broadcast_frame(std::shared_ptr<WirePacket> packet, bool is_keyframe) {
+    // Encoders outside the pipeline write into a packet from packet_pool_,
+    // so the frame is never copied on its way to the clients
+    packet->keyframe = is_keyframe;
+    packet->droppable = h264_is_non_reference(packet->payload.data(), packet->payload.size());
+    packet->seal(common::MessageType::FRAME, packet_sequence_++);
+    broadcast_frame(SharedPacket(std::move(packet)));
+}
+
+void StreamingServer::update_stats(float render_ms, float encode_ms) {
+    last_render_ms_.store(render_ms, std::memory_order_relaxed);
+    last_encode_ms_.store(encode_ms, std::memory_order_relaxed);
+    frames_rendered_.add();
+}
+
+void StreamingServer::register_gauges() {
+    metrics_.gauge("blustream_clients", "Connected clients", [this] {
+        return static_cast<double>(get_client_count());
+    });
+    metrics_.gauge("blustream_target_bitrate_kbps", "Bitrate the rate controller asks of the encoder", [this] {
+        return static_cast<double>(target_bitrate_kbps_.load());
+    });
+    metrics_.gauge("blustream_network_rtt_seconds", "Smoothed RTT of the slowest reporting client", [this] {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        return stats_.network_rtt_ms / 1000.0;
+    });
+}
+
 StreamingServer::Stats StreamingServer::get_stats() const {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    return stats_;
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats = stats_;
+    }
+    
+    stats.render_time_ms = last_render_ms_.load(std::memory_order_relaxed);
+    stats.encoding_time_ms = last_encode_ms_.load(std::memory_order_relaxed);
+    stats.frames_rendered = frames_rendered_.value();
+    stats.frames_encoded = frames_encoded_.value();
+    stats.frames_dropped = frames_dropped_.value();
+    stats.frames_unchanged = frames_unchanged_.value();
+    stats.bytes_sent = bytes_sent_.value();
+    
+    const float duration = std::chrono::duration<float>(std::chrono::steady_clock::now() - stats_start_time_).count();
+    if (duration > 0) {
+        stats.current_fps = stats.frames_rendered / duration;
+        stats.bitrate_mbps = (stats.bytes_sent * 8.0f) / (duration * 1000000.0f);
+    }
+    
+    if (vds_manager_) {
+        stats.slice_cache_hits = vds_manager_->get_slice_hits();
+        stats.slice_cache_misses = vds_manager_->get_slice_misses();
+    }
+    if (prefetcher_) {
+        auto prefetch_stats = prefetcher_->get_stats();
+        stats.slices_prefetched = prefetch_stats.slices_warmed;
+        stats.bricks_prefetched = prefetch_stats.bricks_loaded;
+    }
+    
+    auto latency = [](const LatencyHistogram& histogram) {
+        return Stats::StageLatency{histogram.percentile_ms(0.50), histogram.percentile_ms(0.99)};
+    };
+    stats.slice_fetch_latency = latency(slice_fetch_latency_);
+    stats.render_latency = latency(render_latency_);
+    stats.convert_latency = latency(convert_latency_);
+    stats.encode_latency = latency(encode_latency_);
+    stats.fanout_latency = latency(fanout_latency_);
+    stats.send_latency = latency(send_latency_);
+    stats.end_to_end_latency = latency(end_to_end_latency_);
+    return stats;
 }
 
 bool StreamingServer::load_vds(const std::string& path) {
@@ -649,10 +1284,25 @@ bool StreamingServer::load_vds(const std::string& path) {
     }
     
     BLUSTREAM_LOG_INFO("Loading VDS: " + path);
+    stop_brick_file_writer();
+    
+    // A current brick file skips HueSpace entirely
+    const std::string& brick_file = config_.vds_brick_file;
+    if (!brick_file.empty() && vds_manager_->load_brick_file(brick_file, path)) {
+        return true;
+    }
     
     // Try to load from file first
     if (vds_manager_->load_from_file(path)) {
         BLUSTREAM_LOG_INFO("Successfully loaded VDS from file: " + path);
+        
+        // Serve from HueSpace meanwhile; the next start maps the finished file
+        if (!brick_file.empty()) {
+            brick_file_running_ = true;
+            brick_file_thread_ = std::thread([this, brick_file]() {
+                vds_manager_->write_brick_file(brick_file, &brick_file_running_);
+            });
+        }
         return true;
     }
     
@@ -667,104 +1317,178 @@ bool StreamingServer::load_vds(const std::string& path) {
     return false;
 }
 
+void StreamingServer::stop_brick_file_writer() {
+    brick_file_running_ = false;
+    if (brick_file_thread_.joinable()) {
+        brick_file_thread_.join();
+    }
+}
+
 void StreamingServer::set_slice_params(int axis, int index) {
     current_slice_axis_ = axis;
     current_slice_index_ = index;
+    last_navigation_delta_ = 0;
+    animation_synced_ = false;
     BLUSTREAM_LOG_INFO("Slice params set: axis=" + std::to_string(axis) + 
                       ", index=" + std::to_string(index));
 }
 
-size_t StreamingServer::get_client_count() const {
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    return clients_.size();
+void StreamingServer::navigate_slice(int delta, bool wrap) {
+    const int length = vds_manager_ ? vds_manager_->get_axis_length(current_slice_axis_) : 0;
+    if (length <= 0) {
+        return;
+    }
+    
+    int index = current_slice_index_ + delta;
+    if (wrap) {
+        index = ((index % length) + length) % length;
+    } else {
+        index = std::max(0, std::min(index, length - 1));
+    }
+    current_slice_index_ = index;
+    
+    // Remember the step so the prefetcher keeps looking in the direction of travel
+    last_navigation_delta_ = delta;
+    last_navigation_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-// ClientConnection implementation
-ClientConnection::ClientConnection(int socket_fd, const std::string& address)
-    : socket_fd_(socket_fd)
-    , address_(address)
-    , connected_(true)
-    , bytes_sent_(0) {
-    
-    // Start send thread
-    send_thread_ = std::thread(&ClientConnection::send_loop, this);
+// Map protocol orientation onto the VDS axis held constant by the slice
+static int orientation_to_axis(common::SliceOrientation orientation) {
+    switch (orientation) {
+        case common::SliceOrientation::XLINE:  return 0;  // YZ plane
+        case common::SliceOrientation::ZSLICE: return 2;  // XY plane
+        case common::SliceOrientation::INLINE:
+        default:                               return 1;  // XZ plane
+    }
 }
 
-ClientConnection::~ClientConnection() {
-    disconnect();
-    
-    if (send_thread_.joinable()) {
-        send_thread_.join();
+void StreamingServer::handle_slice_control(const common::SliceControlMessage& control) {
+    switch (control.control_type) {
+        case common::SliceControlType::SET_SLICE:
+            animation_enabled_ = false;
+            set_slice_params(current_slice_axis_, static_cast<int>(control.slice_index));
+            navigate_slice(0);  // Clamp into the survey
+            break;
+            
+        case common::SliceControlType::NEXT_SLICE:
+            animation_enabled_ = false;
+            navigate_slice(1, control.auto_loop);
+            break;
+            
+        case common::SliceControlType::PREV_SLICE:
+            animation_enabled_ = false;
+            navigate_slice(-1, control.auto_loop);
+            break;
+            
+        case common::SliceControlType::SET_ORIENTATION:
+            set_slice_params(orientation_to_axis(control.orientation), current_slice_index_);
+            navigate_slice(0);
+            break;
+            
+        case common::SliceControlType::SET_PLAYBACK:
+            animation_enabled_ = control.playback_speed > 0.0f;
+            animation_synced_ = false;
+            break;
     }
 }
 
-bool ClientConnection::send_frame(const std::vector<uint8_t>& data) {
-    if (!connected_) {
+bool StreamingServer::render_current_slice(AVFrame* frame) {
+    if (config_.gpu_render) {
+        return render_slice_on_gpu(frame);
+    }
+    
+    int axis, index;
+    select_current_slice(axis, index);
+    
+    // Extract in the native sample type, then scale, colour map and convert in one pass
+    if (!vds_manager_->get_slice(axis, index, slice_buffer_, current_lod_)) {
         return false;
     }
     
-    // Add to send queue
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        send_queue_.push(data);
+    auto colormap = vds_manager_->get_colormap();
+    if (!colormap) {
+        return false;
+    }
+    compositor_.set_thread_pool(vds_manager_->get_worker_pool());
+    return compositor_.compose(slice_buffer_, *colormap, frame_planes(frame));
+}
+
+bool StreamingServer::render_slice_on_gpu(AVFrame* frame) {
+    int axis, index;
+    select_current_slice(axis, index);
+    
+    // Only the native slice is uploaded; scaling and colour mapping run in the shader
+    auto colormap = vds_manager_->get_colormap();
+    if (!colormap || !vds_manager_->get_slice(axis, index, slice_buffer_, current_lod_) ||
+        !gl_context_->draw_slice(slice_buffer_, *colormap)) {
+        return false;
     }
-    queue_cv_.notify_one();
     
-    return true;
+    // The readback handed over is the previous frame's, already off the GPU
+    bool converted = false;
+    gl_context_->read_render_target([&](const uint8_t* rgb, int stride) {
+        converted = readback_converter_.convert(rgb, stride, frame_planes(frame));
+    });
+    return converted;
 }
 
-void ClientConnection::send_loop() {
-    while (connected_) {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        queue_cv_.wait(lock, [this] { return !send_queue_.empty() || !connected_; });
+void StreamingServer::select_current_slice(int& axis, int& index) {
+    axis = current_slice_axis_;
+    const int length = vds_manager_->get_axis_length(axis);
+    auto now = std::chrono::steady_clock::now();
+    
+    float velocity = 0.0f;  // Slices per frame
+    
+    if (animation_enabled_) {
+        // Resume from the slice on screen instead of jumping to wherever the clock points
+        if (!animation_synced_.exchange(true)) {
+            float progress = length > 1 ? static_cast<float>(current_slice_index_) / (length - 1) : 0.0f;
+            animation_start_time_ = now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<float>(progress * config_.animation_duration));
+        }
         
-        if (!connected_) {
-            break;
+        // Time-based animated slice rendering for seismic wiggles
+        float elapsed_seconds = std::chrono::duration<float>(now - animation_start_time_).count();
+        index = vds_manager_->get_animated_slice_index(axis, elapsed_seconds, config_.animation_duration);
+        current_slice_index_ = index;
+        
+        if (config_.animation_duration > 0.0f && config_.target_fps > 0.0f) {
+            velocity = (length - 1) / (config_.animation_duration * config_.target_fps);
         }
         
-        if (!send_queue_.empty()) {
-            auto data = send_queue_.front();
-            send_queue_.pop();
-            lock.unlock();
-            
-            // Send frame header
-            common::MessageHeader header;
-            header.magic = 0x42535452;
-            header.version = 1;
-            header.type = static_cast<uint32_t>(common::MessageType::FRAME);
-            header.payload_size = data.size();
-            header.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::steady_clock::now().time_since_epoch()).count();
-            
-            if (send(socket_fd_, &header, sizeof(header), MSG_NOSIGNAL) < 0) {
-                connected_ = false;
-                break;
-            }
-            
-            // Send frame data
-            if (send(socket_fd_, data.data(), data.size(), MSG_NOSIGNAL) < 0) {
-                connected_ = false;
-                break;
-            }
-            
-            bytes_sent_ += sizeof(header) + data.size();
+        // Log progress occasionally for vertical sections (XZ)
+        if (axis == 1) {
+            BLUSTREAM_LOG_EVERY_MS(DEBUG, 1000, "Vertical section animation: " +
+                std::to_string(static_cast<int>(fmod(elapsed_seconds, config_.animation_duration) /
+                                                config_.animation_duration * 100.0f)) + "% through Y-axis");
+        }
+    } else {
+        index = current_slice_index_;
+        
+        // Held NEXT/PREV keys arrive roughly once per frame; treat the last step
+        // as the velocity until navigation has been idle for half a second
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+        if (now_ms - last_navigation_ms_ < 500) {
+            velocity = static_cast<float>(last_navigation_delta_);
         }
     }
-}
-
-void ClientConnection::disconnect() {
-    connected_ = false;
-    queue_cv_.notify_one();
     
-    if (socket_fd_ >= 0) {
-        close(socket_fd_);
-        socket_fd_ = -1;
+    // Coarse while scrubbing or when the output is smaller than the slice;
+    // full resolution returns as soon as the cursor stops
+    current_lod_ = vds_manager_->select_lod(axis, config_.render_width, config_.render_height, velocity);
+    
+    // Let the prefetcher run ahead while this frame copies out its slice
+    if (prefetcher_) {
+        prefetcher_->update(axis, index, velocity, current_lod_);
     }
 }
 
-std::string ClientConnection::get_info() const {
-    return address_ + " (sent: " + std::to_string(bytes_sent_ / 1024) + " KB)";
+size_t StreamingServer::get_client_count() const {
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    return clients_.size();
 }
 
+// ClientConnection implementation
 } // namespace server
 } // namespace blustream
\ No newline at end of file
@@ -50,10 +50,7 @@ public:
         bool enable_async_encoding = true; // Async encoder pipeline
         int encoder_threads = 2;           // Number of encoder threads
         
-        // Adaptive quality settings
-        bool enable_adaptive_bitrate = true;
-        int min_bitrate_kbps = 1000;
-        int max_bitrate_kbps = 10000;
+        // Adaptive quality settings (bitrate limits are in the base Config)
         float quality_scale_factor = 1.0f;
     };
     
@@ -71,7 +68,10 @@ private:
     
     // Enhanced encoding pipeline
     void enhanced_render_loop();
-    void hardware_encode_and_send_frame(const std::vector<uint8_t>& rgb_data);
+    bool render_current_slice_to_texture();
+    void request_keyframe() override;
+    void hardware_encode_and_send_frame();
+    std::vector<uint8_t> slice_rgb_;  // Slice-sized colour-mapped image for the GPU path
     
     // Performance monitoring
     void monitor_performance();
@@ -117,12 +117,15 @@ bool HardwareStreamingServer::initialize_hardware(const HardwareConfig& config)
     encoder_config.height = config.render_height;
     encoder_config.fps = static_cast<int>(config.target_fps);
     encoder_config.bitrate_kbps = config.bitrate_kbps;
-    encoder_config.max_bitrate_kbps = config.max_bitrate_kbps;
+    encoder_config.max_bitrate_kbps = config_.max_bitrate_kbps;  // Defaulted by initialize()
     encoder_config.keyframe_interval = config.keyframe_interval;
     encoder_config.rate_control = config.rate_control;
+    encoder_config.target_latency_ms = config_.target_latency_ms;
     encoder_config.use_zero_copy = config.enable_zero_copy;
     encoder_config.enable_b_frames = false;  // Disable for low latency
     encoder_config.async_depth = config.encoder_threads;
+    encoder_config.slices_per_frame = config.slices_per_frame;
+    encoder_config.intra_refresh = config.intra_refresh;
     
     // Initialize hardware encoder
     if (!hardware_encoder_->initialize(encoder_config)) {
@@ -130,6 +133,28 @@ bool HardwareStreamingServer::initialize_hardware(const HardwareConfig& config)
         return false;
     }
     
+    // Zero-copy needs somewhere on the GPU to render frames into
+    if (hardware_encoder_->is_zero_copy_active()) {
+        bool target_ready = gl_context_ && gl_context_->make_current() &&
+                            gl_context_->create_render_target(config.render_width, config.render_height);
+        if (target_ready && !gl_context_->create_slice_renderer()) {
+            BLUSTREAM_LOG_WARN("No slice shader, zero-copy frames are colour mapped on the CPU");
+        }
+        if (gl_context_) {
+            gl_context_->release_context();  // The render thread takes it over
+        }
+        
+        if (!target_ready) {
+            BLUSTREAM_LOG_WARN("No GL render target for zero-copy, reopening encoder with system-memory frames");
+            hardware_encoder_->shutdown();
+            encoder_config.use_zero_copy = false;
+            if (!hardware_encoder_->initialize(encoder_config)) {
+                BLUSTREAM_LOG_ERROR("Failed to initialize hardware encoder");
+                return false;
+            }
+        }
+    }
+    
     BLUSTREAM_LOG_INFO("✓ Hardware encoder initialized: " + hardware_encoder_->get_encoder_name());
     BLUSTREAM_LOG_INFO("✓ Hardware acceleration: " + 
                       (hardware_encoder_->supports_hardware_acceleration() ? "ENABLED" : "DISABLED"));
@@ -143,22 +168,31 @@ void HardwareStreamingServer::enhanced_render_loop() {
     next_frame_time_ = std::chrono::steady_clock::now();
     animation_start_time_ = next_frame_time_;
     
+    const bool zero_copy = hardware_encoder_ && hardware_encoder_->is_zero_copy_active();
+    if (zero_copy && !gl_context_->make_current()) {
+        BLUSTREAM_LOG_ERROR("Failed to make OpenGL context current for zero-copy rendering");
+        return;
+    }
+    
     while (running_) {
         auto frame_start = std::chrono::steady_clock::now();
         
         // Wait for next frame time
         std::this_thread::sleep_until(next_frame_time_);
         
-        // Calculate animation time for slice progression
-        auto animation_elapsed = std::chrono::duration<float>(frame_start - animation_start_time_).count();
-        
-        // Get VDS slice data based on animation time
-        auto slice_data = vds_manager_->get_animated_slice_rgb(config_.slice_orientation, 
-                                                              animation_elapsed, 
-                                                              config_.animation_duration);
+        // Render the current cursor's slice (animated or navigated) into the GL
+        // render target for zero-copy, or straight into the encoder's input
+        // planes otherwise; both hand the cursor to the prefetcher
+        bool rendered;
+        if (zero_copy) {
+            rendered = render_current_slice_to_texture();
+        } else {
+            AVFrame* input_frame = hardware_encoder_ ? hardware_encoder_->get_input_frame() : nullptr;
+            rendered = input_frame && render_current_slice(input_frame);
+        }
         
-        if (slice_data.empty()) {
-            BLUSTREAM_LOG_WARN("Empty slice data received");
+        if (!rendered) {
+            BLUSTREAM_LOG_WARN("Failed to render slice into encoder frame");
             next_frame_time_ += frame_duration_;
             continue;
         }
@@ -167,16 +201,16 @@ void HardwareStreamingServer::enhanced_render_loop() {
         float render_time_ms = std::chrono::duration<float, std::milli>(render_end - frame_start).count();
         
         // Hardware encode and send frame
-        hardware_encode_and_send_frame(slice_data);
+        hardware_encode_and_send_frame();
         
         auto encode_end = std::chrono::steady_clock::now();
         float encode_time_ms = std::chrono::duration<float, std::milli>(encode_end - render_end).count();
         
         // Update statistics
-        update_stats(render_time_ms, encode_time_ms, 0);  // bytes_sent updated in broadcast
+        update_stats(render_time_ms, encode_time_ms);
         
         // Performance monitoring
-        if (hw_config_.enable_adaptive_bitrate) {
+        if (hw_config_.adaptive_bitrate) {
             adjust_encoder_quality();
         }
         
@@ -190,17 +224,40 @@ void HardwareStreamingServer::enhanced_render_loop() {
             if (frames_behind > 2) {
                 BLUSTREAM_LOG_WARN("Dropping " + std::to_string(frames_behind) + " frames due to performance");
                 next_frame_time_ = now;
-                stats_.frames_dropped += frames_behind;
+                frames_dropped_.add(static_cast<uint64_t>(frames_behind));
             }
         }
-        
-        stats_.frames_rendered++;
     }
     
     BLUSTREAM_LOG_INFO("Enhanced render loop stopped");
 }
 
-void HardwareStreamingServer::hardware_encode_and_send_frame(const std::vector<uint8_t>& rgb_data) {
+bool HardwareStreamingServer::render_current_slice_to_texture() {
+    int axis, index;
+    select_current_slice(axis, index);
+    
+    // Only the native slice is uploaded; the shader scales and colour maps it
+    if (gl_context_->has_slice_renderer()) {
+        auto colormap = vds_manager_->get_colormap();
+        return colormap && vds_manager_->get_slice(axis, index, slice_buffer_, current_lod_) &&
+               gl_context_->draw_slice(slice_buffer_, *colormap);
+    }
+    
+    // Without shaders the slice is colour mapped on the CPU and blitted up
+    if (!vds_manager_->get_slice_rgb(axis, index, slice_buffer_, slice_rgb_, current_lod_)) {
+        return false;
+    }
+    return gl_context_->draw_rgb_image(slice_rgb_.data(), slice_buffer_.width, slice_buffer_.height, true);
+}
+
+void HardwareStreamingServer::request_keyframe() {
+    StreamingServer::request_keyframe();
+    if (hardware_encoder_) {
+        hardware_encoder_->request_keyframe();
+    }
+}
+
+void HardwareStreamingServer::hardware_encode_and_send_frame() {
     if (!hardware_encoder_) {
         BLUSTREAM_LOG_ERROR("Hardware encoder not initialized");
         return;
@@ -208,24 +265,31 @@ void HardwareStreamingServer::hardware_encode_and_send_frame(const std::vector<u
     
     auto encode_start = std::chrono::steady_clock::now();
     
-    // Hardware encode frame
-    std::vector<uint8_t> encoded_data = hardware_encoder_->encode_frame(rgb_data);
+    // Hardware encode straight into a pooled packet, the buffer every client shares
+    auto packet = packet_pool_.acquire();
+    bool produced = hardware_encoder_->is_zero_copy_active()
+        ? hardware_encoder_->encode_from_texture(gl_context_->get_render_texture(), packet->payload)
+        : hardware_encoder_->encode_input_frame(packet->payload);
     
     auto encode_end = std::chrono::steady_clock::now();
     float encode_time_ms = std::chrono::duration<float, std::milli>(encode_end - encode_start).count();
     
-    if (encoded_data.empty()) {
+    if (!produced) {
         // Some encoders may not produce output for every input (B-frames, etc.)
         return;
     }
     
-    // Determine if this is a keyframe (simplified detection)
-    bool is_keyframe = (stats_.frames_encoded % config_.keyframe_interval == 0);
-    
-    // Broadcast to all connected clients
-    broadcast_frame(encoded_data, is_keyframe);
-    
-    stats_.frames_encoded++;
+    // Broadcast to all connected clients, then whatever else the encoder
+    // had ready so a pipelined encoder never accumulates frames
+    while (produced) {
+        bool is_keyframe = hardware_encoder_->last_frame_was_keyframe();
+        bytes_sent_.add(packet->payload.size());
+        broadcast_frame(std::move(packet), is_keyframe);
+        frames_encoded_.add();
+        
+        packet = packet_pool_.acquire();
+        produced = hardware_encoder_->receive_packet(packet->payload);
+    }
     
     // Log performance periodically
     static auto last_log = std::chrono::steady_clock::now();
@@ -237,12 +301,16 @@ void HardwareStreamingServer::hardware_encode_and_send_frame(const std::vector<u
         BLUSTREAM_LOG_INFO("  Min/Max: " + std::to_string(hw_stats.min_encode_time_ms) + 
                           "/" + std::to_string(hw_stats.max_encode_time_ms) + "ms");
         BLUSTREAM_LOG_INFO("  Frames encoded: " + std::to_string(hw_stats.frames_encoded));
-        BLUSTREAM_LOG_INFO("  Current FPS: " + std::to_string(stats_.current_fps));
+        BLUSTREAM_LOG_INFO("  Current FPS: " + std::to_string(get_stats().current_fps));
         last_log = now;
     }
 }
 
 void HardwareStreamingServer::adjust_encoder_quality() {
+    // Bitrate follows the client-driven target every frame; the encoder
+    // only reconfigures when it actually changes
+    hardware_encoder_->set_bitrate(target_bitrate_kbps_);
+    
     auto now = std::chrono::steady_clock::now();
     
     // Only adjust every 2 seconds
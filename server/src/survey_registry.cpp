@@ -0,0 +1,194 @@
+#include "blustream/server/survey_registry.h"
+#include "blustream/common/logger.h"
+
+#include <algorithm>
+
+namespace blustream {
+namespace server {
+
+size_t SurveyRegistry::OpenSet::share_mb() const {
+    return std::max(min_budget_mb, budget_mb / std::max<size_t>(1, surveys.size()));
+}
+
+void SurveyRegistry::OpenSet::rebalance() {
+    const size_t share = share_mb();
+    for (VDSManager* survey : surveys) {
+        survey->set_cache_budget(share);
+    }
+}
+
+SurveyRegistry::SurveyRegistry(const Config& config)
+    : config_(config)
+    , open_(std::make_shared<OpenSet>())
+    , running_(true) {
+    open_->budget_mb = config_.budget_mb;
+    open_->min_budget_mb = config_.min_survey_budget_mb;
+}
+
+SurveyRegistry::~SurveyRegistry() {
+    running_ = false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& item : entries_) {
+        if (item.second->brick_file_writer.joinable()) {
+            item.second->brick_file_writer.join();
+        }
+    }
+}
+
+bool SurveyRegistry::add_survey(const std::string& id, const std::string& path) {
+    if (id.empty()) {
+        BLUSTREAM_LOG_ERROR("Survey ID must not be empty");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = entries_[id];
+    if (!entry) {
+        entry = std::make_unique<Entry>();
+    }
+    entry->path = path;
+    BLUSTREAM_LOG_INFO("Registered survey '" + id + "': " + (path.empty() ? "noise volume" : path));
+    return true;
+}
+
+bool SurveyRegistry::has_survey(const std::string& id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.count(id) != 0;
+}
+
+std::vector<std::string> SurveyRegistry::survey_ids() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> ids;
+    ids.reserve(entries_.size());
+    for (const auto& item : entries_) {
+        ids.push_back(item.first);
+    }
+    return ids;
+}
+
+size_t SurveyRegistry::open_count() const {
+    std::lock_guard<std::mutex> lock(open_->mutex);
+    return open_->surveys.size();
+}
+
+std::string SurveyRegistry::brick_file_path(const std::string& id) const {
+    if (config_.brick_file_dir.empty()) {
+        return "";
+    }
+    return config_.brick_file_dir + "/" + id + ".blsb";
+}
+
+std::shared_ptr<const VDSManager> SurveyRegistry::acquire(const std::string& id) {
+    Entry* entry = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(id);
+        if (it == entries_.end()) {
+            BLUSTREAM_LOG_WARN("Unknown survey '" + id + "'");
+            return nullptr;
+        }
+        entry = it->second.get();
+    }
+
+    // Loading holds only this survey's lock, so other surveys stay available
+    std::lock_guard<std::mutex> open_lock(entry->open_mutex);
+    if (auto survey = entry->survey.lock()) {
+        return survey;
+    }
+    if (!running_) {
+        return nullptr;
+    }
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        path = entry->path;
+    }
+
+    // A finished writer from an earlier open may still need joining
+    if (entry->brick_file_writer.joinable()) {
+        entry->brick_file_writer.join();
+    }
+
+    size_t budget_mb;
+    {
+        std::lock_guard<std::mutex> lock(open_->mutex);
+        budget_mb = std::max(open_->min_budget_mb, open_->budget_mb / (open_->surveys.size() + 1));
+    }
+
+    bool from_brick_file = false;
+    std::unique_ptr<VDSManager> manager = open_survey(id, path, budget_mb, from_brick_file);
+    if (!manager) {
+        return nullptr;
+    }
+
+    // Closing hands the survey's share back to the others
+    std::shared_ptr<OpenSet> open_set = open_;
+    VDSManager* raw = manager.release();
+    std::shared_ptr<const VDSManager> survey(raw, [open_set](const VDSManager* closing) {
+        {
+            std::lock_guard<std::mutex> lock(open_set->mutex);
+            auto& surveys = open_set->surveys;
+            surveys.erase(std::remove(surveys.begin(), surveys.end(), closing), surveys.end());
+            open_set->rebalance();
+        }
+        delete closing;
+    });
+    {
+        std::lock_guard<std::mutex> lock(open_->mutex);
+        open_->surveys.push_back(raw);
+        open_->rebalance();
+        BLUSTREAM_LOG_INFO("Opened survey '" + id + "' (" + std::to_string(open_->surveys.size()) +
+                          " open, " + std::to_string(open_->share_mb()) + " MB each)");
+    }
+    entry->survey = survey;
+
+    // Serve from HueSpace meanwhile; later opens, here or in another process, map the file
+    const std::string brick_file = brick_file_path(id);
+    if (!from_brick_file && !brick_file.empty() && !path.empty()) {
+        entry->brick_file_writer = std::thread([this, survey, brick_file]() {
+            survey->write_brick_file(brick_file, &running_);
+        });
+    }
+    return survey;
+}
+
+std::unique_ptr<VDSManager> SurveyRegistry::open_survey(const std::string& id, const std::string& path,
+                                                        size_t budget_mb, bool& from_brick_file) const {
+    auto manager = std::make_unique<VDSManager>();
+    if (!manager->initialize()) {
+        BLUSTREAM_LOG_ERROR("Failed to initialize VDS manager for survey '" + id + "'");
+        return nullptr;
+    }
+
+    VDSManager::CacheConfig cache_config = config_.cache;
+    cache_config.budget_mb = budget_mb;
+    manager->set_cache_config(cache_config);
+    manager->set_colormap(config_.colormap);
+    manager->set_clip_percentiles(config_.clip_low_percentile, config_.clip_high_percentile);
+
+    // No path is a development survey
+    if (path.empty()) {
+        if (manager->create_noise_volume(128, 128, 128, 0.05f)) {
+            return manager;
+        }
+        BLUSTREAM_LOG_ERROR("Failed to create noise volume for survey '" + id + "'");
+        return nullptr;
+    }
+
+    // A current brick file skips HueSpace entirely
+    const std::string brick_file = brick_file_path(id);
+    if (!brick_file.empty() && manager->load_brick_file(brick_file, path)) {
+        from_brick_file = true;
+        return manager;
+    }
+
+    if (!manager->load_from_file(path)) {
+        BLUSTREAM_LOG_ERROR("Failed to load survey '" + id + "' from " + path);
+        return nullptr;
+    }
+    return manager;
+}
+
+} // namespace server
+} // namespace blustream
@@ -49,6 +49,7 @@ void benchmark_encoder(HardwareEncoder& encoder, int width, int height, int num_
     
     std::vector<float> encode_times;
     std::vector<size_t> frame_sizes;
+    std::vector<uint8_t> encoded_data;
     
     auto benchmark_start = std::chrono::steady_clock::now();
     
@@ -56,7 +57,7 @@ void benchmark_encoder(HardwareEncoder& encoder, int width, int height, int num_
         auto frame_start = std::chrono::steady_clock::now();
         
         // Encode frame
-        auto encoded_data = encoder.encode_frame(test_frame);
+        encoder.encode_frame(test_frame.data(), test_frame.size(), encoded_data);
         
         auto frame_end = std::chrono::steady_clock::now();
         float encode_time_ms = std::chrono::duration<float, std::milli>(frame_end - frame_start).count();
@@ -0,0 +1,129 @@
+#include "blustream/server/thread_pool.h"
+
+#include <algorithm>
+
+namespace blustream {
+namespace server {
+
+ThreadPool::ThreadPool(size_t num_threads)
+    : stopping_(false)
+    , generation_(0)
+    , active_workers_(0)
+    , job_(nullptr)
+    , job_count_(0)
+    , job_chunk_(1)
+    , job_chunks_(0)
+    , next_chunk_(0)
+    , completed_chunks_(0) {
+
+    if (num_threads == 0) {
+        unsigned int hw = std::thread::hardware_concurrency();
+        num_threads = hw > 1 ? hw - 1 : 0;
+    }
+
+    workers_.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++) {
+        workers_.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t, size_t)>& fn, size_t min_chunk) {
+    if (count == 0) {
+        return;
+    }
+
+    // Aim for a few chunks per thread so uneven rows still balance out
+    const size_t target_chunks = concurrency() * 4;
+    const size_t chunk = std::max(std::max<size_t>(min_chunk, 1), (count + target_chunks - 1) / target_chunks);
+
+    if (workers_.empty() || chunk >= count) {
+        fn(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> call_lock(call_mutex_);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &fn;
+        job_count_ = count;
+        job_chunk_ = chunk;
+        job_chunks_ = (count + chunk - 1) / chunk;
+        next_chunk_ = 0;
+        completed_chunks_ = 0;
+        generation_++;
+    }
+    work_cv_.notify_all();
+
+    run_chunks();
+
+    // Wait for the last chunk and for every worker to let go of the job,
+    // so a straggler can never pick up chunks of the next loop with this fn
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] {
+        return completed_chunks_ == job_chunks_ && active_workers_ == 0;
+    });
+    job_ = nullptr;
+}
+
+void ThreadPool::run_chunks() {
+    for (;;) {
+        const size_t chunk_index = next_chunk_.fetch_add(1);
+        if (chunk_index >= job_chunks_) {
+            break;
+        }
+
+        const size_t begin = chunk_index * job_chunk_;
+        const size_t end = std::min(begin + job_chunk_, job_count_);
+        (*job_)(begin, end);
+
+        if (completed_chunks_.fetch_add(1) + 1 == job_chunks_) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_cv_.notify_all();
+        }
+    }
+}
+
+void ThreadPool::worker_loop() {
+    uint64_t seen_generation = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this, seen_generation] {
+                return stopping_ || (generation_ != seen_generation && job_ != nullptr);
+            });
+            if (stopping_) {
+                return;
+            }
+
+            seen_generation = generation_;
+            active_workers_++;
+        }
+
+        run_chunks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            active_workers_--;
+        }
+        done_cv_.notify_all();
+    }
+}
+
+} // namespace server
+} // namespace blustream
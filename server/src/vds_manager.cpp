@@ -1,4 +1,6 @@
 #include "blustream/server/vds_manager.h"
+#include "blustream/server/thread_pool.h"
+#include "blustream/server/brick_file.h"
 #include "blustream/common/logger.h"
 #include <iostream>
 #include <algorithm>
@@ -6,7 +8,8 @@
 #include <random>
 #include <thread>
 #include <limits>
-#include <algorithm>
+#include <cstring>
+#include <type_traits>
 
 // HueSpace includes - based on the sample code provided
 #include <HueSpace3/ProxyInterfaceFactory.h>
@@ -30,12 +33,28 @@ namespace server {
 
 VDSManager::VDSManager() 
     : proxy_interface_(nullptr)
-    , current_vds_(nullptr) {
+    , current_vds_(nullptr)
+    , vds_layout_(nullptr)
+    , noise_scale_(1.0f)
+    , slice_hits_(0)
+    , slice_misses_(0)
+    , colormap_type_(ColorMap::Type::SEISMIC_GRAY)
+    , brick_count_(0)
+    , histogram_checked_(0)
+    , clip_low_(1.0f)
+    , clip_high_(99.0f)
+    , display_min_(0.0f)
+    , display_max_(1.0f) {
     vds_data_.width = 0;
     vds_data_.height = 0;
     vds_data_.depth = 0;
     vds_data_.min_value = 0.0f;
     vds_data_.max_value = 1.0f;
+    vds_data_.format = SampleFormat::F32;
+    vds_data_.scale = 1.0f;
+    vds_data_.offset = 0.0f;
+    
+    rebuild_colormap();
 }
 
 VDSManager::~VDSManager() {
@@ -85,7 +104,11 @@ void VDSManager::shutdown() {
         proxy_interface_ = nullptr;
     }
     
-    vds_data_.data.clear();
+    vds_layout_ = nullptr;
+    brick_cache_.clear();
+    lod_caches_.clear();
+    source_loader_ = nullptr;
+    brick_file_.reset();
 }
 
 bool VDSManager::load_from_file(const std::string& file_path) {
@@ -116,6 +139,8 @@ bool VDSManager::load_from_file(const std::string& file_path) {
         
         // Store the VDS
         current_vds_ = static_cast<void*>(vds);
+        source_path_ = file_path;
+        brick_file_.reset();
         
         // Extract VDS dimensions and data
         if (!extract_vds_data()) {
@@ -145,33 +170,24 @@ bool VDSManager::create_noise_volume(int width, int height, int depth, float noi
     
     // Clear existing VDS
     current_vds_ = nullptr;
+    vds_layout_ = nullptr;
+    source_path_.clear();
+    brick_file_.reset();
     
-    // Create synthetic VDS data
     vds_data_.width = width;
     vds_data_.height = height;
     vds_data_.depth = depth;
-    vds_data_.data.resize(width * height * depth);
+    noise_scale_ = noise_scale;
     
-    float min_val = std::numeric_limits<float>::max();
-    float max_val = std::numeric_limits<float>::lowest();
+    // The octaves and jitter bound the noise, so the encoding range needs no
+    // pass over the volume; the display range follows the generated bricks
+    const float max_val = 0.5f + 0.25f + 0.125f + 0.05f;
+    const float min_val = -max_val;
     
-    // Generate 3D Perlin-like noise
-    for (int z = 0; z < depth; z++) {
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                float value = generate_noise_value(x, y, z, noise_scale);
-                
-                int index = z * (width * height) + y * width + x;
-                vds_data_.data[index] = value;
-                
-                min_val = std::min(min_val, value);
-                max_val = std::max(max_val, value);
-            }
-        }
-    }
+    // Bricks are quantized to the configured format as they are generated
+    set_sample_encoding(cache_config_.sample_format, min_val, max_val);
     
-    vds_data_.min_value = min_val;
-    vds_data_.max_value = max_val;
+    configure_brick_cache([this](BrickCache::Brick& brick) { return generate_noise_brick(brick); });
     
     BLUSTREAM_LOG_INFO("Synthetic noise volume created. Value range: " + 
                       std::to_string(min_val) + " to " + std::to_string(max_val));
@@ -182,156 +198,332 @@ bool VDSManager::create_noise_volume(int width, int height, int depth, float noi
     return true;
 }
 
-std::vector<float> VDSManager::get_slice_data(int axis, int index) const {
-    if (!has_vds()) {
-        return {};
-    }
-    
-    std::vector<float> slice_data;
+// Brick coordinates of the (a, b)-th brick in the layer a constant-axis slice cuts through
+static void slice_brick_coords(int axis, int layer, int a, int b, int& bx, int& by, int& bz) {
+    bx = axis == 0 ? layer : a;
+    by = axis == 1 ? layer : (axis == 0 ? a : b);
+    bz = axis == 2 ? layer : b;
+}
+
+// Copy the part of a constant-axis plane that falls inside one brick into the
+// output slice (row length h for YZ, w for XZ and XY), converting each sample
+template <typename T, typename Out, typename Convert>
+static void copy_brick_plane(const BrickCache::Brick& brick, int axis, int index, int w, int h,
+                             Out* out, Convert convert) {
+    const int sx = brick.size[0];
+    const int sy = brick.size[1];
+    const int sz = brick.size[2];
+    const T* samples = brick.samples_as<T>();
     
-    // If we have real VDS data loaded, use it
-    if (!vds_data_.data.empty()) {
-        // Extract from loaded VDS data
-        switch (axis) {
-            case 0: { // X-axis slice (YZ plane)
-                if (index < 0 || index >= vds_data_.width) return {};
-                slice_data.resize(vds_data_.height * vds_data_.depth);
-                
-                for (int z = 0; z < vds_data_.depth; z++) {
-                    for (int y = 0; y < vds_data_.height; y++) {
-                        int src_idx = z * (vds_data_.width * vds_data_.height) + y * vds_data_.width + index;
-                        int dst_idx = z * vds_data_.height + y;
-                        slice_data[dst_idx] = vds_data_.data[src_idx];
+    switch (axis) {
+        case 0: { // YZ plane: out[z * h + y]
+            const int lx = index - brick.origin[0];
+            if (!brick.crossline.empty()) {
+                // Transposed copy makes every z-row of the plane contiguous
+                const T* src_plane = brick.crossline_as<T>() + static_cast<size_t>(lx) * sz * sy;
+                for (int lz = 0; lz < sz; lz++) {
+                    const T* src = src_plane + static_cast<size_t>(lz) * sy;
+                    Out* dst = out + static_cast<size_t>(brick.origin[2] + lz) * h + brick.origin[1];
+                    for (int ly = 0; ly < sy; ly++) {
+                        dst[ly] = convert(src[ly]);
                     }
                 }
-                break;
-            }
-            
-            case 1: { // Y-axis slice (XZ plane)
-                if (index < 0 || index >= vds_data_.height) return {};
-                slice_data.resize(vds_data_.width * vds_data_.depth);
-                
-                for (int z = 0; z < vds_data_.depth; z++) {
-                    for (int x = 0; x < vds_data_.width; x++) {
-                        int src_idx = z * (vds_data_.width * vds_data_.height) + index * vds_data_.width + x;
-                        int dst_idx = z * vds_data_.width + x;
-                        slice_data[dst_idx] = vds_data_.data[src_idx];
+            } else {
+                // Strided gather; the whole stride pattern stays inside one brick
+                for (int lz = 0; lz < sz; lz++) {
+                    const T* src = samples + static_cast<size_t>(lz) * sy * sx + lx;
+                    Out* dst = out + static_cast<size_t>(brick.origin[2] + lz) * h + brick.origin[1];
+                    for (int ly = 0; ly < sy; ly++) {
+                        dst[ly] = convert(src[static_cast<size_t>(ly) * sx]);
                     }
                 }
-                break;
             }
-            
-            case 2: { // Z-axis slice (XY plane)
-                if (index < 0 || index >= vds_data_.depth) return {};
-                slice_data.resize(vds_data_.width * vds_data_.height);
-                
-                int base_idx = index * (vds_data_.width * vds_data_.height);
-                for (int i = 0; i < vds_data_.width * vds_data_.height; i++) {
-                    slice_data[i] = vds_data_.data[base_idx + i];
+            break;
+        }
+        
+        case 1: { // XZ plane: out[z * w + x]
+            const int ly = index - brick.origin[1];
+            for (int lz = 0; lz < sz; lz++) {
+                const T* src = samples + (static_cast<size_t>(lz) * sy + ly) * sx;
+                Out* dst = out + static_cast<size_t>(brick.origin[2] + lz) * w + brick.origin[0];
+                for (int lx = 0; lx < sx; lx++) {
+                    dst[lx] = convert(src[lx]);
                 }
-                break;
             }
-            
-            default:
-                return {};
+            break;
         }
-    } else {
-        // Generate synthetic noise data for the slice
-        switch (axis) {
-            case 0: { // X-axis slice (YZ plane)
-                if (index < 0 || index >= vds_data_.width) return {};
-                slice_data.resize(vds_data_.height * vds_data_.depth);
-                
-                for (int z = 0; z < vds_data_.depth; z++) {
-                    for (int y = 0; y < vds_data_.height; y++) {
-                        int dst_idx = z * vds_data_.height + y;
-                        slice_data[dst_idx] = generate_noise_value(index, y, z, 0.05f);
-                    }
+        
+        case 2: { // XY plane: out[y * w + x]
+            const int lz = index - brick.origin[2];
+            for (int ly = 0; ly < sy; ly++) {
+                const T* src = samples + (static_cast<size_t>(lz) * sy + ly) * sx;
+                Out* dst = out + static_cast<size_t>(brick.origin[1] + ly) * w + brick.origin[0];
+                for (int lx = 0; lx < sx; lx++) {
+                    dst[lx] = convert(src[lx]);
                 }
-                break;
             }
-            
-            case 1: { // Y-axis slice (XZ plane)
-                if (index < 0 || index >= vds_data_.height) return {};
-                slice_data.resize(vds_data_.width * vds_data_.depth);
+            break;
+        }
+    }
+}
+
+size_t VDSManager::get_slice_sample_count(int axis, int lod) const {
+    const size_t w = get_lod_axis_length(0, lod);
+    const size_t h = get_lod_axis_length(1, lod);
+    const size_t d = get_lod_axis_length(2, lod);
+    
+    switch (axis) {
+        case 0: return h * d;  // YZ plane
+        case 1: return w * d;  // XZ plane
+        case 2: return w * h;  // XY plane
+        default: return 0;
+    }
+}
+
+bool VDSManager::get_slice_data(int axis, int index, float* out) const {
+    const float scale = vds_data_.scale;
+    const float offset = vds_data_.offset;
+    
+    switch (vds_data_.format) {
+        case SampleFormat::U8:
+            return extract_plane<uint8_t>(0, axis, index, out, [scale, offset](uint8_t v) { return offset + scale * v; });
+        case SampleFormat::U16:
+            return extract_plane<uint16_t>(0, axis, index, out,
+                                           [scale, offset](uint16_t v) { return offset + scale * v; });
+        case SampleFormat::F32:
+        default:
+            return extract_plane<float>(0, axis, index, out, [](float v) { return v; });
+    }
+}
+
+bool VDSManager::get_slice(int axis, int index, SliceBuffer& slice, int lod) const {
+    lod = std::clamp(lod, 0, get_lod_levels());
+    const size_t count = has_vds() ? get_slice_sample_count(axis, lod) : 0;
+    if (count == 0 || index < 0) {
+        return false;
+    }
+    
+    slice.format = vds_data_.format;
+    slice.scale = vds_data_.scale;
+    slice.offset = vds_data_.offset;
+    switch (axis) {
+        case 0:  slice.width = get_lod_axis_length(1, lod); slice.height = get_lod_axis_length(2, lod); break;
+        case 1:  slice.width = get_lod_axis_length(0, lod); slice.height = get_lod_axis_length(2, lod); break;
+        default: slice.width = get_lod_axis_length(0, lod); slice.height = get_lod_axis_length(1, lod); break;
+    }
+    
+    // resize() keeps capacity, so steady-state frames reuse the caller's buffer
+    slice.data.resize(count * sample_format_size(slice.format));
+    
+    const int level_index = index >> lod;
+    switch (slice.format) {
+        case SampleFormat::U8:
+            return extract_plane<uint8_t>(lod, axis, level_index, slice.data.data(), [](uint8_t v) { return v; });
+        case SampleFormat::U16:
+            return extract_plane<uint16_t>(lod, axis, level_index, reinterpret_cast<uint16_t*>(slice.data.data()),
+                                           [](uint16_t v) { return v; });
+        case SampleFormat::F32:
+        default:
+            return extract_plane<float>(lod, axis, level_index, reinterpret_cast<float*>(slice.data.data()),
+                                        [](float v) { return v; });
+    }
+}
+
+// index is in the level's own sample grid
+template <typename T, typename Out, typename Convert>
+bool VDSManager::extract_plane(int lod, int axis, int index, Out* out, Convert convert) const {
+    int layer, count_a, count_b;
+    if (!out || !get_slice_brick_range(lod, axis, index, layer, count_a, count_b)) {
+        return false;
+    }
+    
+    BrickCache& cache = lod_cache(lod);
+    const int w = get_lod_axis_length(0, lod);
+    const int h = get_lod_axis_length(1, lod);
+    std::atomic<bool> ok(true);
+    std::atomic<bool> all_resident(true);
+    
+    // Each task owns whole rows of bricks along the slow output axis, so tasks
+    // write disjoint output rows; bricks are fetched on first touch
+    auto extract_rows = [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end && ok; b++) {
+            for (int a = 0; a < count_a; a++) {
+                int bx, by, bz;
+                slice_brick_coords(axis, layer, a, static_cast<int>(b), bx, by, bz);
                 
-                for (int z = 0; z < vds_data_.depth; z++) {
-                    for (int x = 0; x < vds_data_.width; x++) {
-                        int dst_idx = z * vds_data_.width + x;
-                        slice_data[dst_idx] = generate_noise_value(x, index, z, 0.05f);
-                    }
+                bool resident = false;
+                auto brick = cache.get(bx, by, bz, &resident);
+                if (!brick) {
+                    ok = false;
+                    return;
                 }
-                break;
-            }
-            
-            case 2: { // Z-axis slice (XY plane)
-                if (index < 0 || index >= vds_data_.depth) return {};
-                slice_data.resize(vds_data_.width * vds_data_.height);
-                
-                for (int y = 0; y < vds_data_.height; y++) {
-                    for (int x = 0; x < vds_data_.width; x++) {
-                        int dst_idx = y * vds_data_.width + x;
-                        slice_data[dst_idx] = generate_noise_value(x, y, index, 0.05f);
-                    }
+                if (!resident) {
+                    all_resident = false;
                 }
-                break;
+                
+                copy_brick_plane<T>(*brick, axis, index, w, h, out, convert);
             }
-            
-            default:
-                return {};
         }
+    };
+    
+    if (extract_pool_) {
+        extract_pool_->parallel_for(static_cast<size_t>(count_b), extract_rows);
+    } else {
+        extract_rows(0, static_cast<size_t>(count_b));
+    }
+    
+    if (!ok) {
+        return false;
     }
     
-    return slice_data;
+    if (all_resident) {
+        slice_hits_++;
+    } else {
+        slice_misses_++;
+    }
+    return true;
 }
 
-std::vector<uint8_t> VDSManager::get_slice_rgb(int axis, int index) const {
-    auto slice_data = get_slice_data(axis, index);
-    if (slice_data.empty()) {
-        return {};
+bool VDSManager::get_slice_rgb(int axis, int index, SliceBuffer& slice, std::vector<uint8_t>& rgb, int lod) const {
+    if (!get_slice(axis, index, slice, lod)) {
+        return false;
     }
     
-    return float_to_rgb(slice_data);
+    rgb.resize(slice.sample_count() * 3);
+    slice_to_rgb(slice, rgb.data());
+    return true;
 }
 
-std::vector<float> VDSManager::get_animated_slice_data(const std::string& orientation, float time, float duration) const {
-    if (!has_vds()) {
-        return {};
+bool VDSManager::get_slice_brick_range(int lod, int axis, int index, int& layer, int& count_a, int& count_b) const {
+    if (!has_vds() || lod < 0 || lod > get_lod_levels() || index < 0 || index >= get_lod_axis_length(axis, lod)) {
+        return false;
     }
     
-    // Calculate animated position based on time
-    int axis;
-    int max_slices;
+    const BrickCache& cache = lod_cache(lod);
+    layer = index / cache.brick_size();
+    switch (axis) {
+        case 0: count_a = cache.bricks_y(); count_b = cache.bricks_z(); return true;
+        case 1: count_a = cache.bricks_x(); count_b = cache.bricks_z(); return true;
+        case 2: count_a = cache.bricks_x(); count_b = cache.bricks_y(); return true;
+        default: return false;
+    }
+}
+
+bool VDSManager::is_slice_resident(int axis, int index, int lod) const {
+    int layer, count_a, count_b;
+    if (index < 0 || !get_slice_brick_range(lod, axis, index >> lod, layer, count_a, count_b)) {
+        return false;
+    }
     
+    const BrickCache& cache = lod_cache(lod);
+    for (int b = 0; b < count_b; b++) {
+        for (int a = 0; a < count_a; a++) {
+            int bx, by, bz;
+            slice_brick_coords(axis, layer, a, b, bx, by, bz);
+            if (!cache.is_resident(bx, by, bz)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t VDSManager::prefetch_slice(int axis, int index, int lod) const {
+    int layer, count_a, count_b;
+    if (index < 0 || !get_slice_brick_range(lod, axis, index >> lod, layer, count_a, count_b)) {
+        return 0;
+    }
+    
+    // Only touch bricks that are missing so prefetching never reorders the LRU
+    // ahead of the frames actually being rendered
+    BrickCache& cache = lod_cache(lod);
+    size_t loaded = 0;
+    for (int b = 0; b < count_b; b++) {
+        for (int a = 0; a < count_a; a++) {
+            int bx, by, bz;
+            slice_brick_coords(axis, layer, a, b, bx, by, bz);
+            if (cache.is_resident(bx, by, bz)) {
+                continue;
+            }
+            if (cache.get(bx, by, bz)) {
+                loaded++;
+            }
+        }
+    }
+    return loaded;
+}
+
+int VDSManager::get_axis_length(int axis) const {
+    switch (axis) {
+        case 0: return vds_data_.width;
+        case 1: return vds_data_.height;
+        case 2: return vds_data_.depth;
+        default: return 0;
+    }
+}
+
+int VDSManager::get_lod_axis_length(int axis, int lod) const {
+    const int length = get_axis_length(axis);
+    return lod <= 0 ? length : (length + (1 << lod) - 1) >> lod;
+}
+
+int VDSManager::select_lod(int axis, int output_width, int output_height, float velocity) const {
+    const int levels = get_lod_levels();
+    const int across = axis == 0 ? 1 : 0;
+    const int down = axis == 2 ? 1 : 2;
+    
+    // Halve while the slice still has a sample for every output pixel
+    int lod = 0;
+    while (lod < levels && output_width > 0 && output_height > 0 &&
+           get_lod_axis_length(across, lod + 1) >= output_width &&
+           get_lod_axis_length(down, lod + 1) >= output_height) {
+        lod++;
+    }
+    
+    // A cursor skipping 2^l slices a frame never shows the detail between them
+    const float step = std::fabs(velocity);
+    int motion_lod = 0;
+    while (motion_lod < levels && step >= static_cast<float>(2 << motion_lod)) {
+        motion_lod++;
+    }
+    return std::max(lod, motion_lod);
+}
+
+int VDSManager::orientation_to_axis(const std::string& orientation) {
     if (orientation == "XY") {
-        axis = 2; // Z-axis (time slices)
-        max_slices = vds_data_.depth;
-    } else if (orientation == "XZ") {
-        axis = 1; // Y-axis (inline sections) - DEFAULT for wiggles
-        max_slices = vds_data_.height;
+        return 2; // Z-axis (time slices)
     } else if (orientation == "YZ") {
-        axis = 0; // X-axis (crossline sections)
-        max_slices = vds_data_.width;
-    } else {
-        // Default to XZ (vertical sections)
-        axis = 1;
-        max_slices = vds_data_.height;
+        return 0; // X-axis (crossline sections)
+    }
+    // XZ (inline sections) is the default for wiggles
+    return 1;
+}
+
+int VDSManager::get_animated_slice_index(const std::string& orientation, float time, float duration, int& axis) const {
+    axis = orientation_to_axis(orientation);
+    return get_animated_slice_index(axis, time, duration);
+}
+
+int VDSManager::get_animated_slice_index(int axis, float time, float duration) const {
+    const int max_slices = get_axis_length(axis);
+    if (max_slices <= 0 || duration <= 0.0f) {
+        return 0;
     }
     
     // Calculate current slice index based on animation time
     float progress = fmod(time, duration) / duration; // 0.0 to 1.0
     int slice_index = static_cast<int>(progress * (max_slices - 1));
-    slice_index = std::max(0, std::min(slice_index, max_slices - 1));
-    
-    return get_slice_data(axis, slice_index);
+    return std::max(0, std::min(slice_index, max_slices - 1));
 }
 
-std::vector<uint8_t> VDSManager::get_animated_slice_rgb(const std::string& orientation, float time, float duration) const {
-    auto slice_data = get_animated_slice_data(orientation, time, duration);
-    if (slice_data.empty()) {
-        return {};
+bool VDSManager::get_animated_slice(const std::string& orientation, float time, float duration, SliceBuffer& slice) const {
+    if (!has_vds()) {
+        return false;
     }
-    return float_to_rgb(slice_data);
+    
+    int axis;
+    int slice_index = get_animated_slice_index(orientation, time, duration, axis);
+    return get_slice(axis, slice_index, slice);
 }
 
 void VDSManager::get_slice_dimensions(const std::string& orientation, int& width, int& height) const {
@@ -368,155 +560,504 @@ bool VDSManager::extract_vds_data() {
             return false;
         }
         
-        // Extract dimensions
+        vds_layout_ = layout;
+        
+        // Only metadata is read here; samples are paged in brick by brick on first touch,
+        // so the full survey is addressable and startup cost is independent of its size
         vds_data_.width = layout->GetDimensionNumSamples(0);
         vds_data_.height = layout->GetDimensionNumSamples(1);
         vds_data_.depth = layout->GetDimensionNumSamples(2);
         
+        // Quantized requests are scaled by HueSpace across the channel value range,
+        // so that range is what maps a stored code back to an amplitude
+        float range_min = layout->GetChannelValueRangeMin(0);
+        float range_max = layout->GetChannelValueRangeMax(0);
+        if (!(range_max > range_min)) {
+            range_min = 0.0f;
+            range_max = cache_config_.sample_format == SampleFormat::U16 ? 65535.0f : 255.0f;
+        }
+        set_sample_encoding(cache_config_.sample_format, range_min, range_max);
+        
+        configure_brick_cache([this](BrickCache::Brick& brick) { return load_vds_brick(brick); });
+        
         BLUSTREAM_LOG_INFO("VDS dimensions: " + 
                           std::to_string(vds_data_.width) + "x" + 
                           std::to_string(vds_data_.height) + "x" + 
                           std::to_string(vds_data_.depth));
         
-        // Extract real VDS data using RequestVolumeSubset API  
-        // Use safe sampling to avoid memory allocation errors
-        int sample_width = std::min(512, vds_data_.width);     // Safe width 
-        int sample_height = std::min(1024, vds_data_.height);  // Safe height
-        int sample_depth = std::min(512, vds_data_.depth);     // Safe depth
-        
-        // Allocate buffer for real VDS data extraction
-        vds_data_.data.resize(sample_width * sample_height * sample_depth);
-        
-        // Set up coordinates for VDS extraction (centered sampling for stability)
-        int start_x = (vds_data_.width - sample_width) / 2;   // Center
-        int start_y = (vds_data_.height - sample_height) / 2; // Center  
-        int start_z = (vds_data_.depth - sample_depth) / 2;   // Center
-        
-        int startRead[6];
-        int endRead[6];
-        
-        // Set up coordinate ranges for sampling
-        startRead[0] = start_x;
-        startRead[1] = start_y;
-        startRead[2] = start_z;
-        startRead[3] = 0;
-        startRead[4] = 0;
-        startRead[5] = 0;
-        
-        endRead[0] = start_x + sample_width;
-        endRead[1] = start_y + sample_height;
-        endRead[2] = start_z + sample_depth;
-        endRead[3] = 1;
-        endRead[4] = 1;
-        endRead[5] = 1;
-        
-        BLUSTREAM_LOG_INFO("Extracting real VDS data from coordinates: " +
-                          std::to_string(start_x) + "," + std::to_string(start_y) + "," + std::to_string(start_z) +
-                          " to " + std::to_string(start_x + sample_width) + "," + 
-                          std::to_string(start_y + sample_height) + "," + std::to_string(start_z + sample_depth));
-        
-        // Create buffer for raw VDS data (as uint8)
-        std::vector<uint8_t> raw_vds_buffer(sample_width * sample_height * sample_depth);
-        
-        // Request real VDS data using the same pattern as working standalone code
-        Hue::ProxyLib::int64 requestID = Hue::ProxyLib::ProxyInterface::GetVolumeDataAccessInterface()->RequestVolumeSubset(
-            raw_vds_buffer.data(),           // output buffer
-            layout,                          // VDS layout
-            Hue::HueSpaceLib::DimensionGroup012,  // dimension group (xyz)
-            0,                               // LOD
-            0,                               // channel
-            startRead,                       // start coordinates
-            endRead,                         // end coordinates
-            Hue::HueSpaceLib::VolumeDataChannelDescriptor::Format_U8   // 8-bit unsigned format
-        );
+        return true;
         
-        // Wait for the request to complete
-        Hue::ProxyLib::ProxyInterface::GetVolumeDataAccessInterface()->WaitForCompletion(requestID);
+    } catch (const std::exception& e) {
+        BLUSTREAM_LOG_ERROR("Exception extracting VDS data: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void VDSManager::configure_brick_cache(BrickCache::Loader loader, const BrickFile* file) {
+    BrickCache::Config config;
+    config.brick_size = file ? file->header().brick_size : cache_config_.brick_size;
+    config.budget_bytes = cache_config_.budget_mb * 1024 * 1024;
+    config.crossline_layout = cache_config_.crossline_layout;
+    config.format = vds_data_.format;
+    config.mapped = file != nullptr;
+    
+    if (!extract_pool_) {
+        extract_pool_ = std::make_unique<ThreadPool>(cache_config_.extract_threads);
+        BLUSTREAM_LOG_INFO("Slice extraction using " + std::to_string(extract_pool_->concurrency()) + " threads");
+    }
+    
+    // Mapped bricks are served in place; everything else keeps its loader for write_brick_file
+    if (!file) {
+        source_loader_ = loader;
+    }
+    // New bricks also feed the amplitude histogram
+    auto counting_loader = [this, loader](BrickCache::Brick& brick) {
+        if (!loader(brick)) {
+            return false;
+        }
+        record_brick(brick);
+        return true;
+    };
+    brick_cache_.configure(config, vds_data_.width, vds_data_.height, vds_data_.depth, std::move(counting_loader));
+    slice_hits_ = 0;
+    slice_misses_ = 0;
+    
+    histogram_.reset(vds_data_.min_value, vds_data_.max_value);
+    histogram_checked_ = 0;
+    brick_count_ = static_cast<size_t>(brick_cache_.bricks_x()) * brick_cache_.bricks_y() * brick_cache_.bricks_z();
+    brick_counted_.reset(new std::atomic<bool>[brick_count_]());
+    
+    // Each level is an eighth of the one above and gets a quarter of its budget,
+    // so coarse levels stay resident for more of the survey. Levels stop once
+    // the one above fits in a single brick.
+    lod_caches_.clear();
+    for (int lod = 1; lod <= cache_config_.lod_levels; lod++) {
+        if (std::max({get_lod_axis_length(0, lod - 1), get_lod_axis_length(1, lod - 1),
+                      get_lod_axis_length(2, lod - 1)}) <= config.brick_size) {
+            break;
+        }
         
-        // Convert the extracted real VDS data from uint8 to float
-        vds_data_.data.resize(raw_vds_buffer.size());
-        for (size_t i = 0; i < raw_vds_buffer.size(); i++) {
-            vds_data_.data[i] = static_cast<float>(raw_vds_buffer[i]);
+        BrickCache::Config lod_config = config;
+        lod_config.budget_bytes = config.budget_bytes >> (2 * lod);
+        lod_config.mapped = false;
+        auto cache = std::make_unique<BrickCache>();
+        cache->configure(lod_config, get_lod_axis_length(0, lod), get_lod_axis_length(1, lod),
+                         get_lod_axis_length(2, lod),
+                         [this, lod](BrickCache::Brick& brick) { return load_lod_brick(lod, brick); });
+        lod_caches_.push_back(std::move(cache));
+    }
+    if (!lod_caches_.empty()) {
+        BLUSTREAM_LOG_INFO("Level of detail: " + std::to_string(lod_caches_.size()) + " downsampled levels");
+    }
+}
+
+void VDSManager::set_cache_budget(size_t budget_mb) {
+    cache_config_.budget_mb = budget_mb;
+    const size_t budget_bytes = budget_mb * 1024 * 1024;
+    brick_cache_.set_budget(budget_bytes);
+    for (size_t i = 0; i < lod_caches_.size(); i++) {
+        lod_caches_[i]->set_budget(budget_bytes >> (2 * (i + 1)));
+    }
+}
+
+BrickCache& VDSManager::lod_cache(int lod) const {
+    return lod <= 0 ? brick_cache_ : *lod_caches_[lod - 1];
+}
+
+bool VDSManager::load_lod_brick(int lod, BrickCache::Brick& brick) const {
+    switch (brick.format) {
+        case SampleFormat::U8:  return downsample_brick<uint8_t>(lod, brick);
+        case SampleFormat::U16: return downsample_brick<uint16_t>(lod, brick);
+        case SampleFormat::F32:
+        default:                return downsample_brick<float>(lod, brick);
+    }
+}
+
+// Box filter the 2x2x2 finer bricks under this one; samples cut off by the
+// volume edge average over what is there. Codes share one encoding across
+// levels, so averaging them averages the values.
+template <typename T>
+bool VDSManager::downsample_brick(int lod, BrickCache::Brick& brick) const {
+    BrickCache& finer = lod_cache(lod - 1);
+    const int bs = finer.brick_size();
+    const int fine_bricks[3] = {finer.bricks_x(), finer.bricks_y(), finer.bricks_z()};
+    const int sx = brick.size[0];
+    const int sy = brick.size[1];
+    
+    std::vector<float> sum(brick.sample_count(), 0.0f);
+    std::vector<uint8_t> weight(brick.sample_count(), 0);
+    
+    for (int c = 0; c < 8; c++) {
+        int fb[3];
+        bool inside = true;
+        for (int i = 0; i < 3; i++) {
+            fb[i] = brick.origin[i] / bs * 2 + ((c >> i) & 1);
+            inside = inside && fb[i] < fine_bricks[i];
+        }
+        if (!inside) {
+            continue;
         }
         
-        // Calculate min/max values from the REAL VDS data
-        float min_val = std::numeric_limits<float>::max();
-        float max_val = std::numeric_limits<float>::lowest();
+        auto fine = finer.get(fb[0], fb[1], fb[2]);
+        if (!fine) {
+            return false;
+        }
         
-        for (float value : vds_data_.data) {
-            if (std::isfinite(value)) {  // Skip NaN/inf values
-                min_val = std::min(min_val, value);
-                max_val = std::max(max_val, value);
+        const T* src = fine->samples_as<T>();
+        for (int fz = 0; fz < fine->size[2]; fz++) {
+            const int lz = ((fine->origin[2] + fz) >> 1) - brick.origin[2];
+            for (int fy = 0; fy < fine->size[1]; fy++) {
+                const int ly = ((fine->origin[1] + fy) >> 1) - brick.origin[1];
+                const size_t row = (static_cast<size_t>(lz) * sy + ly) * sx;
+                for (int fx = 0; fx < fine->size[0]; fx++, src++) {
+                    const size_t i = row + ((fine->origin[0] + fx) >> 1) - brick.origin[0];
+                    sum[i] += static_cast<float>(*src);
+                    weight[i]++;
+                }
             }
         }
+    }
+    
+    T* out = brick.samples_as<T>();
+    for (size_t i = 0; i < sum.size(); i++) {
+        const float mean = weight[i] ? sum[i] / weight[i] : 0.0f;
+        if constexpr (std::is_floating_point<T>::value) {
+            out[i] = mean;
+        } else {
+            out[i] = static_cast<T>(std::lround(mean));
+        }
+    }
+    return true;
+}
+
+bool VDSManager::write_brick_file(const std::string& path, const std::atomic<bool>* keep_running) const {
+    if (!has_vds() || !source_loader_) {
+        BLUSTREAM_LOG_ERROR("No volume source to write a brick file from");
+        return false;
+    }
+    
+    BrickFile::Header header = BrickFile::make_header(vds_data_.format, vds_data_.width, vds_data_.height,
+                                                      vds_data_.depth, brick_cache_.brick_size());
+    header.scale = vds_data_.scale;
+    header.offset = vds_data_.offset;
+    header.min_value = vds_data_.min_value;
+    header.max_value = vds_data_.max_value;
+    if (!source_path_.empty()) {
+        BrickFile::stat_source(source_path_, header.source_size, header.source_mtime);
+    }
+    
+    BLUSTREAM_LOG_INFO("Writing brick file " + path + " (" + std::to_string(header.brick_count) + " bricks)");
+    return BrickFile::write(path, header, source_loader_, keep_running);
+}
+
+bool VDSManager::load_brick_file(const std::string& path, const std::string& source_path) {
+    std::shared_ptr<BrickFile> file = BrickFile::open(path);
+    if (!file) {
+        return false;
+    }
+    
+    const BrickFile::Header& header = file->header();
+    if (file->format() != cache_config_.sample_format) {
+        BLUSTREAM_LOG_INFO("Brick file " + path + " holds a different sample format, ignoring it");
+        return false;
+    }
+    if (!source_path.empty()) {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        if (!BrickFile::stat_source(source_path, size, mtime) || size != header.source_size ||
+            mtime != header.source_mtime) {
+            BLUSTREAM_LOG_INFO("Brick file " + path + " is out of date with " + source_path + ", ignoring it");
+            return false;
+        }
+    }
+    
+    current_vds_ = nullptr;
+    vds_layout_ = nullptr;
+    source_path_ = source_path;
+    
+    vds_data_.width = header.width;
+    vds_data_.height = header.height;
+    vds_data_.depth = header.depth;
+    vds_data_.format = file->format();
+    vds_data_.min_value = header.min_value;
+    vds_data_.max_value = header.max_value;
+    vds_data_.scale = header.scale;
+    vds_data_.offset = header.offset;
+    reset_display_range();
+    rebuild_colormap();
+    
+    // Bricks point straight into the mapping, which each brick keeps alive
+    const int bs = header.brick_size;
+    configure_brick_cache([file, bs](BrickCache::Brick& brick) {
+        brick.mapped = file->brick_data(brick.origin[0] / bs, brick.origin[1] / bs, brick.origin[2] / bs);
+        brick.mapping = file;
+        return brick.mapped != nullptr;
+    }, file.get());
+    
+    // A copy of the file is written from the mapping
+    source_loader_ = [file, bs](BrickCache::Brick& brick) {
+        size_t bytes = 0;
+        const uint8_t* data = file->brick_data(brick.origin[0] / bs, brick.origin[1] / bs, brick.origin[2] / bs,
+                                                &bytes);
+        if (!data || bytes != brick.samples.size()) {
+            return false;
+        }
+        std::memcpy(brick.samples.data(), data, bytes);
+        return true;
+    };
+    
+    brick_file_ = file;
+    current_vds_ = reinterpret_cast<void*>(0x1);  // Non-null marker
+    
+    BLUSTREAM_LOG_INFO("Volume served from brick file: " + std::to_string(header.width) + "x" +
+                      std::to_string(header.height) + "x" + std::to_string(header.depth));
+    return true;
+}
+
+bool VDSManager::load_vds_brick(BrickCache::Brick& brick) const {
+    const auto* layout = static_cast<const Hue::HueSpaceLib::VolumeDataLayout*>(vds_layout_);
+    if (!layout) {
+        return false;
+    }
+    
+    try {
+        int startRead[6] = {brick.origin[0], brick.origin[1], brick.origin[2], 0, 0, 0};
+        int endRead[6] = {brick.origin[0] + brick.size[0],
+                          brick.origin[1] + brick.size[1],
+                          brick.origin[2] + brick.size[2], 1, 1, 1};
         
-        vds_data_.min_value = min_val;
-        vds_data_.max_value = max_val;
-        
-        // Update dimensions to match extracted data
-        vds_data_.width = sample_width;
-        vds_data_.height = sample_height;
-        vds_data_.depth = sample_depth;
+        Hue::HueSpaceLib::VolumeDataChannelDescriptor::Format format;
+        switch (brick.format) {
+            case SampleFormat::U8:  format = Hue::HueSpaceLib::VolumeDataChannelDescriptor::Format_U8; break;
+            case SampleFormat::U16: format = Hue::HueSpaceLib::VolumeDataChannelDescriptor::Format_U16; break;
+            case SampleFormat::F32:
+            default:                format = Hue::HueSpaceLib::VolumeDataChannelDescriptor::Format_R32; break;
+        }
         
-        BLUSTREAM_LOG_INFO("✓ Extracted REAL VDS seismic data! Range: " + 
-                          std::to_string(vds_data_.min_value) + " to " + std::to_string(vds_data_.max_value) + 
-                          " Dimensions: " + std::to_string(sample_width) + "x" + 
-                          std::to_string(sample_height) + "x" + std::to_string(sample_depth));
+        // Read straight into the brick in its resident format; no widening copy
+        auto* access = Hue::ProxyLib::ProxyInterface::GetVolumeDataAccessInterface();
+        Hue::ProxyLib::int64 requestID = access->RequestVolumeSubset(
+            brick.samples.data(),                 // output buffer
+            layout,                               // VDS layout
+            Hue::HueSpaceLib::DimensionGroup012,  // dimension group (xyz)
+            0,                                    // LOD
+            0,                                    // channel
+            startRead,                            // start coordinates
+            endRead,                              // end coordinates
+            format                                // resident sample format
+        );
         
+        // A failed or cancelled read leaves the brick unwritten; keep it out of the cache
+        if (!access->WaitForCompletion(requestID)) {
+            BLUSTREAM_LOG_WARN("VDS read for brick at " + std::to_string(brick.origin[0]) + "," +
+                              std::to_string(brick.origin[1]) + "," + std::to_string(brick.origin[2]) +
+                              " did not complete");
+            return false;
+        }
         return true;
         
     } catch (const std::exception& e) {
-        BLUSTREAM_LOG_ERROR("Exception extracting VDS data: " + std::string(e.what()));
+        BLUSTREAM_LOG_ERROR("Exception loading VDS brick: " + std::string(e.what()));
         return false;
     }
 }
 
-std::vector<uint8_t> VDSManager::float_to_rgb(const std::vector<float>& data) const {
-    std::vector<uint8_t> rgb_data(data.size() * 3);
+// Store a generated value in the brick's native format
+template <typename T>
+static void quantize_noise(T* dst, float value, float scale, float offset, float max_code) {
+    float code = (value - offset) / scale;
+    *dst = static_cast<T>(std::clamp(std::round(code), 0.0f, max_code));
+}
+
+bool VDSManager::generate_noise_brick(BrickCache::Brick& brick) const {
+    const float scale = vds_data_.scale;
+    const float offset = vds_data_.offset;
     
-    for (size_t i = 0; i < data.size(); i++) {
-        float normalized = normalize_value(data[i]);
-        
-        // Enhanced seismic visualization with smoother rendering to reduce graininess
-        uint8_t intensity;
-        
-        // Apply gentler gamma correction and smoothing for less grainy appearance
-        float smoothed = normalized;
-        
-        // Apply Gaussian-like smoothing curve to reduce graininess
-        float smooth_factor = 1.0f - std::exp(-normalized * 3.0f);
-        smoothed = normalized * 0.7f + smooth_factor * 0.3f;
-        
-        // Apply gentler gamma correction
-        float gamma_corrected = std::pow(smoothed, 0.6f);
-        
-        // Create smooth seismic-style color mapping with reduced contrast jumps
-        if (normalized < 0.05f) {
-            // Very low amplitude - smooth dark
-            intensity = static_cast<uint8_t>(smoothed * 20.0f * 255.0f);
-        } else if (normalized > 0.95f) {
-            // Very high amplitude - smooth bright
-            intensity = static_cast<uint8_t>(255.0f * (0.8f + 0.2f * smoothed));
-        } else {
-            // Mid range - smooth gradient with enhanced contrast
-            intensity = static_cast<uint8_t>(gamma_corrected * 255.0f);
+    size_t i = 0;
+    for (int z = 0; z < brick.size[2]; z++) {
+        for (int y = 0; y < brick.size[1]; y++) {
+            for (int x = 0; x < brick.size[0]; x++, i++) {
+                float value = generate_noise_value(brick.origin[0] + x,
+                                                   brick.origin[1] + y,
+                                                   brick.origin[2] + z, noise_scale_);
+                switch (brick.format) {
+                    case SampleFormat::U8:
+                        quantize_noise(brick.samples_as<uint8_t>() + i, value, scale, offset, 255.0f);
+                        break;
+                    case SampleFormat::U16:
+                        quantize_noise(brick.samples_as<uint16_t>() + i, value, scale, offset, 65535.0f);
+                        break;
+                    case SampleFormat::F32:
+                        brick.samples_as<float>()[i] = value;
+                        break;
+                }
+            }
         }
-        
-        rgb_data[i * 3 + 0] = intensity;  // R
-        rgb_data[i * 3 + 1] = intensity;  // G
-        rgb_data[i * 3 + 2] = intensity;  // B
     }
+    return true;
+}
+
+void VDSManager::set_sample_encoding(SampleFormat format, float min_value, float max_value) {
+    vds_data_.format = format;
+    vds_data_.min_value = min_value;
+    vds_data_.max_value = max_value;
+    
+    // Quantized codes span [min_value, max_value]; floats are stored as-is
+    float max_code = format == SampleFormat::U8 ? 255.0f : (format == SampleFormat::U16 ? 65535.0f : 0.0f);
+    if (max_code > 0.0f && max_value > min_value) {
+        vds_data_.scale = (max_value - min_value) / max_code;
+        vds_data_.offset = min_value;
+    } else {
+        vds_data_.scale = 1.0f;
+        vds_data_.offset = 0.0f;
+    }
+    
+    reset_display_range();
+    rebuild_colormap();
+}
+
+bool VDSManager::parse_sample_format(const std::string& name, SampleFormat& format) {
+    if (name == "u8") {
+        format = SampleFormat::U8;
+    } else if (name == "u16") {
+        format = SampleFormat::U16;
+    } else if (name == "f32") {
+        format = SampleFormat::F32;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void VDSManager::slice_to_rgb(const float* data, size_t count, uint8_t* rgb_data) const {
+    map_to_rgb(SampleFormat::F32, data, count, rgb_data);
+}
+
+void VDSManager::slice_to_rgb(const SliceBuffer& slice, uint8_t* rgb_data) const {
+    map_to_rgb(slice.format, slice.data.data(), slice.sample_count(), rgb_data);
+}
+
+void VDSManager::map_to_rgb(SampleFormat format, const void* samples, size_t count, uint8_t* rgb_data) const {
+    std::shared_ptr<const ColorMap> colormap = get_colormap();
+    const auto* bytes = static_cast<const uint8_t*>(samples);
+    const size_t sample_size = sample_format_size(format);
+    
+    // Table lookups are memory bound; split large slices across the extraction pool
+    auto map_range = [&](size_t begin, size_t end) {
+        colormap->map(format, bytes + begin * sample_size, end - begin, rgb_data + begin * 3);
+    };
+    
+    const size_t min_chunk = 64 * 1024;
+    if (extract_pool_ && count > min_chunk) {
+        extract_pool_->parallel_for(count, map_range, min_chunk);
+    } else {
+        map_range(0, count);
+    }
+}
+
+void VDSManager::set_colormap(ColorMap::Type type) {
+    colormap_type_ = type;
+    rebuild_colormap();
+}
+
+std::shared_ptr<const ColorMap> VDSManager::get_colormap() const {
+    std::lock_guard<std::mutex> lock(colormap_mutex_);
+    return colormap_;
+}
+
+void VDSManager::rebuild_colormap() {
+    ColorMap::Params params;
+    params.type = colormap_type_;
+    params.scale = vds_data_.scale;
+    params.offset = vds_data_.offset;
+    
+    {
+        std::lock_guard<std::mutex> lock(colormap_mutex_);
+        params.min_value = display_min_;
+        params.max_value = display_max_;
+        if (colormap_) {
+            const ColorMap::Params& current = colormap_->get_params();
+            if (current.type == params.type && current.min_value == params.min_value &&
+                current.max_value == params.max_value && current.scale == params.scale &&
+                current.offset == params.offset) {
+                return;  // Tables are already up to date
+            }
+        }
+    }
+    
+    // Build off to the side and swap; frames in flight keep the old tables
+    auto colormap = std::make_shared<ColorMap>();
+    colormap->build(params);
     
-    return rgb_data;
+    // Loader threads can rebuild concurrently; one that raced a newer range
+    // leaves the swap to the rebuild that set it
+    std::lock_guard<std::mutex> lock(colormap_mutex_);
+    if (params.min_value != display_min_ || params.max_value != display_max_) {
+        return;
+    }
+    colormap_ = std::move(colormap);
+}
+
+void VDSManager::set_clip_percentiles(float low, float high) {
+    clip_low_ = std::clamp(low, 0.0f, 100.0f);
+    clip_high_ = std::clamp(high, clip_low_, 100.0f);
+    histogram_checked_ = 0;
+    update_display_range();
+}
+
+void VDSManager::get_display_range(float& low, float& high) const {
+    std::lock_guard<std::mutex> lock(colormap_mutex_);
+    low = display_min_;
+    high = display_max_;
+}
+
+void VDSManager::reset_display_range() {
+    std::lock_guard<std::mutex> lock(colormap_mutex_);
+    display_min_ = vds_data_.min_value;
+    display_max_ = vds_data_.max_value;
+}
+
+void VDSManager::record_brick(const BrickCache::Brick& brick) {
+    const int bs = brick_cache_.brick_size();
+    const size_t index = (static_cast<size_t>(brick.origin[2] / bs) * brick_cache_.bricks_y() + brick.origin[1] / bs) *
+                         brick_cache_.bricks_x() + brick.origin[0] / bs;
+    
+    // Evicted bricks come back through the loader; count each one once
+    if (index >= brick_count_ || brick_counted_[index].exchange(true)) {
+        return;
+    }
+    histogram_.add(brick, vds_data_.scale, vds_data_.offset);
+    update_display_range();
 }
 
-float VDSManager::normalize_value(float value) const {
-    if (vds_data_.max_value <= vds_data_.min_value) {
-        return 0.0f;
+void VDSManager::update_display_range() {
+    // Look again each time the histogram has grown by an eighth, so the
+    // range settles quickly and then only moves when the data says so
+    const uint64_t seen = histogram_.count();
+    uint64_t checked = histogram_checked_.load();
+    if (seen - checked < std::max<uint64_t>(checked / 8, 1) ||
+        !histogram_checked_.compare_exchange_strong(checked, seen)) {
+        return;
+    }
+    
+    float low, high;
+    if (!histogram_.percentile_range(clip_low_, clip_high_, low, high) || !(high > low)) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(colormap_mutex_);
+        const float tolerance = 0.01f * (display_max_ - display_min_);
+        if (std::fabs(low - display_min_) <= tolerance && std::fabs(high - display_max_) <= tolerance) {
+            return;
+        }
+        display_min_ = low;
+        display_max_ = high;
     }
     
-    float normalized = (value - vds_data_.min_value) / (vds_data_.max_value - vds_data_.min_value);
-    return std::clamp(normalized, 0.0f, 1.0f);
+    BLUSTREAM_LOG_DEBUG("Display range " + std::to_string(low) + " to " + std::to_string(high) + " from " +
+                       std::to_string(seen) + " samples");
+    rebuild_colormap();
 }
 
 float VDSManager::generate_noise_value(int x, int y, int z, float scale) const {
@@ -533,9 +1074,11 @@ float VDSManager::generate_noise_value(int x, int y, int z, float scale) const {
     noise += 0.125f * std::sin(fx * 0.4f) * std::cos(fy * 0.4f) * std::sin(fz * 0.4f);
     
     // Add some randomness based on position
-    std::hash<int> hasher;
-    float seed = static_cast<float>(hasher(x * 73856093 ^ y * 19349663 ^ z * 83492791)) / 
-                 static_cast<float>(std::numeric_limits<int>::max());
+    // (hash in unsigned arithmetic and keep 16 bits so the seed stays in [0, 1];
+    // the signed product overflowed to huge outliers that swamped the value range)
+    uint32_t hash = (static_cast<uint32_t>(x) * 73856093u) ^ (static_cast<uint32_t>(y) * 19349663u) ^
+                    (static_cast<uint32_t>(z) * 83492791u);
+    float seed = static_cast<float>(hash & 0xFFFF) / 65535.0f;
     noise += 0.1f * (seed - 0.5f);
     
     return noise;
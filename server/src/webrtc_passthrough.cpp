@@ -0,0 +1,173 @@
+#include "blustream/server/webrtc_passthrough.h"
+#include "blustream/common/logger.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include "modules/video_coding/include/video_codec_interface.h"
+#include "modules/video_coding/include/video_error_codes.h"
+#include "rtc_base/ref_counted_object.h"
+#include "rtc_base/time_utils.h"
+
+namespace blustream {
+namespace server {
+
+void EncodedStreamFeedback::set_target_bitrate(const void* encoder, int kbps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (kbps > 0) {
+        targets_[encoder] = kbps;
+    } else {
+        targets_.erase(encoder);
+    }
+
+    int slowest = 0;
+    for (const auto& [key, target] : targets_) {
+        slowest = slowest == 0 ? target : std::min(slowest, target);
+    }
+
+    // Estimates move every few RTCP reports; only real changes reach the view
+    const int current = target_kbps_;
+    if (slowest == 0 || current == 0 || std::abs(slowest - current) * 20 >= current) {
+        target_kbps_ = slowest;
+    }
+}
+
+EncodedFrameBuffer::EncodedFrameBuffer(rtc::scoped_refptr<webrtc::EncodedImageBuffer> data, bool keyframe,
+                                       int width, int height, std::shared_ptr<EncodedStreamFeedback> feedback)
+    : data_(std::move(data))
+    , keyframe_(keyframe)
+    , width_(width)
+    , height_(height)
+    , feedback_(std::move(feedback)) {
+}
+
+void EncodedVideoSource::push_frame(const uint8_t* data, size_t size, bool keyframe, int width, int height,
+                                    const std::shared_ptr<EncodedStreamFeedback>& feedback) {
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer(new rtc::RefCountedObject<EncodedFrameBuffer>(
+        webrtc::EncodedImageBuffer::Create(data, size), keyframe, width, height, feedback));
+
+    OnFrame(webrtc::VideoFrame::Builder()
+                .set_video_frame_buffer(buffer)
+                .set_timestamp_us(rtc::TimeMicros())
+                .build());
+}
+
+PassthroughVideoEncoder::PassthroughVideoEncoder()
+    : callback_(nullptr)
+    , target_kbps_(0) {
+}
+
+PassthroughVideoEncoder::~PassthroughVideoEncoder() {
+    Release();
+}
+
+int32_t PassthroughVideoEncoder::InitEncode(const webrtc::VideoCodec* codec_settings, const Settings& /* settings */) {
+    if (!codec_settings || codec_settings->codecType != webrtc::kVideoCodecH264) {
+        return WEBRTC_VIDEO_CODEC_ERR_PARAMETER;
+    }
+    return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t PassthroughVideoEncoder::RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback* callback) {
+    callback_ = callback;
+    return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t PassthroughVideoEncoder::Release() {
+    if (feedback_) {
+        feedback_->set_target_bitrate(this, 0);
+        feedback_.reset();
+    }
+    return WEBRTC_VIDEO_CODEC_OK;
+}
+
+void PassthroughVideoEncoder::bind(const std::shared_ptr<EncodedStreamFeedback>& feedback) {
+    if (feedback == feedback_) {
+        return;
+    }
+    Release();
+    feedback_ = feedback;
+    if (feedback_ && target_kbps_ > 0) {
+        feedback_->set_target_bitrate(this, target_kbps_);
+    }
+}
+
+int32_t PassthroughVideoEncoder::Encode(const webrtc::VideoFrame& frame,
+                                        const std::vector<webrtc::VideoFrameType>* frame_types) {
+    auto buffer = frame.video_frame_buffer();
+    if (!callback_ || !buffer || buffer->type() != webrtc::VideoFrameBuffer::Type::kNative) {
+        return WEBRTC_VIDEO_CODEC_ERROR;
+    }
+    const auto* encoded = static_cast<const EncodedFrameBuffer*>(buffer.get());
+    bind(encoded->feedback());
+
+    // PLI and FIR reach us as a keyframe request on the next frame; the
+    // real encoder makes one and this frame goes out as it is
+    if (frame_types && !encoded->keyframe() && feedback_ &&
+        std::find(frame_types->begin(), frame_types->end(), webrtc::VideoFrameType::kVideoFrameKey) !=
+            frame_types->end()) {
+        feedback_->request_keyframe();
+    }
+
+    webrtc::EncodedImage image;
+    image.SetEncodedData(encoded->data());
+    image._encodedWidth = encoded->width();
+    image._encodedHeight = encoded->height();
+    image.SetTimestamp(frame.timestamp());
+    image.capture_time_ms_ = frame.render_time_ms();
+    image.rotation_ = frame.rotation();
+    image._frameType = encoded->keyframe() ? webrtc::VideoFrameType::kVideoFrameKey
+                                           : webrtc::VideoFrameType::kVideoFrameDelta;
+
+    webrtc::CodecSpecificInfo info;
+    info.codecType = webrtc::kVideoCodecH264;
+    info.codecSpecific.H264.packetization_mode = webrtc::H264PacketizationMode::NonInterleaved;
+
+    const auto result = callback_->OnEncodedImage(image, &info);
+    return result.error == webrtc::EncodedImageCallback::Result::OK ? WEBRTC_VIDEO_CODEC_OK
+                                                                    : WEBRTC_VIDEO_CODEC_ERROR;
+}
+
+void PassthroughVideoEncoder::SetRates(const RateControlParameters& parameters) {
+    // The send stream's share of the bandwidth estimate
+    target_kbps_ = static_cast<int>(parameters.bitrate.get_sum_kbps());
+    if (feedback_) {
+        feedback_->set_target_bitrate(this, target_kbps_);
+    }
+}
+
+webrtc::VideoEncoder::EncoderInfo PassthroughVideoEncoder::GetEncoderInfo() const {
+    EncoderInfo info;
+    info.implementation_name = "BluStreamPassthrough";
+    info.supports_native_handle = true;        // EncodedFrameBuffer arrives untouched
+    info.is_hardware_accelerated = true;
+    info.has_trusted_rate_controller = true;   // No frame dropping on our behalf
+    info.supports_simulcast = false;
+    return info;
+}
+
+std::vector<webrtc::SdpVideoFormat> PassthroughEncoderFactory::GetSupportedFormats() const {
+    // Views are encoded Constrained Baseline (see HardwareEncoder::Config::profile),
+    // which Constrained High decoders accept too. Sessions pick their own size,
+    // so claim level 5.2: up to 4096x2304 at 60 fps covers every 1080p and 4K layer.
+    std::vector<webrtc::SdpVideoFormat> formats;
+    for (const char* profile_level_id : {"42e034", "640c34"}) {
+        formats.emplace_back("H264", std::map<std::string, std::string>{{"profile-level-id", profile_level_id},
+                                                                         {"level-asymmetry-allowed", "1"},
+                                                                         {"packetization-mode", "1"}});
+    }
+    return formats;
+}
+
+std::unique_ptr<webrtc::VideoEncoder> PassthroughEncoderFactory::CreateVideoEncoder(
+    const webrtc::SdpVideoFormat& format) {
+    if (format.name != "H264") {
+        LOG_ERROR("Passthrough encoder cannot produce " << format.name);
+        return nullptr;
+    }
+    return std::make_unique<PassthroughVideoEncoder>();
+}
+
+} // namespace server
+} // namespace blustream
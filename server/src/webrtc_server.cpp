@@ -1,102 +1,48 @@
 #include "blustream/server/webrtc_server.h"
 #include "blustream/server/vds_manager.h"
+#include "blustream/server/webrtc_passthrough.h"
 #include "blustream/common/logger.h"
 
 #include <random>
 #include <sstream>
 #include <chrono>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <tuple>
 
 // WebRTC includes
 #include "api/peer_connection_interface.h"
 #include "api/create_peerconnection_factory.h"
 #include "api/video/video_frame.h"
-#include "api/video/i420_buffer.h"
 #include "modules/video_capture/video_capture_factory.h"
-#include "pc/video_track_source.h"
 #include "media/engine/webrtc_media_engine.h"
 
 namespace blustream {
 namespace server {
 
-// Custom video source for injecting our encoded frames
-class CustomVideoSource : public webrtc::VideoTrackSource {
-public:
-    CustomVideoSource() : VideoTrackSource(false /* remote */) {}
-    
-    void send_frame(const std::vector<uint8_t>& rgb_data, int width, int height) {
-        // Convert RGB to I420 format for WebRTC
-        auto i420_buffer = webrtc::I420Buffer::Create(width, height);
-        
-        // Simple RGB to YUV conversion (can be optimized)
-        convert_rgb_to_i420(rgb_data, width, height, i420_buffer);
-        
-        // Create WebRTC video frame
-        webrtc::VideoFrame frame = webrtc::VideoFrame::Builder()
-            .set_video_frame_buffer(i420_buffer)
-            .set_timestamp_us(rtc::TimeMicros())
-            .build();
-        
-        // Send to all sinks
-        OnFrame(frame);
-    }
-
-private:
-    void convert_rgb_to_i420(const std::vector<uint8_t>& rgb_data, int width, int height,
-                            rtc::scoped_refptr<webrtc::I420Buffer> i420_buffer) {
-        // RGB to YUV420 conversion
-        const uint8_t* rgb = rgb_data.data();
-        uint8_t* y_plane = i420_buffer->MutableDataY();
-        uint8_t* u_plane = i420_buffer->MutableDataU();
-        uint8_t* v_plane = i420_buffer->MutableDataV();
-        
-        int y_stride = i420_buffer->StrideY();
-        int u_stride = i420_buffer->StrideU();
-        int v_stride = i420_buffer->StrideV();
-        
-        // Convert RGB to YUV using standard coefficients
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                int rgb_idx = (y * width + x) * 3;
-                uint8_t r = rgb[rgb_idx + 0];
-                uint8_t g = rgb[rgb_idx + 1];
-                uint8_t b = rgb[rgb_idx + 2];
-                
-                // Y component
-                uint8_t y_val = (uint8_t)(0.299 * r + 0.587 * g + 0.114 * b);
-                y_plane[y * y_stride + x] = y_val;
-                
-                // U and V components (subsampled for 4:2:0)
-                if (y % 2 == 0 && x % 2 == 0) {
-                    uint8_t u_val = (uint8_t)(128 - 0.168736 * r - 0.331264 * g + 0.5 * b);
-                    uint8_t v_val = (uint8_t)(128 + 0.5 * r - 0.418688 * g - 0.081312 * b);
-                    
-                    int uv_x = x / 2;
-                    int uv_y = y / 2;
-                    u_plane[uv_y * u_stride + uv_x] = u_val;
-                    v_plane[uv_y * v_stride + uv_x] = v_val;
-                }
-            }
-        }
-    }
-    
-    // VideoTrackSource interface
-    rtc::VideoSourceInterface<webrtc::VideoFrame>* source() override {
-        return this;
-    }
-    bool is_screencast() const override { return false; }
-    absl::optional<bool> needs_denoising() const override { return false; }
-    webrtc::MediaSourceInterface::SourceState state() const override {
-        return webrtc::MediaSourceInterface::kLive;
-    }
-    bool remote() const override { return false; }
-};
+namespace {
+
+int64_t steady_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Requested bitrates are rounded up to one of these so near-identical
+// sessions still share an encode
+const int BITRATE_TIERS_KBPS[] = {1000, 2500, 5000, 8000, 12000, 15000};
+
+// Floor for the bottom layer when receivers report very little bandwidth
+const int MIN_FEEDBACK_BITRATE_KBPS = 150;
+
+} // namespace
 
 // WebRTC Server Implementation
 WebRTCServer::WebRTCServer() 
     : running_(false)
-    , animation_start_time_(std::chrono::steady_clock::now())
+    , animation_start_us_(steady_now_us())
     , stats_start_time_(std::chrono::steady_clock::now()) {
+    stats_ = {};
 }
 
 WebRTCServer::~WebRTCServer() {
@@ -119,21 +65,26 @@ bool WebRTCServer::initialize(const Config& config) {
         return false;
     }
     
-    // Initialize hardware encoder
-    if (!initialize_hardware_encoder()) {
-        LOG_ERROR("Failed to initialize hardware encoder");
+    // Encoders are opened per session as sessions are created
+    if (!initialize_encoder_pool()) {
+        LOG_ERROR("Failed to initialize encoder pool");
         return false;
     }
     
-    // Initialize VDS manager
-    vds_manager_ = std::make_unique<VDSManager>();
+    // Surveys open on demand and share one brick budget
+    SurveyRegistry::Config survey_config;
+    survey_config.budget_mb = config_.vds_cache_budget_mb;
+    survey_config.brick_file_dir = config_.brick_file_dir;
+    surveys_ = std::make_unique<SurveyRegistry>(survey_config);
+    LOG_INFO("  Survey cache budget: " << config_.vds_cache_budget_mb << " MB");
     
     LOG_INFO("WebRTC Server initialized successfully");
     return true;
 }
 
 bool WebRTCServer::initialize_webrtc() {
-    // Create peer connection factory
+    // Create peer connection factory; video is encoded by the encoder pool,
+    // so WebRTC's only video encoder forwards those packets
     peer_connection_factory_ = webrtc::CreatePeerConnectionFactory(
         nullptr /* network_thread */,
         nullptr /* worker_thread */,
@@ -141,7 +92,7 @@ bool WebRTCServer::initialize_webrtc() {
         nullptr /* default_adm */,
         webrtc::CreateBuiltinAudioEncoderFactory(),
         webrtc::CreateBuiltinAudioDecoderFactory(),
-        webrtc::CreateBuiltinVideoEncoderFactory(),
+        std::make_unique<PassthroughEncoderFactory>(),
         webrtc::CreateBuiltinVideoDecoderFactory(),
         nullptr /* audio_mixer */,
         nullptr /* audio_processing */);
@@ -155,29 +106,19 @@ bool WebRTCServer::initialize_webrtc() {
     return true;
 }
 
-bool WebRTCServer::initialize_hardware_encoder() {
-    HardwareEncoder::Config encoder_config;
-    encoder_config.encoder_type = config_.encoder_type;
-    encoder_config.quality_preset = config_.encoder_quality;
-    encoder_config.width = config_.default_width;
-    encoder_config.height = config_.default_height;
-    encoder_config.fps = static_cast<int>(config_.default_fps);
-    encoder_config.bitrate_kbps = (config_.min_bitrate_kbps + config_.max_bitrate_kbps) / 2;
-    
-    // Optimize for low latency
-    encoder_config.enable_b_frames = false;
-    encoder_config.keyframe_interval = 30;  // More frequent keyframes for WebRTC
-    encoder_config.rate_control = HardwareEncoder::Config::VBR;
+bool WebRTCServer::initialize_encoder_pool() {
+    EncoderPool::Config pool_config;
+    pool_config.gpu_encoder_type = config_.encoder_type;
+    pool_config.max_gpu_encoders = config_.encoder_type == HardwareEncoder::Type::SOFTWARE_X264
+                                 ? 0 : config_.max_gpu_encoders;
+    pool_config.max_cpu_encoders = config_.max_cpu_encoders;
+    pool_config.num_workers = config_.encoder_threads;
     
-    hardware_encoder_ = std::make_unique<HardwareEncoder>();
+    encoder_pool_ = std::make_unique<EncoderPool>(pool_config);
     
-    if (!hardware_encoder_->initialize(encoder_config)) {
-        LOG_ERROR("Failed to initialize hardware encoder");
-        return false;
-    }
-    
-    LOG_INFO("Hardware encoder initialized: " << hardware_encoder_->get_encoder_name());
-    LOG_INFO("Hardware acceleration: " << (hardware_encoder_->supports_hardware_acceleration() ? "ENABLED" : "DISABLED"));
+    LOG_INFO("Encoder pool: up to " << pool_config.max_gpu_encoders << " GPU + "
+             << pool_config.max_cpu_encoders << " CPU encoders");
+    LOG_INFO("GPU encoding: " << (HardwareEncoder::is_nvidia_gpu_available() ? "AVAILABLE" : "UNAVAILABLE"));
     
     return true;
 }
@@ -188,11 +129,26 @@ bool WebRTCServer::start() {
         return true;
     }
     
+    if (!encoder_pool_->start()) {
+        LOG_ERROR("Failed to start encoder pool");
+        return false;
+    }
+    
     running_ = true;
-    animation_start_time_ = std::chrono::steady_clock::now();
+    animation_start_us_ = steady_now_us();
     
-    // Start render loop
-    render_thread_ = std::thread(&WebRTCServer::render_loop, this);
+    // Sessions created before start() begin rendering now
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        for (auto& [key, view] : views_) {
+            if (!view->running) {
+                view->running = true;
+                view->render_thread = std::thread(&WebRTCServer::view_render_loop, this, view.get());
+            }
+        }
+    }
+    
+    maintenance_thread_ = std::thread(&WebRTCServer::maintenance_loop, this);
     
     LOG_INFO("WebRTC Server started successfully");
     LOG_INFO("Ready for Phase 5 WebRTC connections");
@@ -209,15 +165,32 @@ void WebRTCServer::stop() {
     
     running_ = false;
     
-    // Wait for render thread
-    if (render_thread_.joinable()) {
-        render_thread_.join();
+    if (maintenance_thread_.joinable()) {
+        maintenance_thread_.join();
     }
     
-    // Clean up all sessions
+    // Clean up all sessions; their encoders go back to the pool first.
+    // Emptied subscriber lists keep the render threads off the sessions
+    // until they are joined, outside the lock.
+    std::vector<std::unique_ptr<ViewStream>> retired;
     {
         std::lock_guard<std::mutex> lock(sessions_mutex_);
+        for (auto& [key, view] : views_) {
+            {
+                std::lock_guard<std::mutex> subscribers_lock(view->subscribers_mutex);
+                view->subscribers.clear();
+            }
+            retired.push_back(std::move(view));
+        }
+        views_.clear();
+        session_views_.clear();
         sessions_.clear();
+        publish_snapshot();
+    }
+    stop_views(retired);
+    
+    if (encoder_pool_) {
+        encoder_pool_->stop();
     }
     
     cleanup();
@@ -226,28 +199,46 @@ void WebRTCServer::stop() {
 }
 
 bool WebRTCServer::load_vds(const std::string& path) {
-    if (!vds_manager_) {
-        LOG_ERROR("VDS Manager not initialized");
+    if (!add_survey(config_.default_survey, path)) {
         return false;
     }
     
     LOG_INFO("Loading VDS file: " << path);
     
-    if (!vds_manager_->load_vds(path)) {
+    // The default survey stays open with no sessions on it
+    default_survey_ = surveys_->acquire(config_.default_survey);
+    if (!default_survey_) {
         LOG_ERROR("Failed to load VDS file: " << path);
         return false;
     }
     
-    auto dimensions = vds_manager_->get_dimensions();
     LOG_INFO("VDS loaded successfully:");
-    LOG_INFO("  Dimensions: " << dimensions[0] << "x" << dimensions[1] << "x" << dimensions[2]);
-    LOG_INFO("  Total slices: " << dimensions[2]);
+    LOG_INFO("  Dimensions: " << default_survey_->get_width() << "x" << default_survey_->get_height()
+             << "x" << default_survey_->get_depth());
+    LOG_INFO("  Total slices: " << default_survey_->get_depth());
     
     return true;
 }
 
+bool WebRTCServer::add_survey(const std::string& id, const std::string& path) {
+    if (!surveys_) {
+        LOG_ERROR("Survey registry not initialized");
+        return false;
+    }
+    return surveys_->add_survey(id, path);
+}
+
+std::vector<std::string> WebRTCServer::get_survey_ids() const {
+    return surveys_ ? surveys_->survey_ids() : std::vector<std::string>();
+}
+
 std::string WebRTCServer::create_session(const SessionConfig& session_config) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    // Open the survey before taking the lock; a first open can take seconds
+    auto survey = surveys_ ? surveys_->acquire(make_view_key(session_config).survey) : nullptr;
+    if (!survey) {
+        LOG_ERROR("Survey not available: " << make_view_key(session_config).survey);
+        return "";
+    }
     
     std::string session_id;
     if (session_config.session_id.empty()) {
@@ -257,16 +248,16 @@ std::string WebRTCServer::create_session(const SessionConfig& session_config) {
     }
     
     // Check if session already exists
-    if (sessions_.find(session_id) != sessions_.end()) {
+    if (find_session(session_id)) {
         LOG_WARN("Session already exists: " << session_id);
         return session_id;
     }
     
-    // Create new session
+    // Create new session; peer connection setup runs unlocked too
     SessionConfig config = session_config;
     config.session_id = session_id;
     
-    auto session = std::make_unique<WebRTCSession>(session_id, peer_connection_factory_, config);
+    auto session = std::make_shared<WebRTCSession>(session_id, peer_connection_factory_, config);
     
     if (!session->initialize(config_.ice_servers)) {
         LOG_ERROR("Failed to initialize session: " << session_id);
@@ -298,22 +289,52 @@ std::string WebRTCServer::create_session(const SessionConfig& session_config) {
         }
     };
     
-    sessions_[session_id] = std::move(session);
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        
+        // Lost a race with an identical request
+        if (sessions_.find(session_id) != sessions_.end()) {
+            LOG_WARN("Session already exists: " << session_id);
+            return session_id;
+        }
+        sessions_[session_id] = std::move(session);
+        publish_snapshot();
+    }
+    
+    // Join the stream of an identical view, or start one; refuse the
+    // session when the pool has no encoder left for a new view
+    if (!attach_view(session_id)) {
+        LOG_ERROR("No view available for session: " << session_id);
+        remove_session(session_id);
+        return "";
+    }
     
     LOG_INFO("Created session: " << session_id);
     return session_id;
 }
 
+bool WebRTCServer::remove_session(const std::string& session_id) {
+    std::vector<std::unique_ptr<ViewStream>> retired;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        if (!erase_session(session_id, retired)) {
+            return false;
+        }
+        publish_snapshot();
+    }
+    stop_views(retired);
+    LOG_INFO("Removed session: " << session_id);
+    return true;
+}
+
 bool WebRTCServer::join_session(const std::string& session_id, const std::string& client_id) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    
-    auto it = sessions_.find(session_id);
-    if (it == sessions_.end()) {
+    auto session = find_session(session_id);
+    if (!session) {
         LOG_ERROR("Session not found: " << session_id);
         return false;
     }
     
-    if (!it->second->add_client(client_id)) {
+    if (!session->add_client(client_id)) {
         LOG_ERROR("Failed to add client to session: " << client_id << " -> " << session_id);
         return false;
     }
@@ -323,38 +344,43 @@ bool WebRTCServer::join_session(const std::string& session_id, const std::string
 }
 
 void WebRTCServer::leave_session(const std::string& session_id, const std::string& client_id) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    auto session = find_session(session_id);
+    if (!session) {
+        return;
+    }
     
-    auto it = sessions_.find(session_id);
-    if (it != sessions_.end()) {
-        it->second->remove_client(client_id);
-        LOG_INFO("Client left session: " << client_id << " <- " << session_id);
-        
-        // Remove session if no clients remain
-        if (it->second->get_clients().empty()) {
-            sessions_.erase(it);
-            LOG_INFO("Removed empty session: " << session_id);
+    session->remove_client(client_id);
+    LOG_INFO("Client left session: " << client_id << " <- " << session_id);
+    
+    // Remove session if no clients remain; checked again under the lock in
+    // case somebody joined meanwhile
+    if (session->get_clients().empty()) {
+        std::vector<std::unique_ptr<ViewStream>> retired;
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            auto it = sessions_.find(session_id);
+            if (it == sessions_.end() || it->second != session || !session->get_clients().empty()) {
+                return;
+            }
+            erase_session(session_id, retired);
+            publish_snapshot();
         }
+        stop_views(retired);
+        LOG_INFO("Removed empty session: " << session_id);
     }
 }
 
 void WebRTCServer::handle_offer(const std::string& session_id, const std::string& client_id, const std::string& sdp) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    
-    auto it = sessions_.find(session_id);
-    if (it != sessions_.end()) {
-        it->second->create_answer(client_id, sdp);
+    if (auto session = find_session(session_id)) {
+        session->create_answer(client_id, sdp);
     } else {
         LOG_ERROR("Session not found for offer: " << session_id);
     }
 }
 
 void WebRTCServer::handle_answer(const std::string& session_id, const std::string& client_id, const std::string& sdp) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    
-    auto it = sessions_.find(session_id);
-    if (it != sessions_.end()) {
-        it->second->set_remote_description(client_id, sdp, "answer");
+    if (auto session = find_session(session_id)) {
+        session->set_remote_description(client_id, sdp, "answer");
     } else {
         LOG_ERROR("Session not found for answer: " << session_id);
     }
@@ -362,18 +388,28 @@ void WebRTCServer::handle_answer(const std::string& session_id, const std::strin
 
 void WebRTCServer::handle_ice_candidate(const std::string& session_id, const std::string& client_id,
                                        const std::string& candidate, const std::string& sdp_mid, int sdp_mline_index) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    
-    auto it = sessions_.find(session_id);
-    if (it != sessions_.end()) {
-        it->second->add_ice_candidate(client_id, candidate, sdp_mid, sdp_mline_index);
+    if (auto session = find_session(session_id)) {
+        session->add_ice_candidate(client_id, candidate, sdp_mid, sdp_mline_index);
     } else {
         LOG_ERROR("Session not found for ICE candidate: " << session_id);
     }
 }
 
 void WebRTCServer::handle_control_message(const ControlMessage& message) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    // As in create_session(), a survey switch opens the survey unlocked
+    std::shared_ptr<const VDSManager> selected_survey;
+    if (message.type == ControlMessage::SELECT_SURVEY) {
+        auto survey = message.parameters.find("survey");
+        if (survey != message.parameters.end() && surveys_) {
+            selected_survey = surveys_->acquire(survey->second);
+        }
+        if (!selected_survey) {
+            LOG_ERROR("Survey not available for session " << message.session_id);
+            return;
+        }
+    }
+    
+    std::unique_lock<std::mutex> lock(sessions_mutex_);
     
     auto it = sessions_.find(message.session_id);
     if (it == sessions_.end()) {
@@ -410,7 +446,7 @@ void WebRTCServer::handle_control_message(const ControlMessage& message) {
             break;
             
         case ControlMessage::RESTART_ANIMATION:
-            animation_start_time_ = std::chrono::steady_clock::now();
+            animation_start_us_ = steady_now_us();
             config.current_slice = -1;  // Reset to animated mode
             config_changed = true;
             LOG_INFO("Animation restarted");
@@ -424,39 +460,443 @@ void WebRTCServer::handle_control_message(const ControlMessage& message) {
             }
             break;
             
+        case ControlMessage::SELECT_SURVEY:
+            config.survey_id = message.parameters.at("survey");
+            config.current_slice = -1;  // Slice indices don't carry over between surveys
+            config_changed = true;
+            LOG_INFO("Changed survey to: " << config.survey_id);
+            break;
+            
         default:
             LOG_WARN("Unknown control message type: " << static_cast<int>(message.type));
             break;
     }
     
-    if (config_changed) {
-        it->second->update_config(config);
+    if (!config_changed) {
+        return;
+    }
+    
+    it->second->update_config(config);
+    std::vector<std::unique_ptr<ViewStream>> retired;
+    const bool has_view = update_session_view(message.session_id, it->second.get(), retired);
+    publish_snapshot();
+    lock.unlock();
+    
+    // The old view's encoders are back in the pool before the new view asks for them
+    stop_views(retired);
+    if (!has_view && !attach_view(message.session_id)) {
+        LOG_ERROR("No view available for session " << message.session_id << " after config change");
     }
 }
 
-void WebRTCServer::render_loop() {
-    LOG_INFO("Starting WebRTC render loop");
-    
-    auto next_frame_time = std::chrono::steady_clock::now();
-    const auto frame_duration = std::chrono::microseconds(static_cast<int>(1000000.0f / config_.default_fps));
+void WebRTCServer::maintenance_loop() {
+    LOG_INFO("Starting WebRTC maintenance loop");
     
+    int cleanup_counter = 0;
     while (running_) {
-        auto frame_start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
         
-        // Render frames for all active sessions
+        // Update statistics
+        update_stats();
+        
+        // Cleanup inactive sessions periodically
+        if (++cleanup_counter % 100 == 0) {  // Every 10 seconds
+            cleanup_inactive_sessions();
+        }
+    }
+    
+    LOG_INFO("WebRTC maintenance loop ended");
+}
+
+bool WebRTCServer::ViewKey::operator<(const ViewKey& other) const {
+    return std::tie(survey, axis, slice, animation_speed, animation_duration, width, height, fps, bitrate_kbps) <
+           std::tie(other.survey, other.axis, other.slice, other.animation_speed, other.animation_duration,
+                    other.width, other.height, other.fps, other.bitrate_kbps);
+}
+
+std::string WebRTCServer::ViewKey::to_string() const {
+    std::ostringstream ss;
+    ss << survey << " axis " << axis << " ";
+    if (slice < 0) {
+        ss << "animated x" << animation_speed << "/" << animation_duration << "s";
+    } else {
+        ss << "slice " << slice;
+    }
+    ss << " " << width << "x" << height << "@" << fps << " " << bitrate_kbps << "kbps";
+    return ss.str();
+}
+
+WebRTCServer::ViewKey WebRTCServer::make_view_key(const SessionConfig& config) const {
+    ViewKey key;
+    key.survey = config.survey_id.empty() ? config_.default_survey : config.survey_id;
+    key.axis = VDSManager::orientation_to_axis(config.orientation);
+    key.width = config.width;
+    key.height = config.height;
+    key.fps = static_cast<int>(std::lround(config.fps));
+    
+    // Resolved like select_view_slice(): animated views follow the shared
+    // animation clock, everything else shows one fixed slice
+    if (config.animate && !config.paused && config.current_slice < 0) {
+        key.slice = -1;
+        key.animation_speed = config.animation_speed;
+        key.animation_duration = config.animation_duration;
+    } else {
+        key.slice = std::max(0, config.current_slice);
+    }
+    
+    const int requested = std::clamp(config.bitrate_kbps, config_.min_bitrate_kbps, config_.max_bitrate_kbps);
+    key.bitrate_kbps = config_.max_bitrate_kbps;
+    for (int tier : BITRATE_TIERS_KBPS) {
+        if (tier >= requested) {
+            key.bitrate_kbps = std::min(tier, config_.max_bitrate_kbps);
+            break;
+        }
+    }
+    return key;
+}
+
+bool WebRTCServer::attach_view(const std::string& session_id) {
+    std::unique_ptr<ViewStream> prepared;
+    for (;;) {
+        ViewKey key;
+        SessionConfig config;
+        bool done = false;
+        bool attached = false;
         {
             std::lock_guard<std::mutex> lock(sessions_mutex_);
-            for (auto& [session_id, session] : sessions_) {
-                if (session->is_active()) {
-                    render_session(session.get());
+            auto it = sessions_.find(session_id);
+            if (it == sessions_.end() || session_views_.count(session_id)) {
+                // Removed meanwhile, or a later config change attached it
+                done = true;
+                attached = it != sessions_.end();
+            } else {
+                config = it->second->get_config();
+                key = make_view_key(config);
+                if (subscribe_session(session_id, it->second.get(), key, prepared)) {
+                    publish_snapshot();
+                    done = true;
+                    attached = true;
                 }
             }
         }
         
-        // Update statistics
-        update_stats();
+        // Not adopted: the key's view appeared meanwhile, or the session now wants another one
+        if (prepared) {
+            stop_view(*prepared);
+            prepared.reset();
+        }
+        if (done) {
+            return attached;
+        }
+        
+        // Opening encoders can take a while; nobody waits on the lock for it
+        prepared = build_view(key, config);
+        if (!prepared) {
+            return false;
+        }
+    }
+}
+
+bool WebRTCServer::subscribe_session(const std::string& session_id, WebRTCSession* session, const ViewKey& key,
+                                     std::unique_ptr<ViewStream>& prepared) {
+    auto config = session->get_config();
+    
+    ViewStream* view = nullptr;
+    auto it = views_.find(key);
+    if (it != views_.end()) {
+        view = it->second.get();
+        LOG_INFO("Session " << session_id << " shares view " << key.to_string());
+    } else if (prepared && !(prepared->key < key) && !(key < prepared->key)) {
+        view = prepared.get();
+        if (running_) {
+            view->running = true;
+            view->render_thread = std::thread(&WebRTCServer::view_render_loop, this, view);
+        }
+        views_[key] = std::move(prepared);
+    } else {
+        return false;
+    }
+    
+    // Decoding can only start at an IDR; don't make the newcomer wait a GOP
+    const size_t layer = select_layer(*view, config);
+    view->layers[layer].encoder->request_keyframe();
+    {
+        std::lock_guard<std::mutex> lock(view->subscribers_mutex);
+        view->subscribers.push_back(Subscriber{session, Subscriber::NO_LAYER, layer, config.quality == "auto",
+                                               config.bitrate_kbps, 0});
+    }
+    session_views_[session_id] = key;
+    return true;
+}
+
+void WebRTCServer::unsubscribe_session(const std::string& session_id, std::vector<std::unique_ptr<ViewStream>>& retired) {
+    auto mapping = session_views_.find(session_id);
+    if (mapping == session_views_.end()) {
+        return;
+    }
+    
+    auto session_it = sessions_.find(session_id);
+    auto view_it = views_.find(mapping->second);
+    session_views_.erase(mapping);
+    if (view_it == views_.end()) {
+        return;
+    }
+    
+    ViewStream& view = *view_it->second;
+    bool empty = false;
+    {
+        // Once off the list the encoder callbacks can't reach the session
+        std::lock_guard<std::mutex> lock(view.subscribers_mutex);
+        if (session_it != sessions_.end()) {
+            WebRTCSession* session = session_it->second.get();
+            view.subscribers.erase(std::remove_if(view.subscribers.begin(), view.subscribers.end(),
+                                                  [session](const Subscriber& subscriber) {
+                                                      return subscriber.session == session;
+                                                  }),
+                                   view.subscribers.end());
+        }
+        empty = view.subscribers.empty();
+    }
+    
+    if (empty) {
+        LOG_INFO("Stopping view " << view.key.to_string());
+        retired.push_back(std::move(view_it->second));
+        views_.erase(view_it);
+    }
+}
+
+bool WebRTCServer::update_session_view(const std::string& session_id, WebRTCSession* session,
+                                       std::vector<std::unique_ptr<ViewStream>>& retired) {
+    auto mapping = session_views_.find(session_id);
+    auto config = session->get_config();
+    ViewKey key = make_view_key(config);
+    if (mapping != session_views_.end() && !(mapping->second < key) && !(key < mapping->second)) {
+        // Same picture; a quality change only moves the session along the ladder
+        set_subscriber_layer(*views_.at(key), session, config);
+        return true;
+    }
+    
+    // Leave the old view first so a session alone in it frees its encoders
+    // for the new one; an existing view for the new key is joined at once
+    unsubscribe_session(session_id, retired);
+    std::unique_ptr<ViewStream> none;
+    return subscribe_session(session_id, session, key, none);
+}
+
+std::unique_ptr<WebRTCServer::ViewStream> WebRTCServer::build_view(const ViewKey& key, const SessionConfig& config) {
+    // Callers have already opened the survey, so this only takes a reference
+    auto survey = surveys_ ? surveys_->acquire(key.survey) : nullptr;
+    if (!survey) {
+        LOG_ERROR("Survey not available for view " << key.to_string());
+        return nullptr;
+    }
+    
+    HardwareEncoder::Config encoder_config;
+    encoder_config.quality_preset = config_.encoder_quality;
+    encoder_config.width = key.width;
+    encoder_config.height = key.height;
+    encoder_config.fps = key.fps;
+    encoder_config.bitrate_kbps = key.bitrate_kbps;
+    encoder_config.max_bitrate_kbps = std::max(key.bitrate_kbps, std::min(key.bitrate_kbps * 3 / 2, config_.max_bitrate_kbps));
+    
+    // Optimize for low latency
+    encoder_config.enable_b_frames = false;
+    encoder_config.keyframe_interval = 30;  // More frequent keyframes for WebRTC
+    encoder_config.profile = "baseline";     // Matches the 42e0 format every session can negotiate
+    encoder_config.rate_control = HardwareEncoder::Config::VBR;
+    encoder_config.target_latency_ms = config_.target_latency_ms;
+    
+    auto view = std::make_unique<ViewStream>();
+    view->key = key;
+    view->survey = std::move(survey);
+    view->config = config;
+    view->config.bitrate_kbps = key.bitrate_kbps;
+    view->still_gate = StillFrameGate(8, std::chrono::milliseconds(std::max(100, config_.still_refresh_ms)));
+    ViewStream* raw_view = view.get();  // Stable once the view is adopted into views_
+    
+    const size_t max_layers = config_.enable_adaptive_quality ? std::max<size_t>(1, config_.simulcast_layers) : 1;
+    auto ladder = HardwareEncoder::make_simulcast_ladder(encoder_config, max_layers, config_.min_bitrate_kbps);
+    
+    for (size_t i = 0; i < ladder.size(); i++) {
+        // Runs on an encoder pool worker; release() waits for it before the view goes
+        auto lease = encoder_pool_->acquire(ladder[i],
+            [this, raw_view, i](const std::vector<uint8_t>& encoded_frame, bool keyframe) {
+                deliver_layer_frame(*raw_view, i, encoded_frame, keyframe);
+            });
+        if (!lease) {
+            // The full-size layer is required; lower ones are a bonus
+            if (i == 0) {
+                return nullptr;  // No layers leased yet, nothing to release
+            }
+            LOG_WARN("Encoder pool exhausted, view " << key.to_string() << " runs "
+                     << i << " of " << ladder.size() << " simulcast layers");
+            break;
+        }
+        
+        ViewLayer layer;
+        layer.encoder_config = ladder[i];
+        layer.encoder = lease;
+        layer.bitrate_kbps = ladder[i].bitrate_kbps;
+        view->layers.push_back(std::move(layer));
+        
+        LOG_INFO("View " << key.to_string() << " layer " << i << ": " << ladder[i].width << "x" << ladder[i].height
+                 << " @ " << ladder[i].bitrate_kbps << " kbps on " << lease->encoder_name()
+                 << (lease->is_hardware() ? " (GPU)" : " (CPU)"));
+    }
+    
+    return view;
+}
+
+void WebRTCServer::stop_view(ViewStream& view) {
+    // Joins the render thread and waits out in-flight encodes; never under sessions_mutex_
+    view.running = false;
+    if (view.render_thread.joinable()) {
+        view.render_thread.join();
+    }
+    for (auto& layer : view.layers) {
+        encoder_pool_->release(layer.encoder);
+    }
+    view.survey.reset();  // Closes the survey if this was its last view
+}
+
+void WebRTCServer::stop_views(std::vector<std::unique_ptr<ViewStream>>& views) {
+    for (auto& view : views) {
+        stop_view(*view);
+    }
+    views.clear();
+}
+
+size_t WebRTCServer::select_layer(const ViewStream& view, const SessionConfig& config) const {
+    const size_t last = view.layers.size() - 1;
+    if (config.quality == "high") return 0;
+    if (config.quality == "medium") return std::min<size_t>(1, last);
+    if (config.quality == "low") return last;
+    
+    // "auto": the largest layer within the session's bitrate
+    return layer_for_bitrate(view, config.bitrate_kbps);
+}
+
+size_t WebRTCServer::layer_for_bitrate(const ViewStream& view, int bitrate_kbps) {
+    for (size_t i = 0; i < view.layers.size(); i++) {
+        if (view.layers[i].encoder_config.bitrate_kbps <= bitrate_kbps) {
+            return i;
+        }
+    }
+    return view.layers.size() - 1;
+}
+
+void WebRTCServer::set_subscriber_layer(ViewStream& view, WebRTCSession* session, const SessionConfig& config) {
+    const size_t layer = std::min(select_layer(view, config), view.layers.size() - 1);
+    bool switching = false;
+    {
+        std::lock_guard<std::mutex> lock(view.subscribers_mutex);
+        for (auto& subscriber : view.subscribers) {
+            if (subscriber.session != session) {
+                continue;
+            }
+            // The current estimate is applied again on the next frame
+            subscriber.auto_quality = config.quality == "auto";
+            subscriber.bitrate_kbps = config.bitrate_kbps;
+            subscriber.estimate_kbps = 0;
+            if (subscriber.target_layer != layer) {
+                subscriber.target_layer = layer;
+                switching = subscriber.layer != layer;
+            }
+        }
+    }
+    
+    // The switch happens at the new layer's next keyframe; ask for one now
+    if (switching) {
+        view.layers[layer].encoder->request_keyframe();
+        LOG_INFO("Session moving to layer " << layer << " (" << view.layers[layer].encoder_config.width << "x"
+                 << view.layers[layer].encoder_config.height << ") of view " << view.key.to_string());
+    }
+}
+
+void WebRTCServer::deliver_layer_frame(ViewStream& view, size_t layer, const std::vector<uint8_t>& encoded_frame,
+                                       bool keyframe) {
+    size_t sent = 0;
+    {
+        std::lock_guard<std::mutex> lock(view.subscribers_mutex);
+        for (auto& subscriber : view.subscribers) {
+            // Frames of the new layer only decode from its keyframe on;
+            // until then the session stays on the old one
+            if (keyframe && subscriber.target_layer == layer) {
+                subscriber.layer = layer;
+            }
+            if (subscriber.layer == layer) {
+                subscriber.session->send_frame(encoded_frame, keyframe, view.layers[layer].encoder_config.width,
+                                               view.layers[layer].encoder_config.height);
+                sent++;
+            }
+        }
+    }
+    
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    stats_.frames_encoded++;
+    stats_.bytes_sent += encoded_frame.size() * sent;
+}
+
+void WebRTCServer::apply_receiver_feedback(ViewStream& view, bool& keyframe_pending) {
+    const size_t bottom = view.layers.size() - 1;
+    bool estimates_changed = false;
+    
+    for (auto& subscriber : view.subscribers) {
+        // PLI / FIR: a receiver lost sync with the layer it decodes
+        if (subscriber.session->take_keyframe_request() && subscriber.layer != Subscriber::NO_LAYER) {
+            view.layers[subscriber.layer].encoder->request_keyframe();
+            keyframe_pending = true;
+        }
+        
+        const int estimate = subscriber.session->get_bitrate_estimate();
+        if (estimate == subscriber.estimate_kbps) {
+            continue;
+        }
+        subscriber.estimate_kbps = estimate;
+        estimates_changed = true;
+        
+        // Congestion moves an auto session down the ladder, recovery back up
+        if (subscriber.auto_quality && estimate > 0) {
+            const size_t layer = layer_for_bitrate(view, std::min(subscriber.bitrate_kbps, estimate));
+            if (layer != subscriber.target_layer) {
+                subscriber.target_layer = layer;
+                view.layers[layer].encoder->request_keyframe();
+                keyframe_pending = true;
+            }
+        }
+    }
+    if (!estimates_changed) {
+        return;
+    }
+    
+    // Sessions already on the bottom layer have nowhere lower to go, so its
+    // encoder follows the slowest of them; the layers above keep their rate
+    ViewLayer& layer = view.layers[bottom];
+    int target = layer.encoder_config.bitrate_kbps;
+    for (const auto& subscriber : view.subscribers) {
+        if (subscriber.target_layer == bottom && subscriber.estimate_kbps > 0) {
+            target = std::min(target, subscriber.estimate_kbps);
+        }
+    }
+    target = std::max(target, MIN_FEEDBACK_BITRATE_KBPS);
+    if (target != layer.bitrate_kbps) {
+        layer.bitrate_kbps = target;
+        layer.encoder->set_bitrate(target);
+        LOG_INFO("View " << view.key.to_string() << " bottom layer at " << target << " kbps from receiver feedback");
+    }
+}
+
+void WebRTCServer::view_render_loop(ViewStream* view) {
+    VDSManager::SliceBuffer slice;
+    std::vector<uint8_t> slice_rgb;
+    auto next_frame_time = std::chrono::steady_clock::now();
+    const float fps = view->key.fps > 0 ? static_cast<float>(view->key.fps) : config_.default_fps;
+    const auto frame_duration = std::chrono::microseconds(static_cast<int>(1000000.0f / fps));
+    
+    while (view->running) {
+        render_view(view, slice, slice_rgb);
         
-        // Frame timing
+        // Frame timing, at this view's own rate
         next_frame_time += frame_duration;
         auto now = std::chrono::steady_clock::now();
         
@@ -466,80 +906,162 @@ void WebRTCServer::render_loop() {
             // We're behind schedule, skip frame timing adjustment
             next_frame_time = now;
         }
-        
-        // Cleanup inactive sessions periodically
-        static int cleanup_counter = 0;
-        if (++cleanup_counter % 300 == 0) {  // Every 10 seconds at 30fps
-            cleanup_inactive_sessions();
-        }
     }
-    
-    LOG_INFO("WebRTC render loop ended");
 }
 
-void WebRTCServer::render_session(WebRTCSession* session) {
-    if (!session || !session->is_active()) {
+void WebRTCServer::render_view(ViewStream* view, VDSManager::SliceBuffer& slice, std::vector<uint8_t>& slice_rgb) {
+    // Only layers somebody receives, or is switching to, get encoded
+    std::vector<bool> wanted(view->layers.size(), false);
+    bool any_active = false;
+    bool keyframe_pending = false;  // A subscriber joining, or switching layer
+    {
+        std::lock_guard<std::mutex> lock(view->subscribers_mutex);
+        apply_receiver_feedback(*view, keyframe_pending);
+        for (const auto& subscriber : view->subscribers) {
+            if (subscriber.session->is_active()) {
+                if (subscriber.layer != Subscriber::NO_LAYER) {
+                    wanted[subscriber.layer] = true;
+                }
+                wanted[subscriber.target_layer] = true;
+                keyframe_pending |= subscriber.layer != subscriber.target_layer;
+                any_active = true;
+            }
+        }
+    }
+    if (!any_active) {
         return;
     }
     
-    auto config = session->get_config();
-    
     // Calculate animation time
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration<float>(now - animation_start_time_).count();
-    float animation_time = elapsed * config.animation_speed;
+    float elapsed = static_cast<float>(steady_now_us() - animation_start_us_.load()) / 1000000.0f;
+    float animation_time = elapsed * view->config.animation_speed;
     
-    // Render VDS frame
-    auto rgb_data = render_vds_frame(config, animation_time);
+    int axis = 0, index = 0;
+    const VDSManager& survey = *view->survey;
+    if (!select_view_slice(survey, view->config, animation_time, axis, index)) {
+        return;
+    }
     
-    if (!rgb_data.empty()) {
-        // Encode frame using hardware encoder
-        std::lock_guard<std::mutex> encoder_lock(encoder_mutex_);
-        auto encoded_frame = hardware_encoder_->encode_frame(rgb_data);
-        
-        if (!encoded_frame.empty()) {
-            session->send_frame(encoded_frame);
-            
-            // Update statistics
-            std::lock_guard<std::mutex> stats_lock(stats_mutex_);
-            stats_.frames_encoded++;
-            stats_.bytes_sent += encoded_frame.size();
+    // A paused or fixed-slice view repeats one picture; browsers keep the
+    // last frame up, so nothing is rendered or encoded until it changes
+    StillFrameGate::Decision decision = StillFrameGate::Decision::RENDER;
+    if (config_.skip_still_frames) {
+        view->gated_colormap = survey.get_colormap();
+        StillFrameGate::View still;
+        still.axis = axis;
+        still.index = index;
+        still.colormap = view->gated_colormap.get();
+        still.width = view->key.width;
+        still.height = view->key.height;
+        decision = view->still_gate.update(still, keyframe_pending);
+        if (decision == StillFrameGate::Decision::SKIP) {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.frames_unchanged++;
+            return;
         }
     }
+    
+    // Extract the slice once, then scale it to every layer; the pool
+    // encodes the layers on whichever workers are free
+    if (!survey.get_slice_rgb(axis, index, slice, slice_rgb)) {
+        return;
+    }
+    for (size_t i = 0; i < view->layers.size(); i++) {
+        if (!wanted[i]) {
+            continue;
+        }
+        ViewLayer& layer = view->layers[i];
+        if (decision == StillFrameGate::Decision::REFRESH) {
+            layer.encoder->request_keyframe();
+        }
+        scale_rgb(slice_rgb, slice.width, slice.height,
+                  layer.encoder_config.width, layer.encoder_config.height, layer.rgb);
+        encoder_pool_->submit(layer.encoder, layer.rgb.data(), layer.rgb.size());
+    }
 }
 
-std::vector<uint8_t> WebRTCServer::render_vds_frame(const SessionConfig& config, float animation_time) {
-    if (!vds_manager_) {
-        return {};
+bool WebRTCServer::select_view_slice(const VDSManager& survey, const SessionConfig& config, float animation_time,
+                                     int& axis, int& index) const {
+    if (!survey.has_vds()) {
+        return false;
     }
     
-    // Calculate slice position based on animation
-    int slice_axis = 2;  // Default to Z axis for XZ orientation
-    if (config.orientation == "XY") slice_axis = 2;
-    else if (config.orientation == "XZ") slice_axis = 1;
-    else if (config.orientation == "YZ") slice_axis = 0;
-    
+    // Only const VDSManager calls here: every view thread renders at once
+    int slice_axis = VDSManager::orientation_to_axis(config.orientation);
     int slice_index = config.current_slice;
     
     if (config.animate && !config.paused && slice_index < 0) {
-        auto dimensions = vds_manager_->get_dimensions();
-        float progress = fmod(animation_time / config.animation_duration, 1.0f);
-        slice_index = static_cast<int>(progress * dimensions[slice_axis]);
-        slice_index = std::clamp(slice_index, 0, dimensions[slice_axis] - 1);
+        slice_index = survey.get_animated_slice_index(slice_axis, animation_time, config.animation_duration);
     }
-    
-    // Set slice parameters
-    vds_manager_->set_slice_orientation(config.orientation);
-    vds_manager_->set_slice_params(slice_axis, slice_index);
-    
-    // Render frame
-    return vds_manager_->render_frame(config.width, config.height);
+    axis = slice_axis;
+    index = std::clamp(slice_index, 0, std::max(0, survey.get_axis_length(slice_axis) - 1));
+    return true;
+}
+
+void WebRTCServer::scale_rgb(const std::vector<uint8_t>& src, int src_width, int src_height,
+                             int width, int height, std::vector<uint8_t>& dst) {
+    // Nearest-neighbour; the slice is already at data resolution
+    dst.resize(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; y++) {
+        const int src_y = static_cast<int>(static_cast<int64_t>(y) * src_height / height);
+        const uint8_t* src_row = src.data() + static_cast<size_t>(src_y) * src_width * 3;
+        uint8_t* dst_row = dst.data() + static_cast<size_t>(y) * width * 3;
+        for (int x = 0; x < width; x++) {
+            const int src_x = static_cast<int>(static_cast<int64_t>(x) * src_width / width);
+            std::memcpy(dst_row + x * 3, src_row + src_x * 3, 3);
+        }
+    }
+}
+
+std::shared_ptr<const WebRTCServer::SessionSnapshot> WebRTCServer::load_snapshot() const {
+    auto snapshot = std::atomic_load(&snapshot_);
+    if (!snapshot) {
+        static const auto empty = std::make_shared<const SessionSnapshot>();
+        return empty;
+    }
+    return snapshot;
+}
+
+std::shared_ptr<WebRTCSession> WebRTCServer::find_session(const std::string& session_id) const {
+    auto snapshot = load_snapshot();
+    auto it = snapshot->sessions.find(session_id);
+    return it != snapshot->sessions.end() ? it->second : nullptr;
+}
+
+void WebRTCServer::publish_snapshot() {
+    // Copy on write: readers keep whichever snapshot they loaded
+    auto snapshot = std::make_shared<SessionSnapshot>();
+    snapshot->sessions = sessions_;
+    for (const auto& [session_id, key] : session_views_) {
+        auto view_it = views_.find(key);
+        if (view_it != views_.end()) {
+            snapshot->session_encoders[session_id] = view_it->second->layers[0].encoder;
+        }
+    }
+    for (const auto& [key, view] : views_) {
+        for (const auto& layer : view->layers) {
+            snapshot->encoders.push_back(layer.encoder);
+        }
+    }
+    snapshot->views = views_.size();
+    std::atomic_store(&snapshot_, std::shared_ptr<const SessionSnapshot>(std::move(snapshot)));
+}
+
+bool WebRTCServer::erase_session(const std::string& session_id, std::vector<std::unique_ptr<ViewStream>>& retired) {
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end()) {
+        return false;
+    }
+    unsubscribe_session(session_id, retired);
+    sessions_.erase(it);
+    return true;
 }
 
 std::string WebRTCServer::generate_session_id() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(0, 15);
+    // Sessions are created from any signaling thread
+    thread_local std::random_device rd;
+    thread_local std::mt19937 gen(rd());
+    thread_local std::uniform_int_distribution<> dis(0, 15);
     
     std::stringstream ss;
     for (int i = 0; i < 8; i++) {
@@ -549,43 +1071,73 @@ std::string WebRTCServer::generate_session_id() {
 }
 
 void WebRTCServer::cleanup_inactive_sessions() {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    // Scan the snapshot; the lock is only taken when there is something to remove
+    std::vector<std::string> inactive;
+    for (const auto& [session_id, session] : load_snapshot()->sessions) {
+        if (!session->is_active()) {
+            inactive.push_back(session_id);
+        }
+    }
+    if (inactive.empty()) {
+        return;
+    }
     
-    auto it = sessions_.begin();
-    while (it != sessions_.end()) {
-        if (!it->second->is_active()) {
-            LOG_INFO("Removing inactive session: " << it->first);
-            it = sessions_.erase(it);
-        } else {
-            ++it;
+    std::vector<std::unique_ptr<ViewStream>> retired;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        for (const auto& session_id : inactive) {
+            LOG_INFO("Removing inactive session: " << session_id);
+            erase_session(session_id, retired);
         }
+        publish_snapshot();
     }
+    stop_views(retired);
 }
 
 void WebRTCServer::update_stats() {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    
     auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration<float>(now - stats_start_time_).count();
-    
-    if (elapsed >= 1.0f) {  // Update every second
-        stats_.active_sessions = sessions_.size();
-        
-        size_t total_clients = 0;
-        for (const auto& [session_id, session] : sessions_) {
-            total_clients += session->get_clients().size();
-        }
-        stats_.total_clients = total_clients;
-        
-        // Get hardware encoder stats
-        if (hardware_encoder_) {
-            auto encoder_stats = hardware_encoder_->get_stats();
-            stats_.avg_encoding_time_ms = encoder_stats.avg_encode_time_ms;
-            stats_.avg_frame_rate = 1000.0f / encoder_stats.avg_encode_time_ms;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        if (std::chrono::duration<float>(now - stats_start_time_).count() < 1.0f) {  // Update every second
+            return;
         }
-        
         stats_start_time_ = now;
     }
+    
+    // Gathered from the snapshot; leases stay readable after their view stops
+    auto snapshot = load_snapshot();
+    
+    size_t total_clients = 0;
+    for (const auto& [session_id, session] : snapshot->sessions) {
+        total_clients += session->get_clients().size();
+    }
+    
+    // Per-view encoder stats, averaged; sessions report their view's
+    float total_encode_ms = 0.0f;
+    for (const auto& encoder : snapshot->encoders) {
+        total_encode_ms += encoder->get_stats().avg_encode_time_ms;
+    }
+    std::unordered_map<std::string, float> session_stats;
+    for (const auto& [session_id, encoder] : snapshot->session_encoders) {
+        session_stats[session_id] = encoder->get_stats().avg_encode_time_ms;
+    }
+    const size_t open_surveys = surveys_ ? surveys_->open_count() : 0;
+    
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.active_sessions = snapshot->sessions.size();
+    stats_.total_clients = total_clients;
+    stats_.session_stats = std::move(session_stats);
+    stats_.active_views = snapshot->views;
+    stats_.open_surveys = open_surveys;
+    stats_.avg_encoding_time_ms = snapshot->encoders.empty() ? 0.0f : total_encode_ms / snapshot->encoders.size();
+    stats_.avg_frame_rate = stats_.avg_encoding_time_ms > 0.0f ? 1000.0f / stats_.avg_encoding_time_ms : 0.0f;
+    
+    if (encoder_pool_) {
+        auto pool_stats = encoder_pool_->get_stats();
+        stats_.frames_dropped = pool_stats.frames_dropped;
+        stats_.gpu_encoders = pool_stats.gpu_encoders;
+        stats_.cpu_encoders = pool_stats.cpu_encoders;
+    }
 }
 
 WebRTCServer::Stats WebRTCServer::get_stats() const {
@@ -594,8 +1146,9 @@ WebRTCServer::Stats WebRTCServer::get_stats() const {
 }
 
 void WebRTCServer::cleanup() {
-    hardware_encoder_.reset();
-    vds_manager_.reset();
+    encoder_pool_.reset();
+    default_survey_.reset();
+    surveys_.reset();
     peer_connection_factory_ = nullptr;
 }
 
@@ -1,4 +1,5 @@
 #include "blustream/server/webrtc_server.h"
+#include "blustream/server/webrtc_passthrough.h"
 #include "blustream/common/logger.h"
 
 // WebRTC includes
@@ -134,7 +135,8 @@ WebRTCSession::WebRTCSession(const std::string& session_id,
     : session_id_(session_id)
     , config_(config)
     , active_(false)
-    , factory_(factory) {
+    , factory_(factory)
+    , feedback_(std::make_shared<EncodedStreamFeedback>()) {
 }
 
 WebRTCSession::~WebRTCSession() {
@@ -223,6 +225,14 @@ bool WebRTCSession::add_client(const std::string& client_id) {
         }
     }
     
+    // Frames arrive already encoded, so libwebrtc must never drop or rescale
+    // them itself; congestion is answered by our bitrate and layer choice
+    for (const auto& sender : peer_connection->GetSenders()) {
+        auto parameters = sender->GetParameters();
+        parameters.degradation_preference = webrtc::DegradationPreference::DISABLED;
+        sender->SetParameters(parameters);
+    }
+    
     // Store peer connection
     peer_connections_[client_id] = peer_connection;
     clients_.push_back(client_id);
@@ -353,30 +363,32 @@ void WebRTCSession::add_ice_candidate(const std::string& client_id, const std::s
     }
 }
 
-void WebRTCSession::send_frame(const std::vector<uint8_t>& encoded_frame) {
-    // For WebRTC, we need to send raw video frames, not encoded frames
-    // The WebRTC library handles encoding internally
-    // This would need to be adapted to send raw RGB data to the video source
-    
-    if (video_source_) {
-        // Extract dimensions from config
-        int width = config_.width;
-        int height = config_.height;
-        
-        // Assuming the encoded_frame is actually RGB data for this implementation
-        // In a real implementation, you'd need to decode the frame first
-        // or modify the pipeline to provide raw frames
-        
-        // For now, we'll log the frame send
-        std::lock_guard<std::mutex> lock(stats_mutex_);
-        stats_.frames_sent++;
-        stats_.bytes_sent += encoded_frame.size();
+void WebRTCSession::send_frame(const std::vector<uint8_t>& encoded_frame, bool keyframe, int width, int height) {
+    if (!active_ || !video_source_) {
+        return;
     }
+    
+    // Each client's passthrough encoder forwards the same access unit to
+    // its RTP packetizer; nothing is decoded or encoded again
+    video_source_->push_frame(encoded_frame.data(), encoded_frame.size(), keyframe, width, height, feedback_);
+    
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.frames_sent++;
+    stats_.bytes_sent += encoded_frame.size();
+}
+
+void WebRTCSession::send_frame_to_client(const std::string& client_id, const std::vector<uint8_t>& encoded_frame,
+                                         bool keyframe, int width, int height) {
+    // All clients share the session's track
+    send_frame(encoded_frame, keyframe, width, height);
+}
+
+bool WebRTCSession::take_keyframe_request() {
+    return feedback_->take_keyframe_request();
 }
 
-void WebRTCSession::send_frame_to_client(const std::string& client_id, const std::vector<uint8_t>& encoded_frame) {
-    // Similar to send_frame but for a specific client
-    send_frame(encoded_frame);
+int WebRTCSession::get_bitrate_estimate() const {
+    return feedback_->target_bitrate_kbps();
 }
 
 void WebRTCSession::update_config(const WebRTCServer::SessionConfig& new_config) {
@@ -385,16 +397,15 @@ void WebRTCSession::update_config(const WebRTCServer::SessionConfig& new_config)
 }
 
 bool WebRTCSession::create_media_stream() {
-    // Create custom video source
-    video_source_ = rtc::scoped_refptr<CustomVideoSource>(new rtc::RefCountedObject<CustomVideoSource>());
-    
-    if (!video_source_) {
-        LOG_ERROR("Failed to create video source");
-        return false;
-    }
+    // Source for pre-encoded frames; the reference taken here is dropped by the deleter
+    EncodedVideoSource* source = new rtc::RefCountedObject<EncodedVideoSource>();
+    source->AddRef();
+    video_source_ = std::shared_ptr<EncodedVideoSource>(source, [](EncodedVideoSource* released) {
+        released->Release();
+    });
     
     // Create video track
-    video_track_ = factory_->CreateVideoTrack("video_track", video_source_);
+    video_track_ = factory_->CreateVideoTrack("video_track", video_source_.get());
     
     if (!video_track_) {
         LOG_ERROR("Failed to create video track");
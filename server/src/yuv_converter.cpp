@@ -0,0 +1,366 @@
+#include "blustream/server/yuv_converter.h"
+#include "blustream/server/thread_pool.h"
+#include "blustream/common/logger.h"
+
+#include <algorithm>
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLUSTREAM_YUV_X86 1
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define BLUSTREAM_YUV_NEON 1
+#endif
+
+namespace blustream {
+namespace server {
+
+namespace {
+
+// One output row pair: Y for both rows and the U/V row between them. rgb1 and
+// y1 may alias row 0 for the last row of an odd-height frame.
+struct RowPair {
+    const uint8_t* rgb0;
+    const uint8_t* rgb1;
+    uint8_t* y0;
+    uint8_t* y1;
+    uint8_t* u;
+    uint8_t* v;
+};
+
+// Scalar kernel; also finishes the columns the SIMD kernels leave behind
+void convert_pair_scalar(const RowPair& row, int begin, int width) {
+    for (int x = begin; x < width; x += 2) {
+        const int x1 = std::min(x + 1, width - 1);
+        const uint8_t* p[4] = {row.rgb0 + x * 3, row.rgb0 + x1 * 3, row.rgb1 + x * 3, row.rgb1 + x1 * 3};
+
+        row.y0[x] = YUVConverter::luma(p[0][0], p[0][1], p[0][2]);
+        row.y1[x] = YUVConverter::luma(p[2][0], p[2][1], p[2][2]);
+        if (x1 != x) {
+            row.y0[x1] = YUVConverter::luma(p[1][0], p[1][1], p[1][2]);
+            row.y1[x1] = YUVConverter::luma(p[3][0], p[3][1], p[3][2]);
+        }
+
+        // Average the 2x2 block in RGB, then convert once
+        const uint8_t r = static_cast<uint8_t>((p[0][0] + p[1][0] + p[2][0] + p[3][0] + 2) >> 2);
+        const uint8_t g = static_cast<uint8_t>((p[0][1] + p[1][1] + p[2][1] + p[3][1] + 2) >> 2);
+        const uint8_t b = static_cast<uint8_t>((p[0][2] + p[1][2] + p[2][2] + p[3][2] + 2) >> 2);
+        row.u[x / 2] = YUVConverter::chroma_u(r, g, b);
+        row.v[x / 2] = YUVConverter::chroma_v(r, g, b);
+    }
+}
+
+#if BLUSTREAM_YUV_X86
+
+// Split 16 packed RGB pixels (48 bytes) into R, G and B byte vectors
+__attribute__((target("sse4.1")))
+inline void deinterleave_rgb16(const uint8_t* src, __m128i& r, __m128i& g, __m128i& b) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+
+    r = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(a, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(m, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(c, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13)));
+    g = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(a, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(m, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(c, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14)));
+    b = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(a, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(m, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(c, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15)));
+}
+
+// Y for eight 16-bit pixels; the weighted sum stays below 65536 so unsigned lanes suffice
+__attribute__((target("sse4.1")))
+inline __m128i luma8_sse(__m128i r, __m128i g, __m128i b) {
+    __m128i y = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+    y = _mm_add_epi16(y, _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+    return _mm_add_epi16(_mm_srli_epi16(y, 8), _mm_set1_epi16(16));
+}
+
+__attribute__((target("sse4.1")))
+inline __m128i chroma8_sse(__m128i r, __m128i g, __m128i b, short cr, short cg, short cb) {
+    __m128i c = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)), _mm_mullo_epi16(g, _mm_set1_epi16(cg)));
+    c = _mm_add_epi16(c, _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(cb)), _mm_set1_epi16(128)));
+    return _mm_add_epi16(_mm_srai_epi16(c, 8), _mm_set1_epi16(128));
+}
+
+// Rounded mean of each 2x2 block across two rows of 16 bytes
+__attribute__((target("sse4.1")))
+inline __m128i average2x2_sse(__m128i top, __m128i bottom) {
+    const __m128i ones = _mm_set1_epi8(1);
+    __m128i sum = _mm_add_epi16(_mm_maddubs_epi16(top, ones), _mm_maddubs_epi16(bottom, ones));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+__attribute__((target("sse4.1")))
+inline void store_chroma8_sse(const __m128i r0[3], const __m128i r1[3], uint8_t* u, uint8_t* v) {
+    const __m128i r = average2x2_sse(r0[0], r1[0]);
+    const __m128i g = average2x2_sse(r0[1], r1[1]);
+    const __m128i b = average2x2_sse(r0[2], r1[2]);
+    const __m128i cu = chroma8_sse(r, g, b, -38, -74, 112);
+    const __m128i cv = chroma8_sse(r, g, b, 112, -94, -18);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(u), _mm_packus_epi16(cu, cu));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(v), _mm_packus_epi16(cv, cv));
+}
+
+__attribute__((target("sse4.1")))
+inline void store_luma16_sse(const __m128i px[3], uint8_t* dst) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = luma8_sse(_mm_unpacklo_epi8(px[0], zero), _mm_unpacklo_epi8(px[1], zero),
+                                 _mm_unpacklo_epi8(px[2], zero));
+    const __m128i hi = luma8_sse(_mm_unpackhi_epi8(px[0], zero), _mm_unpackhi_epi8(px[1], zero),
+                                 _mm_unpackhi_epi8(px[2], zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(lo, hi));
+}
+
+__attribute__((target("sse4.1")))
+int convert_pair_sse41(const RowPair& row, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i p0[3], p1[3];
+        deinterleave_rgb16(row.rgb0 + x * 3, p0[0], p0[1], p0[2]);
+        deinterleave_rgb16(row.rgb1 + x * 3, p1[0], p1[1], p1[2]);
+
+        store_luma16_sse(p0, row.y0 + x);
+        store_luma16_sse(p1, row.y1 + x);
+        store_chroma8_sse(p0, p1, row.u + x / 2, row.v + x / 2);
+    }
+    return x;
+}
+
+// AVX2 does the luma math for all 16 pixels in one register
+__attribute__((target("avx2")))
+inline void store_luma16_avx2(const __m128i px[3], uint8_t* dst) {
+    const __m256i r = _mm256_cvtepu8_epi16(px[0]);
+    const __m256i g = _mm256_cvtepu8_epi16(px[1]);
+    const __m256i b = _mm256_cvtepu8_epi16(px[2]);
+
+    __m256i y = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(66)),
+                                 _mm256_mullo_epi16(g, _mm256_set1_epi16(129)));
+    y = _mm256_add_epi16(y, _mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(25)),
+                                             _mm256_set1_epi16(128)));
+    y = _mm256_add_epi16(_mm256_srli_epi16(y, 8), _mm256_set1_epi16(16));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                     _mm_packus_epi16(_mm256_castsi256_si128(y), _mm256_extracti128_si256(y, 1)));
+}
+
+__attribute__((target("avx2")))
+int convert_pair_avx2(const RowPair& row, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i p0[3], p1[3];
+        deinterleave_rgb16(row.rgb0 + x * 3, p0[0], p0[1], p0[2]);
+        deinterleave_rgb16(row.rgb1 + x * 3, p1[0], p1[1], p1[2]);
+
+        store_luma16_avx2(p0, row.y0 + x);
+        store_luma16_avx2(p1, row.y1 + x);
+        store_chroma8_sse(p0, p1, row.u + x / 2, row.v + x / 2);
+    }
+    return x;
+}
+
+bool cpu_has_avx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+bool cpu_has_sse41() {
+    static const bool has_sse41 = __builtin_cpu_supports("sse4.1");
+    return has_sse41;
+}
+
+#endif // BLUSTREAM_YUV_X86
+
+#if BLUSTREAM_YUV_NEON
+
+inline uint8x16_t luma16_neon(const uint8x16x3_t& px) {
+    uint16x8_t lo = vmull_u8(vget_low_u8(px.val[0]), vdup_n_u8(66));
+    lo = vmlal_u8(lo, vget_low_u8(px.val[1]), vdup_n_u8(129));
+    lo = vmlal_u8(lo, vget_low_u8(px.val[2]), vdup_n_u8(25));
+    uint16x8_t hi = vmull_u8(vget_high_u8(px.val[0]), vdup_n_u8(66));
+    hi = vmlal_u8(hi, vget_high_u8(px.val[1]), vdup_n_u8(129));
+    hi = vmlal_u8(hi, vget_high_u8(px.val[2]), vdup_n_u8(25));
+
+    // vrshrn computes (x + 128) >> 8
+    return vaddq_u8(vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)), vdupq_n_u8(16));
+}
+
+inline int16x8_t average2x2_neon(uint8x16_t top, uint8x16_t bottom) {
+    return vreinterpretq_s16_u16(vrshrq_n_u16(vpadalq_u8(vpaddlq_u8(top), bottom), 2));
+}
+
+inline uint8x8_t chroma8_neon(int16x8_t r, int16x8_t g, int16x8_t b, int16_t cr, int16_t cg, int16_t cb) {
+    int16x8_t c = vmulq_n_s16(r, cr);
+    c = vmlaq_n_s16(c, g, cg);
+    c = vmlaq_n_s16(c, b, cb);
+    return vqmovun_s16(vaddq_s16(vrshrq_n_s16(c, 8), vdupq_n_s16(128)));
+}
+
+int convert_pair_neon(const RowPair& row, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const uint8x16x3_t p0 = vld3q_u8(row.rgb0 + x * 3);
+        const uint8x16x3_t p1 = vld3q_u8(row.rgb1 + x * 3);
+
+        vst1q_u8(row.y0 + x, luma16_neon(p0));
+        vst1q_u8(row.y1 + x, luma16_neon(p1));
+
+        const int16x8_t r = average2x2_neon(p0.val[0], p1.val[0]);
+        const int16x8_t g = average2x2_neon(p0.val[1], p1.val[1]);
+        const int16x8_t b = average2x2_neon(p0.val[2], p1.val[2]);
+        vst1_u8(row.u + x / 2, chroma8_neon(r, g, b, -38, -74, 112));
+        vst1_u8(row.v + x / 2, chroma8_neon(r, g, b, 112, -94, -18));
+    }
+    return x;
+}
+
+#endif // BLUSTREAM_YUV_NEON
+
+void convert_pair(const RowPair& row, int width) {
+    int done = 0;
+#if BLUSTREAM_YUV_X86
+    if (cpu_has_avx2()) {
+        done = convert_pair_avx2(row, width);
+    } else if (cpu_has_sse41()) {
+        done = convert_pair_sse41(row, width);
+    }
+#elif BLUSTREAM_YUV_NEON
+    done = convert_pair_neon(row, width);
+#endif
+    convert_pair_scalar(row, done, width);
+}
+
+} // namespace
+
+YUVConverter::YUVConverter()
+    : sws_context_(nullptr)
+    , sws_width_(0)
+    , sws_height_(0) {
+    configure(Config());
+}
+
+YUVConverter::~YUVConverter() {
+    if (sws_context_) {
+        sws_freeContext(sws_context_);
+    }
+}
+
+void YUVConverter::configure(const Config& config) {
+    config_ = config;
+
+    // Started by the first native conversion; encoders fed GPU frames never need one
+    pool_.reset();
+}
+
+bool YUVConverter::convert(const uint8_t* rgb, int rgb_stride, const YUV420Planes& out) {
+    if (!rgb || !out.y || !out.u || !out.v || out.width <= 0 || out.height <= 0 ||
+        rgb_stride < out.width * 3) {
+        return false;
+    }
+
+    if (config_.backend == Backend::SWSCALE) {
+        return convert_swscale(rgb, rgb_stride, out);
+    }
+    return convert_native(rgb, rgb_stride, out);
+}
+
+bool YUVConverter::convert_native(const uint8_t* rgb, int rgb_stride, const YUV420Planes& out) {
+    const int pairs = (out.height + 1) / 2;
+
+    auto convert_rows = [&](size_t begin, size_t end) {
+        for (size_t pair = begin; pair < end; pair++) {
+            const int y0 = static_cast<int>(pair) * 2;
+            const int y1 = std::min(y0 + 1, out.height - 1);
+
+            RowPair row;
+            row.rgb0 = rgb + static_cast<size_t>(y0) * rgb_stride;
+            row.rgb1 = rgb + static_cast<size_t>(y1) * rgb_stride;
+            row.y0 = out.y + static_cast<size_t>(y0) * out.y_stride;
+            row.y1 = out.y + static_cast<size_t>(y1) * out.y_stride;
+            row.u = out.u + pair * out.u_stride;
+            row.v = out.v + pair * out.v_stride;
+            convert_pair(row, out.width);
+        }
+    };
+
+    if (!pool_ && config_.threads != 1) {
+        // ThreadPool counts workers, we count the caller too
+        pool_ = std::make_unique<ThreadPool>(config_.threads == 0 ? 0 : config_.threads - 1);
+    }
+    if (pool_) {
+        pool_->parallel_for(static_cast<size_t>(pairs), convert_rows, 16);
+    } else {
+        convert_rows(0, static_cast<size_t>(pairs));
+    }
+    return true;
+}
+
+bool YUVConverter::convert_swscale(const uint8_t* rgb, int rgb_stride, const YUV420Planes& out) {
+    sws_context_ = sws_getCachedContext(sws_context_,
+                                        out.width, out.height, AV_PIX_FMT_RGB24,
+                                        out.width, out.height, AV_PIX_FMT_YUV420P,
+                                        SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws_context_) {
+        BLUSTREAM_LOG_ERROR("Failed to create swscale context for " +
+                           std::to_string(out.width) + "x" + std::to_string(out.height));
+        return false;
+    }
+
+    if (out.width != sws_width_ || out.height != sws_height_) {
+        // RGB in, BT.601 limited-range YUV out, same as the native kernels
+        const int* bt601 = sws_getCoefficients(SWS_CS_ITU601);
+        sws_setColorspaceDetails(sws_context_, bt601, 1, bt601, 0, 0, 1 << 16, 1 << 16);
+        sws_width_ = out.width;
+        sws_height_ = out.height;
+    }
+
+    const uint8_t* src_planes[1] = {rgb};
+    const int src_strides[1] = {rgb_stride};
+    uint8_t* const dst_planes[3] = {out.y, out.u, out.v};
+    const int dst_strides[3] = {out.y_stride, out.u_stride, out.v_stride};
+
+    return sws_scale(sws_context_, src_planes, src_strides, 0, out.height, dst_planes, dst_strides) > 0;
+}
+
+bool YUVConverter::parse_backend(const std::string& name, Backend& backend) {
+    if (name == "native") {
+        backend = Backend::NATIVE;
+    } else if (name == "swscale" || name == "sws") {
+        backend = Backend::SWSCALE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string YUVConverter::backend_to_string(Backend backend) {
+    switch (backend) {
+        case Backend::NATIVE:  return "native";
+        case Backend::SWSCALE: return "swscale";
+        default:               return "unknown";
+    }
+}
+
+std::string YUVConverter::get_kernel_name() {
+#if BLUSTREAM_YUV_X86
+    return cpu_has_avx2() ? "avx2" : (cpu_has_sse41() ? "sse4.1" : "scalar");
+#elif BLUSTREAM_YUV_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace server
+} // namespace blustream